@@ -165,6 +165,13 @@ struct t_fileio* trx_get_fileio(t_trxstatus* status);
 float trx_get_time_of_final_frame(t_trxstatus* status);
 /* get time of final frame. Only supported for TNG and XTC */
 
+void trx_set_natoms_to_read(t_trxstatus* status, int natoms);
+/* Only read the first natoms atoms of subsequent frames, for file formats
+ * where that is faster than reading complete frames (currently XTC and memory-mapped TRR).
+ * Frames read in that way have fr->natoms equal to natoms, other formats
+ * still read all atoms. Pass 0 to read all atoms again.
+ */
+
 gmx_bool bRmod_fd(double a, double b, double c, gmx_bool bDouble);
 /* Returns TRUE when (a - b) MOD c = 0, using a margin which is slightly
  * larger than the float/double precision.
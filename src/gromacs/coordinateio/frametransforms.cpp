@@ -0,0 +1,166 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*!\internal
+ * \file
+ * \brief
+ * Implements frame transforms from frametransforms.h.
+ *
+ * \ingroup module_coordinateio
+ */
+
+#include "gmxpre.h"
+
+#include "frametransforms.h"
+
+#include <algorithm>
+
+#include "gromacs/math/do_fit.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/rmpbc.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+FrameAtomSubset::FrameAtomSubset(ArrayRef<const int> indices) :
+    indices_(indices.begin(), indices.end()), scratch_(indices.size())
+{
+}
+
+void FrameAtomSubset::transformFrame(t_trxframe* frame)
+{
+    for (const int index : indices_)
+    {
+        if (index < 0 || index >= frame->natoms)
+        {
+            GMX_THROW(InconsistentInputError(formatString(
+                    "Atom index %d is not in a frame with %d atoms", index + 1, frame->natoms)));
+        }
+    }
+    for (rvec* vectors : { frame->x, frame->v, frame->f })
+    {
+        if (vectors == nullptr)
+        {
+            continue;
+        }
+        for (size_t i = 0; i < indices_.size(); i++)
+        {
+            scratch_[i] = vectors[indices_[i]];
+        }
+        std::copy(scratch_.begin(), scratch_.end(), reinterpret_cast<RVec*>(vectors));
+    }
+    frame->natoms = gmx::ssize(indices_);
+    frame->bIndex = true;
+    frame->index  = indices_.data();
+}
+
+FrameMakeWhole::FrameMakeWhole(const InteractionDefinitions& idef, PbcType pbcType, int natoms) :
+    gpbc_(gmx_rmpbc_init(idef, pbcType, natoms))
+{
+}
+
+FrameMakeWhole::~FrameMakeWhole()
+{
+    gmx_rmpbc_done(gpbc_);
+}
+
+void FrameMakeWhole::transformFrame(t_trxframe* frame)
+{
+    gmx_rmpbc_trxfr(gpbc_, frame);
+}
+
+FrameFitToReference::FrameFitToReference(ArrayRef<const RVec> reference,
+                                         ArrayRef<const real> masses,
+                                         ArrayRef<const int>  fitIndices) :
+    reference_(reference.begin(), reference.end()),
+    weights_(reference.size(), 0),
+    fitIndices_(fitIndices.begin(), fitIndices.end())
+{
+    if (masses.size() != reference.size())
+    {
+        GMX_THROW(InconsistentInputError("Need one mass for each reference atom"));
+    }
+    if (fitIndices_.empty())
+    {
+        GMX_THROW(InconsistentInputError("Need at least one atom to fit on"));
+    }
+    for (const int index : fitIndices_)
+    {
+        if (index < 0 || index >= gmx::ssize(reference_))
+        {
+            GMX_THROW(InconsistentInputError(
+                    formatString("Fit atom %d is not in the reference structure", index + 1)));
+        }
+        weights_[index] = masses[index];
+    }
+    const RVec firstAtom = reference_[0];
+    reset_x(fitIndices_.size(),
+            fitIndices_.data(),
+            reference_.size(),
+            nullptr,
+            as_rvec_array(reference_.data()),
+            weights_.data());
+    referenceCenter_ = firstAtom - reference_[0];
+}
+
+void FrameFitToReference::transformFrame(t_trxframe* frame)
+{
+    if (!frame->bX)
+    {
+        GMX_THROW(InconsistentInputError("Can not fit a frame without coordinates"));
+    }
+    if (frame->natoms != gmx::ssize(reference_))
+    {
+        GMX_THROW(InconsistentInputError(formatString(
+                "Frame with %d atoms can not be fitted to a reference with %zu atoms",
+                frame->natoms,
+                reference_.size())));
+    }
+    reset_x(fitIndices_.size(),
+            fitIndices_.data(),
+            frame->natoms,
+            nullptr,
+            frame->x,
+            weights_.data());
+    do_fit(frame->natoms, weights_.data(), as_rvec_array(reference_.data()), frame->x);
+    for (int i = 0; i < frame->natoms; i++)
+    {
+        rvec_inc(frame->x[i], referenceCenter_);
+    }
+}
+
+} // namespace gmx
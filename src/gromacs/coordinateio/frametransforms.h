@@ -0,0 +1,163 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \file
+ * \brief
+ * Declares frame transforms for use with gmx::TrajectoryFrameReader.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+#ifndef GMX_COORDINATEIO_FRAMETRANSFORMS_H
+#define GMX_COORDINATEIO_FRAMETRANSFORMS_H
+
+#include <vector>
+
+#include "gromacs/coordinateio/iframetransform.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+class InteractionDefinitions;
+enum class PbcType : int;
+struct gmx_rmpbc;
+
+namespace gmx
+{
+
+/*!\brief
+ * Reduces a frame to a subset of its atoms.
+ *
+ * Coordinates, velocities and forces of the selected atoms are moved
+ * to the front of their arrays, in the order of the indices, and the
+ * frame index is set so that the original atom numbers are retained.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+class FrameAtomSubset : public IFrameTransform
+{
+public:
+    /*! \brief
+     * Construct the transform.
+     *
+     * \param[in] indices Zero-based indices of the atoms to keep.
+     */
+    explicit FrameAtomSubset(ArrayRef<const int> indices);
+
+    /*! \copydoc IFrameTransform::transformFrame
+     *
+     * \throws InconsistentInputError if an index is not in the frame.
+     */
+    void transformFrame(t_trxframe* frame) override;
+
+private:
+    //! Atoms to keep.
+    std::vector<int> indices_;
+    //! Scratch buffer for gathering vectors.
+    std::vector<RVec> scratch_;
+};
+
+/*!\brief
+ * Makes molecules whole that are broken over periodic boundaries.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+class FrameMakeWhole : public IFrameTransform
+{
+public:
+    /*! \brief
+     * Construct the transform.
+     *
+     * \param[in] idef    Interactions that define which atoms are bonded.
+     * \param[in] pbcType Type of the periodic boundary conditions.
+     * \param[in] natoms  Number of atoms in the frames.
+     */
+    FrameMakeWhole(const InteractionDefinitions& idef, PbcType pbcType, int natoms);
+    ~FrameMakeWhole() override;
+
+    void transformFrame(t_trxframe* frame) override;
+
+private:
+    //! Handle for the molecule connectivity.
+    gmx_rmpbc* gpbc_;
+};
+
+/*!\brief
+ * Superimposes frames on a reference structure.
+ *
+ * The centre of mass of the fit atoms is moved to that of the
+ * reference, after which the frame is rotated to minimize the mass
+ * weighted RMSD of the fit atoms from the reference.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+class FrameFitToReference : public IFrameTransform
+{
+public:
+    /*! \brief
+     * Construct the transform.
+     *
+     * \param[in] reference  Reference coordinates of all atoms.
+     * \param[in] masses     Masses of all atoms, used as fit weights.
+     * \param[in] fitIndices Zero-based indices of the atoms to fit on.
+     * \throws InconsistentInputError if the arguments do not match.
+     */
+    FrameFitToReference(ArrayRef<const RVec> reference,
+                        ArrayRef<const real> masses,
+                        ArrayRef<const int>  fitIndices);
+
+    /*! \copydoc IFrameTransform::transformFrame
+     *
+     * \throws InconsistentInputError if the frame size differs from
+     *         that of the reference.
+     */
+    void transformFrame(t_trxframe* frame) override;
+
+private:
+    //! Reference coordinates with the fit centre of mass at the origin.
+    std::vector<RVec> reference_;
+    //! Fit weights, zero for atoms that are not fitted.
+    std::vector<real> weights_;
+    //! Atoms to fit on.
+    std::vector<int> fitIndices_;
+    //! Centre of mass of the fit atoms in the reference.
+    RVec referenceCenter_;
+};
+
+} // namespace gmx
+
+#endif
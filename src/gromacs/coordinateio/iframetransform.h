@@ -0,0 +1,91 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \file
+ * \brief
+ * Declares gmx::IFrameTransform interface for modifying trajectory
+ * frames after they have been read from disk.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+#ifndef GMX_COORDINATEIO_IFRAMETRANSFORM_H
+#define GMX_COORDINATEIO_IFRAMETRANSFORM_H
+
+#include <memory>
+
+#include "gromacs/utility/classhelpers.h"
+
+struct t_trxframe;
+
+namespace gmx
+{
+
+/*!\brief
+ * Transform applied to each frame read by TrajectoryFrameReader.
+ *
+ * Transforms are called on the thread that prefetches frames, in the
+ * order in which they were added to the reader, and never concurrently
+ * with each other. Implementations can therefore keep scratch buffers
+ * as members, but must not share mutable state with the caller.
+ *
+ * \inlibraryapi
+ * \ingroup module_coordinateio
+ */
+class IFrameTransform
+{
+public:
+    IFrameTransform() {}
+    virtual ~IFrameTransform() {}
+
+    /*! \brief
+     * Change \p frame in place.
+     *
+     * The coordinate, velocity and force arrays of \p frame are owned
+     * by the reader and have room for the number of atoms in the file,
+     * so a transform can reduce, but not increase, \c natoms.
+     *
+     * \param[in,out] frame Frame that will be worked on.
+     */
+    virtual void transformFrame(t_trxframe* frame) = 0;
+
+    GMX_DISALLOW_COPY_AND_ASSIGN(IFrameTransform);
+};
+
+//! Smart pointer to manage the frame transform object.
+using FrameTransformPointer = std::unique_ptr<IFrameTransform>;
+
+} // namespace gmx
+
+#endif
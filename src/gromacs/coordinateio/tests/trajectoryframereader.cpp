@@ -0,0 +1,280 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*!\internal
+ * \file
+ * \brief
+ * Tests for gmx::TrajectoryFrameReader and the frame transforms.
+ *
+ * \ingroup module_coordinateio
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/coordinateio/trajectoryframereader.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/coordinateio/frametransforms.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/exceptions.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+//! Number of atoms in the test trajectory.
+constexpr int c_numAtoms = 4;
+//! Number of frames in the test trajectory.
+constexpr int c_numFrames = 7;
+
+//! Coordinates of \p atom in the first frame.
+RVec referencePosition(int atom)
+{
+    return { real(atom), real(atom * atom) * 0.5_real, real(1 - atom) };
+}
+
+//! Coordinates of all atoms in frame \p step.
+std::vector<RVec> framePositions(int step)
+{
+    std::vector<RVec> x(c_numAtoms);
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        x[i] = referencePosition(i) + RVec(step, 0, 0);
+    }
+    return x;
+}
+
+/*! \brief
+ * Writes a TRR file in which every frame is the reference structure
+ * shifted by the frame number along x.
+ */
+std::string writeTestTrajectory(TestFileManager* fileManager)
+{
+    std::string filename = fileManager->getTemporaryFilePath("frames.trr");
+    t_fileio*   fio      = gmx_trr_open(filename.c_str(), "w");
+    matrix      box      = { { 5, 0, 0 }, { 0, 5, 0 }, { 0, 0, 5 } };
+    for (int step = 0; step < c_numFrames; step++)
+    {
+        std::vector<RVec> x    = framePositions(step);
+        const real        time = 0.5_real * step;
+        gmx_trr_write_frame(
+                fio, step, time, 0, box, c_numAtoms, as_rvec_array(x.data()), nullptr, nullptr);
+    }
+    gmx_trr_close(fio);
+    return filename;
+}
+
+//! Writes the frames of writeTestTrajectory() to an XTC file.
+std::string writeTestXtcTrajectory(TestFileManager* fileManager)
+{
+    std::string filename = fileManager->getTemporaryFilePath("frames.xtc");
+    t_fileio*   fio      = open_xtc(filename.c_str(), "w");
+    matrix      box      = { { 5, 0, 0 }, { 0, 5, 0 }, { 0, 0, 5 } };
+    for (int step = 0; step < c_numFrames; step++)
+    {
+        std::vector<RVec> x = framePositions(step);
+        write_xtc(fio, c_numAtoms, step, 0.5_real * step, box, as_rvec_array(x.data()), 1000);
+    }
+    close_xtc(fio);
+    return filename;
+}
+
+//! Transform that throws when it sees a given step.
+class ThrowAtStep : public IFrameTransform
+{
+public:
+    explicit ThrowAtStep(int step) : step_(step) {}
+
+    void transformFrame(t_trxframe* frame) override
+    {
+        if (frame->step == step_)
+        {
+            GMX_THROW(InternalError("Transform failed"));
+        }
+    }
+
+private:
+    int step_;
+};
+
+//! Test fixture, parametrized on the number of frames to read ahead.
+class TrajectoryFrameReaderTest : public ::testing::TestWithParam<int>
+{
+public:
+    TrajectoryFrameReaderTest() : filename_(writeTestTrajectory(&fileManager_)) {}
+
+    //! Handles the temporary trajectory file.
+    TestFileManager fileManager_;
+    //! Name of the trajectory file.
+    std::string filename_;
+};
+
+TEST_P(TrajectoryFrameReaderTest, ReadsAllFramesInOrder)
+{
+    TrajectoryFrameReader reader(filename_, TRX_NEED_X, GetParam());
+    for (int step = 0; step < c_numFrames; step++)
+    {
+        const t_trxframe* frame = reader.readNextFrame();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(step, frame->step);
+        EXPECT_REAL_EQ(step * 0.5_real, frame->time);
+        ASSERT_EQ(c_numAtoms, frame->natoms);
+        EXPECT_REAL_EQ(referencePosition(c_numAtoms - 1)[XX] + step, frame->x[c_numAtoms - 1][XX]);
+        EXPECT_REAL_EQ(5, frame->box[ZZ][ZZ]);
+    }
+    EXPECT_EQ(reader.readNextFrame(), nullptr);
+    EXPECT_EQ(reader.readNextFrame(), nullptr);
+}
+
+TEST_P(TrajectoryFrameReaderTest, CanBeDestroyedBeforeTheEnd)
+{
+    TrajectoryFrameReader reader(filename_, TRX_NEED_X, GetParam());
+    ASSERT_NE(reader.readNextFrame(), nullptr);
+}
+
+TEST_P(TrajectoryFrameReaderTest, KeepsLastFrameAfterTheEnd)
+{
+    TrajectoryFrameReader reader(filename_, TRX_NEED_X, GetParam());
+    t_trxframe*           lastFrame = nullptr;
+    t_trxframe*           frame;
+    while ((frame = reader.readNextFrame()) != nullptr)
+    {
+        // Modifying a frame in place does not affect the later frames
+        EXPECT_REAL_EQ(referencePosition(0)[XX] + frame->step, frame->x[0][XX]);
+        frame->x[0][XX] = -1;
+        lastFrame       = frame;
+    }
+    ASSERT_NE(lastFrame, nullptr);
+    EXPECT_EQ(c_numFrames - 1, lastFrame->step);
+    EXPECT_REAL_EQ(-1, lastFrame->x[0][XX]);
+}
+
+TEST_P(TrajectoryFrameReaderTest, ReadsRequestedAtomsAfterFirstFrame)
+{
+    TrajectoryFrameReader reader(writeTestXtcTrajectory(&fileManager_), TRX_NEED_X, GetParam());
+    const t_trxframe*     frame = reader.readNextFrame();
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(c_numAtoms, frame->natoms);
+    reader.setNumAtomsToRead(2);
+    for (int step = 1; step < c_numFrames; step++)
+    {
+        frame = reader.readNextFrame();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(step, frame->step);
+        ASSERT_EQ(2, frame->natoms);
+        EXPECT_REAL_EQ_TOL(
+                referencePosition(1)[XX] + step, frame->x[1][XX], absoluteTolerance(1e-3));
+    }
+    EXPECT_EQ(reader.readNextFrame(), nullptr);
+}
+
+TEST_P(TrajectoryFrameReaderTest, SelectsAtomSubset)
+{
+    TrajectoryFrameReader  reader(filename_, TRX_NEED_X, GetParam());
+    const std::vector<int> indices = { 3, 1 };
+    reader.addTransform(std::make_unique<FrameAtomSubset>(indices));
+    for (int step = 0; step < c_numFrames; step++)
+    {
+        const t_trxframe* frame = reader.readNextFrame();
+        ASSERT_NE(frame, nullptr);
+        ASSERT_EQ(2, frame->natoms);
+        ASSERT_TRUE(frame->bIndex);
+        EXPECT_EQ(3, frame->index[0]);
+        EXPECT_EQ(1, frame->index[1]);
+        EXPECT_REAL_EQ(referencePosition(3)[YY], frame->x[0][YY]);
+        EXPECT_REAL_EQ(referencePosition(1)[XX] + step, frame->x[1][XX]);
+    }
+    EXPECT_EQ(reader.readNextFrame(), nullptr);
+}
+
+TEST_P(TrajectoryFrameReaderTest, FitsToReference)
+{
+    TrajectoryFrameReader   reader(filename_, TRX_NEED_X, GetParam());
+    std::vector<RVec>       reference;
+    const std::vector<real> masses(c_numAtoms, 1);
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        reference.push_back(referencePosition(i));
+    }
+    const std::vector<int> fitIndices = { 0, 1, 2, 3 };
+    reader.addTransform(std::make_unique<FrameFitToReference>(reference, masses, fitIndices));
+    const t_trxframe* frame;
+    while ((frame = reader.readNextFrame()) != nullptr)
+    {
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(reference[i][d], frame->x[i][d], absoluteTolerance(1e-5));
+            }
+        }
+    }
+}
+
+TEST_P(TrajectoryFrameReaderTest, RethrowsTransformErrorAfterEarlierFrames)
+{
+    TrajectoryFrameReader reader(filename_, TRX_NEED_X, GetParam());
+    reader.addTransform(std::make_unique<ThrowAtStep>(3));
+    for (int step = 0; step < 3; step++)
+    {
+        const t_trxframe* frame = reader.readNextFrame();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(step, frame->step);
+    }
+    EXPECT_THROW_GMX(reader.readNextFrame(), InternalError);
+}
+
+INSTANTIATE_TEST_CASE_P(WithFramesAhead, TrajectoryFrameReaderTest, ::testing::Values(0, 1, 3));
+
+} // namespace
+
+} // namespace test
+
+} // namespace gmx
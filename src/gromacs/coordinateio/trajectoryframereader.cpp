@@ -0,0 +1,386 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*!\internal
+ * \file
+ * \brief
+ * Implements gmx::TrajectoryFrameReader.
+ *
+ * \ingroup module_coordinateio
+ */
+
+#include "gmxpre.h"
+
+#include "trajectoryframereader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+/*! \brief
+ * Copies \p numAtoms vectors from \p source to \p storage.
+ *
+ * \returns Pointer to the copy, or nullptr when there is no source.
+ */
+rvec* copyVectors(const rvec* source, int numAtoms, std::vector<RVec>* storage)
+{
+    if (source == nullptr)
+    {
+        return nullptr;
+    }
+    storage->assign(source, source + numAtoms);
+    return as_rvec_array(storage->data());
+}
+
+//! Frame that owns the storage for its vectors.
+struct FrameBuffer
+{
+    //! Makes a deep copy of the vectors in \p source.
+    void assign(const t_trxframe& source)
+    {
+        frame = source;
+        /* The atoms belong to the file reader, and the index to a transform */
+        frame.bAtoms = false;
+        frame.atoms  = nullptr;
+        frame.bIndex = false;
+        frame.index  = nullptr;
+        frame.x      = copyVectors(source.bX ? source.x : nullptr, source.natoms, &x);
+        frame.v      = copyVectors(source.bV ? source.v : nullptr, source.natoms, &v);
+        frame.f      = copyVectors(source.bF ? source.f : nullptr, source.natoms, &f);
+    }
+
+    //! The frame returned to the caller.
+    t_trxframe frame;
+    //! Storage for the coordinates.
+    std::vector<RVec> x;
+    //! Storage for the velocities.
+    std::vector<RVec> v;
+    //! Storage for the forces.
+    std::vector<RVec> f;
+};
+
+} // namespace
+
+/*! \internal
+ * \brief
+ * Private implementation class for TrajectoryFrameReader.
+ *
+ * Buffers cycle between three states: free, ready for the caller and
+ * in use by the caller. The prefetch thread takes free buffers, fills
+ * them and appends them to the ready queue; readNextFrame() hands out
+ * ready buffers and returns the previous one to the free list.
+ */
+class TrajectoryFrameReader::Impl
+{
+public:
+    Impl(const std::string& filename, int flags, int numFramesAhead, const gmx_output_env_t* oenv);
+    ~Impl();
+
+    //! Implements TrajectoryFrameReader::setNumAtomsToRead().
+    void setNumAtomsToRead(int natoms);
+    //! Implements TrajectoryFrameReader::readNextFrame().
+    t_trxframe* readNextFrame();
+
+private:
+    /*! \brief
+     * Reads the next frame into \p buffer and applies the transforms.
+     *
+     * \returns false at the end of the trajectory.
+     */
+    bool prepareFrame(FrameBuffer* buffer);
+    //! Body of the prefetch thread.
+    void prefetchFrames();
+
+public:
+    //! Transforms applied to each frame, in order.
+    std::vector<FrameTransformPointer> transforms_;
+    //! Whether frames have been requested, after which transforms can not be added.
+    bool started_ = false;
+
+private:
+    //! Output environment needed by the trxio routines.
+    const gmx_output_env_t* oenv_;
+    //! Default output environment created when none was given, or nullptr.
+    gmx_output_env_t* ownOenv_ = nullptr;
+    //! Status of the open trajectory file.
+    t_trxstatus* status_ = nullptr;
+    //! Frame that the trxio routines read into.
+    t_trxframe readFrame_;
+    //! Whether readFrame_ still holds the frame read in the constructor.
+    bool haveFirstFrame_ = true;
+    //! Whether frames are read on a background thread.
+    bool readAhead_;
+    //! Storage for the frames, numFramesAhead + 1 of them.
+    std::vector<FrameBuffer> buffers_;
+    //! Buffer handed to the caller, or -1.
+    int current_ = -1;
+
+    //! Protects the buffer lists and the flags below.
+    std::mutex mutex_;
+    //! Signals that a frame is ready or reading has ended.
+    std::condition_variable frameReady_;
+    //! Signals that a buffer is free or the thread should stop.
+    std::condition_variable bufferFree_;
+    //! Buffers with prepared frames, in trajectory order.
+    std::deque<int> readyBuffers_;
+    //! Buffers that can be filled.
+    std::vector<int> freeBuffers_;
+    //! Whether the last frame has been prepared.
+    bool endOfTrajectory_ = false;
+    //! Whether the prefetch thread should stop.
+    bool stop_ = false;
+    //! Exception thrown while preparing a frame.
+    std::exception_ptr exception_;
+    //! The prefetch thread, started at the second read.
+    std::thread thread_;
+};
+
+TrajectoryFrameReader::Impl::Impl(const std::string&      filename,
+                                  int                     flags,
+                                  int                     numFramesAhead,
+                                  const gmx_output_env_t* oenv) :
+    oenv_(oenv), readAhead_(numFramesAhead > 0), buffers_(numFramesAhead + 1)
+{
+    GMX_RELEASE_ASSERT(numFramesAhead >= 0, "Number of frames to read ahead can not be negative");
+    if (oenv_ == nullptr)
+    {
+        output_env_init_default(&ownOenv_);
+        oenv_ = ownOenv_;
+    }
+    if (!read_first_frame(oenv_, &status_, filename.c_str(), &readFrame_, flags))
+    {
+        if (ownOenv_ != nullptr)
+        {
+            output_env_done(ownOenv_);
+        }
+        GMX_THROW(FileIOError(formatString("Could not read a frame from '%s'", filename.c_str())));
+    }
+    for (int i = numFramesAhead; i >= 0; i--)
+    {
+        freeBuffers_.push_back(i);
+    }
+}
+
+TrajectoryFrameReader::Impl::~Impl()
+{
+    if (thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        bufferFree_.notify_one();
+        thread_.join();
+    }
+    close_trx(status_);
+    done_frame(&readFrame_);
+    if (ownOenv_ != nullptr)
+    {
+        output_env_done(ownOenv_);
+    }
+}
+
+void TrajectoryFrameReader::Impl::setNumAtomsToRead(int natoms)
+{
+    GMX_RELEASE_ASSERT(!thread_.joinable(),
+                       "The number of atoms to read can not change while reading ahead");
+    trx_set_natoms_to_read(status_, natoms);
+}
+
+bool TrajectoryFrameReader::Impl::prepareFrame(FrameBuffer* buffer)
+{
+    if (haveFirstFrame_)
+    {
+        haveFirstFrame_ = false;
+    }
+    else if (!read_next_frame(oenv_, status_, &readFrame_))
+    {
+        return false;
+    }
+    buffer->assign(readFrame_);
+    for (auto& transform : transforms_)
+    {
+        transform->transformFrame(&buffer->frame);
+    }
+    return true;
+}
+
+void TrajectoryFrameReader::Impl::prefetchFrames()
+{
+    while (true)
+    {
+        int bufferIndex;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            bufferFree_.wait(lock, [this] { return !freeBuffers_.empty() || stop_; });
+            if (stop_)
+            {
+                return;
+            }
+            bufferIndex = freeBuffers_.back();
+            freeBuffers_.pop_back();
+        }
+
+        bool               haveFrame = false;
+        std::exception_ptr exception;
+        try
+        {
+            haveFrame = prepareFrame(&buffers_[bufferIndex]);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (haveFrame)
+            {
+                readyBuffers_.push_back(bufferIndex);
+            }
+            else
+            {
+                exception_       = exception;
+                endOfTrajectory_ = true;
+            }
+        }
+        frameReady_.notify_one();
+        if (!haveFrame)
+        {
+            return;
+        }
+    }
+}
+
+t_trxframe* TrajectoryFrameReader::Impl::readNextFrame()
+{
+    if (!readAhead_)
+    {
+        if (endOfTrajectory_)
+        {
+            return nullptr;
+        }
+        started_ = true;
+        if (!prepareFrame(&buffers_[0]))
+        {
+            endOfTrajectory_ = true;
+            return nullptr;
+        }
+        return &buffers_[0].frame;
+    }
+
+    if (!started_)
+    {
+        // The first frame was read in the constructor, so it only needs
+        // to be prepared. The thread is not started yet, such that the
+        // caller can still change what is read from the next frames.
+        started_              = true;
+        const int bufferIndex = freeBuffers_.back();
+        prepareFrame(&buffers_[bufferIndex]);
+        freeBuffers_.pop_back();
+        current_ = bufferIndex;
+        return &buffers_[current_].frame;
+    }
+    if (!thread_.joinable())
+    {
+        thread_ = std::thread([this] { prefetchFrames(); });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (current_ >= 0)
+    {
+        freeBuffers_.push_back(current_);
+        current_ = -1;
+        bufferFree_.notify_one();
+    }
+    frameReady_.wait(lock, [this] { return !readyBuffers_.empty() || endOfTrajectory_; });
+    if (!readyBuffers_.empty())
+    {
+        current_ = readyBuffers_.front();
+        readyBuffers_.pop_front();
+        return &buffers_[current_].frame;
+    }
+    if (exception_)
+    {
+        std::exception_ptr exception = exception_;
+        exception_                   = nullptr;
+        std::rethrow_exception(exception);
+    }
+    return nullptr;
+}
+
+TrajectoryFrameReader::TrajectoryFrameReader(const std::string&      filename,
+                                             int                     flags,
+                                             int                     numFramesAhead,
+                                             const gmx_output_env_t* oenv) :
+    impl_(new Impl(filename, flags, numFramesAhead, oenv))
+{
+}
+
+TrajectoryFrameReader::~TrajectoryFrameReader() = default;
+
+void TrajectoryFrameReader::addTransform(FrameTransformPointer transform)
+{
+    GMX_RELEASE_ASSERT(!impl_->started_, "Transforms must be added before reading frames");
+    impl_->transforms_.push_back(std::move(transform));
+}
+
+void TrajectoryFrameReader::setNumAtomsToRead(int natoms)
+{
+    impl_->setNumAtomsToRead(natoms);
+}
+
+t_trxframe* TrajectoryFrameReader::readNextFrame()
+{
+    return impl_->readNextFrame();
+}
+
+} // namespace gmx
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \file
+ * \brief
+ * Declares gmx::TrajectoryFrameReader, which reads trajectory frames
+ * ahead of their use on a background thread.
+ *
+ * \inpublicapi
+ * \ingroup module_coordinateio
+ */
+#ifndef GMX_COORDINATEIO_TRAJECTORYFRAMEREADER_H
+#define GMX_COORDINATEIO_TRAJECTORYFRAMEREADER_H
+
+#include <memory>
+#include <string>
+
+#include "gromacs/coordinateio/iframetransform.h"
+
+struct gmx_output_env_t;
+struct t_trxframe;
+
+namespace gmx
+{
+
+/*!\brief
+ * Reads frames from a trajectory file in sequence.
+ *
+ * Frames are read, and passed through the registered transforms, on
+ * a background thread while the caller works on earlier frames. At
+ * most \c numFramesAhead frames are prepared in advance, so the reader
+ * holds numFramesAhead + 1 frames of memory in total, independent of
+ * the length of the trajectory. With \c numFramesAhead equal to zero
+ * no thread is started and frames are read on demand.
+ *
+ * The frame returned by readNextFrame() belongs to the caller until the
+ * next call to readNextFrame(), so it can be modified in place, e.g., to
+ * make molecules whole. It remains valid until that call or until the
+ * reader is destroyed. After readNextFrame() has returned nullptr, the
+ * last frame stays valid until the reader is destroyed.
+ *
+ * The first frame is read in the constructor, so that errors in
+ * opening the file are reported there, and is returned by the first
+ * call to readNextFrame() without reading ahead. Reading ahead starts
+ * with the second call. Later read errors that are
+ * fatal in read_next_frame() remain fatal; exceptions thrown by
+ * transforms are rethrown from readNextFrame() after the frames that
+ * preceded the failing one have been returned.
+ *
+ * \inpublicapi
+ * \ingroup module_coordinateio
+ */
+class TrajectoryFrameReader
+{
+public:
+    /*! \brief
+     * Opens \p filename and reads the first frame.
+     *
+     * \param[in] filename       Name of the trajectory file.
+     * \param[in] flags          TRX_READ_* and TRX_NEED_* flags for read_first_frame().
+     * \param[in] numFramesAhead Number of frames to prepare in advance.
+     * \param[in] oenv           Output environment for the trxio routines,
+     *     which must outlive the reader, or nullptr to use a default one.
+     * \throws    FileIOError if no frame could be read.
+     */
+    TrajectoryFrameReader(const std::string&      filename,
+                          int                     flags,
+                          int                     numFramesAhead,
+                          const gmx_output_env_t* oenv = nullptr);
+    //! Stops reading ahead and closes the file.
+    ~TrajectoryFrameReader();
+
+    /*! \brief
+     * Adds \p transform to the end of the transforms applied to each frame.
+     *
+     * Can only be called before the first call to readNextFrame().
+     */
+    void addTransform(FrameTransformPointer transform);
+    /*! \brief
+     * Limits the atoms read from subsequent frames to the first \p natoms.
+     *
+     * Only has an effect for the formats supported by
+     * trx_set_natoms_to_read(). Can only be called before frames are read
+     * ahead, i.e., before the second call to readNextFrame().
+     */
+    void setNumAtomsToRead(int natoms);
+
+    /*! \brief
+     * Returns the next frame, or nullptr when the trajectory has ended.
+     *
+     * Makes the frame returned by the previous call available for reuse.
+     */
+    t_trxframe* readNextFrame();
+
+private:
+    class Impl;
+
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the FFT-based mean-square displacement calculator
+ *
+ * \ingroup module_correlationfunctions
+ */
+#include "gmxpre.h"
+
+#include "meansquaredisplacement.h"
+
+#include <algorithm>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+/*! \brief Returns the smallest even length >= \p minSize with only factors 2, 3, 5 and 7
+ *
+ * FFTs of such lengths are efficient with all supported FFT libraries.
+ */
+int niceFftSize(int minSize)
+{
+    for (int size = std::max(minSize + (minSize & 1), 2);; size += 2)
+    {
+        int remainder = size;
+        for (int factor : { 2, 3, 5, 7 })
+        {
+            while (remainder % factor == 0)
+            {
+                remainder /= factor;
+            }
+        }
+        if (remainder == 1)
+        {
+            return size;
+        }
+    }
+}
+
+} // namespace
+
+MsdFftCalculator::MsdFftCalculator(int numFrames) :
+    numFrames_(numFrames), fftSize_(0), fft_(nullptr)
+{
+    if (numFrames < 1)
+    {
+        GMX_THROW(InvalidInputError("Need at least one frame to compute displacements"));
+    }
+    /* Padding to at least twice the length avoids wrap-around in the correlation */
+    fftSize_ = niceFftSize(2 * numFrames_);
+    gmx_fft_init_1d_real(&fft_, fftSize_, GMX_FFT_FLAG_CONSERVATIVE);
+    /* In-place real transforms need room for fftSize_/2 + 1 complex numbers */
+    for (auto& transform : transform_)
+    {
+        transform.resize(fftSize_ + 2);
+    }
+    work_.resize(fftSize_ + 2);
+    haveTransform_.fill(false);
+}
+
+MsdFftCalculator::~MsdFftCalculator()
+{
+    gmx_fft_destroy(fft_);
+}
+
+void MsdFftCalculator::setPositions(ArrayRef<const RVec> x)
+{
+    GMX_RELEASE_ASSERT(x.ssize() == numFrames_, "Need positions for all frames");
+
+    x_ = x;
+    average_ = { 0, 0, 0 };
+    for (const RVec& v : x_)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            average_[d] += v[d];
+        }
+    }
+    average_ /= numFrames_;
+    haveTransform_.fill(false);
+}
+
+void MsdFftCalculator::transformDimension(int dim)
+{
+    std::vector<real>& transform = transform_[dim];
+    for (int t = 0; t < numFrames_; t++)
+    {
+        transform[t] = x_[t][dim] - average_[dim];
+    }
+    std::fill(transform.begin() + numFrames_, transform.end(), 0);
+    gmx_fft_1d_real(fft_, GMX_FFT_REAL_TO_COMPLEX, transform.data(), transform.data());
+    haveTransform_[dim] = true;
+}
+
+void MsdFftCalculator::addDisplacementProducts(int              dim1,
+                                               int              dim2,
+                                               double           weight,
+                                               ArrayRef<double> result)
+{
+    GMX_RELEASE_ASSERT(result.ssize() == numFrames_, "Need output for all frames");
+
+    for (int dim : { dim1, dim2 })
+    {
+        if (!haveTransform_[dim])
+        {
+            transformDimension(dim);
+        }
+    }
+
+    /* The spectrum conj(A) B + conj(B) A is real and symmetric, its inverse gives
+     * sum_t a(t) b(t+m) + b(t) a(t+m), unnormalized by the FFT library.
+     */
+    const std::vector<real>& a = transform_[dim1];
+    const std::vector<real>& b = transform_[dim2];
+    for (int k = 0; k <= fftSize_ / 2; k++)
+    {
+        work_[2 * k]     = 2 * (a[2 * k] * b[2 * k] + a[2 * k + 1] * b[2 * k + 1]) / fftSize_;
+        work_[2 * k + 1] = 0;
+    }
+    gmx_fft_1d_real(fft_, GMX_FFT_COMPLEX_TO_REAL, work_.data(), work_.data());
+
+    /* The remaining terms sum a(t) b(t) over t >= m and t < numFrames - m */
+    auto product = [this, dim1, dim2](int t) {
+        return (x_[t][dim1] - average_[dim1]) * (x_[t][dim2] - average_[dim2]);
+    };
+    double total = 0;
+    for (int t = 0; t < numFrames_; t++)
+    {
+        total += product(t);
+    }
+    /* Displacements at lag zero are zero, which we do not leave to rounding */
+    double head = total;
+    double tail = total;
+    for (int m = 1; m < numFrames_; m++)
+    {
+        tail -= product(m - 1);
+        head -= product(numFrames_ - m);
+        result[m] += weight * (head + tail - work_[m]) / (numFrames_ - m);
+    }
+}
+
+} // namespace gmx
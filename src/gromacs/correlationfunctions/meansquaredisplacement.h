@@ -0,0 +1,136 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal
+ * \file
+ * \brief
+ * Declares a class for computing mean-square displacements for all lag
+ * times with FFTs
+ *
+ * \inlibraryapi
+ * \ingroup module_correlationfunctions
+ */
+#ifndef GMX_MEANSQUAREDISPLACEMENT_H
+#define GMX_MEANSQUAREDISPLACEMENT_H
+
+#include <array>
+#include <vector>
+
+#include "gromacs/fft/fft.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief
+ * Computes displacement correlations of a single particle trajectory
+ * using every frame as time origin.
+ *
+ * For lag \f$m\f$ and dimensions \f$a,b\f$ the quantity
+ * \f[
+ *   \frac{1}{T-m}\sum_{t=0}^{T-m-1}
+ *     \left(x_a(t+m)-x_a(t)\right)\left(x_b(t+m)-x_b(t)\right)
+ * \f]
+ * is computed for all \f$0 \le m < T\f$ in \f$O(T \log T)\f$ operations
+ * by splitting it into sums over squares, which are accumulated directly,
+ * and a cross correlation, which is computed with a zero-padded real FFT.
+ * With \f$a=b\f$ this gives the mean-square displacement along \f$a\f$.
+ *
+ * Each component of the positions is centered on its average before
+ * transforming, which does not change the result but avoids losing
+ * precision to the absolute position of the particle.
+ *
+ * An object holds FFT plans and work buffers and is not thread-safe;
+ * use one object per thread.
+ */
+class MsdFftCalculator
+{
+public:
+    /*! \brief Sets up the FFT for trajectories of \p numFrames frames
+     *
+     * \throws InvalidInputError if \p numFrames is smaller than one.
+     */
+    explicit MsdFftCalculator(int numFrames);
+    ~MsdFftCalculator();
+
+    //! Returns the number of frames in the trajectories handled.
+    int numFrames() const { return numFrames_; }
+
+    /*! \brief Sets the particle trajectory to analyze
+     *
+     * \p x should contain numFrames() positions and should not contain
+     * jumps over periodic boundaries. Transforms of the components are
+     * computed lazily when first needed by addDisplacementProducts().
+     */
+    void setPositions(ArrayRef<const RVec> x);
+
+    /*! \brief Adds \p weight times the origin-averaged displacement
+     * product of dimensions \p dim1 and \p dim2 to \p result
+     *
+     * \p result should have numFrames() elements, element \c m receives
+     * the value for a lag of \c m frames.
+     */
+    void addDisplacementProducts(int dim1, int dim2, double weight, ArrayRef<double> result);
+
+private:
+    //! Computes the transform of dimension \p dim of the current positions
+    void transformDimension(int dim);
+
+    //! Number of frames
+    int numFrames_;
+    //! Length of the zero-padded transforms
+    int fftSize_;
+    //! FFT setup for real transforms of length fftSize_
+    gmx_fft_t fft_;
+    //! The positions to analyze
+    ArrayRef<const RVec> x_;
+    //! The average of each component of x_
+    DVec average_;
+    //! Whether the transform of each component of x_ is present in transform_
+    std::array<bool, DIM> haveTransform_;
+    //! Transforms of the centered components of x_, as fftSize_/2 + 1 complex numbers
+    std::array<std::vector<real>, DIM> transform_;
+    //! Work buffer for the product spectrum and the correlation
+    std::vector<real> work_;
+
+    GMX_DISALLOW_COPY_AND_ASSIGN(MsdFftCalculator);
+};
+
+} // namespace gmx
+
+#endif
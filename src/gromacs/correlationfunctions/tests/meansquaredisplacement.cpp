@@ -0,0 +1,131 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the FFT-based mean-square displacement calculator
+ *
+ * \ingroup module_correlationfunctions
+ */
+#include "gmxpre.h"
+
+#include "gromacs/correlationfunctions/meansquaredisplacement.h"
+
+#include <cmath>
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/real.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace
+{
+
+//! Returns a deterministic, irregular trajectory far from the origin
+std::vector<RVec> makeTrajectory(int numFrames)
+{
+    std::vector<RVec> x(numFrames);
+    RVec              pos(10.0, -4.0, 7.5);
+    for (int t = 0; t < numFrames; t++)
+    {
+        pos[XX] += 0.1 * std::sin(1.3 * t) + 0.01;
+        pos[YY] += 0.07 * std::cos(0.7 * t * t);
+        pos[ZZ] += 0.05 * std::sin(2.9 * t + 0.3) - 0.02;
+        x[t] = pos;
+    }
+    return x;
+}
+
+//! Computes the displacement products by looping over all time origins
+std::vector<double> directProducts(ArrayRef<const RVec> x, int dim1, int dim2)
+{
+    const int           numFrames = x.ssize();
+    std::vector<double> result(numFrames, 0);
+    for (int m = 0; m < numFrames; m++)
+    {
+        for (int t = 0; t + m < numFrames; t++)
+        {
+            result[m] += double(x[t + m][dim1] - x[t][dim1]) * (x[t + m][dim2] - x[t][dim2]);
+        }
+        result[m] /= numFrames - m;
+    }
+    return result;
+}
+
+class MsdFftCalculatorTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(MsdFftCalculatorTest, MatchesDirectSummation)
+{
+    const int               numFrames = GetParam();
+    const std::vector<RVec> x         = makeTrajectory(numFrames);
+    MsdFftCalculator        calculator(numFrames);
+    calculator.setPositions(x);
+
+    const std::pair<int, int> dimPairs[] = { { XX, XX }, { YY, YY }, { ZZ, ZZ },
+                                             { YY, XX }, { ZZ, XX }, { ZZ, YY } };
+    for (const auto& dims : dimPairs)
+    {
+        SCOPED_TRACE(formatString("dimensions %d %d", dims.first, dims.second));
+        std::vector<double> result(numFrames, 0);
+        calculator.addDisplacementProducts(dims.first, dims.second, 2.0, result);
+        const std::vector<double> reference = directProducts(x, dims.first, dims.second);
+        for (int m = 0; m < numFrames; m++)
+        {
+            const double tolerance = 1000 * GMX_REAL_EPS * (1 + std::abs(reference[m]));
+            EXPECT_NEAR(2.0 * reference[m], result[m], tolerance) << "lag " << m;
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(TrajectoryLengths,
+                        MsdFftCalculatorTest,
+                        ::testing::Values(1, 2, 17, 100, 331));
+
+TEST(MsdFftCalculatorErrorTest, ThrowsWithoutFrames)
+{
+    EXPECT_THROW_GMX(MsdFftCalculator calculator(0), InvalidInputError);
+}
+
+} // namespace
+} // namespace gmx
@@ -1243,6 +1243,16 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
            source file.
         */
 
+        /* Without grid communication, the grid unwrapping and the force
+         * gather can be done in the same thread parallel region as the FFTs
+         * and solve, which avoids the fork-join overhead and the serial
+         * x-overlap copy between these stages.
+         */
+        const bool gatherInFftRegion = (pme->nnodes == 1);
+
+        lambda  = grid_index < DO_Q ? lambda_q : lambda_lj;
+        bClearF = (bFirst && PAR(cr));
+
         /* Here we start a large thread parallel region */
 #pragma omp parallel num_threads(pme->nthread) private(thread)
         {
@@ -1319,6 +1329,27 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
                 }
 
                 copy_fftgrid_to_pmegrid(pme, fftgrid, grid, grid_index, pme->nthread, thread);
+
+                if (gatherInFftRegion)
+                {
+                    /* The unwrapping reads grid parts copied by other threads */
+#pragma omp barrier
+                    unwrap_periodic_pmegrid_x(pme, grid, pme->nthread, thread);
+#pragma omp barrier
+                    unwrap_periodic_pmegrid_yz(pme, grid, pme->nthread, thread);
+
+                    if (stepWork.computeForces)
+                    {
+                        /* interpolate forces for our local atoms */
+#pragma omp barrier
+                        gather_f_bsplines(pme,
+                                          grid,
+                                          bClearF,
+                                          &atc,
+                                          &atc.spline[thread],
+                                          pme->bFEP ? (grid_index % 2 == 0 ? 1.0 - lambda : lambda) : 1.0);
+                    }
+                }
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
@@ -1326,13 +1357,13 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
          * With MPI we have to synchronize here before gmx_sum_qgrid_dd.
          */
 
-        /* distribute local grid to all nodes */
-        if (pme->nnodes > 1)
+        if (!gatherInFftRegion)
         {
+            /* distribute local grid to all nodes */
             gmx_sum_qgrid_dd(pme, grid, GMX_SUM_GRID_BACKWARD);
-        }
 
-        unwrap_periodic_pmegrid(pme, grid);
+            unwrap_periodic_pmegrid(pme, grid);
+        }
 
         if (stepWork.computeForces)
         {
@@ -1343,21 +1374,22 @@ int gmx_pme_do(struct gmx_pme_t*              pme,
              * atc->f is the actual force array, not a buffer,
              * therefore we should not clear it.
              */
-            lambda  = grid_index < DO_Q ? lambda_q : lambda_lj;
-            bClearF = (bFirst && PAR(cr));
-#pragma omp parallel for num_threads(pme->nthread) schedule(static)
-            for (thread = 0; thread < pme->nthread; thread++)
+            if (!gatherInFftRegion)
             {
-                try
+#pragma omp parallel for num_threads(pme->nthread) schedule(static)
+                for (thread = 0; thread < pme->nthread; thread++)
                 {
-                    gather_f_bsplines(pme,
-                                      grid,
-                                      bClearF,
-                                      &atc,
-                                      &atc.spline[thread],
-                                      pme->bFEP ? (grid_index % 2 == 0 ? 1.0 - lambda : lambda) : 1.0);
+                    try
+                    {
+                        gather_f_bsplines(pme,
+                                          grid,
+                                          bClearF,
+                                          &atc,
+                                          &atc.spline[thread],
+                                          pme->bFEP ? (grid_index % 2 == 0 ? 1.0 - lambda : lambda) : 1.0);
+                    }
+                    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
                 }
-                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
             }
 
 
@@ -74,6 +74,8 @@ using namespace gmx; // TODO: Remove when this file is moved into gmx namespace
    For SIMD4 with unaligned load/store support:
      order 4 uses the order 4 unaligned SIMD template
      order 5 uses the order 4+5 aligned SIMD template
+   All other orders use the aligned SIMD4 runtime-order overload,
+   which is mostly useful for high orders with coarse grids.
  */
 struct do_fspline
 {
@@ -283,6 +285,85 @@ struct do_fspline
 
         return { reduce(fx_S), reduce(fy_S), reduce(fz_S) };
     }
+
+    /* This code assumes that the grid is allocated 4-real aligned
+     * and that pme->pmegrid_nz is a multiple of 4.
+     * This code supports any pme_order <= PME_ORDER_MAX, it is used
+     * for the orders without a compile-time specialization above.
+     */
+    RVec operator()(int order) const
+    {
+        const int norder = nn * order;
+        GMX_ASSERT(gridNZ % 4 == 0,
+                   "For aligned SIMD4 operations the grid size has to be padded up to a multiple "
+                   "of 4");
+        /* Pointer arithmetic alert, next six statements */
+        const real* const gmx_restrict thx  = spline->theta.coefficients[XX] + norder;
+        const real* const gmx_restrict thy  = spline->theta.coefficients[YY] + norder;
+        const real* const gmx_restrict thz  = spline->theta.coefficients[ZZ] + norder;
+        const real* const gmx_restrict dthx = spline->dtheta.coefficients[XX] + norder;
+        const real* const gmx_restrict dthy = spline->dtheta.coefficients[YY] + norder;
+        const real* const gmx_restrict dthz = spline->dtheta.coefficients[ZZ] + norder;
+
+        const int offset     = idxZ & 3;
+        const int numBlocksZ = (offset + order + 3) >> 2;
+
+        /* Zero-pad the z-splines to whole aligned blocks, so no masking is needed */
+        alignas(GMX_SIMD_ALIGNMENT) real tz_aligned[c_pmeMaxNumSimd4BlocksZ * GMX_SIMD4_WIDTH];
+        alignas(GMX_SIMD_ALIGNMENT) real dz_aligned[c_pmeMaxNumSimd4BlocksZ * GMX_SIMD4_WIDTH];
+        for (int i = 0; i < numBlocksZ * GMX_SIMD4_WIDTH; i++)
+        {
+            tz_aligned[i] = 0;
+            dz_aligned[i] = 0;
+        }
+        for (int ithz = 0; ithz < order; ithz++)
+        {
+            tz_aligned[offset + ithz] = thz[ithz];
+            dz_aligned[offset + ithz] = dthz[ithz];
+        }
+
+        Simd4Real tz_S[c_pmeMaxNumSimd4BlocksZ];
+        Simd4Real dz_S[c_pmeMaxNumSimd4BlocksZ];
+        for (int b = 0; b < numBlocksZ; b++)
+        {
+            tz_S[b] = load4(tz_aligned + b * GMX_SIMD4_WIDTH);
+            dz_S[b] = load4(dz_aligned + b * GMX_SIMD4_WIDTH);
+        }
+
+        Simd4Real fx_S = setZero();
+        Simd4Real fy_S = setZero();
+        Simd4Real fz_S = setZero();
+
+        for (int ithx = 0; (ithx < order); ithx++)
+        {
+            const int       index_x = (idxX + ithx) * gridNY * gridNZ;
+            const Simd4Real tx_S    = Simd4Real(thx[ithx]);
+            const Simd4Real dx_S    = Simd4Real(dthx[ithx]);
+
+            for (int ithy = 0; (ithy < order); ithy++)
+            {
+                const real* const gridLine = grid + index_x + (idxY + ithy) * gridNZ + idxZ - offset;
+                const Simd4Real   ty_S     = Simd4Real(thy[ithy]);
+                const Simd4Real   dy_S     = Simd4Real(dthy[ithy]);
+
+                Simd4Real fxy1_S = setZero();
+                Simd4Real fz1_S  = setZero();
+                for (int b = 0; b < numBlocksZ; b++)
+                {
+                    const Simd4Real gval_S = load4(gridLine + b * GMX_SIMD4_WIDTH);
+
+                    fxy1_S = fma(tz_S[b], gval_S, fxy1_S);
+                    fz1_S  = fma(dz_S[b], gval_S, fz1_S);
+                }
+
+                fx_S = fma(dx_S * ty_S, fxy1_S, fx_S);
+                fy_S = fma(tx_S * dy_S, fxy1_S, fy_S);
+                fz_S = fma(tx_S * ty_S, fz1_S, fz_S);
+            }
+        }
+
+        return { reduce(fx_S), reduce(fy_S), reduce(fz_S) };
+    }
 #endif
 private:
     const gmx_pme_t* const pme;
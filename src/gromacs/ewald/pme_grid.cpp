@@ -480,65 +480,64 @@ void wrap_periodic_pmegrid(const gmx_pme_t* pme, real* pmegrid)
 }
 
 
-void unwrap_periodic_pmegrid(struct gmx_pme_t* pme, real* pmegrid)
+void unwrap_periodic_pmegrid_x(const gmx_pme_t* pme, real* pmegrid, int nthread, int thread)
 {
-    int nx, ny, nz, pny, pnz, ny_x, overlap, ix;
-
-    nx = pme->nkx;
-    ny = pme->nky;
-    nz = pme->nkz;
+    if (pme->nnodes_major != 1)
+    {
+        return;
+    }
 
-    pny = pme->pmegrid_ny;
-    pnz = pme->pmegrid_nz;
+    const int nx      = pme->nkx;
+    const int nz      = pme->nkz;
+    const int pny     = pme->pmegrid_ny;
+    const int pnz     = pme->pmegrid_nz;
+    const int overlap = pme->pme_order - 1;
+    const int ny_x    = (pme->nnodes_minor == 1 ? pme->nky : pme->pmegrid_ny);
 
-    overlap = pme->pme_order - 1;
+    /* The overlap in x is only pme_order - 1 wide, so we divide over y */
+    const int iy0 = (thread * ny_x) / nthread;
+    const int iy1 = ((thread + 1) * ny_x) / nthread;
 
-    if (pme->nnodes_major == 1)
+    for (int ix = 0; ix < overlap; ix++)
     {
-        ny_x = (pme->nnodes_minor == 1 ? ny : pme->pmegrid_ny);
-
-        for (ix = 0; ix < overlap; ix++)
+        for (int iy = iy0; iy < iy1; iy++)
         {
-            int iy, iz;
-
-            for (iy = 0; iy < ny_x; iy++)
+            for (int iz = 0; iz < nz; iz++)
             {
-                for (iz = 0; iz < nz; iz++)
-                {
-                    pmegrid[((nx + ix) * pny + iy) * pnz + iz] = pmegrid[(ix * pny + iy) * pnz + iz];
-                }
+                pmegrid[((nx + ix) * pny + iy) * pnz + iz] = pmegrid[(ix * pny + iy) * pnz + iz];
             }
         }
     }
+}
 
-    if (pme->nnodes_minor == 1)
+void unwrap_periodic_pmegrid_yz(const gmx_pme_t* pme, real* pmegrid, int nthread, int thread)
+{
+    const int ny      = pme->nky;
+    const int nz      = pme->nkz;
+    const int pny     = pme->pmegrid_ny;
+    const int pnz     = pme->pmegrid_nz;
+    const int overlap = pme->pme_order - 1;
+
+    const int ix0 = (thread * pme->pmegrid_nx) / nthread;
+    const int ix1 = ((thread + 1) * pme->pmegrid_nx) / nthread;
+
+    for (int ix = ix0; ix < ix1; ix++)
     {
-#pragma omp parallel for num_threads(pme->nthread) schedule(static)
-        for (ix = 0; ix < pme->pmegrid_nx; ix++)
+        if (pme->nnodes_minor == 1)
         {
-            // Trivial OpenMP region that does not throw, no need for try/catch
-            int iy, iz;
-
-            for (iy = 0; iy < overlap; iy++)
+            for (int iy = 0; iy < overlap; iy++)
             {
-                for (iz = 0; iz < nz; iz++)
+                for (int iz = 0; iz < nz; iz++)
                 {
                     pmegrid[(ix * pny + ny + iy) * pnz + iz] = pmegrid[(ix * pny + iy) * pnz + iz];
                 }
             }
         }
-    }
 
-    /* Copy periodic overlap in z */
-#pragma omp parallel for num_threads(pme->nthread) schedule(static)
-    for (ix = 0; ix < pme->pmegrid_nx; ix++)
-    {
-        // Trivial OpenMP region that does not throw, no need for try/catch
-        int iy, iz;
-
-        for (iy = 0; iy < pme->pmegrid_ny; iy++)
+        /* Copy periodic overlap in z, this uses the y-overlap of the same x-plane set above */
+        for (int iy = 0; iy < pme->pmegrid_ny; iy++)
         {
-            for (iz = 0; iz < overlap; iz++)
+            for (int iz = 0; iz < overlap; iz++)
             {
                 pmegrid[(ix * pny + iy) * pnz + nz + iz] = pmegrid[(ix * pny + iy) * pnz + iz];
             }
@@ -546,14 +545,23 @@ void unwrap_periodic_pmegrid(struct gmx_pme_t* pme, real* pmegrid)
     }
 }
 
+void unwrap_periodic_pmegrid(struct gmx_pme_t* pme, real* pmegrid)
+{
+    unwrap_periodic_pmegrid_x(pme, pmegrid, 1, 0);
+
+#pragma omp parallel for num_threads(pme->nthread) schedule(static)
+    for (int thread = 0; thread < pme->nthread; thread++)
+    {
+        // Trivial OpenMP region that does not throw, no need for try/catch
+        unwrap_periodic_pmegrid_yz(pme, pmegrid, pme->nthread, thread);
+    }
+}
+
 void set_grid_alignment(int gmx_unused* pmegrid_nz, int gmx_unused pme_order)
 {
 #ifdef PME_SIMD4_SPREAD_GATHER
-    if (pme_order == 5
-#    if !PME_4NSIMD_GATHER
-        || pme_order == 4
-#    endif
-    )
+    /* All orders, apart from 4 with 4N SIMD gather, use aligned SIMD4 */
+    if (pme_order != 4 || !PME_4NSIMD_GATHER)
     {
         /* Round nz up to a multiple of 4 to ensure alignment */
         *pmegrid_nz = ((*pmegrid_nz + 3) & ~3);
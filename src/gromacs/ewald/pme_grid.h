@@ -67,6 +67,18 @@ void wrap_periodic_pmegrid(const gmx_pme_t* pme, real* pmegrid);
 
 void unwrap_periodic_pmegrid(gmx_pme_t* pme, real* pmegrid);
 
+/*! \brief Copies the periodic images along x of \p pmegrid, part \p thread of \p nthread
+ *
+ * Together with unwrap_periodic_pmegrid_yz() this does the work of
+ * unwrap_periodic_pmegrid() from within an existing thread-parallel
+ * region. All threads need to complete this call before any thread
+ * calls unwrap_periodic_pmegrid_yz().
+ */
+void unwrap_periodic_pmegrid_x(const gmx_pme_t* pme, real* pmegrid, int nthread, int thread);
+
+//! Copies the periodic images along y and z of \p pmegrid, part \p thread of \p nthread
+void unwrap_periodic_pmegrid_yz(const gmx_pme_t* pme, real* pmegrid, int nthread, int thread);
+
 void pmegrid_init(pmegrid_t* grid,
                   int        cx,
                   int        cy,
@@ -103,6 +103,12 @@ static const real lb_scale_factor_symm[] = { 2.0 / 64, 12.0 / 64, 30.0 / 64, 20.
  */
 #define PME_ORDER_MAX 12
 
+/*! \brief The maximum number of aligned 4-real blocks covering the spline of one atom along z
+ *
+ * The aligned start of the blocks can be up to 3 grid points before the atom index.
+ */
+constexpr int c_pmeMaxNumSimd4BlocksZ = (3 + PME_ORDER_MAX + 3) / 4;
+
 
 /* Temporary suppression until these structs become opaque and don't live in
  * a header that is included by other headers. Also, until then I have no
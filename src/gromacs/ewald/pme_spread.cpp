@@ -322,6 +322,71 @@ static void make_bsplines(splinevec  theta,
     }
 
 
+#ifdef PME_SIMD4_SPREAD_GATHER
+/*! \brief Spreads one coefficient with SIMD4 for pme_order other than 4 and 5
+ *
+ * This is mainly intended for high orders, up to PME_ORDER_MAX, which
+ * are used with coarse grids.
+ *
+ * This code assumes that the grid is allocated 4-real aligned
+ * and that pnz is a multiple of 4. The z-spline is zero-padded
+ * to whole 4-real aligned blocks, so the grid is updated without
+ * masking.
+ */
+static void spreadCoefficientAnyOrderSimd4(real* gmx_restrict grid,
+                                           int                pny,
+                                           int                pnz,
+                                           int                order,
+                                           int                i0,
+                                           int                j0,
+                                           int                k0,
+                                           real               coefficient,
+                                           const real*        thx,
+                                           const real*        thy,
+                                           const real*        thz)
+{
+    using namespace gmx;
+
+    const int offset     = k0 & 3;
+    const int numBlocksZ = (offset + order + 3) >> 2;
+    real*     gridStartZ = grid + k0 - offset;
+
+    alignas(GMX_SIMD_ALIGNMENT) real thz_aligned[c_pmeMaxNumSimd4BlocksZ * GMX_SIMD4_WIDTH];
+    for (int i = 0; i < numBlocksZ * GMX_SIMD4_WIDTH; i++)
+    {
+        thz_aligned[i] = 0;
+    }
+    for (int ithz = 0; ithz < order; ithz++)
+    {
+        thz_aligned[offset + ithz] = thz[ithz];
+    }
+
+    Simd4Real tz_S[c_pmeMaxNumSimd4BlocksZ];
+    for (int b = 0; b < numBlocksZ; b++)
+    {
+        tz_S[b] = load4(thz_aligned + b * GMX_SIMD4_WIDTH);
+    }
+
+    for (int ithx = 0; ithx < order; ithx++)
+    {
+        const int  index_x = (i0 + ithx) * pny * pnz;
+        const real valx    = coefficient * thx[ithx];
+
+        for (int ithy = 0; ithy < order; ithy++)
+        {
+            const Simd4Real vxy_S    = Simd4Real(valx * thy[ithy]);
+            real*           gridLine = gridStartZ + index_x + (j0 + ithy) * pnz;
+
+            for (int b = 0; b < numBlocksZ; b++)
+            {
+                real* gridBlock = gridLine + b * GMX_SIMD4_WIDTH;
+                store4(gridBlock, fma(vxy_S, tz_S[b], load4(gridBlock)));
+            }
+        }
+    }
+}
+#endif
+
 static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
                                                 const PmeAtomComm*     atc,
                                                 splinedata_t*          spline,
@@ -330,14 +395,20 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
 
     /* spread coefficients from home atoms to local grid */
     real*      grid;
-    int        i, nn, n, ithx, ithy, ithz, i0, j0, k0;
+    int        i, nn, n, ithx, i0, j0, k0;
     const int* idxptr;
-    int        order, norder, index_x, index_xy, index_xyz;
-    real       valx, valxy, coefficient;
+    int        order, norder, index_x;
+    real       valx, coefficient;
     real *     thx, *thy, *thz;
     int        pnx, pny, pnz, ndatatot;
     int        offx, offy, offz;
 
+#ifndef PME_SIMD4_SPREAD_GATHER
+    /* Only used by the scalar DO_BSPLINE loops */
+    int  ithy, ithz, index_xy, index_xyz;
+    real valxy;
+#endif
+
 #if defined PME_SIMD4_SPREAD_GATHER && !defined PME_SIMD4_UNALIGNED
     alignas(GMX_SIMD_ALIGNMENT) real thz_aligned[GMX_SIMD4_WIDTH * 2];
 #endif
@@ -401,7 +472,14 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
                     DO_BSPLINE(5)
 #endif
                     break;
-                default: DO_BSPLINE(order) break;
+                default:
+#ifdef PME_SIMD4_SPREAD_GATHER
+                    spreadCoefficientAnyOrderSimd4(
+                            grid, pny, pnz, order, i0, j0, k0, coefficient, thx, thy, thz);
+#else
+                    DO_BSPLINE(order)
+#endif
+                    break;
             }
         }
     }
@@ -42,7 +42,9 @@
 
 #include "gmxpre.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -74,6 +76,8 @@ std::vector<Matrix3x3> const c_sampleBoxes{
 
 //! A couple of valid inputs for grid sizes
 std::vector<IVec> const c_sampleGridSizes{ IVec{ 16, 12, 14 }, IVec{ 13, 15, 11 } };
+//! Grid sizes that are valid for all PME orders, with z-sizes that need padding for SIMD4
+std::vector<IVec> const c_sampleGridSizesHighOrder{ IVec{ 24, 22, 25 }, IVec{ 23, 27, 22 } };
 //! Random charges
 std::vector<real> const c_sampleChargesFull{ 4.95F, 3.11F, 3.97F, 1.08F, 2.09F, 1.1F,
                                              4.13F, 3.31F, 2.8F,  5.83F, 5.09F, 6.1F,
@@ -179,9 +183,26 @@ std::vector<RVec> const c_sampleForcesFull{
 
 //! PME orders to test
 std::vector<int> const pmeOrders{ 3, 4, 5 };
+//! PME orders to test that require larger grids
+std::vector<int> const pmeOrdersHigh{ 6, 8, 12 };
 //! Atom counts to test
 std::vector<size_t> const atomCounts{ 1, 2, 13 };
 
+/*! \brief Returns \p values repeated until there are at least \p size elements
+ *
+ * Lets the sample spline data above, which covers PME orders up to 5,
+ * also provide input for the higher orders.
+ */
+std::vector<real> repeatToSize(const std::vector<real>& values, size_t size)
+{
+    std::vector<real> repeated;
+    while (repeated.size() < size)
+    {
+        repeated.insert(repeated.end(), values.begin(), values.end());
+    }
+    return repeated;
+}
+
 /* Helper structures for test input */
 
 //! A structure for all the spline data which depends in size both on the PME order and atom count
@@ -223,12 +244,21 @@ class PmeGatherTest : public ::testing::TestWithParam<GatherInputParameters>
 private:
     //! Storage of all the input atom datasets
     static InputDataByAtomCount s_inputAtomDataSets_;
+    //! The sample spline values, repeated to cover the highest PME order
+    static std::vector<real> s_splineValues_;
+    //! The sample spline derivatives, repeated to cover the highest PME order
+    static std::vector<real> s_splineDerivatives_;
 
 public:
     PmeGatherTest() = default;
     //! Sets the input atom data references and programs once
     static void SetUpTestCase()
     {
+        const size_t maxAtomCount = *std::max_element(atomCounts.begin(), atomCounts.end());
+        const size_t splineSize   = DIM * maxAtomCount * pmeOrdersHigh.back();
+        s_splineValues_           = repeatToSize(c_sampleSplineValuesFull, splineSize);
+        s_splineDerivatives_      = repeatToSize(c_sampleSplineDerivativesFull, splineSize);
+
         size_t start = 0;
         for (auto atomCount : atomCounts)
         {
@@ -239,16 +269,18 @@ public:
             start += atomCount;
             atomData.coordinates.resize(atomCount, RVec{ 1e6, 1e7, -1e8 });
             /* The coordinates are intentionally bogus in this test - only the size matters; the gridline indices are fed directly as inputs */
-            for (auto pmeOrder : pmeOrders)
+            std::vector<int> allPmeOrders(pmeOrders);
+            allPmeOrders.insert(allPmeOrders.end(), pmeOrdersHigh.begin(), pmeOrdersHigh.end());
+            for (auto pmeOrder : allPmeOrders)
             {
                 AtomAndPmeOrderSizedData splineData;
                 const size_t             dimSize = atomCount * pmeOrder;
                 for (int dimIndex = 0; dimIndex < DIM; dimIndex++)
                 {
                     splineData.splineValues[dimIndex] =
-                            SplineParamsDimVector(c_sampleSplineValuesFull).subArray(dimIndex * dimSize, dimSize);
+                            SplineParamsDimVector(s_splineValues_).subArray(dimIndex * dimSize, dimSize);
                     splineData.splineDerivatives[dimIndex] =
-                            SplineParamsDimVector(c_sampleSplineDerivativesFull).subArray(dimIndex * dimSize, dimSize);
+                            SplineParamsDimVector(s_splineDerivatives_).subArray(dimIndex * dimSize, dimSize);
                 }
                 atomData.splineDataByPmeOrder[pmeOrder] = splineData;
             }
@@ -365,6 +397,8 @@ std::vector<std::unique_ptr<PmeTestHardwareContext>> PmeGatherTest::s_pmeTestHar
 
 // An instance of static atom data
 InputDataByAtomCount PmeGatherTest::s_inputAtomDataSets_;
+std::vector<real>    PmeGatherTest::s_splineValues_;
+std::vector<real>    PmeGatherTest::s_splineDerivatives_;
 
 //! Test for PME force gathering
 TEST_P(PmeGatherTest, ReproducesOutputs)
@@ -381,6 +415,15 @@ INSTANTIATE_TEST_CASE_P(SaneInput,
                                            ::testing::ValuesIn(c_sampleGrids),
                                            ::testing::ValuesIn(atomCounts)));
 
+//! Instantiation of the PME gathering test for the higher PME orders
+INSTANTIATE_TEST_CASE_P(HighOrderInput,
+                        PmeGatherTest,
+                        ::testing::Combine(::testing::ValuesIn(c_sampleBoxes),
+                                           ::testing::ValuesIn(pmeOrdersHigh),
+                                           ::testing::ValuesIn(c_sampleGridSizesHighOrder),
+                                           ::testing::ValuesIn(c_sampleGrids),
+                                           ::testing::ValuesIn(atomCounts)));
+
 } // namespace
 } // namespace test
 } // namespace gmx
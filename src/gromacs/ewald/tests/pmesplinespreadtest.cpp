@@ -300,6 +300,8 @@ std::vector<Matrix3x3> const c_sampleBoxes{
 
 //! A couple of valid inputs for grid sizes.
 std::vector<IVec> const c_sampleGridSizes{ IVec{ 16, 12, 14 }, IVec{ 19, 17, 11 } };
+//! Grid sizes that are valid for all PME orders, with z-sizes that need padding for SIMD4
+std::vector<IVec> const c_sampleGridSizesHighOrder{ IVec{ 24, 22, 25 }, IVec{ 23, 27, 22 } };
 
 //! Random charges
 std::vector<real> const c_sampleChargesFull{ 4.95F, 3.11F, 3.97F, 1.08F, 2.09F, 1.1F,
@@ -370,6 +372,10 @@ auto c_inputBoxes = ::testing::ValuesIn(c_sampleBoxes);
 auto c_inputPmeOrders = ::testing::Range(3, 5 + 1);
 //! moved out from instantiantions for readability
 auto c_inputGridSizes = ::testing::ValuesIn(c_sampleGridSizes);
+//! PME orders that require larger grids than c_sampleGridSizes
+auto c_inputPmeOrdersHigh = ::testing::Values(6, 8, 12);
+//! moved out from instantiantions for readability
+auto c_inputGridSizesHighOrder = ::testing::ValuesIn(c_sampleGridSizesHighOrder);
 
 /*! \brief Instantiation of the test with valid input and 1 atom */
 INSTANTIATE_TEST_CASE_P(SaneInput1,
@@ -396,6 +402,33 @@ INSTANTIATE_TEST_CASE_P(SaneInput13,
                                            c_inputGridSizes,
                                            ::testing::Values(c_sampleCoordinates13),
                                            ::testing::Values(c_sampleCharges13)));
+
+/*! \brief Instantiation of the test with valid input, 1 atom and high PME orders */
+INSTANTIATE_TEST_CASE_P(HighOrderInput1,
+                        PmeSplineAndSpreadTest,
+                        ::testing::Combine(c_inputBoxes,
+                                           c_inputPmeOrdersHigh,
+                                           c_inputGridSizesHighOrder,
+                                           ::testing::Values(c_sampleCoordinates1),
+                                           ::testing::Values(c_sampleCharges1)));
+
+/*! \brief Instantiation of the test with valid input, 2 atoms and high PME orders */
+INSTANTIATE_TEST_CASE_P(HighOrderInput2,
+                        PmeSplineAndSpreadTest,
+                        ::testing::Combine(c_inputBoxes,
+                                           c_inputPmeOrdersHigh,
+                                           c_inputGridSizesHighOrder,
+                                           ::testing::Values(c_sampleCoordinates2),
+                                           ::testing::Values(c_sampleCharges2)));
+
+/*! \brief Instantiation of the test with valid input, 13 atoms and high PME orders */
+INSTANTIATE_TEST_CASE_P(HighOrderInput13,
+                        PmeSplineAndSpreadTest,
+                        ::testing::Combine(c_inputBoxes,
+                                           c_inputPmeOrdersHigh,
+                                           c_inputGridSizesHighOrder,
+                                           ::testing::Values(c_sampleCoordinates13),
+                                           ::testing::Values(c_sampleCharges13)));
 } // namespace
 } // namespace test
 } // namespace gmx
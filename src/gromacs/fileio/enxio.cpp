@@ -94,6 +94,9 @@ struct ener_file
     t_fileio*  fio;
     int        framenr;
     real       frametime;
+    int        nReadTerm;   /* Number of entries in bReadTerm, 0 reads all terms */
+    gmx_bool*  bReadTerm;   /* Which energy terms to read, when nReadTerm > 0 */
+    gmx_bool   bSkipBlocks; /* Whether to skip the block data of frames */
 };
 
 static void enxsubblock_init(t_enxsubblock* sb)
@@ -777,6 +780,7 @@ void done_ener_file(ener_file_t ef)
 {
     // Free the contents, then the pointer itself
     close_enx(ef);
+    sfree(ef->bReadTerm);
     sfree(ef);
 }
 
@@ -876,8 +880,11 @@ ener_file_t open_enx(const char* fn, const char* mode)
         ef->fio = gmx_fio_open(fn, mode);
     }
 
-    ef->framenr   = 0;
-    ef->frametime = 0;
+    ef->framenr     = 0;
+    ef->frametime   = 0;
+    ef->nReadTerm   = 0;
+    ef->bReadTerm   = nullptr;
+    ef->bSkipBlocks = FALSE;
     return ef;
 }
 
@@ -886,6 +893,90 @@ t_fileio* enx_file_pointer(const ener_file* ef)
     return ef->fio;
 }
 
+void enx_set_data_to_read(ener_file_t ef, int nre, const gmx_bool* bReadTerm, gmx_bool bSkipBlocks)
+{
+    sfree(ef->bReadTerm);
+    ef->bReadTerm = nullptr;
+    ef->nReadTerm = 0;
+    if (nre > 0)
+    {
+        snew(ef->bReadTerm, nre);
+        std::copy(bReadTerm, bReadTerm + nre, ef->bReadTerm);
+        ef->nReadTerm = nre;
+    }
+    ef->bSkipBlocks = bSkipBlocks;
+}
+
+//! Moves the read position of \p fio \p numBytes forward, returns whether that succeeded
+static gmx_bool skip_bytes(t_fileio* fio, gmx_off_t numBytes)
+{
+    return gmx_fio_seek(fio, gmx_fio_ftell(fio) + numBytes) == 0;
+}
+
+/*! \brief Returns the size in bytes of an item of an XDR subblock type
+ *
+ * Returns 0 for types with items of variable size, which cannot be skipped.
+ */
+static int xdr_item_size(xdr_datatype type)
+{
+    switch (type)
+    {
+        case xdr_datatype_float: return 4;
+        case xdr_datatype_double: return 8;
+        case xdr_datatype_int: return 4;
+        case xdr_datatype_int64: return 8;
+        default: return 0;
+    }
+}
+
+/*! \brief Reads the energy terms selected with enx_set_data_to_read()
+ *
+ * Runs of terms that are not selected are skipped in the file in one
+ * seek and are set to zero in \p fr. \p realSize is the size of a
+ * real in the file.
+ */
+static gmx_bool read_selected_energies(ener_file_t ef, t_enxframe* fr, int realSize)
+{
+    /* Sums of length 1 are not stored */
+    const int nrealPerTerm = (fr->nsum > 0) ? 3 : 1;
+    gmx_bool  bOK          = TRUE;
+    int       i            = 0;
+
+    while (bOK && i < fr->nre)
+    {
+        if (i < ef->nReadTerm && !ef->bReadTerm[i])
+        {
+            int iEnd = i + 1;
+            while (iEnd < std::min(fr->nre, ef->nReadTerm) && !ef->bReadTerm[iEnd])
+            {
+                iEnd++;
+            }
+            bOK = skip_bytes(ef->fio, static_cast<gmx_off_t>(iEnd - i) * nrealPerTerm * realSize);
+            for (; i < iEnd; i++)
+            {
+                fr->ener[i].e    = 0;
+                fr->ener[i].eav  = 0;
+                fr->ener[i].esum = 0;
+            }
+        }
+        else
+        {
+            bOK = gmx_fio_do_real(ef->fio, fr->ener[i].e);
+            if (nrealPerTerm == 3)
+            {
+                real eav, esum;
+                bOK = bOK && gmx_fio_do_real(ef->fio, eav);
+                bOK = bOK && gmx_fio_do_real(ef->fio, esum);
+                fr->ener[i].eav  = eav;
+                fr->ener[i].esum = esum;
+            }
+            i++;
+        }
+    }
+
+    return bOK;
+}
+
 static void convert_full_sums(ener_old_t* ener_old, t_enxframe* fr)
 {
     int    nstep_all;
@@ -1032,7 +1123,20 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         fr->e_alloc = fr->nre;
     }
 
-    for (i = 0; i < fr->nre; i++)
+    /* Terms can only be skipped when the file uses the current layout,
+     * where e_size tells the size of a real in the file.
+     */
+    const int realSize = (fr->nre > 0) ? fr->e_size / (4 * fr->nre) : 0;
+    const gmx_bool bSelectTerms = bRead && ef->nReadTerm > 0 && file_version >= 4
+                                  && !ef->eo.bOldFileOpen
+                                  && (realSize == static_cast<int>(sizeof(float))
+                                      || realSize == static_cast<int>(sizeof(double)))
+                                  && fr->e_size == 4 * fr->nre * realSize;
+    if (bSelectTerms)
+    {
+        bOK = bOK && read_selected_energies(ef, fr, realSize);
+    }
+    for (i = 0; i < fr->nre && !bSelectTerms; i++)
     {
         bOK = bOK && gmx_fio_do_real(ef->fio, fr->ener[i].e);
 
@@ -1073,6 +1177,43 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         /* Convert old full simulation sums to sums between energy frames */
         convert_full_sums(&(ef->eo), fr);
     }
+    if (bRead && ef->bSkipBlocks && file_version >= 4)
+    {
+        /* Skip the data of all subblocks with items of fixed size,
+         * read the others, and hide the blocks from the caller.
+         */
+        for (b = 0; b < fr->nblock; b++)
+        {
+            for (i = 0; i < fr->block[b].nsub; i++)
+            {
+                t_enxsubblock* sub      = &(fr->block[b].sub[i]);
+                const int      itemSize = xdr_item_size(sub->type);
+
+                if (itemSize > 0)
+                {
+                    bOK = bOK && skip_bytes(ef->fio, static_cast<gmx_off_t>(sub->nr) * itemSize);
+                }
+                else
+                {
+                    enxsubblock_alloc(sub);
+                    switch (sub->type)
+                    {
+                        case xdr_datatype_char:
+                            bOK = bOK && gmx_fio_ndo_uchar(ef->fio, sub->cval, sub->nr);
+                            break;
+                        case xdr_datatype_string:
+                            bOK = bOK && gmx_fio_ndo_string(ef->fio, sub->sval, sub->nr);
+                            break;
+                        default:
+                            gmx_incons(
+                                    "Reading unknown block data type: this file is corrupted or "
+                                    "from the future");
+                    }
+                }
+            }
+        }
+        fr->nblock = 0;
+    }
     /* read the blocks */
     for (b = 0; b < fr->nblock; b++)
     {
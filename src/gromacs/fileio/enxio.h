@@ -178,6 +178,15 @@ void free_enxnms(int n, gmx_enxnm_t* nms);
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr);
 /* Reads enx_frames, memory in fr is (re)allocated if necessary */
 
+void enx_set_data_to_read(ener_file_t ef, int nre, const gmx_bool* bReadTerm, gmx_bool bSkipBlocks);
+/* Restricts what do_enx() reads from ef to the energy terms i < nre
+ * with bReadTerm[i] set; the other terms are skipped in the file and
+ * are zero in the frame. Terms with index nre or larger are read.
+ * With nre=0 all terms are read. When bSkipBlocks is set, the block
+ * data is skipped as well and frames are returned with nblock=0.
+ * Only files written with the current layout are read selectively.
+ */
+
 void get_enx_state(const char* fn, real t, const SimulationGroups& groups, t_inputrec* ir, t_state* state);
 /*
  * Reads state variables from enx file fn at time t.
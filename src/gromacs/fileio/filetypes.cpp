@@ -144,7 +144,8 @@ static const t_deffile deffile[efNR] = {
     { eftASC, ".cub", "pot", nullptr, "Gaussian cube file" },
     { eftASC, ".xpm", "root", nullptr, "X PixMap compatible matrix file" },
     { eftASC, "", "rundir", nullptr, "Run directory" },
-    { eftASC, ".csv", "bench", nullptr, "CSV data file" }
+    { eftASC, ".csv", "bench", nullptr, "CSV data file" },
+    { eftGEN, ".mrc", "density", nullptr, "MRC density map" }
 };
 
 const char* ftp2ext(int ftp)
@@ -45,6 +45,8 @@
 #include <cstdio>
 #include <cstring>
 
+#include <atomic>
+#include <future>
 #include <mutex>
 #include <vector>
 
@@ -569,6 +571,7 @@ static int gmx_fio_int_get_file_position(t_fileio* fio, gmx_off_t* offset)
 std::vector<gmx_file_position_t> gmx_fio_get_output_file_positions()
 {
     std::vector<gmx_file_position_t> outputfiles;
+    std::vector<t_fileio*>           files;
     t_fileio*                        cur;
 
     Lock openFilesLock(open_file_mutex);
@@ -585,16 +588,40 @@ std::vector<gmx_file_position_t> gmx_fio_get_output_file_positions()
 
             /* Get the file position */
             gmx_fio_int_get_file_position(cur, &outputfiles.back().offset);
-            if (!GMX_FAHCORE)
-            {
-                outputfiles.back().checksumSize = gmx_fio_int_get_file_md5(
-                        cur, outputfiles.back().offset, &outputfiles.back().checksum);
-            }
+            files.push_back(cur);
         }
 
         cur = gmx_fio_get_next(cur);
     }
 
+    if (!GMX_FAHCORE)
+    {
+        /* Each checksum reads back up to 1 MB from the end of its file.
+           The files are independent, so a single helper thread takes
+           files from the same list as this thread. No file can be
+           closed while we hold the open file mutex. */
+        std::atomic<size_t> nextFile(0);
+        const auto          computeChecksums = [&outputfiles, &files, &nextFile]() {
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++)
+            {
+                gmx_fio_lock(files[i]);
+                outputfiles[i].checksumSize = gmx_fio_int_get_file_md5(
+                        files[i], outputfiles[i].offset, &outputfiles[i].checksum);
+                gmx_fio_unlock(files[i]);
+            }
+        };
+        std::future<void> helper;
+        if (files.size() > 1)
+        {
+            helper = std::async(std::launch::async, computeChecksums);
+        }
+        computeChecksums();
+        if (helper.valid())
+        {
+            helper.get();
+        }
+    }
+
     return outputfiles;
 }
 
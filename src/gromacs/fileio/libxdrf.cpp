@@ -39,6 +39,7 @@
 
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -284,91 +285,108 @@ static void sendints(int          buf[],
 
 /*___________________________________________________________________________
  |
- | receivebits - decode number from buf using specified number of bits
+ | XtcBitReader - decode numbers from the bit stream written by sendbits
  |
- | extract the number of bits from the array buf and construct an integer
- | from it. Return that value.
+ | Keeps the not yet consumed bits in a 64-bit register. Unlike the state
+ | stored in the first three ints of the buffer used by sendbits, this state
+ | stays local to xdr3dfcoord, so the compiler can keep it in registers
+ | over the whole decoding loop.
  |
  */
 
-static int receivebits(int buf[], int num_of_bits)
+namespace
 {
 
-    int            cnt, num, lastbits;
-    unsigned int   lastbyte;
-    unsigned char* cbuf;
-    int            mask = (1 << num_of_bits) - 1;
-
-    cbuf     = reinterpret_cast<unsigned char*>(buf) + 3 * sizeof(*buf);
-    cnt      = buf[0];
-    lastbits = static_cast<unsigned int>(buf[1]);
-    lastbyte = static_cast<unsigned int>(buf[2]);
+struct XtcBitReader
+{
+    explicit XtcBitReader(const unsigned char* data) : data(data) {}
 
-    num = 0;
-    while (num_of_bits >= 8)
-    {
-        lastbyte = (lastbyte << 8) | cbuf[cnt++];
-        num |= (lastbyte >> lastbits) << (num_of_bits - 8);
-        num_of_bits -= 8;
-    }
-    if (num_of_bits > 0)
+    /* extract num_of_bits (at most 32) bits and construct an integer from them */
+    int receivebits(const int num_of_bits)
     {
-        if (lastbits < num_of_bits)
+        while (numCachedBits < num_of_bits)
         {
-            lastbits += 8;
-            lastbyte = (lastbyte << 8) | cbuf[cnt++];
+            cache = (cache << 8) | *data++;
+            numCachedBits += 8;
         }
-        lastbits -= num_of_bits;
-        num |= (lastbyte >> lastbits) & ((1 << num_of_bits) - 1);
+        numCachedBits -= num_of_bits;
+        return static_cast<int>((cache >> numCachedBits) & ((uint64_t(1) << num_of_bits) - 1));
     }
-    num &= mask;
-    buf[0] = cnt;
-    buf[1] = lastbits;
-    buf[2] = lastbyte;
-    return num;
-}
 
-/*____________________________________________________________________________
- |
- | receiveints - decode 'small' integers from the buf array
- |
- | this routine is the inverse from sendints() and decodes the small integers
- | written to buf by calculating the remainder and doing divisions with
- | the given sizes[]. You need to specify the total number of bits to be
- | used from buf in num_of_bits.
- |
- */
-
-static void receiveints(int buf[], const int num_of_ints, int num_of_bits, const unsigned int sizes[], int nums[])
-{
-    int bytes[32];
-    int i, j, num_of_bytes, p, num;
-
-    bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0;
-    num_of_bytes                              = 0;
-    while (num_of_bits > 8)
+    /* the inverse of sendints, see receiveints_bytewise for the general case */
+    void receiveints(const int num_of_ints, int num_of_bits, const unsigned int sizes[], int nums[])
     {
-        bytes[num_of_bytes++] = receivebits(buf, 8);
-        num_of_bits -= 8;
-    }
-    if (num_of_bits > 0)
-    {
-        bytes[num_of_bytes++] = receivebits(buf, num_of_bits);
+        if (num_of_bits > 64)
+        {
+            receiveints_bytewise(num_of_ints, num_of_bits, sizes, nums);
+            return;
+        }
+        /* The bytes are stored least significant first, so as long as the
+         * combined integer fits in 64 bits we can use plain integer division
+         * instead of the bytewise long division.
+         */
+        uint64_t num   = 0;
+        int      shift = 0;
+        while (num_of_bits > 8)
+        {
+            num |= static_cast<uint64_t>(receivebits(8)) << shift;
+            shift += 8;
+            num_of_bits -= 8;
+        }
+        if (num_of_bits > 0)
+        {
+            num |= static_cast<uint64_t>(receivebits(num_of_bits)) << shift;
+        }
+        for (int i = num_of_ints - 1; i > 0; i--)
+        {
+            nums[i] = static_cast<int>(num % sizes[i]);
+            num /= sizes[i];
+        }
+        nums[0] = static_cast<int>(num);
     }
-    for (i = num_of_ints - 1; i > 0; i--)
+
+    /* decode 'small' integers by calculating the remainder and doing
+     * divisions with the given sizes[] on a multibyte integer */
+    void receiveints_bytewise(const int num_of_ints, int num_of_bits, const unsigned int sizes[], int nums[])
     {
-        num = 0;
-        for (j = num_of_bytes - 1; j >= 0; j--)
+        int bytes[32];
+        int i, j, num_of_bytes, p, num;
+
+        bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0;
+        num_of_bytes                              = 0;
+        while (num_of_bits > 8)
+        {
+            bytes[num_of_bytes++] = receivebits(8);
+            num_of_bits -= 8;
+        }
+        if (num_of_bits > 0)
+        {
+            bytes[num_of_bytes++] = receivebits(num_of_bits);
+        }
+        for (i = num_of_ints - 1; i > 0; i--)
         {
-            num      = (num << 8) | bytes[j];
-            p        = num / sizes[i];
-            bytes[j] = p;
-            num      = num - p * sizes[i];
+            num = 0;
+            for (j = num_of_bytes - 1; j >= 0; j--)
+            {
+                num      = (num << 8) | bytes[j];
+                p        = num / sizes[i];
+                bytes[j] = p;
+                num      = num - p * sizes[i];
+            }
+            nums[i] = num;
         }
-        nums[i] = num;
+        nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
     }
-    nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
-}
+
+    //! Next byte to load into the cache
+    const unsigned char* data;
+    //! Bits loaded from data, the lowest numCachedBits of which are not yet consumed
+    uint64_t cache = 0;
+    //! Number of valid bits in cache
+    int numCachedBits = 0;
+};
+
+} // namespace
 
 /*____________________________________________________________________________
  |
@@ -397,7 +415,7 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits, const
  |
  */
 
-int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
+int xdr3dfcoord_partial(XDR* xdrs, float* fp, int* size, float* precision, int numAtomsToDecode)
 {
     int*     ip  = nullptr;
     int*     buf = nullptr;
@@ -899,26 +917,31 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
         }
 
 
-        buf[0] = buf[1] = buf[2] = 0;
+        XtcBitReader bitReader(reinterpret_cast<unsigned char*>(buf) + 3 * sizeof(*buf));
 
         lfp           = fp;
         inv_precision = 1.0 / *precision;
         run           = 0;
         i             = 0;
         lip           = ip;
-        while (i < lsize)
+        /* The coordinates are delta coded, so the first atoms can be
+         * decoded without decoding the rest. A run of small differences
+         * can extend beyond numAtomsToDecode, but never beyond lsize.
+         */
+        const int numToDecode = std::min(lsize, numAtomsToDecode);
+        while (i < numToDecode)
         {
             thiscoord = reinterpret_cast<int*>(lip) + i * 3;
 
             if (bitsize == 0)
             {
-                thiscoord[0] = receivebits(buf, bitsizeint[0]);
-                thiscoord[1] = receivebits(buf, bitsizeint[1]);
-                thiscoord[2] = receivebits(buf, bitsizeint[2]);
+                thiscoord[0] = bitReader.receivebits(bitsizeint[0]);
+                thiscoord[1] = bitReader.receivebits(bitsizeint[1]);
+                thiscoord[2] = bitReader.receivebits(bitsizeint[2]);
             }
             else
             {
-                receiveints(buf, 3, bitsize, sizeint, thiscoord);
+                bitReader.receiveints(3, bitsize, sizeint, thiscoord);
             }
 
             i++;
@@ -931,11 +954,11 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
             prevcoord[2] = thiscoord[2];
 
 
-            flag       = receivebits(buf, 1);
+            flag       = bitReader.receivebits(1);
             is_smaller = 0;
             if (flag == 1)
             {
-                run        = receivebits(buf, 5);
+                run        = bitReader.receivebits(5);
                 is_smaller = run % 3;
                 run -= is_smaller;
                 is_smaller--;
@@ -945,7 +968,7 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
                 thiscoord += 3;
                 for (k = 0; k < run; k += 3)
                 {
-                    receiveints(buf, 3, smallidx, sizesmall, thiscoord);
+                    bitReader.receiveints(3, smallidx, sizesmall, thiscoord);
                     i++;
                     thiscoord[0] += prevcoord[0] - smallnum;
                     thiscoord[1] += prevcoord[1] - smallnum;
@@ -1014,6 +1037,11 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
     return 1;
 }
 
+int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
+{
+    return xdr3dfcoord_partial(xdrs, fp, size, precision, INT_MAX);
+}
+
 
 /******************************************************************
 
@@ -0,0 +1,373 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the memory-mapped TRR reader.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "mappedtrrreader.h"
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef HAVE_SYS_MMAN_H
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#    include <unistd.h>
+#endif
+
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Magic number at the start of each TRR frame.
+const int c_trrMagic = 1993;
+//! Version string in each TRR frame header.
+const char c_trrVersion[] = "GMX_trn_file";
+
+//! Returns the big-endian 32-bit XDR unit at \p p.
+inline uint32_t loadXdrUnit(const char* p)
+{
+    const auto* b = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+}
+
+//! Returns the XDR float at \p p.
+inline float loadXdrFloat(const char* p)
+{
+    const uint32_t bits = loadXdrUnit(p);
+    float          value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//! Returns the XDR double at \p p.
+inline double loadXdrDouble(const char* p)
+{
+    const uint64_t bits = (uint64_t(loadXdrUnit(p)) << 32) | loadXdrUnit(p + 4);
+    double         value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//! Returns the size of the floating-point values in the frame described by \p sh.
+int floatSize(const gmx_trr_header_t& sh)
+{
+    int size = 0;
+    if (sh.box_size)
+    {
+        size = sh.box_size / (DIM * DIM);
+    }
+    else if (sh.x_size)
+    {
+        size = sh.x_size / (sh.natoms * DIM);
+    }
+    else if (sh.v_size)
+    {
+        size = sh.v_size / (sh.natoms * DIM);
+    }
+    else if (sh.f_size)
+    {
+        size = sh.f_size / (sh.natoms * DIM);
+    }
+    else
+    {
+        GMX_THROW(FileIOError("Can not determine precision of trr file"));
+    }
+    if (size != sizeof(float) && size != sizeof(double))
+    {
+        GMX_THROW(FileIOError(formatString("Float size %d. Maybe different CPU?", size)));
+    }
+    return size;
+}
+
+} // namespace
+
+RVec XdrRVecView::operator[](int i) const
+{
+    if (isDouble_)
+    {
+        const char* p = data_ + i * DIM * sizeof(double);
+        return { static_cast<real>(loadXdrDouble(p)),
+                 static_cast<real>(loadXdrDouble(p + sizeof(double))),
+                 static_cast<real>(loadXdrDouble(p + 2 * sizeof(double))) };
+    }
+    const char* p = data_ + i * DIM * sizeof(float);
+    return { loadXdrFloat(p), loadXdrFloat(p + sizeof(float)), loadXdrFloat(p + 2 * sizeof(float)) };
+}
+
+void XdrRVecView::copyTo(rvec* x) const
+{
+    copyTo(size_, x);
+}
+
+void XdrRVecView::copyTo(int numVectors, rvec* x) const
+{
+    GMX_ASSERT(numVectors >= 0 && numVectors <= size_, "Number of vectors out of range");
+    for (int i = 0; i < numVectors; i++)
+    {
+        const RVec value = (*this)[i];
+        copy_rvec(value, x[i]);
+    }
+}
+
+bool MappedTrrReader::isSupported()
+{
+#ifdef HAVE_SYS_MMAN_H
+    return true;
+#else
+    return false;
+#endif
+}
+
+MappedTrrReader::MappedTrrReader(const std::string& fileName) : header_()
+{
+#ifdef HAVE_SYS_MMAN_H
+    fd_ = open(fileName.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        GMX_THROW_WITH_ERRNO(FileIOError("Could not open file " + fileName), "open", errno);
+    }
+    extendMapping(1);
+#else
+    GMX_UNUSED_VALUE(fileName);
+    GMX_THROW(NotImplementedError("Memory mapping of files is not supported on this platform"));
+#endif
+}
+
+MappedTrrReader::~MappedTrrReader()
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+#endif
+}
+
+void MappedTrrReader::extendMapping(size_t size)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (size <= size_)
+    {
+        return;
+    }
+    struct stat fileStatus;
+    if (fstat(fd_, &fileStatus) != 0)
+    {
+        GMX_THROW_WITH_ERRNO(FileIOError("Could not determine the size of a mapped file"), "fstat", errno);
+    }
+    const auto fileSize = static_cast<size_t>(fileStatus.st_size);
+    if (fileSize <= size_)
+    {
+        return;
+    }
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    void* data = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED)
+    {
+        GMX_THROW_WITH_ERRNO(FileIOError("Could not map a trajectory file into memory"), "mmap", errno);
+    }
+    // Frames are mostly read in order, so let the kernel read ahead.
+    madvise(data, fileSize, MADV_SEQUENTIAL);
+    data_ = static_cast<char*>(data);
+    size_ = fileSize;
+#else
+    GMX_UNUSED_VALUE(size);
+#endif
+}
+
+gmx_bool MappedTrrReader::readFrameHeader(gmx_off_t offset, gmx_bool* bOK)
+{
+    gmx_off_t position = offset;
+    // Reads an XDR int, returns false when it is beyond the end of the file.
+    auto readInt = [this, &position](int* value) {
+        extendMapping(position + sizeof(int32_t));
+        if (position + static_cast<gmx_off_t>(sizeof(int32_t)) > static_cast<gmx_off_t>(size_))
+        {
+            return false;
+        }
+        *value = static_cast<int32_t>(loadXdrUnit(data_ + position));
+        position += sizeof(int32_t);
+        return true;
+    };
+
+    *bOK = TRUE;
+    int magic;
+    if (!readInt(&magic))
+    {
+        return FALSE;
+    }
+    if (magic != c_trrMagic)
+    {
+        *bOK = FALSE;
+        GMX_THROW(FileIOError(
+                "Failed to find GROMACS magic number in trr frame header, so this is not a trr "
+                "file!"));
+    }
+
+    // The version string, stored as its size including the terminating
+    // zero, followed by an XDR string padded to a multiple of four bytes.
+    int stringSize, xdrStringSize;
+    *bOK = readInt(&stringSize) && readInt(&xdrStringSize);
+    if (!*bOK)
+    {
+        return FALSE;
+    }
+    const int versionLength = std::strlen(c_trrVersion);
+    if (stringSize != versionLength + 1 || xdrStringSize != versionLength)
+    {
+        *bOK = FALSE;
+        GMX_THROW(FileIOError("Invalid version string in trr frame header"));
+    }
+    const gmx_off_t paddedStringSize = (xdrStringSize + 3) / 4 * 4;
+    extendMapping(position + paddedStringSize);
+    *bOK = position + paddedStringSize <= static_cast<gmx_off_t>(size_);
+    if (!*bOK)
+    {
+        return FALSE;
+    }
+    if (std::memcmp(data_ + position, c_trrVersion, versionLength) != 0)
+    {
+        *bOK = FALSE;
+        GMX_THROW(FileIOError("Invalid version string in trr frame header"));
+    }
+    position += paddedStringSize;
+
+    gmx_trr_header_t& sh = header_;
+    sh                   = gmx_trr_header_t();
+    *bOK = readInt(&sh.ir_size) && readInt(&sh.e_size) && readInt(&sh.box_size)
+           && readInt(&sh.vir_size) && readInt(&sh.pres_size) && readInt(&sh.top_size)
+           && readInt(&sh.sym_size) && readInt(&sh.x_size) && readInt(&sh.v_size)
+           && readInt(&sh.f_size) && readInt(&sh.natoms);
+    if (!*bOK)
+    {
+        return FALSE;
+    }
+    const int realSize = floatSize(sh);
+    sh.bDouble         = (realSize == sizeof(double));
+
+    int step = 0;
+    *bOK     = readInt(&step) && readInt(&sh.nre);
+    extendMapping(position + 2 * realSize);
+    *bOK = *bOK && position + 2 * realSize <= static_cast<gmx_off_t>(size_);
+    if (!*bOK)
+    {
+        return FALSE;
+    }
+    sh.step = step;
+    if (sh.bDouble)
+    {
+        sh.t      = loadXdrDouble(data_ + position);
+        sh.lambda = loadXdrDouble(data_ + position + realSize);
+    }
+    else
+    {
+        sh.t      = loadXdrFloat(data_ + position);
+        sh.lambda = loadXdrFloat(data_ + position + realSize);
+    }
+    position += 2 * realSize;
+
+    dataOffset_ = position;
+    dataSize_   = static_cast<gmx_off_t>(sh.ir_size) + sh.e_size + sh.box_size + sh.vir_size
+                + sh.pres_size + sh.top_size + sh.sym_size + sh.x_size + sh.v_size + sh.f_size;
+    return TRUE;
+}
+
+bool MappedTrrReader::hasFrameData()
+{
+    extendMapping(frameEndOffset());
+    return frameEndOffset() <= static_cast<gmx_off_t>(size_);
+}
+
+XdrRVecView MappedTrrReader::dataView(size_t offset, int size, int numVectors) const
+{
+    if (size == 0)
+    {
+        return {};
+    }
+    return { data_ + dataOffset_ + offset, numVectors, static_cast<bool>(header_.bDouble) };
+}
+
+XdrRVecView MappedTrrReader::box() const
+{
+    return dataView(0, header_.box_size, DIM);
+}
+
+XdrRVecView MappedTrrReader::x() const
+{
+    const size_t offset = header_.box_size + header_.vir_size + header_.pres_size;
+    return dataView(offset, header_.x_size, header_.natoms);
+}
+
+XdrRVecView MappedTrrReader::v() const
+{
+    const size_t offset = header_.box_size + header_.vir_size + header_.pres_size + header_.x_size;
+    return dataView(offset, header_.v_size, header_.natoms);
+}
+
+XdrRVecView MappedTrrReader::f() const
+{
+    const size_t offset = header_.box_size + header_.vir_size + header_.pres_size + header_.x_size
+                          + header_.v_size;
+    return dataView(offset, header_.f_size, header_.natoms);
+}
+
+} // namespace gmx
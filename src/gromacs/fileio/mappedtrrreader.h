@@ -0,0 +1,180 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares a reader for TRR files that works on a memory mapping of the file.
+ *
+ * Reading through the mapping avoids the stdio buffering and the per-value
+ * XDR calls of the t_fileio based reader. The vectors in a frame can be
+ * accessed directly in the mapped file, and are only converted from the
+ * big-endian XDR representation when accessed, so only the atoms that are
+ * used need to be touched.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_MAPPEDTRRREADER_H
+#define GMX_FILEIO_MAPPEDTRRREADER_H
+
+#include <cstddef>
+
+#include <string>
+
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/futil.h"
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * View of vectors stored in XDR representation in a mapped TRR file.
+ *
+ * The values are converted to host representation and precision on access.
+ * A view is only valid until the next frame is read from the reader it
+ * came from.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class XdrRVecView
+{
+public:
+    //! Creates an empty view.
+    XdrRVecView() = default;
+    //! Creates a view of \p size vectors stored at \p data.
+    XdrRVecView(const char* data, int size, bool isDouble) :
+        data_(data), size_(size), isDouble_(isDouble)
+    {
+    }
+
+    //! Returns the number of vectors in the view.
+    int size() const { return size_; }
+    //! Returns whether the view is empty.
+    bool empty() const { return size_ == 0; }
+    //! Returns vector \p i.
+    RVec operator[](int i) const;
+    //! Copies all vectors into \p x, which should have room for size() vectors.
+    void copyTo(rvec* x) const;
+    //! Copies the first \p numVectors vectors into \p x.
+    void copyTo(int numVectors, rvec* x) const;
+
+private:
+    //! Start of the data in the mapped file.
+    const char* data_ = nullptr;
+    //! Number of vectors.
+    int size_ = 0;
+    //! Whether the values are stored in double precision.
+    bool isDouble_ = false;
+};
+
+/*! \libinternal \brief
+ * Reads TRR frames from a read-only memory mapping of the file.
+ *
+ * Frames are addressed by their offset in the file, so the reader can be
+ * combined with a t_fileio for the same file that tracks the position.
+ * When a frame extends beyond the mapped part of the file, the mapping is
+ * extended, so trajectories that are still being written can be read.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class MappedTrrReader
+{
+public:
+    //! Returns whether memory mapping of files is supported on this platform.
+    static bool isSupported();
+
+    /*! \brief
+     * Maps the file \p fileName.
+     *
+     * \throws FileIOError if the file cannot be opened or mapped.
+     */
+    explicit MappedTrrReader(const std::string& fileName);
+    ~MappedTrrReader();
+    GMX_DISALLOW_COPY_AND_ASSIGN(MappedTrrReader);
+
+    /*! \brief
+     * Reads the header of the frame starting at \p offset.
+     *
+     * Has the same semantics as gmx_trr_read_frame_header(): returns FALSE
+     * if there is no frame, and sets \p bOK to FALSE when the header is
+     * incomplete.
+     *
+     * \throws FileIOError if the data at \p offset is not a TRR frame header.
+     */
+    gmx_bool readFrameHeader(gmx_off_t offset, gmx_bool* bOK);
+    //! Returns whether the data of the current frame is completely present in the file.
+    bool hasFrameData();
+
+    //! Returns the header of the current frame.
+    const gmx_trr_header_t& header() const { return header_; }
+    //! Returns the offset where the current frame ends.
+    gmx_off_t frameEndOffset() const { return dataOffset_ + dataSize_; }
+
+    //! Returns the box of the current frame, empty if not present.
+    XdrRVecView box() const;
+    //! Returns the coordinates of the current frame, empty if not present.
+    XdrRVecView x() const;
+    //! Returns the velocities of the current frame, empty if not present.
+    XdrRVecView v() const;
+    //! Returns the forces of the current frame, empty if not present.
+    XdrRVecView f() const;
+
+private:
+    //! Makes sure that \p size bytes of the file are mapped, if the file is that large.
+    void extendMapping(size_t size);
+    //! Returns a view of the \p numVectors vectors starting \p offset bytes into the frame data.
+    XdrRVecView dataView(size_t offset, int size, int numVectors) const;
+
+    //! File descriptor of the mapped file.
+    int fd_ = -1;
+    //! Start of the mapping.
+    char* data_ = nullptr;
+    //! Size of the mapping.
+    size_t size_ = 0;
+    //! Header of the current frame.
+    gmx_trr_header_t header_;
+    //! Offset of the data of the current frame.
+    gmx_off_t dataOffset_ = 0;
+    //! Size of the data of the current frame.
+    gmx_off_t dataSize_ = 0;
+};
+
+} // namespace gmx
+
+#endif
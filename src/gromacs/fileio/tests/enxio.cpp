@@ -0,0 +1,227 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for selective reading of energy files
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/enxio.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+class EnergyFileReadTest : public ::testing::Test
+{
+public:
+    //! The number of energy terms
+    static constexpr int c_numTerms = 5;
+    //! The number of frames
+    static constexpr int c_numFrames = 3;
+
+    EnergyFileReadTest() : fileName_(fileManager_.getTemporaryFilePath(".edr")) {}
+
+    //! Returns the energy of \p term in \p frame
+    static real energy(int frame, int term) { return 10 * frame + term; }
+
+    //! Writes the test energy file with one block of doubles and ints per frame
+    void writeFile()
+    {
+        ener_file_t  ef = open_enx(fileName_.c_str(), "w");
+        gmx_enxnm_t* enm;
+        snew(enm, c_numTerms);
+        std::vector<std::string> names;
+        for (int i = 0; i < c_numTerms; i++)
+        {
+            names.push_back("Term" + std::to_string(i));
+        }
+        for (int i = 0; i < c_numTerms; i++)
+        {
+            enm[i].name = const_cast<char*>(names[i].c_str());
+            enm[i].unit = const_cast<char*>("kJ/mol");
+        }
+        int nre = c_numTerms;
+        do_enxnms(ef, &nre, &enm);
+        sfree(enm);
+
+        for (int frame = 0; frame < c_numFrames; frame++)
+        {
+            std::vector<t_energy> ener(c_numTerms);
+            for (int i = 0; i < c_numTerms; i++)
+            {
+                ener[i].e    = energy(frame, i);
+                ener[i].eav  = 2 * energy(frame, i);
+                ener[i].esum = 3 * energy(frame, i);
+            }
+            std::vector<double> blockDoubles = { 0.5 * frame, 1.5, 2.5 };
+            std::vector<int>    blockInts    = { frame, 7 };
+
+            t_enxframe fr;
+            init_enxframe(&fr);
+            fr.t      = frame;
+            fr.step   = 10 * frame;
+            fr.nsteps = 10;
+            fr.dt     = 0.1;
+            fr.nsum   = 10;
+            fr.nre    = c_numTerms;
+            fr.ener   = ener.data();
+            add_blocks_enxframe(&fr, 1);
+            add_subblocks_enxblock(&fr.block[0], 2);
+            fr.block[0].id          = enxDHCOLL;
+            fr.block[0].sub[0].type = xdr_datatype_double;
+            fr.block[0].sub[0].nr   = blockDoubles.size();
+            fr.block[0].sub[0].dval = blockDoubles.data();
+            fr.block[0].sub[1].type = xdr_datatype_int;
+            fr.block[0].sub[1].nr   = blockInts.size();
+            fr.block[0].sub[1].ival = blockInts.data();
+            do_enx(ef, &fr);
+            free_enxframe(&fr);
+        }
+        done_ener_file(ef);
+    }
+
+    //! Opens the test file for reading and reads the energy names
+    ener_file_t openForReading()
+    {
+        ener_file_t  ef  = open_enx(fileName_.c_str(), "r");
+        gmx_enxnm_t* enm = nullptr;
+        int          nre = 0;
+        do_enxnms(ef, &nre, &enm);
+        EXPECT_EQ(c_numTerms, nre);
+        free_enxnms(nre, enm);
+        return ef;
+    }
+
+    TestFileManager fileManager_;
+    std::string     fileName_;
+};
+
+TEST_F(EnergyFileReadTest, ReadsAllData)
+{
+    writeFile();
+    ener_file_t ef = openForReading();
+    t_enxframe  fr;
+    init_enxframe(&fr);
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        ASSERT_TRUE(do_enx(ef, &fr));
+        EXPECT_EQ(10 * frame, fr.step);
+        ASSERT_EQ(c_numTerms, fr.nre);
+        for (int i = 0; i < c_numTerms; i++)
+        {
+            EXPECT_REAL_EQ(energy(frame, i), fr.ener[i].e);
+            EXPECT_DOUBLE_EQ(2 * energy(frame, i), fr.ener[i].eav);
+        }
+        ASSERT_EQ(1, fr.nblock);
+        EXPECT_EQ(frame, fr.block[0].sub[1].ival[0]);
+    }
+    EXPECT_FALSE(do_enx(ef, &fr));
+    free_enxframe(&fr);
+    done_ener_file(ef);
+}
+
+TEST_F(EnergyFileReadTest, ReadsSelectedTermsAndSkipsBlocks)
+{
+    writeFile();
+    ener_file_t    ef      = openForReading();
+    const gmx_bool bRead[] = { FALSE, TRUE, FALSE, FALSE, TRUE };
+    enx_set_data_to_read(ef, c_numTerms, bRead, TRUE);
+    t_enxframe fr;
+    init_enxframe(&fr);
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        ASSERT_TRUE(do_enx(ef, &fr));
+        EXPECT_EQ(10 * frame, fr.step);
+        EXPECT_EQ(static_cast<double>(frame), fr.t);
+        ASSERT_EQ(c_numTerms, fr.nre);
+        for (int i = 0; i < c_numTerms; i++)
+        {
+            EXPECT_REAL_EQ(bRead[i] ? energy(frame, i) : 0, fr.ener[i].e);
+            EXPECT_DOUBLE_EQ(bRead[i] ? 3 * energy(frame, i) : 0, fr.ener[i].esum);
+        }
+        EXPECT_EQ(0, fr.nblock);
+    }
+    EXPECT_FALSE(do_enx(ef, &fr));
+    free_enxframe(&fr);
+    done_ener_file(ef);
+}
+
+TEST_F(EnergyFileReadTest, ReadsSelectedTermsAndBlocks)
+{
+    writeFile();
+    ener_file_t    ef      = openForReading();
+    const gmx_bool bRead[] = { TRUE, FALSE, FALSE };
+    enx_set_data_to_read(ef, 3, bRead, FALSE);
+    t_enxframe fr;
+    init_enxframe(&fr);
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        ASSERT_TRUE(do_enx(ef, &fr));
+        ASSERT_EQ(c_numTerms, fr.nre);
+        EXPECT_REAL_EQ(energy(frame, 0), fr.ener[0].e);
+        EXPECT_REAL_EQ(0, fr.ener[1].e);
+        EXPECT_REAL_EQ(0, fr.ener[2].e);
+        // Terms beyond the selection are read
+        EXPECT_REAL_EQ(energy(frame, 3), fr.ener[3].e);
+        EXPECT_REAL_EQ(energy(frame, 4), fr.ener[4].e);
+        ASSERT_EQ(1, fr.nblock);
+        ASSERT_EQ(2, fr.block[0].nsub);
+        EXPECT_EQ(0.5 * frame, fr.block[0].sub[0].dval[0]);
+        EXPECT_EQ(7, fr.block[0].sub[1].ival[1]);
+    }
+    free_enxframe(&fr);
+    done_ener_file(ef);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,240 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for MappedTrrReader
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/mappedtrrreader.h"
+
+#include "config.h"
+
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+#ifdef HAVE_SYS_MMAN_H
+
+class MappedTrrReaderTest : public ::testing::Test
+{
+public:
+    MappedTrrReaderTest() : fileName_(fileManager_.getTemporaryFilePath(".trr"))
+    {
+        ThreeFry2x64<16>              rng(12345, RandomDomain::Other);
+        UniformRealDistribution<real> dist(-5, 5);
+        for (auto* vectors : { &x_, &v_, &f_ })
+        {
+            vectors->resize(c_numAtoms);
+            for (auto& vector : *vectors)
+            {
+                vector = { dist(rng), dist(rng), dist(rng) };
+            }
+        }
+    }
+
+    //! Writes \p numFrames frames with coordinates, and velocities and forces in odd frames.
+    void writeFrames(int numFrames)
+    {
+        t_fileio* fio = gmx_trr_open(fileName_.c_str(), "w");
+        for (int frame = 0; frame < numFrames; frame++)
+        {
+            const bool allData = (frame % 2 == 1);
+            gmx_trr_write_frame(fio,
+                                frame * 100,
+                                0.2 * frame,
+                                0.1 * frame,
+                                box_,
+                                c_numAtoms,
+                                as_rvec_array(x_.data()),
+                                allData ? as_rvec_array(v_.data()) : nullptr,
+                                allData ? as_rvec_array(f_.data()) : nullptr);
+        }
+        gmx_trr_close(fio);
+    }
+
+    //! Checks that \p view contains \p expected.
+    static void checkVectors(ArrayRef<const RVec> expected, const XdrRVecView& view)
+    {
+        ASSERT_EQ(expected.ssize(), view.size());
+        std::vector<RVec> copy(view.size());
+        view.copyTo(as_rvec_array(copy.data()));
+        for (int i = 0; i < view.size(); i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(expected[i][d], view[i][d]);
+                EXPECT_EQ(expected[i][d], copy[i][d]);
+            }
+        }
+    }
+
+    static constexpr int c_numAtoms = 50;
+    TestFileManager      fileManager_;
+    std::string          fileName_;
+    matrix               box_ = { { 5, 0, 0 }, { 0.5, 6, 0 }, { 0.5, 0.5, 7 } };
+    std::vector<RVec>    x_, v_, f_;
+};
+
+TEST_F(MappedTrrReaderTest, ReadsFramesAsWritten)
+{
+    const int numFrames = 3;
+    writeFrames(numFrames);
+
+    MappedTrrReader reader(fileName_);
+    gmx_off_t       offset = 0;
+    gmx_bool        bOK;
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        ASSERT_TRUE(reader.readFrameHeader(offset, &bOK));
+        ASSERT_TRUE(bOK);
+        ASSERT_TRUE(reader.hasFrameData());
+        const gmx_trr_header_t& header = reader.header();
+        EXPECT_EQ(frame * 100, header.step);
+        EXPECT_REAL_EQ_TOL(0.2 * frame, header.t, defaultRealTolerance());
+        EXPECT_REAL_EQ_TOL(0.1 * frame, header.lambda, defaultRealTolerance());
+        EXPECT_EQ(c_numAtoms, header.natoms);
+        checkVectors(arrayRefFromArray(reinterpret_cast<const RVec*>(box_), DIM), reader.box());
+        checkVectors(x_, reader.x());
+        if (frame % 2 == 1)
+        {
+            checkVectors(v_, reader.v());
+            checkVectors(f_, reader.f());
+        }
+        else
+        {
+            EXPECT_TRUE(reader.v().empty());
+            EXPECT_TRUE(reader.f().empty());
+        }
+        offset = reader.frameEndOffset();
+    }
+    EXPECT_FALSE(reader.readFrameHeader(offset, &bOK));
+    EXPECT_TRUE(bOK);
+}
+
+TEST_F(MappedTrrReaderTest, CopiesFirstAtoms)
+{
+    writeFrames(1);
+
+    MappedTrrReader reader(fileName_);
+    gmx_bool        bOK;
+    ASSERT_TRUE(reader.readFrameHeader(0, &bOK));
+    const int         numAtoms = 20;
+    std::vector<RVec> x(numAtoms);
+    reader.x().copyTo(numAtoms, as_rvec_array(x.data()));
+    for (int i = 0; i < numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(x_[i][d], x[i][d]);
+        }
+    }
+}
+
+TEST_F(MappedTrrReaderTest, ThrowsOnInvalidFrameHeader)
+{
+    writeFrames(1);
+    // Corrupt the version string that follows the magic number and the string sizes.
+    {
+        FILE* fp = gmx_ffopen(fileName_, "r+b");
+        std::fseek(fp, 3 * sizeof(int32_t), SEEK_SET);
+        std::fputc('X', fp);
+        gmx_ffclose(fp);
+    }
+
+    MappedTrrReader reader(fileName_);
+    gmx_bool        bOK;
+    EXPECT_THROW_GMX(reader.readFrameHeader(0, &bOK), FileIOError);
+    EXPECT_FALSE(bOK);
+    EXPECT_THROW_GMX(reader.readFrameHeader(sizeof(int32_t), &bOK), FileIOError);
+}
+
+TEST_F(MappedTrrReaderTest, DetectsIncompleteFrame)
+{
+    writeFrames(2);
+    gmx_off_t secondFrame;
+    {
+        MappedTrrReader reader(fileName_);
+        gmx_bool        bOK;
+        ASSERT_TRUE(reader.readFrameHeader(0, &bOK));
+        secondFrame = reader.frameEndOffset();
+    }
+    gmx_bool bOK;
+
+    // Truncate within the data of the second frame.
+    gmx_truncate(fileName_, secondFrame + 200);
+    {
+        MappedTrrReader reader(fileName_);
+        ASSERT_TRUE(reader.readFrameHeader(secondFrame, &bOK));
+        EXPECT_TRUE(bOK);
+        EXPECT_FALSE(reader.hasFrameData());
+    }
+
+    // Truncate within the header of the second frame.
+    gmx_truncate(fileName_, secondFrame + 20);
+    MappedTrrReader reader(fileName_);
+    EXPECT_FALSE(reader.readFrameHeader(secondFrame, &bOK));
+    EXPECT_FALSE(bOK);
+}
+
+#endif
+
+} // namespace
+} // namespace test
+} // namespace gmx
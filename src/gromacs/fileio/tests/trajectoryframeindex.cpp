@@ -0,0 +1,195 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for TrajectoryFrameIndex
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trajectoryframeindex.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vectypes.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+class TrajectoryFrameIndexTest : public ::testing::TestWithParam<const char*>
+{
+public:
+    TrajectoryFrameIndexTest() :
+        fileName_(fileManager_.getTemporaryFilePath(GetParam())),
+        // Register the index file for clean-up.
+        indexFileName_(fileManager_.getTemporaryFilePath(std::string(GetParam()) + ".frameidx")),
+        x_(c_numAtoms)
+    {
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            x_[i] = { 0.1F * i, 0.2F * i, 0.3F * i };
+        }
+    }
+
+    //! Appends \p numFrames frames to the trajectory, recording where they are written.
+    void writeFrames(int numFrames)
+    {
+        const bool isXtc = (fileName_.find(".xtc") != std::string::npos);
+        t_fileio*  fio   = isXtc ? open_xtc(fileName_.c_str(), "a")
+                              : gmx_trr_open(fileName_.c_str(), "a");
+        matrix box = { { 5, 0, 0 }, { 0, 5, 0 }, { 0, 0, 5 } };
+        for (int frame = 0; frame < numFrames; frame++, step_ += 10)
+        {
+            offsets_.push_back(gmx_fio_ftell(fio));
+            if (isXtc)
+            {
+                ASSERT_EQ(1, write_xtc(fio, c_numAtoms, step_, 0.5 * step_, box, as_rvec_array(x_.data()), 1000));
+            }
+            else
+            {
+                gmx_trr_write_frame(
+                        fio, step_, 0.5 * step_, 0, box, c_numAtoms, as_rvec_array(x_.data()), nullptr, nullptr);
+            }
+        }
+        endOffset_ = gmx_fio_ftell(fio);
+        gmx_fio_close(fio);
+    }
+
+    //! Returns the stored index for the trajectory, as a reader would obtain it.
+    std::optional<TrajectoryFrameIndex> readIndex()
+    {
+        t_fileio* fio   = gmx_fio_open(fileName_.c_str(), "r");
+        auto      index = TrajectoryFrameIndex::readStored(fileName_, fio);
+        EXPECT_EQ(0, gmx_fio_ftell(fio)) << "File position should be preserved";
+        gmx_fio_close(fio);
+        return index;
+    }
+
+    //! Checks that \p index describes all frames written.
+    void checkIndex(const TrajectoryFrameIndex& index)
+    {
+        ASSERT_EQ(offsets_.size(), index.frames().size());
+        for (size_t i = 0; i < offsets_.size(); i++)
+        {
+            EXPECT_EQ(offsets_[i], index.frames()[i].offset);
+            EXPECT_EQ(int64_t(10 * i), index.frames()[i].step);
+            EXPECT_DOUBLE_EQ(5.0 * i, index.frames()[i].time);
+            EXPECT_EQ(int(i), index.frameStartingAt(offsets_[i]));
+        }
+        EXPECT_EQ(endOffset_, index.endOffset());
+    }
+
+    static constexpr int   c_numAtoms = 20;
+    TestFileManager        fileManager_;
+    std::string            fileName_;
+    std::string            indexFileName_;
+    std::vector<RVec>      x_;
+    std::vector<gmx_off_t> offsets_;
+    gmx_off_t              endOffset_ = 0;
+    int64_t                step_      = 0;
+};
+
+TEST_P(TrajectoryFrameIndexTest, ReturnsNothingWithoutStoredIndex)
+{
+    writeFrames(5);
+    EXPECT_FALSE(readIndex().has_value());
+}
+
+TEST_P(TrajectoryFrameIndexTest, ExtendsEmptyStoredIndex)
+{
+    TrajectoryFrameIndex().write(fileName_);
+    writeFrames(5);
+    auto index = readIndex();
+    ASSERT_TRUE(index.has_value());
+    checkIndex(*index);
+}
+
+TEST_P(TrajectoryFrameIndexTest, ExtendsStoredIndexForAppendedFrames)
+{
+    TrajectoryFrameIndex().write(fileName_);
+    writeFrames(3);
+    readIndex()->write(fileName_);
+    writeFrames(4);
+    auto index = readIndex();
+    ASSERT_TRUE(index.has_value());
+    checkIndex(*index);
+}
+
+TEST_P(TrajectoryFrameIndexTest, HandlesTruncatedTrajectory)
+{
+    TrajectoryFrameIndex().write(fileName_);
+    writeFrames(5);
+    readIndex()->write(fileName_);
+    // Truncate within the fourth frame, as a crashed run could leave it.
+    gmx_truncate(fileName_, offsets_[3] + 8);
+    endOffset_ = offsets_[3];
+    offsets_.resize(3);
+    auto index = readIndex();
+    ASSERT_TRUE(index.has_value());
+    checkIndex(*index);
+}
+
+TEST_P(TrajectoryFrameIndexTest, IgnoresStoredIndexForOtherTrajectory)
+{
+    TrajectoryFrameIndex().write(fileName_);
+    writeFrames(5);
+    readIndex()->write(fileName_);
+    // Overwrite the trajectory with frames that start at different steps.
+    offsets_.clear();
+    step_ = 1000;
+    gmx_truncate(fileName_, 0);
+    writeFrames(2);
+    EXPECT_FALSE(readIndex().has_value());
+}
+
+INSTANTIATE_TEST_CASE_P(XtcAndTrr, TrajectoryFrameIndexTest, ::testing::Values(".xtc", ".trr"));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,218 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for XTC compression and decompression
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <cmath>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Parameters for a round-trip test: number of atoms, precision
+ * and the edge length of the cubic volume to place the atoms in. */
+struct XtcRoundTripParameters
+{
+    //! Number of atoms.
+    int numAtoms;
+    //! XTC precision, 1/nm.
+    real precision;
+    //! Size of the volume to place the atoms in, nm.
+    real size;
+};
+
+class XtcRoundTripTest : public ::testing::TestWithParam<XtcRoundTripParameters>
+{
+public:
+    //! Writes a trajectory with numFrames_ frames to \p fileName and returns the coordinates.
+    std::vector<std::vector<RVec>> writeTrajectory(const std::string& fileName)
+    {
+        const XtcRoundTripParameters& params = GetParam();
+
+        // Water-like triplets of nearby atoms exercise the run-length encoded
+        // small differences, while the random placement of the triplets
+        // exercises the full-range integer encoding.
+        ThreeFry2x64<16>              rng(12345, RandomDomain::Other);
+        UniformRealDistribution<real> position(0, params.size);
+        UniformRealDistribution<real> offset(-0.1, 0.1);
+        std::vector<std::vector<RVec>> frames(numFrames_, std::vector<RVec>(params.numAtoms));
+        for (auto& x : frames)
+        {
+            for (int i = 0; i < params.numAtoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x[i][d] = (i % 3 == 0) ? position(rng) : x[i - i % 3][d] + offset(rng);
+                }
+            }
+        }
+        matrix box = { { params.size, 0, 0 }, { 0, params.size, 0 }, { 0, 0, params.size } };
+
+        t_fileio* fio = open_xtc(fileName.c_str(), "w");
+        for (int frame = 0; frame < numFrames_; frame++)
+        {
+            EXPECT_EQ(1,
+                      write_xtc(fio,
+                                params.numAtoms,
+                                frame,
+                                frame,
+                                box,
+                                as_rvec_array(frames[frame].data()),
+                                params.precision));
+        }
+        close_xtc(fio);
+        return frames;
+    }
+
+    //! Returns the tolerance for comparing decompressed coordinates.
+    real tolerance() const
+    {
+        // Rounding to the precision gives an error of at most half a unit,
+        // in addition there is the float round-off in the conversion.
+        return 0.5 / GetParam().precision + 4 * GMX_FLOAT_EPS * GetParam().size;
+    }
+
+    const int       numFrames_ = 3;
+    TestFileManager fileManager_;
+};
+
+TEST_P(XtcRoundTripTest, DecompressesWithinPrecision)
+{
+    const XtcRoundTripParameters&        params   = GetParam();
+    const std::string                    fileName = fileManager_.getTemporaryFilePath(".xtc");
+    const std::vector<std::vector<RVec>> frames   = writeTrajectory(fileName);
+
+    t_fileio* fio = open_xtc(fileName.c_str(), "r");
+    int       numAtoms;
+    int64_t   step;
+    real      time, precision;
+    matrix    readBox;
+    rvec*     x = nullptr;
+    gmx_bool  bOK;
+    ASSERT_EQ(1, read_first_xtc(fio, &numAtoms, &step, &time, readBox, &x, &precision, &bOK));
+    ASSERT_EQ(params.numAtoms, numAtoms);
+    for (int frame = 0; frame < numFrames_; frame++)
+    {
+        if (frame > 0)
+        {
+            ASSERT_EQ(1, read_next_xtc(fio, numAtoms, &step, &time, readBox, x, &precision, &bOK));
+        }
+        ASSERT_TRUE(bOK);
+        EXPECT_EQ(frame, step);
+        for (int i = 0; i < numAtoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(frames[frame][i][d], x[i][d], tolerance()) << "atom " << i << " frame " << frame;
+            }
+        }
+    }
+    EXPECT_EQ(0, read_next_xtc(fio, numAtoms, &step, &time, readBox, x, &precision, &bOK));
+    close_xtc(fio);
+    sfree(x);
+}
+
+TEST_P(XtcRoundTripTest, DecompressesLeadingAtoms)
+{
+    const XtcRoundTripParameters&        params   = GetParam();
+    const std::string                    fileName = fileManager_.getTemporaryFilePath(".xtc");
+    const std::vector<std::vector<RVec>> frames   = writeTrajectory(fileName);
+    // Stop the decoding both at the start and in the middle of a water-like triplet.
+    const int numAtomsToDecode[] = { params.numAtoms / 3, params.numAtoms / 2 + 1 };
+
+    t_fileio* fio = open_xtc(fileName.c_str(), "r");
+    int       numAtoms;
+    int64_t   step;
+    real      time, precision;
+    matrix    box;
+    rvec*     x = nullptr;
+    gmx_bool  bOK;
+    ASSERT_EQ(1, read_first_xtc(fio, &numAtoms, &step, &time, box, &x, &precision, &bOK));
+    for (int frame = 1; frame < numFrames_; frame++)
+    {
+        const int numDecoded = numAtomsToDecode[frame - 1];
+        ASSERT_EQ(1,
+                  read_next_xtc_partial(
+                          fio, numAtoms, numDecoded, &step, &time, box, x, &precision, &bOK));
+        ASSERT_TRUE(bOK);
+        EXPECT_EQ(frame, step);
+        for (int i = 0; i < numDecoded; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(frames[frame][i][d], x[i][d], tolerance()) << "atom " << i << " frame " << frame;
+            }
+        }
+    }
+    // The partial reads leave the file positioned at the next frame.
+    EXPECT_EQ(0, read_next_xtc(fio, numAtoms, &step, &time, box, x, &precision, &bOK));
+    close_xtc(fio);
+    sfree(x);
+}
+
+//! Cases covering the different integer encodings used by the compression.
+const XtcRoundTripParameters c_xtcRoundTripCases[] = {
+    { 3000, 1000, 5 },    // Small differences, combined integers fit in 64 bits
+    { 3000, 1000, 8000 }, // Combined integers need more than 64 bits
+    { 3000, 1e4, 2000 },  // Each integer is encoded separately
+};
+
+INSTANTIATE_TEST_CASE_P(XtcCompression, XtcRoundTripTest, ::testing::ValuesIn(c_xtcRoundTripCases));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,291 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the index of frame locations in XTC and TRR trajectory files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "trajectoryframeindex.h"
+
+#include <cstdio>
+
+#include <algorithm>
+
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/gmxfio_xdr.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/utility/fileptr.h"
+#include "gromacs/utility/inmemoryserializer.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Magic number at the start of each XTC frame.
+const int c_xtcMagic = 1995;
+//! Magic number at the start of each TRR frame.
+const int c_trrMagic = 1993;
+//! Magic number identifying a frame index file.
+const int c_frameIndexMagic = 0x47465849;
+//! Version of the frame index file format.
+const int c_frameIndexVersion = 1;
+//! Size in bytes of the header of a frame index file.
+const size_t c_frameIndexHeaderSize = 2 * sizeof(int32_t) + 2 * sizeof(int64_t);
+//! Size in bytes of each frame in a frame index file.
+const size_t c_frameIndexFrameSize = 2 * sizeof(int64_t) + sizeof(double);
+
+/*! \brief
+ * Reads the frame header starting at \p offset and positions \p fio after
+ * the frame.
+ *
+ * \returns whether a complete frame header was found.
+ */
+bool skipFrame(t_fileio* fio, gmx_off_t offset, int64_t* step, double* time)
+{
+    const int fileType = gmx_fio_getftp(fio);
+    if (gmx_fio_seek(fio, offset) != 0)
+    {
+        return false;
+    }
+    // Check the magic number first, as the readers fail fatally for
+    // anything that is not a frame header.
+    int magic;
+    if (xdr_int(gmx_fio_getxdr(fio), &magic) == 0
+        || magic != (fileType == efXTC ? c_xtcMagic : c_trrMagic)
+        || gmx_fio_seek(fio, offset) != 0)
+    {
+        return false;
+    }
+    gmx_bool bOK;
+    if (fileType == efXTC)
+    {
+        real frameTime;
+        if (!skip_next_xtc(fio, step, &frameTime, &bOK))
+        {
+            return false;
+        }
+        *time = frameTime;
+        return true;
+    }
+    gmx_trr_header_t header;
+    if (!gmx_trr_read_frame_header(fio, &header, &bOK) || !gmx_trr_skip_frame_data(fio, &header))
+    {
+        return false;
+    }
+    *step = header.step;
+    *time = header.t;
+    return true;
+}
+
+//! Returns whether \p frame is found in the file at its recorded location and ends at \p endOffset.
+bool frameMatchesFile(t_fileio* fio, const TrajectoryFrameLocation& frame, gmx_off_t endOffset)
+{
+    int64_t step;
+    double  time;
+    return skipFrame(fio, frame.offset, &step, &time) && step == frame.step
+           && gmx_fio_ftell(fio) == endOffset;
+}
+
+//! Reads the stored index, or returns nothing if there is no valid index file.
+std::optional<TrajectoryFrameIndex> readStoredIndex(const std::string& fileName)
+{
+    FilePtr fp(std::fopen(fileName.c_str(), "rb"));
+    if (!fp)
+    {
+        return std::nullopt;
+    }
+    std::vector<char> buffer;
+    char              chunk[4096];
+    size_t            numRead;
+    while ((numRead = std::fread(chunk, 1, sizeof(chunk), fp.get())) > 0)
+    {
+        buffer.insert(buffer.end(), chunk, chunk + numRead);
+    }
+    if (buffer.size() < c_frameIndexHeaderSize
+        || (buffer.size() - c_frameIndexHeaderSize) % c_frameIndexFrameSize != 0)
+    {
+        return std::nullopt;
+    }
+
+    InMemoryDeserializer serializer(buffer, false, EndianSwapBehavior::SwapIfHostIsLittleEndian);
+    int32_t              magic, version;
+    int64_t              endOffset, numFrames;
+    serializer.doInt32(&magic);
+    serializer.doInt32(&version);
+    serializer.doInt64(&endOffset);
+    serializer.doInt64(&numFrames);
+    if (magic != c_frameIndexMagic || version != c_frameIndexVersion
+        || (buffer.size() - c_frameIndexHeaderSize) / c_frameIndexFrameSize != static_cast<size_t>(numFrames))
+    {
+        return std::nullopt;
+    }
+    TrajectoryFrameIndex index;
+    for (int64_t i = 0; i < numFrames; i++)
+    {
+        TrajectoryFrameLocation frame;
+        int64_t                 offset;
+        serializer.doInt64(&frame.step);
+        serializer.doDouble(&frame.time);
+        serializer.doInt64(&offset);
+        frame.offset = offset;
+        index.addFrame(frame.step, frame.time, frame.offset, endOffset);
+    }
+    return index;
+}
+
+} // namespace
+
+std::string TrajectoryFrameIndex::fileNameForTrajectory(const std::string& trajectoryFileName)
+{
+    return trajectoryFileName + ".frameidx";
+}
+
+std::optional<TrajectoryFrameIndex> TrajectoryFrameIndex::readStored(const std::string& trajectoryFileName,
+                                                                     t_fileio*          fio)
+{
+    auto index = readStoredIndex(fileNameForTrajectory(trajectoryFileName));
+    if (!index)
+    {
+        return std::nullopt;
+    }
+
+    const gmx_off_t originalPosition = gmx_fio_ftell(fio);
+    gmx_fseek(gmx_fio_getfp(fio), 0, SEEK_END);
+    const gmx_off_t fileSize = gmx_fio_ftell(fio);
+
+    // Keep the frames from the stored index that are still in the file,
+    // provided that the first and last of them are found where expected.
+    index->truncate(fileSize);
+    const auto& frames = index->frames_;
+    if (!frames.empty()
+        && !(frameMatchesFile(fio, frames.front(), frames.size() > 1 ? frames[1].offset : index->endOffset_)
+             && frameMatchesFile(fio, frames.back(), index->endOffset_)))
+    {
+        gmx_fio_seek(fio, originalPosition);
+        return std::nullopt;
+    }
+
+    // Read the headers of the frames appended after the index was stored.
+    int64_t step;
+    double  time;
+    while (index->endOffset_ < fileSize && skipFrame(fio, index->endOffset_, &step, &time)
+           && gmx_fio_ftell(fio) <= fileSize)
+    {
+        index->addFrame(step, time, index->endOffset_, gmx_fio_ftell(fio));
+    }
+
+    gmx_fio_seek(fio, originalPosition);
+    return index;
+}
+
+void TrajectoryFrameIndex::addFrame(int64_t step, double time, gmx_off_t offset, gmx_off_t endOffset)
+{
+    frames_.push_back({ step, time, offset });
+    endOffset_ = endOffset;
+}
+
+void TrajectoryFrameIndex::truncate(gmx_off_t size)
+{
+    if (endOffset_ <= size)
+    {
+        return;
+    }
+    // The frames are contiguous, so the first frame that does not end
+    // within the file is the last one that starts within it.
+    auto firstRemoved = std::upper_bound(
+            frames_.begin(), frames_.end(), size, [](gmx_off_t value, const TrajectoryFrameLocation& frame) {
+                return value < frame.offset;
+            });
+    if (firstRemoved == frames_.begin())
+    {
+        endOffset_ = 0;
+    }
+    else
+    {
+        --firstRemoved;
+        endOffset_ = firstRemoved->offset;
+    }
+    frames_.erase(firstRemoved, frames_.end());
+}
+
+int TrajectoryFrameIndex::frameStartingAt(gmx_off_t offset) const
+{
+    auto frame = std::lower_bound(
+            frames_.begin(), frames_.end(), offset, [](const TrajectoryFrameLocation& frame, gmx_off_t value) {
+                return frame.offset < value;
+            });
+    if (frame == frames_.end() || frame->offset != offset)
+    {
+        return -1;
+    }
+    return static_cast<int>(frame - frames_.begin());
+}
+
+void TrajectoryFrameIndex::write(const std::string& trajectoryFileName) const
+{
+    InMemorySerializer serializer(EndianSwapBehavior::SwapIfHostIsLittleEndian);
+    int32_t            magic     = c_frameIndexMagic;
+    int32_t            version   = c_frameIndexVersion;
+    int64_t            endOffset = endOffset_;
+    int64_t            numFrames = frames_.size();
+    serializer.doInt32(&magic);
+    serializer.doInt32(&version);
+    serializer.doInt64(&endOffset);
+    serializer.doInt64(&numFrames);
+    for (TrajectoryFrameLocation frame : frames_)
+    {
+        int64_t offset = frame.offset;
+        serializer.doInt64(&frame.step);
+        serializer.doDouble(&frame.time);
+        serializer.doInt64(&offset);
+    }
+    const std::vector<char> buffer = serializer.finishAndGetBuffer();
+
+    FilePtr fp(std::fopen(fileNameForTrajectory(trajectoryFileName).c_str(), "wb"));
+    if (fp)
+    {
+        std::fwrite(buffer.data(), 1, buffer.size(), fp.get());
+    }
+}
+
+} // namespace gmx
@@ -0,0 +1,139 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares an index of frame locations in XTC and TRR trajectory files.
+ *
+ * The index allows seeking directly to a frame, instead of reading (and for
+ * XTC, decompressing) all preceding frames or searching for frame headers.
+ * It can be stored next to the trajectory in a small file, which mdrun
+ * writes for its XTC and TRR output when requested. Readers only use a
+ * stored index that matches the trajectory, and never write one.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_TRAJECTORYFRAMEINDEX_H
+#define GMX_FILEIO_TRAJECTORYFRAMEINDEX_H
+
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/futil.h"
+
+struct t_fileio;
+
+namespace gmx
+{
+
+//! Location and identification of a single frame in a trajectory file.
+struct TrajectoryFrameLocation
+{
+    //! MD step of the frame.
+    int64_t step;
+    //! Time of the frame.
+    double time;
+    //! Offset of the start of the frame in the file, in bytes.
+    gmx_off_t offset;
+};
+
+/*! \libinternal \brief
+ * Index of the frames in an XTC or TRR trajectory file.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class TrajectoryFrameIndex
+{
+public:
+    //! Returns the name of the file that stores the index for \p trajectoryFileName.
+    static std::string fileNameForTrajectory(const std::string& trajectoryFileName);
+
+    /*! \brief
+     * Returns the index stored for the trajectory opened in \p fio.
+     *
+     * The index stored for \p trajectoryFileName is used for all frames it
+     * still describes correctly, and frame headers are read for the frames
+     * that were appended after it was stored. Without a stored index that
+     * matches the trajectory, nothing is returned and the trajectory is not
+     * scanned. Frame data is never read. The file position of \p fio is
+     * preserved.
+     */
+    static std::optional<TrajectoryFrameIndex> readStored(const std::string& trajectoryFileName,
+                                                          t_fileio*          fio);
+
+    /*! \brief
+     * Adds a frame that occupies bytes [\p offset, \p endOffset) of the file.
+     *
+     * Frames must be added in the order they are stored in the file,
+     * without gaps between them.
+     */
+    void addFrame(int64_t step, double time, gmx_off_t offset, gmx_off_t endOffset);
+    /*! \brief
+     * Removes the frames that do not end at or before \p size.
+     *
+     * Used when a trajectory has been truncated, e.g., for appending output.
+     */
+    void truncate(gmx_off_t size);
+
+    //! Returns the frames in the index.
+    ArrayRef<const TrajectoryFrameLocation> frames() const { return frames_; }
+    //! Returns the offset where the last frame in the index ends.
+    gmx_off_t endOffset() const { return endOffset_; }
+    //! Returns the index of the frame starting at \p offset, or -1 if no frame starts there.
+    int frameStartingAt(gmx_off_t offset) const;
+
+    /*! \brief
+     * Writes the index for \p trajectoryFileName.
+     *
+     * As the index is only an optimization, failing to write it is not
+     * an error.
+     */
+    void write(const std::string& trajectoryFileName) const;
+
+private:
+    //! Frames in the order they are stored in the file.
+    std::vector<TrajectoryFrameLocation> frames_;
+    //! Offset where the last frame ends.
+    gmx_off_t endOffset_ = 0;
+};
+
+} // namespace gmx
+
+#endif
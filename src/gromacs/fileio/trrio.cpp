@@ -367,6 +367,16 @@ gmx_bool gmx_trr_read_frame_data(t_fileio* fio, gmx_trr_header_t* header, rvec*
     return do_trr_frame_data(fio, header, box, x, v, f);
 }
 
+gmx_bool gmx_trr_skip_frame_data(t_fileio* fio, const gmx_trr_header_t* sh)
+{
+    /* The sizes in the header are the sizes of the data blocks in bytes */
+    const gmx_off_t dataSize = static_cast<gmx_off_t>(sh->ir_size) + sh->e_size + sh->box_size
+                               + sh->vir_size + sh->pres_size + sh->top_size + sh->sym_size
+                               + sh->x_size + sh->v_size + sh->f_size;
+
+    return gmx_fio_seek(fio, gmx_fio_ftell(fio) + dataSize) == 0;
+}
+
 t_fileio* gmx_trr_open(const char* fn, const char* mode)
 {
     return gmx_fio_open(fn, mode);
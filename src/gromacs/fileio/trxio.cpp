@@ -43,8 +43,12 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+#include <utility>
+
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/filetypes.h"
@@ -52,11 +56,13 @@
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/groio.h"
+#include "gromacs/fileio/mappedtrrreader.h"
 #include "gromacs/fileio/oenv.h"
 #include "gromacs/fileio/pdbio.h"
 #include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/tpxio.h"
+#include "gromacs/fileio/trajectoryframeindex.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/fileio/xtcio.h"
@@ -91,9 +97,12 @@ struct t_trxstatus
     t_fileio*            fio;
     gmx_tng_trajectory_t tng;
     int                  natoms;
+    int                  natomsToRead; /* Number of atoms to read for XTC and mapped TRR, 0 means all */
     double               DT, BOX[3];
     gmx_bool             bReadBox;
     char*                persistent_line; /* Persistent line for reading g96 trajectories */
+    gmx::TrajectoryFrameIndex* frameIndex; /* Frame locations for skipping frames, can be NULL */
+    gmx::MappedTrrReader*      mappedTrr;  /* Reader for TRR files through a mapping, can be NULL */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t* vmdplugin;
 #endif
@@ -173,6 +182,9 @@ static void status_init(t_trxstatus* status)
     status->tf              = 0;
     status->persistent_line = nullptr;
     status->tng             = nullptr;
+    status->frameIndex      = nullptr;
+    status->mappedTrr       = nullptr;
+    status->natomsToRead    = 0;
 }
 
 
@@ -271,6 +283,11 @@ float trx_get_time_of_final_frame(t_trxstatus* status)
     return lasttime;
 }
 
+void trx_set_natoms_to_read(t_trxstatus* status, int natoms)
+{
+    status->natomsToRead = natoms;
+}
+
 void clear_trxframe(t_trxframe* fr, gmx_bool bFirst)
 {
     fr->not_ok    = 0;
@@ -640,6 +657,8 @@ void close_trx(t_trxstatus* status)
         gmx_fio_close(status->fio);
     }
     sfree(status->persistent_line);
+    delete status->frameIndex;
+    delete status->mappedTrr;
 #if GMX_USE_PLUGINS
     sfree(status->vmdplugin);
 #endif
@@ -665,49 +684,109 @@ t_trxstatus* open_trx(const char* outfile, const char* filemode)
     return stat;
 }
 
+static void set_trr_frame_header(t_trxstatus* status, t_trxframe* fr, const gmx_trr_header_t& sh)
+{
+    fr->bDouble   = sh.bDouble;
+    fr->natoms    = sh.natoms;
+    fr->bStep     = TRUE;
+    fr->step      = sh.step;
+    fr->bTime     = TRUE;
+    fr->time      = sh.t;
+    fr->bLambda   = TRUE;
+    fr->bFepState = TRUE;
+    fr->lambda    = sh.lambda;
+    fr->bBox      = sh.box_size > 0;
+    if (status->flags & (TRX_READ_X | TRX_NEED_X))
+    {
+        if (fr->x == nullptr)
+        {
+            snew(fr->x, sh.natoms);
+        }
+        fr->bX = sh.x_size > 0;
+    }
+    if (status->flags & (TRX_READ_V | TRX_NEED_V))
+    {
+        if (fr->v == nullptr)
+        {
+            snew(fr->v, sh.natoms);
+        }
+        fr->bV = sh.v_size > 0;
+    }
+    if (status->flags & (TRX_READ_F | TRX_NEED_F))
+    {
+        if (fr->f == nullptr)
+        {
+            snew(fr->f, sh.natoms);
+        }
+        fr->bF = sh.f_size > 0;
+    }
+}
+
+/* Reads a TRR frame from the mapped file, starting at the position of
+ * status->fio, and positions status->fio after the frame.
+ * Only the requested data is converted, directly from the mapping.
+ */
+static gmx_bool gmx_next_frame_mapped(t_trxstatus* status, t_trxframe* fr)
+{
+    gmx::MappedTrrReader* reader = status->mappedTrr;
+    gmx_bool              bOK;
+
+    if (!reader->readFrameHeader(gmx_fio_ftell(status->fio), &bOK))
+    {
+        if (!bOK)
+        {
+            fr->not_ok = HEADER_NOT_OK;
+        }
+        return FALSE;
+    }
+    const gmx_trr_header_t& sh = reader->header();
+    set_trr_frame_header(status, fr, sh);
+    if (!reader->hasFrameData())
+    {
+        fr->not_ok = DATA_NOT_OK;
+        return FALSE;
+    }
+    if (status->natomsToRead > 0 && status->natomsToRead < sh.natoms)
+    {
+        /* Only the data of the atoms needed is converted */
+        fr->natoms = status->natomsToRead;
+    }
+    if (sh.box_size > 0)
+    {
+        reader->box().copyTo(fr->box);
+    }
+    if (fr->x != nullptr && sh.x_size > 0)
+    {
+        reader->x().copyTo(fr->natoms, fr->x);
+    }
+    if (fr->v != nullptr && sh.v_size > 0)
+    {
+        reader->v().copyTo(fr->natoms, fr->v);
+    }
+    if (fr->f != nullptr && sh.f_size > 0)
+    {
+        reader->f().copyTo(fr->natoms, fr->f);
+    }
+    gmx_fio_seek(status->fio, reader->frameEndOffset());
+
+    return TRUE;
+}
+
 static gmx_bool gmx_next_frame(t_trxstatus* status, t_trxframe* fr)
 {
     gmx_trr_header_t sh;
     gmx_bool         bOK, bRet;
 
+    if (status->mappedTrr)
+    {
+        return gmx_next_frame_mapped(status, fr);
+    }
+
     bRet = FALSE;
 
     if (gmx_trr_read_frame_header(status->fio, &sh, &bOK))
     {
-        fr->bDouble   = sh.bDouble;
-        fr->natoms    = sh.natoms;
-        fr->bStep     = TRUE;
-        fr->step      = sh.step;
-        fr->bTime     = TRUE;
-        fr->time      = sh.t;
-        fr->bLambda   = TRUE;
-        fr->bFepState = TRUE;
-        fr->lambda    = sh.lambda;
-        fr->bBox      = sh.box_size > 0;
-        if (status->flags & (TRX_READ_X | TRX_NEED_X))
-        {
-            if (fr->x == nullptr)
-            {
-                snew(fr->x, sh.natoms);
-            }
-            fr->bX = sh.x_size > 0;
-        }
-        if (status->flags & (TRX_READ_V | TRX_NEED_V))
-        {
-            if (fr->v == nullptr)
-            {
-                snew(fr->v, sh.natoms);
-            }
-            fr->bV = sh.v_size > 0;
-        }
-        if (status->flags & (TRX_READ_F | TRX_NEED_F))
-        {
-            if (fr->f == nullptr)
-            {
-                snew(fr->f, sh.natoms);
-            }
-            fr->bF = sh.f_size > 0;
-        }
+        set_trr_frame_header(status, fr, sh);
         if (gmx_trr_read_frame_data(status->fio, &sh, fr->box, fr->x, fr->v, fr->f))
         {
             bRet = TRUE;
@@ -806,6 +885,30 @@ static int pdb_first_x(t_trxstatus* status, FILE* fp, t_trxframe* fr)
     return fr->natoms;
 }
 
+/* Positions the file at the next frame that check_times2() does not skip,
+ * using the frame index to avoid reading the skipped frames.
+ */
+static void skip_frames_with_index(t_trxstatus* status, const gmx_output_env_t* oenv, gmx_bool bDouble)
+{
+    const auto frames = status->frameIndex->frames();
+    int        first  = status->frameIndex->frameStartingAt(gmx_fio_ftell(status->fio));
+    if (first < 0)
+    {
+        return;
+    }
+    int frame = first;
+    while (frame < frames.ssize() && check_times2(frames[frame].time, status->t0, bDouble) < 0)
+    {
+        printcount(status, oenv, frames[frame].time, TRUE);
+        frame++;
+    }
+    if (frame > first)
+    {
+        gmx_fio_seek(status->fio,
+                     frame < frames.ssize() ? frames[frame].offset : status->frameIndex->endOffset());
+    }
+}
+
 bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxframe* fr)
 {
     real     pt;
@@ -818,6 +921,11 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
 
     do
     {
+        if (status->frameIndex && !(status->flags & TRX_DONT_SKIP))
+        {
+            skip_frames_with_index(status, oenv, fr->bDouble);
+        }
+
         clear_trxframe(fr, FALSE);
 
         if (status->tng)
@@ -843,7 +951,7 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                 break;
             }
             case efXTC:
-                if (bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
+                if (!status->frameIndex && bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
                 {
                     if (xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
                     {
@@ -854,9 +962,32 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                     }
                     initcount(status);
                 }
-                bRet      = (read_next_xtc(
-                                status->fio, fr->natoms, &fr->step, &fr->time, fr->box, fr->x, &fr->prec, &bOK)
-                        != 0);
+                if (status->natomsToRead > 0 && status->natomsToRead < status->natoms)
+                {
+                    /* Decompressing only the atoms needed saves most of the time */
+                    bRet = (read_next_xtc_partial(status->fio,
+                                                  status->natoms,
+                                                  status->natomsToRead,
+                                                  &fr->step,
+                                                  &fr->time,
+                                                  fr->box,
+                                                  fr->x,
+                                                  &fr->prec,
+                                                  &bOK)
+                            != 0);
+                    if (bRet)
+                    {
+                        fr->natoms = status->natomsToRead;
+                    }
+                }
+                else
+                {
+                    /* After partial frames, fr->natoms is less than the frame size */
+                    fr->natoms = std::max(fr->natoms, status->natoms);
+                    bRet       = (read_next_xtc(
+                                    status->fio, fr->natoms, &fr->step, &fr->time, fr->box, fr->x, &fr->prec, &bOK)
+                            != 0);
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
@@ -948,9 +1079,26 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
     {
         fio = (*status)->fio = gmx_fio_open(fn, "r");
     }
+    if ((ftp == efXTC || ftp == efTRR) && !(flags & TRX_DONT_SKIP) && (bTimeSet(TBEGIN) || bTimeSet(TDELTA)))
+    {
+        /* With the frame locations stored next to the trajectory, frames
+         * that are skipped need not be read. Without them, XTC files are
+         * searched for the starting time instead.
+         */
+        auto frameIndex = gmx::TrajectoryFrameIndex::readStored(fn, fio);
+        if (frameIndex)
+        {
+            (*status)->frameIndex = new gmx::TrajectoryFrameIndex(std::move(*frameIndex));
+        }
+    }
     switch (ftp)
     {
-        case efTRR: break;
+        case efTRR:
+            if (getenv("GMX_TRR_MMAP") != nullptr && gmx::MappedTrrReader::isSupported())
+            {
+                (*status)->mappedTrr = new gmx::MappedTrrReader(fn);
+            }
+            break;
         case efCPT:
             read_checkpoint_trxframe(fio, fr);
             bFirst = FALSE;
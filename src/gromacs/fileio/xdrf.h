@@ -58,6 +58,15 @@
 /* Read or write reduced precision *float* coordinates */
 int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision);
 
+/* Read reduced precision *float* coordinates, but only decode the first
+ * numAtomsToDecode of the *size atoms. A few more atoms can be decoded,
+ * so fp should have room for all *size atoms, but only the first
+ * numAtomsToDecode are guaranteed to be set. The rest of the compressed
+ * data is still consumed, so xdrs is positioned after the coordinates.
+ * When writing, this is the same as xdr3dfcoord().
+ */
+int xdr3dfcoord_partial(XDR* xdrs, float* fp, int* size, float* precision, int numAtomsToDecode);
+
 
 /* Read or write a *real* value (stored as float) */
 int xdr_real(XDR* xdrs, real* r);
@@ -41,6 +41,8 @@
 
 #include <cstring>
 
+#include <algorithm>
+
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/xdrf.h"
@@ -140,7 +142,9 @@ static int xtc_header(XDR* xd, int* magic, int* natoms, int64_t* step, real* tim
     return result;
 }
 
-static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_bool bRead)
+/* Reads or writes the box and coordinates. When reading, only the first
+ * natomsDecode coordinates are guaranteed to be decompressed. */
+static int xtc_coord(XDR* xd, int* natoms, int natomsDecode, rvec* box, rvec* x, real* prec, gmx_bool bRead)
 {
     int i, j, result;
 #if GMX_DOUBLE
@@ -178,12 +182,12 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
         }
         fprec = *prec;
     }
-    result = XTC_CHECK("x", xdr3dfcoord(xd, ftmp, natoms, &fprec));
+    result = XTC_CHECK("x", xdr3dfcoord_partial(xd, ftmp, natoms, &fprec, natomsDecode));
 
     /* Copy from temp. array if reading */
     if (bRead)
     {
-        for (i = 0; (i < *natoms); i++)
+        for (i = 0; (i < std::min(*natoms, natomsDecode)); i++)
         {
             x[i][XX] = ftmp[DIM * i + XX];
             x[i][YY] = ftmp[DIM * i + YY];
@@ -193,7 +197,7 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
     }
     sfree(ftmp);
 #else
-    result = XTC_CHECK("x", xdr3dfcoord(xd, x[0], natoms, prec));
+    result = XTC_CHECK("x", xdr3dfcoord_partial(xd, x[0], natoms, prec, natomsDecode));
 #endif
 
     return result;
@@ -223,7 +227,7 @@ int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* bo
     }
 
     /* write data */
-    bOK = xtc_coord(xd, &natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), &prec, FALSE); /* bOK will be 1 if writing went well */
+    bOK = xtc_coord(xd, &natoms, natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), &prec, FALSE); /* bOK will be 1 if writing went well */
 
     if (bOK)
     {
@@ -254,12 +258,25 @@ int read_first_xtc(t_fileio* fio, int* natoms, int64_t* step, real* time, matrix
 
     snew(*x, *natoms);
 
-    *bOK = (xtc_coord(xd, natoms, box, *x, prec, TRUE) != 0);
+    *bOK = (xtc_coord(xd, natoms, *natoms, box, *x, prec, TRUE) != 0);
 
     return static_cast<int>(*bOK);
 }
 
 int read_next_xtc(t_fileio* fio, int natoms, int64_t* step, real* time, matrix box, rvec* x, real* prec, gmx_bool* bOK)
+{
+    return read_next_xtc_partial(fio, natoms, natoms, step, time, box, x, prec, bOK);
+}
+
+int read_next_xtc_partial(t_fileio* fio,
+                          int       natoms,
+                          int       natomsDecode,
+                          int64_t*  step,
+                          real*     time,
+                          matrix    box,
+                          rvec*     x,
+                          real*     prec,
+                          gmx_bool* bOK)
 {
     int  magic;
     int  n;
@@ -282,7 +299,52 @@ int read_next_xtc(t_fileio* fio, int natoms, int64_t* step, real* time, matrix b
         gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)", n, natoms);
     }
 
-    *bOK = (xtc_coord(xd, &natoms, box, x, prec, TRUE) != 0);
+    *bOK = (xtc_coord(xd, &natoms, natomsDecode, box, x, prec, TRUE) != 0);
+
+    return static_cast<int>(*bOK);
+}
+
+int skip_next_xtc(t_fileio* fio, int64_t* step, real* time, gmx_bool* bOK)
+{
+    int  magic;
+    int  natoms;
+    XDR* xd;
+
+    *bOK = TRUE;
+    xd   = gmx_fio_getxdr(fio);
+
+    /* read header */
+    if (!xtc_header(xd, &magic, &natoms, step, time, TRUE, bOK))
+    {
+        return 0;
+    }
+
+    /* Check magic number */
+    check_xtc_magic(magic);
+
+    /* The box and the atom count precede the coordinates. Up to nine atoms
+     * are stored uncompressed, otherwise the precision, the integer ranges
+     * and the initial small index precede the size of the compressed data
+     * in bytes, which is padded to full XDR units.
+     */
+    const int c_xdrUnit   = 4;
+    gmx_off_t numSkipped  = (DIM * DIM + 1) * c_xdrUnit;
+    gmx_off_t dataSizePos = gmx_fio_ftell(fio) + numSkipped + (1 + 2 * DIM + 1) * c_xdrUnit;
+    if (natoms <= 9)
+    {
+        numSkipped += natoms * DIM * c_xdrUnit;
+    }
+    else
+    {
+        int dataSize;
+        if (gmx_fio_seek(fio, dataSizePos) != 0 || !XTC_CHECK("data size", xdr_int(xd, &dataSize)))
+        {
+            *bOK = FALSE;
+            return 0;
+        }
+        numSkipped = (dataSize + c_xdrUnit - 1) / c_xdrUnit * c_xdrUnit;
+    }
+    *bOK = (gmx_fio_seek(fio, gmx_fio_ftell(fio) + numSkipped) == 0);
 
     return static_cast<int>(*bOK);
 }
@@ -75,6 +75,26 @@ int read_first_xtc(struct t_fileio* fio,
 int read_next_xtc(struct t_fileio* fio, int natoms, int64_t* step, real* time, matrix box, rvec* x, real* prec, gmx_bool* bOK);
 /* Read subsequent frames */
 
+int read_next_xtc_partial(struct t_fileio* fio,
+                          int              natoms,
+                          int              natomsDecode,
+                          int64_t*         step,
+                          real*            time,
+                          matrix           box,
+                          rvec*            x,
+                          real*            prec,
+                          gmx_bool*        bOK);
+/* Read subsequent frames, but only decompress the coordinates of the first
+ * natomsDecode atoms, which is faster when only those are needed.
+ * x should have room for natoms atoms, but only the first natomsDecode
+ * are guaranteed to be set.
+ */
+
+int skip_next_xtc(struct t_fileio* fio, int64_t* step, real* time, gmx_bool* bOK);
+/* Read the header of the next frame and skip its coordinates without
+ * decompressing them. The file is positioned at the following frame.
+ */
+
 int write_xtc(struct t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
 /* Write a frame to xtc file */
 
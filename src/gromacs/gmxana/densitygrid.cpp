@@ -0,0 +1,136 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the threaded grid accumulation shared by gmx density,
+ * gmx densmap and gmx spatial.
+ */
+#include "gmxpre.h"
+
+#include "densitygrid.h"
+
+#include <algorithm>
+
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+//! The number of cells each thread reduces at a time
+static constexpr int c_reductionBlockSize = 4096;
+
+DensityGridAccumulator::DensityGridAccumulator(int numCells, int numThreads) :
+    numCells_(numCells), threadGrids_(std::max(numThreads, 1))
+{
+    GMX_RELEASE_ASSERT(numCells >= 0, "Cannot have a negative number of cells");
+    const int numGrids = static_cast<int>(threadGrids_.size());
+    // Let every thread touch its own grid first so it is local to that thread
+#pragma omp parallel for num_threads(numGrids) schedule(static)
+    for (int thread = 0; thread < numGrids; thread++)
+    {
+        try
+        {
+            threadGrids_[thread].assign(numCells_, 0.0);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+ArrayRef<const double> DensityGridAccumulator::grid()
+{
+    const int numGrids  = static_cast<int>(threadGrids_.size());
+    const int numBlocks = (numCells_ + c_reductionBlockSize - 1) / c_reductionBlockSize;
+    if (numGrids > 1)
+    {
+#pragma omp parallel for num_threads(numGrids) schedule(static)
+        for (int block = 0; block < numBlocks; block++)
+        {
+            try
+            {
+                const int begin  = block * c_reductionBlockSize;
+                const int end    = std::min(begin + c_reductionBlockSize, numCells_);
+                double*   result = threadGrids_[0].data();
+                for (int thread = 1; thread < numGrids; thread++)
+                {
+                    double* grid = threadGrids_[thread].data();
+                    for (int cell = begin; cell < end; cell++)
+                    {
+                        result[cell] += grid[cell];
+                        grid[cell] = 0;
+                    }
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+    return threadGrids_[0];
+}
+
+GaussianDensityGridAccumulator::GaussianDensityGridAccumulator(const dynamicExtents3D& extents,
+                                                               const GaussianSpreadKernelParameters::Shape& kernelShape,
+                                                               int numThreads) :
+    threadTransforms_(std::max(numThreads, 1), GaussTransform3D(extents, kernelShape)),
+    grid_(extents.extent(0) * extents.extent(1) * extents.extent(2), 0.0)
+{
+}
+
+ArrayRef<const double> GaussianDensityGridAccumulator::grid()
+{
+    const int numCells = static_cast<int>(grid_.size());
+    const int numBlocks = (numCells + c_reductionBlockSize - 1) / c_reductionBlockSize;
+#pragma omp parallel for num_threads(static_cast<int>(threadTransforms_.size())) schedule(static)
+    for (int block = 0; block < numBlocks; block++)
+    {
+        try
+        {
+            const int begin = block * c_reductionBlockSize;
+            const int end   = std::min(begin + c_reductionBlockSize, numCells);
+            for (GaussTransform3D& transform : threadTransforms_)
+            {
+                // Layout of the transform is z, y, x with x running fastest
+                float* lattice = transform.view().data();
+                for (int cell = begin; cell < end; cell++)
+                {
+                    grid_[cell] += lattice[cell];
+                    lattice[cell] = 0;
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    return grid_;
+}
+
+} // namespace gmx
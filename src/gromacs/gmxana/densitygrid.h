@@ -0,0 +1,195 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares the threaded grid accumulation shared by gmx density,
+ * gmx densmap and gmx spatial.
+ */
+#ifndef GMX_GMXANA_DENSITYGRID_H
+#define GMX_GMXANA_DENSITYGRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "gromacs/math/gausstransform.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdspan/extensions.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+/*! \internal \brief
+ * Accumulates weighted counts into a grid of cells using all OpenMP threads.
+ *
+ * Every thread bins its share of the items into a private copy of the grid,
+ * so binning needs neither atomics nor locks. The private grids are summed
+ * only when the result is requested; during that reduction each thread owns
+ * a contiguous block of cells and adds up all copies of that block while it
+ * is in cache. Accumulation can continue after a reduction.
+ */
+class DensityGridAccumulator
+{
+public:
+    //! Sets up zeroed grids of \p numCells cells for \p numThreads threads.
+    DensityGridAccumulator(int numCells, int numThreads);
+
+    /*! \brief Bins \p numItems items, distributing them over the threads.
+     *
+     * \p binItem is called as binItem(i, &cell, &weight) for each item
+     * index i and returns false when the item should not be binned.
+     * It is called concurrently from several threads.
+     *
+     * \returns The number of items that were not binned.
+     */
+    template<typename BinItem>
+    int accumulate(int numItems, const BinItem& binItem);
+
+    //! Returns the grid summed over all threads.
+    ArrayRef<const double> grid();
+
+    //! Returns the number of cells in the grid.
+    int numCells() const { return numCells_; }
+
+private:
+    //! The number of cells per grid
+    int numCells_;
+    //! One private grid per thread, the first one holds the reduced result
+    std::vector<std::vector<double>> threadGrids_;
+};
+
+/*! \internal \brief
+ * Spreads Gaussians onto a three-dimensional lattice using all OpenMP threads.
+ *
+ * Each thread spreads into a private GaussTransform3D with the same
+ * precomputed kernel shape; the lattices are summed when the result is
+ * requested. Lattice coordinates and the layout of the result follow
+ * GaussTransform3D, i.e. the x index runs fastest.
+ */
+class GaussianDensityGridAccumulator
+{
+public:
+    /*! \brief Sets up zeroed lattices for \p numThreads threads.
+     *
+     * \param[in] extents     Lattice extents in z, y, x order
+     * \param[in] kernelShape Width and range of the Gaussian in lattice units
+     * \param[in] numThreads  The number of threads to spread with
+     */
+    GaussianDensityGridAccumulator(const dynamicExtents3D&                      extents,
+                                   const GaussianSpreadKernelParameters::Shape& kernelShape,
+                                   int                                          numThreads);
+
+    /*! \brief Spreads \p numItems Gaussians, distributing them over the threads.
+     *
+     * \p placeItem is called as placeItem(i, &latticeCoordinate, &amplitude)
+     * for each item index i and returns false when the item should be
+     * skipped. It is called concurrently from several threads.
+     */
+    template<typename PlaceItem>
+    void accumulate(int numItems, const PlaceItem& placeItem);
+
+    //! Returns the lattice summed over all threads, x index fastest.
+    ArrayRef<const double> grid();
+
+private:
+    //! One Gauss transform per thread
+    std::vector<GaussTransform3D> threadTransforms_;
+    //! The summed lattice
+    std::vector<double> grid_;
+};
+
+template<typename BinItem>
+int DensityGridAccumulator::accumulate(int numItems, const BinItem& binItem)
+{
+    const int numThreads = static_cast<int>(threadGrids_.size());
+    int       numSkipped = 0;
+#pragma omp parallel for num_threads(numThreads) schedule(static) reduction(+ : numSkipped)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            double*   grid  = threadGrids_[thread].data();
+            const int begin = static_cast<int>((static_cast<int64_t>(numItems) * thread) / numThreads);
+            const int end = static_cast<int>((static_cast<int64_t>(numItems) * (thread + 1)) / numThreads);
+            for (int i = begin; i < end; i++)
+            {
+                int    cell;
+                double weight;
+                if (binItem(i, &cell, &weight))
+                {
+                    grid[cell] += weight;
+                }
+                else
+                {
+                    numSkipped++;
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    return numSkipped;
+}
+
+template<typename PlaceItem>
+void GaussianDensityGridAccumulator::accumulate(int numItems, const PlaceItem& placeItem)
+{
+    const int numThreads = static_cast<int>(threadTransforms_.size());
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            GaussTransform3D& transform = threadTransforms_[thread];
+            const int begin = static_cast<int>((static_cast<int64_t>(numItems) * thread) / numThreads);
+            const int end = static_cast<int>((static_cast<int64_t>(numItems) * (thread + 1)) / numThreads);
+            for (int i = begin; i < end; i++)
+            {
+                RVec latticeCoordinate;
+                real amplitude;
+                if (placeItem(i, &latticeCoordinate, &amplitude))
+                {
+                    transform.add({ latticeCoordinate, amplitude });
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+} // namespace gmx
+
+#endif
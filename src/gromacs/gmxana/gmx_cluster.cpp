@@ -42,6 +42,8 @@
 #include <cstring>
 
 #include <algorithm>
+#include <functional>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -53,6 +55,7 @@
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/linearalgebra/eigensolver.h"
 #include "gromacs/math/do_fit.h"
+#include "gromacs/math/rmsdmatrix.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
@@ -65,6 +68,7 @@
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
 
@@ -640,10 +644,12 @@ static void dump_nnb(FILE* fp, const char* title, int n1, t_nnb* nnb)
     }
 }
 
+static void gromos_clusters(int n1, t_nnb* nnb, t_clusters* clust);
+
 static void gromos(int n1, real** mat, real rmsdcut, t_clusters* clust)
 {
     t_nnb* nnb;
-    int    i, j, k, j1, maxval;
+    int    i, j, k, maxval;
 
     /* Put all neighbors nearer than rmsdcut in the list */
     fprintf(stderr, "Making list of neighbors within cutoff ");
@@ -675,6 +681,60 @@ static void gromos(int n1, real** mat, real rmsdcut, t_clusters* clust)
     }
     fprintf(stderr, "%3d%%\n", 100);
 
+    gromos_clusters(n1, nnb, clust);
+}
+
+/*! \brief Make neighbor lists of all structures closer than rmsdcut
+ *
+ * Only pairs below the cutoff are stored, so memory use grows with
+ * the number of neighbors instead of the square of the number of frames.
+ */
+static t_nnb* rmsd_neighbor_lists(int      nf,
+                                  rvec**   xx,
+                                  int      isize,
+                                  real*    mass,
+                                  gmx_bool bFit,
+                                  real     rmsdcut,
+                                  int64_t* nrPairs)
+{
+    std::vector<std::vector<int>> neighbors(nf);
+    for (int i = 0; i < nf; i++)
+    {
+        /* As in the matrix, each structure is its own neighbor */
+        neighbors[i].push_back(i);
+    }
+    *nrPairs = 0;
+    gmx::calcRmsdNeighbors(gmx::ArrayRef<const rvec* const>(xx, xx + nf),
+                           gmx::arrayRefFromArray(mass, isize),
+                           bFit,
+                           rmsdcut,
+                           gmx_omp_get_max_threads(),
+                           [&neighbors, nrPairs](int frame1, int frame2, real /*rmsd*/) {
+                               neighbors[frame1].push_back(frame2);
+                               neighbors[frame2].push_back(frame1);
+                               (*nrPairs)++;
+                           });
+
+    t_nnb* nnb;
+    snew(nnb, nf);
+    for (int i = 0; i < nf; i++)
+    {
+        std::sort(neighbors[i].begin(), neighbors[i].end());
+        nnb[i].nr = neighbors[i].size();
+        snew(nnb[i].nb, nnb[i].nr);
+        std::copy(neighbors[i].begin(), neighbors[i].end(), nnb[i].nb);
+    }
+    return nnb;
+}
+
+/*! \brief Cluster with the gromos algorithm from neighbor lists
+ *
+ * The neighbor lists are freed.
+ */
+static void gromos_clusters(int n1, t_nnb* nnb, t_clusters* clust)
+{
+    int i, j, k, j1;
+
     /* sort neighbor list on number of neighbors, largest first */
     std::sort(nnb, nnb + n1, nrnb_comp);
 
@@ -991,9 +1051,18 @@ static void ana_trans(t_clusters*             clust,
     sfree(axis);
 }
 
+//! Access to the RMSDs between structures for analyze_clusters
+struct t_cluster_rmsd
+{
+    //! Returns the RMSD between structures i and j > i
+    std::function<real(int i, int j)> pair;
+    //! Returns for each structure, in increasing order, the sum of its RMSDs to the others
+    std::function<std::vector<real>(gmx::ArrayRef<const int> structure)> sums;
+};
+
 static void analyze_clusters(int                     nf,
                              t_clusters*             clust,
-                             real**                  rmsd,
+                             const t_cluster_rmsd&   rmsd,
                              int                     natom,
                              t_atoms*                atoms,
                              rvec*                   xtps,
@@ -1189,23 +1258,15 @@ static void analyze_clusters(int                     nf,
         clrmsd  = 0;
         midstr  = 0;
         midrmsd = 10000;
+        const std::vector<real> rmsdSums =
+                (nstr > 1) ? rmsd.sums(gmx::arrayRefFromArray(structure, nstr))
+                           : std::vector<real>();
         for (i1 = 0; i1 < nstr; i1++)
         {
             r = 0;
             if (nstr > 1)
             {
-                for (i = 0; i < nstr; i++)
-                {
-                    if (i < i1)
-                    {
-                        r += rmsd[structure[i]][structure[i1]];
-                    }
-                    else
-                    {
-                        r += rmsd[structure[i1]][structure[i]];
-                    }
-                }
-                r /= (nstr - 1);
+                r = rmsdSums[i1] / (nstr - 1);
             }
             if (r < midrmsd)
             {
@@ -1288,7 +1349,7 @@ static void analyze_clusters(int                     nf,
                         {
                             if (bWrite[i1])
                             {
-                                bWrite[i] = rmsd[structure[i1]][structure[i]] > rmsmin;
+                                bWrite[i] = rmsd.pair(structure[i1], structure[i]) > rmsmin;
                             }
                         }
                     }
@@ -1420,8 +1481,19 @@ int gmx_cluster(int argc, char* argv[])
         "and eliminate it from the pool of clusters. Repeat for remaining",
         "structures in pool.[PAR]",
 
+        "gromos-sparse: as gromos, but without computing and storing the",
+        "full RMSD matrix. Only the pairs of structures within the cut-off",
+        "are stored, and most other pairs are never computed, because the",
+        "RMSDs to a few reference structures give a lower bound for the",
+        "RMSD of a pair. Memory use grows with the number of structures",
+        "and their neighbors instead of the square of the number of",
+        "structures, which allows clustering of long trajectories.",
+        "The clusters are identical to those from gromos. This method",
+        "requires a trajectory and does not write the [TT]-o[tt] and",
+        "[TT]-dist[tt] files.[PAR]",
+
         "When the clustering algorithm assigns each structure to exactly one",
-        "cluster (single linkage, Jarvis Patrick and gromos) and a trajectory",
+        "cluster (single linkage, Jarvis Patrick and both gromos methods) and a trajectory",
         "file is supplied, the structure with",
         "the smallest average distance to the others or the average structure",
         "or all structures for each cluster will be written to a trajectory",
@@ -1467,10 +1539,11 @@ int gmx_cluster(int argc, char* argv[])
 
     matrix      box;
     matrix*     boxes = nullptr;
-    rvec *      xtps, *usextps, *x1, **xx = nullptr;
+    rvec *      xtps, *usextps, **xx = nullptr;
     const char *fn, *trx_out_fn;
     t_clusters  clust;
-    t_mat *     rms, *orig = nullptr;
+    t_mat *     rms = nullptr, *orig = nullptr;
+    t_nnb*      nnb = nullptr;
     real*       eigenvalues;
     t_topology  top;
     PbcType     pbcType;
@@ -1480,14 +1553,14 @@ int gmx_cluster(int argc, char* argv[])
     int      isize = 0, ifsize = 0, iosize = 0;
     int *    index = nullptr, *fitidx = nullptr, *outidx = nullptr, *frameindices = nullptr;
     char*    grpname;
-    real     rmsd, **d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
+    real     **d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
     char     buf[STRLEN], buf1[80];
     gmx_bool bAnalyze, bUseRmsdCut, bJP_RMSD = FALSE, bReadMat, bReadTraj, bPBC = TRUE;
 
     int                method, ncluster = 0;
     static const char* methodname[] = { nullptr,       "linkage",         "jarvis-patrick",
                                         "monte-carlo", "diagonalization", "gromos",
-                                        nullptr };
+                                        "gromos-sparse", nullptr };
     enum
     {
         m_null,
@@ -1496,6 +1569,7 @@ int gmx_cluster(int argc, char* argv[])
         m_monte_carlo,
         m_diagonalize,
         m_gromos,
+        m_gromos_sparse,
         m_nr
     };
     /* Set colors for plotting: white = zero RMS, black = maximum */
@@ -1656,7 +1730,15 @@ int gmx_cluster(int argc, char* argv[])
         gmx_fatal(FARGS, "Invalid method");
     }
 
-    bAnalyze = (method == m_linkage || method == m_jarvis_patrick || method == m_gromos);
+    bAnalyze = (method == m_linkage || method == m_jarvis_patrick || method == m_gromos
+                || method == m_gromos_sparse);
+    if (method == m_gromos_sparse && (bReadMat || bRMSdist || bBinary))
+    {
+        gmx_fatal(FARGS,
+                  "Method %s computes RMS deviations from a trajectory and "
+                  "can not be combined with -dm, -dista or -binary",
+                  methodname[0]);
+    }
 
     /* Open log file */
     log = ftp2FILE(efLOG, NFILE, fnm, "w");
@@ -1698,7 +1780,8 @@ int gmx_cluster(int argc, char* argv[])
     }
     else /* method != m_jarvis */
     {
-        bUseRmsdCut = (bBinary || method == m_linkage || method == m_gromos);
+        bUseRmsdCut = (bBinary || method == m_linkage || method == m_gromos
+                       || method == m_gromos_sparse);
     }
     if (bUseRmsdCut && method != m_jarvis_patrick)
     {
@@ -1833,6 +1916,14 @@ int gmx_cluster(int argc, char* argv[])
 
         nlevels = gmx::ssize(readmat[0].map);
     }
+    else if (method == m_gromos_sparse)
+    {
+        fprintf(stderr, "Computing RMS deviations of %d structures below %g nm\n", nf, rmsdcut);
+        nnb = rmsd_neighbor_lists(nf, xx, isize, mass, bFit, rmsdcut, &nrms);
+        ffprintf_d(stderr, log, buf, "Number of structures %d\n", nf);
+        sprintf(buf1, "%" PRId64, nrms);
+        ffprintf_s(stderr, log, buf, "Number of pairs within the cutoff %s\n", buf1);
+    }
     else /* !bReadMat */
     {
         rms  = init_mat(nf, method == m_diagonalize);
@@ -1840,31 +1931,13 @@ int gmx_cluster(int argc, char* argv[])
         if (!bRMSdist)
         {
             fprintf(stderr, "Computing %dx%d RMS deviation matrix\n", nf, nf);
-            /* Initialize work array */
-            snew(x1, isize);
-            for (i1 = 0; i1 < nf; i1++)
-            {
-                for (i2 = i1 + 1; i2 < nf; i2++)
-                {
-                    for (i = 0; i < isize; i++)
-                    {
-                        copy_rvec(xx[i1][i], x1[i]);
-                    }
-                    if (bFit)
-                    {
-                        do_fit(isize, mass, xx[i2], x1);
-                    }
-                    rmsd = rmsdev(isize, mass, xx[i2], x1);
-                    set_mat_entry(rms, i1, i2, rmsd);
-                }
-                nrms -= nf - i1 - 1;
-                fprintf(stderr,
-                        "\r# RMSD calculations left: "
-                        "%" PRId64 "   ",
-                        nrms);
-                fflush(stderr);
-            }
-            sfree(x1);
+            gmx::calcRmsdMatrix(gmx::ArrayRef<const rvec* const>(xx, xx + nf),
+                                gmx::arrayRefFromArray(mass, isize),
+                                bFit,
+                                gmx_omp_get_max_threads(),
+                                [rms](int frame1, int frame2, real rmsd) {
+                                    set_mat_entry(rms, frame1, frame2, rmsd);
+                                });
         }
         else /* bRMSdist */
         {
@@ -1904,30 +1977,37 @@ int gmx_cluster(int argc, char* argv[])
         }
         fprintf(stderr, "\n\n");
     }
-    ffprintf_gg(stderr, log, buf, "The RMSD ranges from %g to %g nm\n", rms->minrms, rms->maxrms);
-    ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2 * rms->sumrms / (nf * (nf - 1)));
-    ffprintf_d(stderr, log, buf, "Number of structures for matrix %d\n", nf);
-    ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", mat_energy(rms));
-    if (bUseRmsdCut && (rmsdcut < rms->minrms || rmsdcut > rms->maxrms))
-    {
-        fprintf(stderr,
-                "WARNING: rmsd cutoff %g is outside range of rmsd values "
-                "%g to %g\n",
-                rmsdcut,
-                rms->minrms,
-                rms->maxrms);
-    }
-    if (bAnalyze && (rmsmin < rms->minrms))
-    {
-        fprintf(stderr, "WARNING: rmsd minimum %g is below lowest rmsd value %g\n", rmsmin, rms->minrms);
-    }
-    if (bAnalyze && (rmsmin > rmsdcut))
+    if (rms != nullptr)
     {
-        fprintf(stderr, "WARNING: rmsd minimum %g is above rmsd cutoff %g\n", rmsmin, rmsdcut);
-    }
+        ffprintf_gg(
+                stderr, log, buf, "The RMSD ranges from %g to %g nm\n", rms->minrms, rms->maxrms);
+        ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2 * rms->sumrms / (nf * (nf - 1)));
+        ffprintf_d(stderr, log, buf, "Number of structures for matrix %d\n", nf);
+        ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", mat_energy(rms));
+        if (bUseRmsdCut && (rmsdcut < rms->minrms || rmsdcut > rms->maxrms))
+        {
+            fprintf(stderr,
+                    "WARNING: rmsd cutoff %g is outside range of rmsd values "
+                    "%g to %g\n",
+                    rmsdcut,
+                    rms->minrms,
+                    rms->maxrms);
+        }
+        if (bAnalyze && (rmsmin < rms->minrms))
+        {
+            fprintf(stderr,
+                    "WARNING: rmsd minimum %g is below lowest rmsd value %g\n",
+                    rmsmin,
+                    rms->minrms);
+        }
+        if (bAnalyze && (rmsmin > rmsdcut))
+        {
+            fprintf(stderr, "WARNING: rmsd minimum %g is above rmsd cutoff %g\n", rmsmin, rmsdcut);
+        }
 
-    /* Plot the rmsd distribution */
-    rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
+        /* Plot the rmsd distribution */
+        rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
+    }
 
     if (bBinary)
     {
@@ -1983,6 +2063,7 @@ int gmx_cluster(int argc, char* argv[])
             jarvis_patrick(rms->nn, rms->mat, M, P, bJP_RMSD ? rmsdcut : -1, &clust);
             break;
         case m_gromos: gromos(rms->nn, rms->mat, rmsdcut, &clust); break;
+        case m_gromos_sparse: gromos_clusters(nf, nnb, &clust); break;
         default: gmx_fatal(FARGS, "DEATH HORROR unknown method \"%s\"", methodname[0]);
     }
 
@@ -1993,13 +2074,63 @@ int gmx_cluster(int argc, char* argv[])
 
     if (bAnalyze)
     {
-        if (minstruct > 1)
+        t_cluster_rmsd clusterRmsd;
+        if (rms != nullptr)
         {
-            ncluster = plot_clusters(nf, rms->mat, &clust, minstruct);
+            if (minstruct > 1)
+            {
+                ncluster = plot_clusters(nf, rms->mat, &clust, minstruct);
+            }
+            else
+            {
+                mark_clusters(nf, rms->mat, rms->maxrms, &clust);
+            }
+            /* Only the upper half of the matrix still contains RMSD values */
+            clusterRmsd.pair = [rms](int i, int j) { return rms->mat[i][j]; };
+            clusterRmsd.sums = [rms](gmx::ArrayRef<const int> structure) {
+                std::vector<real> sums(structure.size(), 0);
+                for (int i1 = 0; i1 < gmx::ssize(structure); i1++)
+                {
+                    for (int i = 0; i < gmx::ssize(structure); i++)
+                    {
+                        sums[i1] += (i < i1) ? rms->mat[structure[i]][structure[i1]]
+                                             : rms->mat[structure[i1]][structure[i]];
+                    }
+                }
+                return sums;
+            };
         }
         else
         {
-            mark_clusters(nf, rms->mat, rms->maxrms, &clust);
+            /* Without a matrix, compute the RMSDs within each cluster */
+            clusterRmsd.pair = [xx, isize, mass, bFit](int i, int j) {
+                if (bFit)
+                {
+                    const auto* xi = reinterpret_cast<const gmx::RVec*>(xx[i]);
+                    const auto* xj = reinterpret_cast<const gmx::RVec*>(xx[j]);
+                    return gmx::calcFittedRmsd(gmx::arrayRefFromArray(xi, isize),
+                                               gmx::arrayRefFromArray(xj, isize),
+                                               gmx::arrayRefFromArray(mass, isize));
+                }
+                return rmsdev(isize, mass, xx[i], xx[j]);
+            };
+            clusterRmsd.sums = [xx, isize, mass, bFit](gmx::ArrayRef<const int> structure) {
+                std::vector<const rvec*> frames;
+                for (int frame : structure)
+                {
+                    frames.push_back(xx[frame]);
+                }
+                std::vector<double> sums(structure.size(), 0);
+                gmx::calcRmsdMatrix(frames,
+                                    gmx::arrayRefFromArray(mass, isize),
+                                    bFit,
+                                    gmx_omp_get_max_threads(),
+                                    [&sums](int frame1, int frame2, real rmsd) {
+                                        sums[frame1] += rmsd;
+                                        sums[frame2] += rmsd;
+                                    });
+                return std::vector<real>(sums.begin(), sums.end());
+            };
         }
         init_t_atoms(&useatoms, isize, FALSE);
         snew(usextps, isize);
@@ -2014,7 +2145,7 @@ int gmx_cluster(int argc, char* argv[])
         useatoms.nr = isize;
         analyze_clusters(nf,
                          &clust,
-                         rms->mat,
+                         clusterRmsd,
                          isize,
                          &useatoms,
                          usextps,
@@ -2062,68 +2193,22 @@ int gmx_cluster(int argc, char* argv[])
         }
     }
 
-    fp = opt2FILE("-o", NFILE, fnm, "w");
-    fprintf(stderr, "Writing rms distance/clustering matrix ");
-    if (bReadMat)
-    {
-        write_xpm(fp,
-                  0,
-                  readmat[0].title,
-                  readmat[0].legend,
-                  readmat[0].label_x,
-                  readmat[0].label_y,
-                  nf,
-                  nf,
-                  readmat[0].axis_x.data(),
-                  readmat[0].axis_y.data(),
-                  rms->mat,
-                  0.0,
-                  rms->maxrms,
-                  rlo_top,
-                  rhi_top,
-                  &nlevels);
-    }
-    else
+    if (rms != nullptr)
     {
-        auto timeLabel = output_env_get_time_label(oenv);
-        auto title = gmx::formatString("RMS%sDeviation / Cluster Index", bRMSdist ? " Distance " : " ");
-        if (minstruct > 1)
-        {
-            write_xpm_split(fp,
-                            0,
-                            title,
-                            "RMSD (nm)",
-                            timeLabel,
-                            timeLabel,
-                            nf,
-                            nf,
-                            time,
-                            time,
-                            rms->mat,
-                            0.0,
-                            rms->maxrms,
-                            &nlevels,
-                            rlo_top,
-                            rhi_top,
-                            0.0,
-                            ncluster,
-                            &ncluster,
-                            TRUE,
-                            rlo_bot,
-                            rhi_bot);
-        }
-        else
+        fp = opt2FILE("-o", NFILE, fnm, "w");
+        fprintf(stderr, "Writing rms distance/clustering matrix ");
+        if (bReadMat)
         {
             write_xpm(fp,
                       0,
-                      title,
-                      "RMSD (nm)",
-                      timeLabel,
-                      timeLabel,
+                      readmat[0].title,
+                      readmat[0].legend,
+                      readmat[0].label_x,
+                      readmat[0].label_y,
                       nf,
                       nf,
-                      time,
-                      time,
+                      readmat[0].axis_x.data(),
+                      readmat[0].axis_y.data(),
                       rms->mat,
                       0.0,
                       rms->maxrms,
@@ -2131,9 +2216,59 @@ int gmx_cluster(int argc, char* argv[])
                       rhi_top,
                       &nlevels);
         }
+        else
+        {
+            auto timeLabel = output_env_get_time_label(oenv);
+            auto title     = gmx::formatString("RMS%sDeviation / Cluster Index",
+                                               bRMSdist ? " Distance " : " ");
+            if (minstruct > 1)
+            {
+                write_xpm_split(fp,
+                                0,
+                                title,
+                                "RMSD (nm)",
+                                timeLabel,
+                                timeLabel,
+                                nf,
+                                nf,
+                                time,
+                                time,
+                                rms->mat,
+                                0.0,
+                                rms->maxrms,
+                                &nlevels,
+                                rlo_top,
+                                rhi_top,
+                                0.0,
+                                ncluster,
+                                &ncluster,
+                                TRUE,
+                                rlo_bot,
+                                rhi_bot);
+            }
+            else
+            {
+                write_xpm(fp,
+                          0,
+                          title,
+                          "RMSD (nm)",
+                          timeLabel,
+                          timeLabel,
+                          nf,
+                          nf,
+                          time,
+                          time,
+                          rms->mat,
+                          0.0,
+                          rms->maxrms,
+                          rlo_top,
+                          rhi_top,
+                          &nlevels);
+            }
+        }
+        fprintf(stderr, "\n");
+        gmx_ffclose(fp);
     }
-    fprintf(stderr, "\n");
-    gmx_ffclose(fp);
     if (nullptr != orig)
     {
         fp             = opt2FILE("-om", NFILE, fnm, "w");
@@ -2160,13 +2295,16 @@ int gmx_cluster(int argc, char* argv[])
         sfree(orig);
     }
     /* now show what we've done */
-    do_view(oenv, opt2fn("-o", NFILE, fnm), "-nxy");
+    if (rms != nullptr)
+    {
+        do_view(oenv, opt2fn("-o", NFILE, fnm), "-nxy");
+        do_view(oenv, opt2fn("-dist", NFILE, fnm), "-nxy");
+    }
     do_view(oenv, opt2fn_null("-sz", NFILE, fnm), "-nxy");
     if (method == m_diagonalize)
     {
         do_view(oenv, opt2fn_null("-ev", NFILE, fnm), "-nxy");
     }
-    do_view(oenv, opt2fn("-dist", NFILE, fnm), "-nxy");
     if (bAnalyze)
     {
         do_view(oenv, opt2fn_null("-tr", NFILE, fnm), "-nxy");
@@ -48,6 +48,7 @@
 #include "gromacs/gmxana/eigio.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/linearalgebra/eigensolver.h"
+#include "gromacs/linearalgebra/matrix.h"
 #include "gromacs/math/do_fit.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
@@ -60,6 +61,7 @@
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/sysinfo.h"
 
@@ -89,7 +91,7 @@ void throwErrorIfIndexOutOfBounds(ArrayRef<const int> indices,
         return;
     }
     const int largestIndex = *std::max_element(indices.begin(), indices.end());
-    if (largestIndex < largestOkayIndex)
+    if (largestIndex >= largestOkayIndex)
     {
         GMX_THROW(RangeError("The provided structure file only contains "
                              + std::to_string(largestOkayIndex) + " coordinates, but coordinate index "
@@ -103,6 +105,9 @@ void throwErrorIfIndexOutOfBounds(ArrayRef<const int> indices,
 
 } // namespace gmx
 
+//! Number of frames that are added to the covariance matrix at once
+static const int c_covarBatchSize = 64;
+
 int gmx_covar(int argc, char* argv[])
 {
     const char* desc[] = {
@@ -137,7 +142,13 @@ int gmx_covar(int argc, char* argv[])
         "of atoms involved. It is easy to run out of memory, in which",
         "case this tool will probably exit with a 'Segmentation fault'. You",
         "should consider carefully whether a reduced set of atoms will meet",
-        "your needs for lower costs."
+        "your needs for lower costs.",
+        "[PAR]",
+        "Frames are added to the covariance matrix in batches, using threaded",
+        "matrix-matrix products. When [TT]-last[tt] selects fewer than half of the",
+        "eigenvectors, only those are computed, with an iterative (Lanczos)",
+        "solver that does not need a second copy of the matrix. The trace check",
+        "is then replaced by the fraction of the trace they cover."
     };
     static gmx_bool bFit = TRUE, bRef = FALSE, bM = FALSE, bPBC = TRUE;
     static int      end  = -1;
@@ -162,20 +173,20 @@ int gmx_covar(int argc, char* argv[])
     matrix            box, zerobox;
     real *            sqrtm, *mat, *eigenvalues, sum, trace, inv_nframes;
     real              t, tstart, tend, **mat2;
-    real              xj, *w_rls = nullptr;
+    real*             w_rls = nullptr;
     real              min, max, *axis;
     int               natoms, nat, nframes0, nframes, nlevels;
-    int64_t           ndim, i, j, k, l;
+    int64_t           ndim, i, j, k;
     int               WriteXref;
     const char *      fitfile, *trxfile, *ndxfile;
     const char *      eigvalfile, *eigvecfile, *averfile, *logfile;
     const char *      asciifile, *xpmfile, *xpmafile;
     char              str[STRLEN], *fitname, *ananame;
-    int               d, dj, nfit;
+    int               d, dj, nfit, nbatch;
     int *             index, *ifit;
     gmx_bool          bDiffMass1, bDiffMass2;
     t_rgb             rlo, rmi, rhi;
-    real*             eigenvectors;
+    real *            eigenvectors, *xbatch;
     gmx_output_env_t* oenv;
     gmx_rmpbc_t       gpbc = nullptr;
 
@@ -352,6 +363,8 @@ int gmx_covar(int argc, char* argv[])
             "Constructing covariance matrix (%dx%d) ...\n",
             static_cast<int>(ndim),
             static_cast<int>(ndim));
+    snew(xbatch, c_covarBatchSize * ndim);
+    nbatch  = 0;
     nframes = 0;
     nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
     tstart  = t;
@@ -369,39 +382,36 @@ int gmx_covar(int argc, char* argv[])
             reset_x(nfit, ifit, nat, nullptr, xread, w_rls);
             do_fit(nat, w_rls, xref, xread);
         }
+        /* Store the deviation x of this frame in the next column of the batch */
+        rvec* xdev = reinterpret_cast<rvec*>(xbatch + nbatch * ndim);
         if (bRef)
         {
             for (i = 0; i < natoms; i++)
             {
-                rvec_sub(xread[index[i]], xref[index[i]], x[i]);
+                rvec_sub(xread[index[i]], xref[index[i]], xdev[i]);
             }
         }
         else
         {
             for (i = 0; i < natoms; i++)
             {
-                rvec_sub(xread[index[i]], xav[i], x[i]);
+                rvec_sub(xread[index[i]], xav[i], xdev[i]);
             }
         }
+        nbatch++;
 
-        for (j = 0; j < natoms; j++)
+        if (nbatch == c_covarBatchSize)
         {
-            for (dj = 0; dj < DIM; dj++)
-            {
-                k  = ndim * (DIM * j + dj);
-                xj = x[j][dj];
-                for (i = j; i < natoms; i++)
-                {
-                    l = k + DIM * i;
-                    for (d = 0; d < DIM; d++)
-                    {
-                        mat[l + d] += x[i][d] * xj;
-                    }
-                }
-            }
+            symmetric_rank_k_update(ndim, nbatch, xbatch, mat, gmx_omp_get_max_threads());
+            nbatch = 0;
         }
     } while (read_next_x(oenv, status, &t, xread, box) && (bRef || nframes < nframes0));
     close_trx(status);
+    if (nbatch > 0)
+    {
+        symmetric_rank_k_update(ndim, nbatch, xbatch, mat, gmx_omp_get_max_threads());
+    }
+    sfree(xbatch);
     gmx_rmpbc_done(gpbc);
 
     fprintf(stderr, "Read %d frames\n", nframes);
@@ -598,15 +608,57 @@ int gmx_covar(int argc, char* argv[])
     }
 
 
+    /* Set 'end', the maximum eigenvector and -value index used for output */
+    const bool bPartial = (end > 0 && 2 * static_cast<int64_t>(end) < ndim);
+    if (end == -1)
+    {
+        if (nframes - 1 < ndim)
+        {
+            end = nframes - 1;
+            fprintf(stderr, "\nWARNING: there are fewer frames in your trajectory than there are\n");
+            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
+            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
+        }
+        else
+        {
+            end = ndim;
+        }
+    }
+    else if (end > ndim)
+    {
+        end = ndim;
+    }
+
     /* call diagonalization routine */
 
     snew(eigenvalues, ndim);
-    snew(eigenvectors, ndim * ndim);
 
-    std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
-    fprintf(stderr, "\nDiagonalizing ...\n");
-    fflush(stderr);
-    eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+    if (bPartial)
+    {
+        /* Only the largest eigenvalues are needed, determine these with
+         * matrix-vector products. The results are moved to the end of the
+         * arrays, where the full diagonalization would have stored them.
+         */
+        fprintf(stderr, "\nDetermining the %d largest eigenvalues ...\n", end);
+        fflush(stderr);
+        snew(eigenvectors, end * ndim);
+        dense_iterative_eigensolver(
+                mat, ndim, end, eigenvalues, eigenvectors, 100000, gmx_omp_get_max_threads());
+        for (i = end - 1; i >= 0; i--)
+        {
+            eigenvalues[ndim - end + i] = eigenvalues[i];
+            eigenvalues[i]              = 0;
+        }
+        std::memcpy(mat + (ndim - end) * ndim, eigenvectors, end * ndim * sizeof(real));
+    }
+    else
+    {
+        snew(eigenvectors, ndim * ndim);
+        std::memcpy(eigenvectors, mat, ndim * ndim * sizeof(real));
+        fprintf(stderr, "\nDiagonalizing ...\n");
+        fflush(stderr);
+        eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+    }
     sfree(eigenvectors);
 
     /* now write the output */
@@ -616,26 +668,22 @@ int gmx_covar(int argc, char* argv[])
     {
         sum += eigenvalues[i];
     }
-    fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
-    if (std::abs(trace - sum) > 0.01 * trace)
+    if (bPartial)
     {
         fprintf(stderr,
-                "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
+                "\nSum of the %d largest eigenvalues: %g (%snm^2), %.1f%% of the trace\n",
+                end,
+                sum,
+                bM ? "u " : "",
+                100 * sum / trace);
     }
-
-    /* Set 'end', the maximum eigenvector and -value index used for output */
-    if (end == -1)
+    else
     {
-        if (nframes - 1 < ndim)
+        fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n", sum, bM ? "u " : "");
+        if (std::abs(trace - sum) > 0.01 * trace)
         {
-            end = nframes - 1;
-            fprintf(stderr, "\nWARNING: there are fewer frames in your trajectory than there are\n");
-            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
-            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
-        }
-        else
-        {
-            end = ndim;
+            fprintf(stderr,
+                    "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
         }
     }
 
@@ -716,7 +764,14 @@ int gmx_covar(int argc, char* argv[])
     }
     fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim), static_cast<int>(ndim));
     fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n", trace);
-    fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    if (bPartial)
+    {
+        fprintf(out, "Sum of the %d largest eigenvalues: %g\n\n", end, sum);
+    }
+    else
+    {
+        fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n", sum);
+    }
 
     fprintf(out, "Wrote %d eigenvalues to %s\n", static_cast<int>(end), eigvalfile);
     if (WriteXref == eWXR_YES)
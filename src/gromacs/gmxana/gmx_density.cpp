@@ -46,6 +46,7 @@
 #include "gromacs/commandline/viewit.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
+#include "gromacs/gmxana/densitygrid.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/gmxana/gstat.h"
 #include "gromacs/math/units.h"
@@ -59,6 +60,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 typedef struct
@@ -171,172 +173,47 @@ static void center_coords(t_atoms* atoms, const int* index_center, int ncenter,
     }
 }
 
-static void calc_electron_density(const char*             fn,
-                                  int**                   index,
-                                  const int               gnx[],
-                                  double***               slDensity,
-                                  int*                    nslices,
-                                  t_topology*             top,
-                                  PbcType                 pbcType,
-                                  int                     axis,
-                                  int                     nr_grps,
-                                  real*                   slWidth,
-                                  t_electron              eltab[],
-                                  int                     nr,
-                                  gmx_bool                bCenter,
-                                  int*                    index_center,
-                                  int                     ncenter,
-                                  gmx_bool                bRelative,
-                                  const gmx_output_env_t* oenv)
+/*! \brief Sets den_val to the number of electrons of each atom in the groups.
+ *
+ * Looking up the electron count once per atom keeps the search out of
+ * the loop over frames.
+ */
+static void set_electron_values(int**       index,
+                                const int   gnx[],
+                                int         nr_grps,
+                                t_topology* top,
+                                t_electron  eltab[],
+                                int         nr,
+                                real*       den_val)
 {
-    rvec*        x0;  /* coordinates without pbc */
-    matrix       box; /* box (3x3) */
-    double       invvol;
-    int          natoms; /* nr. atoms in trj */
-    t_trxstatus* status;
-    int          i, n,     /* loop indices */
-            nr_frames = 0, /* number of frames */
-            slice;         /* current slice */
-    t_electron* found;     /* found by bsearch */
-    t_electron  sought;    /* thingie thought by bsearch */
-    real        boxSz, aveBox;
-    gmx_rmpbc_t gpbc = nullptr;
-
-    real t, z;
-
-    if (axis < 0 || axis >= DIM)
-    {
-        gmx_fatal(FARGS, "Invalid axes. Terminating\n");
-    }
-
-    if ((natoms = read_first_x(oenv, &status, fn, &t, &x0, box)) == 0)
+    for (int n = 0; n < nr_grps; n++)
     {
-        gmx_fatal(FARGS, "Could not read coordinates from statusfile\n");
-    }
-
-    aveBox = 0;
-
-    if (!*nslices)
-    {
-        *nslices = static_cast<int>(box[axis][axis] * 10); /* default value */
-        fprintf(stderr, "\nDividing the box in %d slices\n", *nslices);
-    }
-
-    snew(*slDensity, nr_grps);
-    for (i = 0; i < nr_grps; i++)
-    {
-        snew((*slDensity)[i], *nslices);
-    }
-
-    gpbc = gmx_rmpbc_init(&top->idef, pbcType, top->atoms.nr);
-    /*********** Start processing trajectory ***********/
-    do
-    {
-        gmx_rmpbc(gpbc, natoms, box, x0);
-
-        /* Translate atoms so the com of the center-group is in the
-         * box geometrical center.
-         */
-        if (bCenter)
-        {
-            center_coords(&top->atoms, index_center, ncenter, box, x0);
-        }
-
-        invvol = *nslices / (box[XX][XX] * box[YY][YY] * box[ZZ][ZZ]);
-
-        if (bRelative)
+        for (int i = 0; i < gnx[n]; i++)
         {
-            *slWidth = 1.0 / (*nslices);
-            boxSz    = 1.0;
-        }
-        else
-        {
-            *slWidth = box[axis][axis] / (*nslices);
-            boxSz    = box[axis][axis];
-        }
-
-        aveBox += box[axis][axis];
-
-        for (n = 0; n < nr_grps; n++)
-        {
-            for (i = 0; i < gnx[n]; i++) /* loop over all atoms in index file */
+            const int  a = index[n][i];
+            t_electron sought; /* thingie thought by bsearch */
+            sought.nr_el    = 0;
+            sought.atomname = gmx_strdup(*(top->atoms.atomname[a]));
+
+            t_electron* found = static_cast<t_electron*>(
+                    bsearch(&sought,
+                            eltab,
+                            nr,
+                            sizeof(t_electron),
+                            reinterpret_cast<int (*)(const void*, const void*)>(compare)));
+
+            if (found == nullptr)
             {
-                z = x0[index[n][i]][axis];
-                while (z < 0)
-                {
-                    z += box[axis][axis];
-                }
-                while (z > box[axis][axis])
-                {
-                    z -= box[axis][axis];
-                }
-
-                if (bRelative)
-                {
-                    z = z / box[axis][axis];
-                }
-
-                /* determine which slice atom is in */
-                if (bCenter)
-                {
-                    slice = static_cast<int>(std::floor((z - (boxSz / 2.0)) / (*slWidth)) + *nslices / 2.);
-                }
-                else
-                {
-                    slice = static_cast<int>(z / (*slWidth));
-                }
-                sought.nr_el    = 0;
-                sought.atomname = gmx_strdup(*(top->atoms.atomname[index[n][i]]));
-
-                /* now find the number of electrons. This is not efficient. */
-                found = static_cast<t_electron*>(
-                        bsearch(&sought,
-                                eltab,
-                                nr,
-                                sizeof(t_electron),
-                                reinterpret_cast<int (*)(const void*, const void*)>(compare)));
-
-                if (found == nullptr)
-                {
-                    fprintf(stderr,
-                            "Couldn't find %s. Add it to the .dat file\n",
-                            *(top->atoms.atomname[index[n][i]]));
-                }
-                else
-                {
-                    (*slDensity)[n][slice] += (found->nr_el - top->atoms.atom[index[n][i]].q) * invvol;
-                }
-                free(sought.atomname);
+                fprintf(stderr, "Couldn't find %s. Add it to the .dat file\n", *(top->atoms.atomname[a]));
+                den_val[a] = 0;
             }
-        }
-        nr_frames++;
-    } while (read_next_x(oenv, status, &t, x0, box));
-    gmx_rmpbc_done(gpbc);
-
-    /*********** done with status file **********/
-    close_trx(status);
-
-    /* slDensity now contains the total number of electrons per slice, summed
-       over all frames. Now divide by nr_frames and volume of slice
-     */
-
-    fprintf(stderr, "\nRead %d frames from trajectory. Counting electrons\n", nr_frames);
-
-    if (bRelative)
-    {
-        aveBox /= nr_frames;
-        *slWidth = aveBox / (*nslices);
-    }
-
-    for (n = 0; n < nr_grps; n++)
-    {
-        for (i = 0; i < *nslices; i++)
-        {
-            (*slDensity)[n][i] /= nr_frames;
+            else
+            {
+                den_val[a] = found->nr_el - top->atoms.atom[a].q;
+            }
+            free(sought.atomname);
         }
     }
-
-    sfree(x0); /* free memory used by coordinate array */
 }
 
 static void calc_density(const char*             fn,
@@ -354,7 +231,9 @@ static void calc_density(const char*             fn,
                          int                     ncenter,
                          gmx_bool                bRelative,
                          const gmx_output_env_t* oenv,
-                         const char**            dens_opt)
+                         const char**            dens_opt,
+                         t_electron              eltab[],
+                         int                     nr)
 {
     rvec*        x0;  /* coordinates without pbc */
     matrix       box; /* box (3x3) */
@@ -362,9 +241,8 @@ static void calc_density(const char*             fn,
     int          natoms; /* nr. atoms in trj */
     t_trxstatus* status;
     int          i, n,     /* loop indices */
-            nr_frames = 0, /* number of frames */
-            slice;         /* current slice */
-    real        t, z;
+            nr_frames = 0; /* number of frames */
+    real        t;
     real        boxSz, aveBox;
     real*       den_val; /* values from which the density is calculated */
     gmx_rmpbc_t gpbc = nullptr;
@@ -393,11 +271,17 @@ static void calc_density(const char*             fn,
         snew((*slDensity)[i], *nslices);
     }
 
+    gmx::DensityGridAccumulator sliceAccumulator(nr_grps * (*nslices), gmx_omp_get_max_threads());
+
     gpbc = gmx_rmpbc_init(&top->idef, pbcType, top->atoms.nr);
     /*********** Start processing trajectory ***********/
 
     snew(den_val, top->atoms.nr);
-    if (dens_opt[0][0] == 'n')
+    if (dens_opt[0][0] == 'e')
+    {
+        set_electron_values(index, gnx, nr_grps, top, eltab, nr, den_val);
+    }
+    else if (dens_opt[0][0] == 'n')
     {
         for (i = 0; (i < top->atoms.nr); i++)
         {
@@ -448,9 +332,10 @@ static void calc_density(const char*             fn,
 
         for (n = 0; n < nr_grps; n++)
         {
-            for (i = 0; i < gnx[n]; i++) /* loop over all atoms in index file */
-            {
-                z = x0[index[n][i]][axis];
+            const int* groupIndex = index[n];
+            /* loop over all atoms in index file */
+            sliceAccumulator.accumulate(gnx[n], [&](int i, int* cell, double* weight) {
+                real z = x0[groupIndex[i]][axis];
                 while (z < 0)
                 {
                     z += box[axis][axis];
@@ -466,6 +351,7 @@ static void calc_density(const char*             fn,
                 }
 
                 /* determine which slice atom is in */
+                int slice;
                 if (bCenter)
                 {
                     slice = static_cast<int>(std::floor((z - (boxSz / 2.0)) / (*slWidth)) + *nslices / 2.);
@@ -488,8 +374,10 @@ static void calc_density(const char*             fn,
                     slice -= *nslices;
                 }
 
-                (*slDensity)[n][slice] += den_val[index[n][i]] * invvol;
-            }
+                *cell   = n * (*nslices) + slice;
+                *weight = den_val[groupIndex[i]] * invvol;
+                return true;
+            });
         }
         nr_frames++;
     } while (read_next_x(oenv, status, &t, x0, box));
@@ -498,6 +386,15 @@ static void calc_density(const char*             fn,
     /*********** done with status file **********/
     close_trx(status);
 
+    gmx::ArrayRef<const double> summedDensity = sliceAccumulator.grid();
+    for (n = 0; n < nr_grps; n++)
+    {
+        for (i = 0; i < *nslices; i++)
+        {
+            (*slDensity)[n][i] = summedDensity[n * (*nslices) + i];
+        }
+    }
+
     /* slDensity now contains the total mass per slice, summed over all
        frames. Now divide by nr_frames and volume of slice
      */
@@ -712,15 +609,15 @@ int gmx_density(int argc, char* argv[])
         "When calculating electron densities, atomnames are used instead of types. This is bad.",
     };
 
-    double**    density;        /* density per slice          */
-    real        slWidth;        /* width of one slice         */
-    char*       grpname_center; /* centering group name     */
-    char**      grpname;        /* groupnames                 */
-    int         nr_electrons;   /* nr. electrons              */
-    int         ncenter;        /* size of centering group    */
-    int*        ngx;            /* sizes of groups            */
-    t_electron* el_tab;         /* tabel with nr. of electrons*/
-    t_topology* top;            /* topology               */
+    double**    density;                /* density per slice          */
+    real        slWidth;                /* width of one slice         */
+    char*       grpname_center;         /* centering group name     */
+    char**      grpname;                /* groupnames                 */
+    int         nr_electrons = 0;       /* nr. electrons              */
+    int         ncenter;                /* size of centering group    */
+    int*        ngx;                    /* sizes of groups            */
+    t_electron* el_tab       = nullptr; /* tabel with nr. of electrons*/
+    t_topology* top;                    /* topology               */
     PbcType     pbcType;
     int*        index_center; /* index for centering group  */
     int**       index;        /* indices for all groups     */
@@ -780,45 +677,27 @@ int gmx_density(int argc, char* argv[])
     {
         nr_electrons = get_electrons(&el_tab, ftp2fn(efDAT, NFILE, fnm));
         fprintf(stderr, "Read %d atomtypes from datafile\n", nr_electrons);
-
-        calc_electron_density(ftp2fn(efTRX, NFILE, fnm),
-                              index,
-                              ngx,
-                              &density,
-                              &nslices,
-                              top,
-                              pbcType,
-                              axis,
-                              ngrps,
-                              &slWidth,
-                              el_tab,
-                              nr_electrons,
-                              bCenter,
-                              index_center,
-                              ncenter,
-                              bRelative,
-                              oenv);
-    }
-    else
-    {
-        calc_density(ftp2fn(efTRX, NFILE, fnm),
-                     index,
-                     ngx,
-                     &density,
-                     &nslices,
-                     top,
-                     pbcType,
-                     axis,
-                     ngrps,
-                     &slWidth,
-                     bCenter,
-                     index_center,
-                     ncenter,
-                     bRelative,
-                     oenv,
-                     dens_opt);
     }
 
+    calc_density(ftp2fn(efTRX, NFILE, fnm),
+                 index,
+                 ngx,
+                 &density,
+                 &nslices,
+                 top,
+                 pbcType,
+                 axis,
+                 ngrps,
+                 &slWidth,
+                 bCenter,
+                 index_center,
+                 ncenter,
+                 bRelative,
+                 oenv,
+                 dens_opt,
+                 el_tab,
+                 nr_electrons);
+
     plot_density(
             density, opt2fn("-o", NFILE, fnm), nslices, ngrps, grpname, slWidth, dens_opt, bCenter, bRelative, bSymmetrize, oenv);
 
@@ -45,6 +45,7 @@
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/matio.h"
 #include "gromacs/fileio/trxio.h"
+#include "gromacs/gmxana/densitygrid.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/gmxana/gstat.h"
 #include "gromacs/math/utilities.h"
@@ -57,6 +58,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 int gmx_densmap(int argc, char* argv[])
@@ -122,7 +124,7 @@ int gmx_densmap(int argc, char* argv[])
     t_trxstatus*      status;
     t_topology        top;
     PbcType           pbcType = PbcType::Unset;
-    rvec *            x, xcom[2], direction, center, dx;
+    rvec *            x, xcom[2], direction, center;
     matrix            box;
     real              t, m, mtot;
     t_pbc             pbc;
@@ -131,8 +133,8 @@ int gmx_densmap(int argc, char* argv[])
     const char*       unit;
     int               i, j, k, l, ngrps, anagrp, *gnx = nullptr, nindex, nradial = 0, nfr, nmpower;
     int **            ind = nullptr, *index;
-    real **           grid, maxgrid, m1, m2, box1, box2, *tickx, *tickz, invcellvol;
-    real              invspa = 0, invspz = 0, axial, r, vol_old, vol, rowsum;
+    real **           grid, maxgrid, box1, box2, *tickx, *tickz, invcellvol;
+    real              invspa = 0, invspz = 0, vol_old, vol, rowsum;
     int               nlev = 51;
     t_rgb             rlo = { 1, 1, 1 }, rhi = { 0, 0, 0 };
     gmx_output_env_t* oenv;
@@ -269,6 +271,8 @@ int gmx_densmap(int argc, char* argv[])
         snew(grid[i], n2);
     }
 
+    gmx::DensityGridAccumulator gridAccumulator(n1 * n2, gmx_omp_get_max_threads());
+
     box1 = 0;
     box2 = 0;
     nfr  = 0;
@@ -287,32 +291,34 @@ int gmx_densmap(int argc, char* argv[])
             {
                 invcellvol /= box[c1][c1] * box[c2][c2];
             }
-            for (i = 0; i < nindex; i++)
-            {
-                j = index[i];
-                if ((!bXmin || x[j][cav] >= xmin) && (!bXmax || x[j][cav] <= xmax))
+            gridAccumulator.accumulate(nindex, [&](int i, int* cell, double* weight) {
+                const int a = index[i];
+                if ((bXmin && x[a][cav] < xmin) || (bXmax && x[a][cav] > xmax))
                 {
-                    m1 = x[j][c1] / box[c1][c1];
-                    if (m1 >= 1)
-                    {
-                        m1 -= 1;
-                    }
-                    if (m1 < 0)
-                    {
-                        m1 += 1;
-                    }
-                    m2 = x[j][c2] / box[c2][c2];
-                    if (m2 >= 1)
-                    {
-                        m2 -= 1;
-                    }
-                    if (m2 < 0)
-                    {
-                        m2 += 1;
-                    }
-                    grid[static_cast<int>(m1 * n1)][static_cast<int>(m2 * n2)] += invcellvol;
+                    return false;
                 }
-            }
+                real m1 = x[a][c1] / box[c1][c1];
+                if (m1 >= 1)
+                {
+                    m1 -= 1;
+                }
+                if (m1 < 0)
+                {
+                    m1 += 1;
+                }
+                real m2 = x[a][c2] / box[c2][c2];
+                if (m2 >= 1)
+                {
+                    m2 -= 1;
+                }
+                if (m2 < 0)
+                {
+                    m2 += 1;
+                }
+                *cell   = static_cast<int>(m1 * n1) * n2 + static_cast<int>(m2 * n2);
+                *weight = invcellvol;
+                return true;
+            });
         }
         else
         {
@@ -348,26 +354,37 @@ int gmx_densmap(int argc, char* argv[])
                 center[i] = xcom[0][i] + 0.5 * direction[i];
             }
             unitv(direction, direction);
-            for (i = 0; i < nindex; i++)
-            {
-                j = index[i];
-                pbc_dx(&pbc, x[j], center, dx);
-                axial = iprod(dx, direction);
-                r     = std::sqrt(norm2(dx) - axial * axial);
-                if (axial >= -amax && axial < amax && r < rmax)
+            gridAccumulator.accumulate(nindex, [&](int i, int* cell, double* weight) {
+                rvec dx;
+                pbc_dx(&pbc, x[index[i]], center, dx);
+                const real axial = iprod(dx, direction);
+                real       r     = std::sqrt(norm2(dx) - axial * axial);
+                if (!(axial >= -amax && axial < amax && r < rmax))
                 {
-                    if (bMirror)
-                    {
-                        r += rmax;
-                    }
-                    grid[static_cast<int>((axial + amax) * invspa)][static_cast<int>(r * invspz)] += 1;
+                    return false;
                 }
-            }
+                if (bMirror)
+                {
+                    r += rmax;
+                }
+                *cell   = static_cast<int>((axial + amax) * invspa) * n2 + static_cast<int>(r * invspz);
+                *weight = 1;
+                return true;
+            });
         }
         nfr++;
     } while (read_next_x(oenv, status, &t, x, box));
     close_trx(status);
 
+    gmx::ArrayRef<const double> summedGrid = gridAccumulator.grid();
+    for (i = 0; i < n1; i++)
+    {
+        for (j = 0; j < n2; j++)
+        {
+            grid[i][j] = summedGrid[i * n2 + j];
+        }
+    }
+
     /* normalize gridpoints */
     maxgrid = 0;
     if (!bRadial)
@@ -1938,6 +1938,18 @@ int gmx_energy(int argc, char* argv[])
         get_dhdl_parms(ftp2fn(efTPR, NFILE, fnm), ir);
     }
 
+    /* Only the selected terms are used, so the other terms and,
+     * unless dH/dl data is extracted, the blocks are skipped when reading.
+     */
+    gmx_bool* bReadTerm;
+    snew(bReadTerm, nre);
+    for (i = 0; i < nset; i++)
+    {
+        bReadTerm[set[i]] = TRUE;
+    }
+    enx_set_data_to_read(fp, nre, bReadTerm, !bDHDL);
+    sfree(bReadTerm);
+
     /* Initiate energies and set them to zero */
     edat.nsteps    = 0;
     edat.npoints   = 0;
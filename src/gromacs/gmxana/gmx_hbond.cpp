@@ -45,13 +45,15 @@
 
 #include <algorithm>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
 #include "gromacs/correlationfunctions/autocorr.h"
-#include "gromacs/correlationfunctions/crosscorr.h"
 #include "gromacs/correlationfunctions/expfit.h"
 #include "gromacs/correlationfunctions/integrate.h"
+#include "gromacs/fft/fft.h"
 #include "gromacs/fileio/matio.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
@@ -71,6 +73,7 @@
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/programcontext.h"
@@ -142,19 +145,31 @@ typedef struct
 typedef int t_icell[grNR];
 typedef int h_id[MAXHYDRO];
 
+/* Run-length encoded record of the frames in which a hbond is present.
+ * Memory use scales with the number of times the hbond forms, not with
+ * the length of the trajectory.
+ */
+typedef struct
+{
+    int  nrun;   /* Number of runs of consecutive frames   */
+    int  nalloc; /* Allocated number of runs               */
+    int* run;    /* First frame and one past the last frame
+                  * of each run, 2*nrun entries             */
+} t_hbexist;
+
 typedef struct
 {
     int history[MAXHYDRO];
     /* Has this hbond existed ever? If so as hbDist or hbHB or both.
      * Result is stored as a bitmap (1 = hbDist) || (2 = hbHB)
      */
-    /* Bitmask array which tells whether a hbond is present
-     * at a given time. Either of these may be NULL
+    /* Existence series which tell whether a hbond is present
+     * at a given time, relative to n0. Either of these may be NULL
      */
-    int            n0;                 /* First frame a HB was found     */
-    int            nframes, maxframes; /* Amount of frames in this hbond */
-    unsigned int** h;
-    unsigned int** g;
+    int         n0;      /* First frame a HB was found     */
+    int         nframes; /* Amount of frames in this hbond */
+    t_hbexist** h;
+    t_hbexist** g;
     /* See Xu and Berne, JPCB 105 (2001), p. 11929. We define the
      * function g(t) = [1-h(t)] H(t) where H(t) is one when the donor-
      * acceptor distance is less than the user-specified distance (typically
@@ -181,10 +196,19 @@ typedef struct
     h_id* nhbonds; /* The number of HBs per H at current */
 } t_donors;
 
+/* The hbonds found for one donor, stored sparsely since only a small
+ * fraction of all donor-acceptor pairs ever forms a hbond.
+ */
+typedef struct
+{
+    int       nr, nalloc;
+    int*      acc; /* Acceptor indices, in increasing order */
+    t_hbond** hb;  /* The hbond with each acceptor          */
+} t_donorhbonds;
+
 typedef struct
 {
     gmx_bool bHBmap, bDAnr;
-    int      wordlen;
     /* The following arrays are nframes long */
     int      nframes, max_frames, maxhydro;
     int *    nhb, *ndist;
@@ -195,9 +219,9 @@ typedef struct
     /* These structures are initialized from the topology at start up */
     t_donors    d;
     t_acceptors a;
-    /* This holds a matrix with all possible hydrogen bonds */
-    int        nrhb, nrdist;
-    t_hbond*** hbmap;
+    /* This holds, for each donor, all hydrogen bonds found */
+    int            nrhb, nrdist;
+    t_donorhbonds* hbmap;
 } t_hbdata;
 
 /* Changed argument 'bMerge' into 'oneHB' below,
@@ -211,9 +235,8 @@ static t_hbdata* mk_hbdata(gmx_bool bHBmap, gmx_bool bDAnr, gmx_bool oneHB)
     t_hbdata* hb;
 
     snew(hb, 1);
-    hb->wordlen = 8 * sizeof(unsigned int);
-    hb->bHBmap  = bHBmap;
-    hb->bDAnr   = bDAnr;
+    hb->bHBmap = bHBmap;
+    hb->bDAnr  = bDAnr;
     if (oneHB)
     {
         hb->maxhydro = 1;
@@ -227,21 +250,50 @@ static t_hbdata* mk_hbdata(gmx_bool bHBmap, gmx_bool bDAnr, gmx_bool oneHB)
 
 static void mk_hbmap(t_hbdata* hb)
 {
-    int i, j;
-
     snew(hb->hbmap, hb->d.nrd);
-    for (i = 0; (i < hb->d.nrd); i++)
+}
+
+/* Returns the hbond between donor id and acceptor ia, or NULL if none was found */
+static t_hbond* get_hbond(const t_hbdata* hb, int id, int ia)
+{
+    const t_donorhbonds* dhb = &hb->hbmap[id];
+    const int*           acc = std::lower_bound(dhb->acc, dhb->acc + dhb->nr, ia);
+
+    if (acc != dhb->acc + dhb->nr && *acc == ia)
     {
-        snew(hb->hbmap[i], hb->a.nra);
-        if (hb->hbmap[i] == nullptr)
-        {
-            gmx_fatal(FARGS, "Could not allocate enough memory for hbmap");
-        }
-        for (j = 0; j < hb->a.nra; j++)
-        {
-            hb->hbmap[i][j] = nullptr;
-        }
+        return dhb->hb[acc - dhb->acc];
+    }
+    return nullptr;
+}
+
+/* Returns the hbond between donor id and acceptor ia, creating it when needed */
+static t_hbond* get_or_add_hbond(t_hbdata* hb, int id, int ia)
+{
+    t_donorhbonds* dhb = &hb->hbmap[id];
+    const int      i   = std::lower_bound(dhb->acc, dhb->acc + dhb->nr, ia) - dhb->acc;
+
+    if (i < dhb->nr && dhb->acc[i] == ia)
+    {
+        return dhb->hb[i];
     }
+    if (dhb->nr == dhb->nalloc)
+    {
+        dhb->nalloc = over_alloc_small(dhb->nr + 1);
+        srenew(dhb->acc, dhb->nalloc);
+        srenew(dhb->hb, dhb->nalloc);
+    }
+    for (int j = dhb->nr; j > i; j--)
+    {
+        dhb->acc[j] = dhb->acc[j - 1];
+        dhb->hb[j]  = dhb->hb[j - 1];
+    }
+    dhb->acc[i] = ia;
+    snew(dhb->hb[i], 1);
+    snew(dhb->hb[i]->h, hb->maxhydro);
+    snew(dhb->hb[i]->g, hb->maxhydro);
+    dhb->nr++;
+
+    return dhb->hb[i];
 }
 
 static void add_frames(t_hbdata* hb, int nframes)
@@ -262,90 +314,99 @@ static void add_frames(t_hbdata* hb, int nframes)
     hb->nframes = nframes;
 }
 
-#define OFFSET(frame) ((frame) / 32)
-#define MASK(frame) (1 << ((frame) % 32))
+static gmx_bool is_hb(const t_hbexist* hbexist, int frame)
+{
+    /* Find the last run starting at or before frame */
+    int lo = 0, hi = hbexist->nrun;
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        if (hbexist->run[2 * mid] <= frame)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo > 0 && frame < hbexist->run[2 * lo - 1];
+}
 
-static void _set_hb(unsigned int hbexist[], unsigned int frame, gmx_bool bValue)
+/* Adds a run of frames [first,last) to an existence series.
+ * Runs must be added in order, but may touch or overlap the last run.
+ */
+static void add_hb_run(t_hbexist* hbexist, int first, int last)
 {
-    if (bValue)
+    const int n = hbexist->nrun;
+
+    if (n > 0 && first <= hbexist->run[2 * n - 1])
     {
-        hbexist[OFFSET(frame)] |= MASK(frame);
+        GMX_RELEASE_ASSERT(first >= hbexist->run[2 * n - 2],
+                           "Hydrogen bond runs added out of order");
+        hbexist->run[2 * n - 1] = std::max(hbexist->run[2 * n - 1], last);
+        return;
     }
-    else
+    if (n == hbexist->nalloc)
     {
-        hbexist[OFFSET(frame)] &= ~MASK(frame);
+        hbexist->nalloc = over_alloc_small(n + 1);
+        srenew(hbexist->run, 2 * hbexist->nalloc);
     }
+    hbexist->run[2 * n]     = first;
+    hbexist->run[2 * n + 1] = last;
+    hbexist->nrun++;
 }
 
-static gmx_bool is_hb(const unsigned int hbexist[], int frame)
+static void done_hbexist(t_hbexist* hbexist)
 {
-    return (hbexist[OFFSET(frame)] & MASK(frame)) != 0;
+    if (hbexist)
+    {
+        sfree(hbexist->run);
+        sfree(hbexist);
+    }
 }
 
-static void set_hb(t_hbdata* hb, int id, int ih, int ia, int frame, int ihb)
+static void set_hb(t_hbond* hb, int ih, int frame, int ihb)
 {
-    unsigned int* ghptr = nullptr;
+    t_hbexist* ghptr = nullptr;
 
     if (ihb == hbHB)
     {
-        ghptr = hb->hbmap[id][ia]->h[ih];
+        ghptr = hb->h[ih];
     }
     else if (ihb == hbDist)
     {
-        ghptr = hb->hbmap[id][ia]->g[ih];
+        ghptr = hb->g[ih];
     }
     else
     {
         gmx_fatal(FARGS, "Incomprehensible iValue %d in set_hb", ihb);
     }
 
-    _set_hb(ghptr, frame - hb->hbmap[id][ia]->n0, TRUE);
+    add_hb_run(ghptr, frame - hb->n0, frame - hb->n0 + 1);
 }
 
-static void add_ff(t_hbdata* hbd, int id, int h, int ia, int frame, int ihb)
+static void add_ff(t_hbdata* hbd, t_hbond* hb, int id, int h, int frame, int ihb)
 {
-    int      i, j, n;
-    t_hbond* hb       = hbd->hbmap[id][ia];
-    int      maxhydro = std::min(hbd->maxhydro, hbd->d.nhydro[id]);
-    int      wlen     = hbd->wordlen;
-    int      delta    = 32 * wlen;
+    int i;
+    int maxhydro = std::min(hbd->maxhydro, hbd->d.nhydro[id]);
 
     if (!hb->h[0])
     {
-        hb->n0        = frame;
-        hb->maxframes = delta;
+        hb->n0 = frame;
         for (i = 0; (i < maxhydro); i++)
         {
-            snew(hb->h[i], hb->maxframes / wlen);
-            snew(hb->g[i], hb->maxframes / wlen);
+            snew(hb->h[i], 1);
+            snew(hb->g[i], 1);
         }
     }
     else
     {
         hb->nframes = frame - hb->n0;
-        /* We need a while loop here because hbonds may be returning
-         * after a long time.
-         */
-        while (hb->nframes >= hb->maxframes)
-        {
-            n = hb->maxframes + delta;
-            for (i = 0; (i < maxhydro); i++)
-            {
-                srenew(hb->h[i], n / wlen);
-                srenew(hb->g[i], n / wlen);
-                for (j = hb->maxframes / wlen; (j < n / wlen); j++)
-                {
-                    hb->h[i][j] = 0;
-                    hb->g[i][j] = 0;
-                }
-            }
-
-            hb->maxframes = n;
-        }
     }
     if (frame >= 0)
     {
-        set_hb(hbd, id, h, ia, frame, ihb);
+        set_hb(hb, h, frame, ihb);
     }
 }
 
@@ -509,6 +570,7 @@ add_hbond(t_hbdata* hb, int d, int a, int h, int grpd, int grpa, int frame, gmx_
             k = 0;
         }
 
+        t_hbond* hbond = nullptr;
         if (hb->bHBmap)
         {
 
@@ -516,13 +578,8 @@ add_hbond(t_hbdata* hb, int d, int a, int h, int grpd, int grpa, int frame, gmx_
             {
                 try
                 {
-                    if (hb->hbmap[id][ia] == nullptr)
-                    {
-                        snew(hb->hbmap[id][ia], 1);
-                        snew(hb->hbmap[id][ia]->h, hb->maxhydro);
-                        snew(hb->hbmap[id][ia]->g, hb->maxhydro);
-                    }
-                    add_ff(hb, id, k, ia, frame, ihb);
+                    hbond = get_or_add_hbond(hb, id, ia);
+                    add_ff(hb, hbond, id, k, frame, ihb);
                 }
                 GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
             }
@@ -534,13 +591,13 @@ add_hbond(t_hbdata* hb, int d, int a, int h, int grpd, int grpa, int frame, gmx_
          */
         if (frame >= 0)
         {
-            hh = hb->hbmap[id][ia]->history[k];
+            hh = hbond->history[k];
             if (ihb == hbHB)
             {
                 hb->nhb[frame]++;
                 if (!(ISHB(hh)))
                 {
-                    hb->hbmap[id][ia]->history[k] = hh | 2;
+                    hbond->history[k] = hh | 2;
                     hb->nrhb++;
                 }
             }
@@ -551,7 +608,7 @@ add_hbond(t_hbdata* hb, int d, int a, int h, int grpd, int grpa, int frame, gmx_
                     hb->ndist[frame]++;
                     if (!(ISDIST(hh)))
                     {
-                        hb->hbmap[id][ia]->history[k] = hh | 1;
+                        hbond->history[k] = hh | 1;
                         hb->nrdist++;
                     }
                 }
@@ -1410,69 +1467,59 @@ static int is_hbond(t_hbdata* hb,
 /* Merging is now done on the fly, so do_merge is most likely obsolete now.
  * Will do some more testing before removing the function entirely.
  * - Erik Marklund, MAY 10 2010 */
-static void do_merge(t_hbdata* hb, int ntmp, bool htmp[], bool gtmp[], t_hbond* hb0, t_hbond* hb1)
+/* Returns the union of two existence series, shifted by shift0 and shift1 frames */
+static t_hbexist* merge_hbexist(const t_hbexist* e0, int shift0, const t_hbexist* e1, int shift1)
+{
+    t_hbexist* merged;
+    int        i0 = 0, i1 = 0;
+
+    snew(merged, 1);
+    while (i0 < e0->nrun || i1 < e1->nrun)
+    {
+        if (i1 == e1->nrun
+            || (i0 < e0->nrun && e0->run[2 * i0] + shift0 <= e1->run[2 * i1] + shift1))
+        {
+            add_hb_run(merged, e0->run[2 * i0] + shift0, e0->run[2 * i0 + 1] + shift0);
+            i0++;
+        }
+        else
+        {
+            add_hb_run(merged, e1->run[2 * i1] + shift1, e1->run[2 * i1 + 1] + shift1);
+            i1++;
+        }
+    }
+    return merged;
+}
+
+static void do_merge(t_hbond* hb0, t_hbond* hb1)
 {
     /* Here we need to make sure we're treating periodicity in
      * the right way for the geminate recombination kinetics. */
 
-    int m, mm, n00, n01, nn0, nnframes;
+    int        n00, n01, nn0, nnframes;
+    t_hbexist* merged;
 
     /* Decide where to start from when merging */
     n00      = hb0->n0;
     n01      = hb1->n0;
     nn0      = std::min(n00, n01);
     nnframes = std::max(n00 + hb0->nframes, n01 + hb1->nframes) - nn0;
-    /* Initiate tmp arrays */
-    for (m = 0; (m < ntmp); m++)
-    {
-        htmp[m] = false;
-        gtmp[m] = false;
-    }
-    /* Fill tmp arrays with values due to first HB */
-    /* Once again '<' had to be replaced with '<='
-       to catch the last frame in which the hbond
-       appears.
-       - Erik Marklund, June 1, 2006 */
-    for (m = 0; (m <= hb0->nframes); m++)
-    {
-        mm       = m + n00 - nn0;
-        htmp[mm] = is_hb(hb0->h[0], m);
-    }
-    for (m = 0; (m <= hb0->nframes); m++)
-    {
-        mm       = m + n00 - nn0;
-        gtmp[mm] = is_hb(hb0->g[0], m);
-    }
-    /* Next HB */
-    for (m = 0; (m <= hb1->nframes); m++)
-    {
-        mm       = m + n01 - nn0;
-        htmp[mm] = htmp[mm] || is_hb(hb1->h[0], m);
-        gtmp[mm] = gtmp[mm] || is_hb(hb1->g[0], m);
-    }
-    /* Reallocate target array */
-    if (nnframes > hb0->maxframes)
-    {
-        srenew(hb0->h[0], 4 + nnframes / hb->wordlen);
-        srenew(hb0->g[0], 4 + nnframes / hb->wordlen);
-    }
 
-    /* Copy temp array to target array */
-    for (m = 0; (m <= nnframes); m++)
-    {
-        _set_hb(hb0->h[0], m, htmp[m]);
-        _set_hb(hb0->g[0], m, gtmp[m]);
-    }
+    merged = merge_hbexist(hb0->h[0], n00 - nn0, hb1->h[0], n01 - nn0);
+    done_hbexist(hb0->h[0]);
+    hb0->h[0] = merged;
+    merged    = merge_hbexist(hb0->g[0], n00 - nn0, hb1->g[0], n01 - nn0);
+    done_hbexist(hb0->g[0]);
+    hb0->g[0] = merged;
 
     /* Set scalar variables */
-    hb0->n0        = nn0;
-    hb0->maxframes = nnframes;
+    hb0->n0      = nn0;
+    hb0->nframes = nnframes;
 }
 
 static void merge_hb(t_hbdata* hb, gmx_bool bTwo, gmx_bool bContact)
 {
-    int      i, inrnew, indnew, j, ii, jj, id, ia, ntmp;
-    bool *   htmp, *gtmp;
+    int      i, inrnew, indnew, j, k, ii, jj, id, ia;
     t_hbond *hb0, *hb1;
 
     inrnew = hb->nrhb;
@@ -1481,27 +1528,25 @@ static void merge_hb(t_hbdata* hb, gmx_bool bTwo, gmx_bool bContact)
     /* Check whether donors are also acceptors */
     printf("Merging hbonds with Acceptor and Donor swapped\n");
 
-    ntmp = 2 * hb->max_frames;
-    snew(gtmp, ntmp);
-    snew(htmp, ntmp);
     for (i = 0; (i < hb->d.nrd); i++)
     {
         fprintf(stderr, "\r%d/%d", i + 1, hb->d.nrd);
         fflush(stderr);
         id = hb->d.don[i];
         ii = hb->a.aptr[id];
-        for (j = 0; (j < hb->a.nra); j++)
+        for (k = 0; (k < hb->hbmap[i].nr); k++)
         {
+            j  = hb->hbmap[i].acc[k];
             ia = hb->a.acc[j];
             jj = hb->d.dptr[ia];
             if ((id != ia) && (ii != NOTSET) && (jj != NOTSET)
                 && (!bTwo || (hb->d.grp[i] != hb->a.grp[j])))
             {
-                hb0 = hb->hbmap[i][j];
-                hb1 = hb->hbmap[jj][ii];
+                hb0 = hb->hbmap[i].hb[k];
+                hb1 = get_hbond(hb, jj, ii);
                 if (hb0 && hb1 && ISHB(hb0->history[0]) && ISHB(hb1->history[0]))
                 {
-                    do_merge(hb, ntmp, htmp, gtmp, hb0, hb1);
+                    do_merge(hb0, hb1);
                     if (ISHB(hb1->history[0]))
                     {
                         inrnew--;
@@ -1518,8 +1563,8 @@ static void merge_hb(t_hbdata* hb, gmx_bool bTwo, gmx_bool bContact)
                     {
                         gmx_incons("Neither hydrogen bond nor distance");
                     }
-                    sfree(hb1->h[0]);
-                    sfree(hb1->g[0]);
+                    done_hbexist(hb1->h[0]);
+                    done_hbexist(hb1->g[0]);
                     hb1->h[0]       = nullptr;
                     hb1->g[0]       = nullptr;
                     hb1->history[0] = hbNo;
@@ -1532,8 +1577,6 @@ static void merge_hb(t_hbdata* hb, gmx_bool bTwo, gmx_bool bContact)
     printf("- Reduced number of distances from %d to %d\n", hb->nrdist, indnew);
     hb->nrhb   = inrnew;
     hb->nrdist = indnew;
-    sfree(gtmp);
-    sfree(htmp);
 }
 
 static void do_nhb_dist(FILE* fp, t_hbdata* hb, real t)
@@ -1565,24 +1608,24 @@ static void do_nhb_dist(FILE* fp, t_hbdata* hb, real t)
 
 static void do_hblife(const char* fn, t_hbdata* hb, gmx_bool bMerge, gmx_bool bContact, const gmx_output_env_t* oenv)
 {
-    FILE*          fp;
-    const char*    leg[] = { "p(t)", "t p(t)" };
-    int*           histo;
-    int            i, j, j0, k, m, nh, ihb, ohb, nhydro, ndump = 0;
-    int            nframes = hb->nframes;
-    unsigned int** h;
-    real           t, x1, dt;
-    double         sum, integral;
-    t_hbond*       hbh;
+    FILE*       fp;
+    const char* leg[] = { "p(t)", "t p(t)" };
+    int*        histo;
+    int         i, j0, k, m, nh, r, nhydro;
+    int         nframes = hb->nframes;
+    t_hbexist** h;
+    real        t, x1, dt;
+    double      sum, integral;
+    t_hbond*    hbh;
 
     snew(h, hb->maxhydro);
     snew(histo, nframes + 1);
     /* Total number of hbonds analyzed here */
     for (i = 0; (i < hb->d.nrd); i++)
     {
-        for (k = 0; (k < hb->a.nra); k++)
+        for (k = 0; (k < hb->hbmap[i].nr); k++)
         {
-            hbh = hb->hbmap[i][k];
+            hbh = hb->hbmap[i].hb[k];
             if (hbh)
             {
                 if (bMerge)
@@ -1610,30 +1653,11 @@ static void do_hblife(const char* fn, t_hbdata* hb, gmx_bool bMerge, gmx_bool bC
                 }
                 for (nh = 0; (nh < nhydro); nh++)
                 {
-                    ohb = 0;
-                    j0  = 0;
-
-                    for (j = 0; (j <= hbh->nframes); j++)
+                    /* Count the runs that have ended within the frames of this hbond */
+                    for (r = 0; (r < h[nh]->nrun) && (h[nh]->run[2 * r + 1] <= hbh->nframes); r++)
                     {
-                        ihb = static_cast<int>(is_hb(h[nh], j));
-                        if (debug && (ndump < 10))
-                        {
-                            fprintf(debug, "%5d  %5d\n", j, ihb);
-                        }
-                        if (ihb != ohb)
-                        {
-                            if (ihb)
-                            {
-                                j0 = j;
-                            }
-                            else
-                            {
-                                histo[j - j0]++;
-                            }
-                            ohb = ihb;
-                        }
+                        histo[h[nh]->run[2 * r + 1] - h[nh]->run[2 * r]]++;
                     }
-                    ndump++;
                 }
             }
         }
@@ -1698,11 +1722,11 @@ static void dump_ac(t_hbdata* hb, gmx_bool oneHB, int nDump)
         fprintf(fp, "%10.3f", hb->time[j]);
         for (i = nd = 0; (i < hb->d.nrd) && (nd < nDump); i++)
         {
-            for (k = 0; (k < hb->a.nra) && (nd < nDump); k++)
+            for (k = 0; (k < hb->hbmap[i].nr) && (nd < nDump); k++)
             {
                 bPrint = FALSE;
                 ihb = idist = 0;
-                hbh         = hb->hbmap[i][k];
+                hbh         = hb->hbmap[i].hb[k];
                 if (oneHB)
                 {
                     if (hbh->h[0])
@@ -1988,6 +2012,21 @@ static void normalizeACF(real* ct, real* gt, int nhb, int len)
     }
 }
 
+/*! \brief Fills \p f with the 0/1 existence of \p e over frames [0, \p nf] of a hydrogen bond,
+ * leaving the rest of the \p nframes elements zero. */
+static void fill_hbexist(const t_hbexist* e, int nf, int nframes, real* f)
+{
+    std::fill(f, f + nframes, 0);
+    for (int r = 0; r < e->nrun; r++)
+    {
+        const int end = std::min({ e->run[2 * r + 1], nf + 1, nframes });
+        for (int j = e->run[2 * r]; j < end; j++)
+        {
+            f[j] = 1;
+        }
+    }
+}
+
 static void do_hbac(const char*             fn,
                     t_hbdata*               hb,
                     int                     nDump,
@@ -2000,206 +2039,169 @@ static void do_hbac(const char*             fn,
                     int                     nThreads)
 {
     FILE* fp;
-    int   i, j, k, m, ihb, idist, n2, nn;
+    int   i, j, k, m, n2, nn;
 
-    const char*    legLuzar[] = { "Ac\\sfin sys\\v{}\\z{}(t)",
+    const char* legLuzar[] = { "Ac\\sfin sys\\v{}\\z{}(t)",
                                "Ac(t)",
                                "Cc\\scontact,hb\\v{}\\z{}(t)",
                                "-dAc\\sfs\\v{}\\z{}/dt" };
-    gmx_bool       bNorm      = FALSE;
-    double         nhb        = 0;
-    real *         rhbex      = nullptr, *ht, *gt, *ght, *dght, *kt;
-    real *         ct, tail, tail2, dtail, *cct;
-    const real     tol     = 1e-3;
-    int            nframes = hb->nframes;
-    unsigned int **h = nullptr, **g = nullptr;
-    int            nh, nhbonds, nhydro;
-    t_hbond*       hbh;
-    int            acType;
-    int*           dondata = nullptr;
-
-    enum
-    {
-        AC_NONE,
-        AC_NN,
-        AC_GEM,
-        AC_LUZAR
-    };
-
-    const bool bOMP = GMX_OPENMP;
+    double      nhb = 0;
+    real *      ght, *kt;
+    real *      ct, tail, tail2, dtail, *cct;
+    const real  tol     = 1e-3;
+    int         nframes = hb->nframes;
+    t_hbond*    hbh;
 
     printf("Doing autocorrelation ");
-
-    acType = AC_LUZAR;
     printf("according to the theory of Luzar and Chandler.\n");
     fflush(stdout);
 
-    /* build hbexist matrix in reals for autocorr */
-    /* Allocate memory for computing ACF (rhbex) and aggregating the ACF (ct) */
+    /* The correlation functions are computed by FFT over a zero-padded
+     * power-of-two length, which avoids wrap-around for all lags.
+     */
     n2 = 1;
     while (n2 < nframes)
     {
         n2 *= 2;
     }
+    const int nfft  = 2 * n2;
+    const int nspec = nfft / 2 + 1;
 
     nn = nframes / 2;
 
-    if (acType != AC_NN || bOMP)
-    {
-        snew(h, hb->maxhydro);
-        snew(g, hb->maxhydro);
-    }
-
     /* Dump hbonds for debugging */
     dump_ac(hb, bMerge || bContact, nDump);
 
-    /* Total number of hbonds analyzed here */
-    nhbonds = 0;
-
-    if (acType != AC_LUZAR && bOMP)
+    /* Collect the hbonds (or contacts) analyzed here, with the hydrogen index */
+    std::vector<std::pair<const t_hbond*, int>> series;
+    for (i = 0; (i < hb->d.nrd); i++)
     {
-        nThreads = std::min((nThreads <= 0) ? INT_MAX : nThreads, gmx_omp_get_max_threads());
-
-        gmx_omp_set_num_threads(nThreads);
-        snew(dondata, nThreads);
-        for (i = 0; i < nThreads; i++)
-        {
-            dondata[i] = -1;
-        }
-        printf("ACF calculations parallelized with OpenMP using %i threads.\n"
-               "Expect close to linear scaling over this donor-loop.\n",
-               nThreads);
-        fflush(stdout);
-        fprintf(stderr, "Donors: [thread no]\n");
+        for (k = 0; (k < hb->hbmap[i].nr); k++)
         {
-            char tmpstr[7];
-            for (i = 0; i < nThreads; i++)
+            hbh = hb->hbmap[i].hb[k];
+            if (bMerge || bContact)
             {
-                snprintf(tmpstr, 7, "[%i]", i);
-                fprintf(stderr, "%-7s", tmpstr);
+                if (ISHB(hbh->history[0]))
+                {
+                    series.emplace_back(hbh, 0);
+                }
+            }
+            else
+            {
+                for (m = 0; (m < hb->maxhydro); m++)
+                {
+                    if (bContact ? ISDIST(hbh->history[m]) : ISHB(hbh->history[m]))
+                    {
+                        series.emplace_back(hbh, m);
+                    }
+                }
             }
         }
-        fprintf(stderr, "\n");
     }
+    const int nseries = static_cast<int>(series.size());
 
+    nThreads = std::min((nThreads <= 0) ? INT_MAX : nThreads, gmx_omp_get_max_threads());
+    nThreads = std::max(1, std::min(nThreads, nseries));
+    fprintf(stderr, "ACF over %d %s using %d thread%s\n", nseries, bContact ? "contacts" : "hbonds",
+            nThreads, nThreads > 1 ? "s" : "");
 
-    /* Build the ACF */
-    snew(rhbex, 2 * n2);
-    snew(ct, 2 * n2);
-    snew(gt, 2 * n2);
-    snew(ht, 2 * n2);
-    snew(ght, 2 * n2);
-    snew(dght, 2 * n2);
-
-    snew(kt, nn);
-    snew(cct, nn);
-
-    for (i = 0; (i < hb->d.nrd); i++)
+    /* Instead of correlating each hbond separately, the power spectrum of h(t)
+     * and the cross spectrum of h(t) and g(t) are summed over all hbonds,
+     * per thread in double precision, and transformed back only once.
+     */
+    std::vector<std::vector<double>> spectrumThread(nThreads, std::vector<double>(3 * nspec, 0.0));
+    std::vector<double>              nhbThread(nThreads, 0.0);
+#pragma omp parallel num_threads(nThreads)
     {
-        for (k = 0; (k < hb->a.nra); k++)
+        try
         {
-            nhydro = 0;
-            hbh    = hb->hbmap[i][k];
+            const int         thread = gmx_omp_get_thread_num();
+            std::vector<real> ht(nfft + 2, 0), gt(nfft + 2, 0);
+            std::vector<real> hSpec(nfft + 2), gSpec(nfft + 2);
+            double*           spectrum = spectrumThread[thread].data();
+            gmx_fft_t         fft;
 
-            if (hbh)
+            gmx_fft_init_1d_real(&fft, nfft, GMX_FFT_FLAG_CONSERVATIVE);
+#pragma omp for schedule(static)
+            for (int s = 0; s < nseries; s++)
             {
-                if (bMerge || bContact)
+                const t_hbond* hbs = series[s].first;
+                const int      ih  = series[s].second;
+
+                fill_hbexist(hbs->h[ih], hbs->nframes, nframes, ht.data());
+                fill_hbexist(hbs->g[ih], hbs->nframes, nframes, gt.data());
+                for (int j = 0; (j < nframes); j++)
                 {
-                    if (ISHB(hbh->history[0]))
+                    /* For contacts: if a second cut-off is provided, use it,
+                     * otherwise use g(t) = 1-h(t) */
+                    if (!R2 && bContact)
                     {
-                        h[0]   = hbh->h[0];
-                        g[0]   = hbh->g[0];
-                        nhydro = 1;
+                        gt[j] = 1 - ht[j];
                     }
-                }
-                else
-                {
-                    for (m = 0; (m < hb->maxhydro); m++)
+                    else
                     {
-                        if (bContact ? ISDIST(hbh->history[m]) : ISHB(hbh->history[m]))
-                        {
-                            g[nhydro] = hbh->g[m];
-                            h[nhydro] = hbh->h[m];
-                            nhydro++;
-                        }
+                        gt[j] = gt[j] * (1 - ht[j]);
                     }
+                    nhbThread[thread] += ht[j];
                 }
 
-                int nf = hbh->nframes;
-                for (nh = 0; (nh < nhydro); nh++)
+                gmx_fft_1d_real(fft, GMX_FFT_REAL_TO_COMPLEX, ht.data(), hSpec.data());
+                gmx_fft_1d_real(fft, GMX_FFT_REAL_TO_COMPLEX, gt.data(), gSpec.data());
+                for (int f = 0; f < nspec; f++)
                 {
-                    int nrint = bContact ? hb->nrdist : hb->nrhb;
-                    if ((((nhbonds + 1) % 10) == 0) || (nhbonds + 1 == nrint))
-                    {
-                        fprintf(stderr, "\rACF %d/%d", nhbonds + 1, nrint);
-                        fflush(stderr);
-                    }
-                    nhbonds++;
-                    for (j = 0; (j < nframes); j++)
-                    {
-                        if (j <= nf)
-                        {
-                            ihb   = static_cast<int>(is_hb(h[nh], j));
-                            idist = static_cast<int>(is_hb(g[nh], j));
-                        }
-                        else
-                        {
-                            ihb = idist = 0;
-                        }
-                        rhbex[j] = ihb;
-                        /* For contacts: if a second cut-off is provided, use it,
-                         * otherwise use g(t) = 1-h(t) */
-                        if (!R2 && bContact)
-                        {
-                            gt[j] = 1 - ihb;
-                        }
-                        else
-                        {
-                            gt[j] = idist * (1 - ihb);
-                        }
-                        ht[j] = rhbex[j];
-                        nhb += ihb;
-                    }
-
-                    /* The autocorrelation function is normalized after summation only */
-                    low_do_autocorr(nullptr,
-                                    oenv,
-                                    nullptr,
-                                    nframes,
-                                    1,
-                                    -1,
-                                    &rhbex,
-                                    hb->time[1] - hb->time[0],
-                                    eacNormal,
-                                    1,
-                                    FALSE,
-                                    bNorm,
-                                    FALSE,
-                                    0,
-                                    -1,
-                                    0);
-
-                    /* Cross correlation analysis for thermodynamics */
-                    for (j = nframes; (j < n2); j++)
-                    {
-                        ht[j] = 0;
-                        gt[j] = 0;
-                    }
-
-                    cross_corr(n2, ht, gt, dght);
-
-                    for (j = 0; (j < nn); j++)
-                    {
-                        ct[j] += rhbex[j];
-                        ght[j] += dght[j];
-                    }
+                    const double hRe = hSpec[2 * f];
+                    const double hIm = hSpec[2 * f + 1];
+                    const double gRe = gSpec[2 * f];
+                    const double gIm = gSpec[2 * f + 1];
+                    /* |H|^2 and H conj(G) */
+                    spectrum[f] += hRe * hRe + hIm * hIm;
+                    spectrum[nspec + 2 * f] += hRe * gRe + hIm * gIm;
+                    spectrum[nspec + 2 * f + 1] += hIm * gRe - hRe * gIm;
                 }
             }
+            gmx_fft_destroy(fft);
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
-    fprintf(stderr, "\n");
-    sfree(h);
-    sfree(g);
+    gmx_fft_cleanup();
+
+    /* Reduce over threads in a fixed order */
+    std::vector<double> spectrum(3 * nspec, 0.0);
+    for (int t = 0; t < nThreads; t++)
+    {
+        for (int f = 0; f < 3 * nspec; f++)
+        {
+            spectrum[f] += spectrumThread[t][f];
+        }
+        nhb += nhbThread[t];
+    }
+
+    std::vector<real> acSpec(nfft + 2, 0), ccSpec(nfft + 2), acf(nfft + 2), ccf(nfft + 2);
+    for (int f = 0; f < nspec; f++)
+    {
+        acSpec[2 * f]     = spectrum[f];
+        ccSpec[2 * f]     = spectrum[nspec + 2 * f];
+        ccSpec[2 * f + 1] = spectrum[nspec + 2 * f + 1];
+    }
+    gmx_fft_t fft;
+    gmx_fft_init_1d_real(&fft, nfft, GMX_FFT_FLAG_CONSERVATIVE);
+    gmx_fft_1d_real(fft, GMX_FFT_COMPLEX_TO_REAL, acSpec.data(), acf.data());
+    gmx_fft_1d_real(fft, GMX_FFT_COMPLEX_TO_REAL, ccSpec.data(), ccf.data());
+    gmx_fft_destroy(fft);
+    gmx_fft_cleanup();
+
+    snew(ct, nn);
+    snew(ght, nn);
+    snew(kt, nn);
+    snew(cct, nn);
+    for (j = 0; (j < nn); j++)
+    {
+        /* The autocorrelation is averaged over time origins per hbond,
+         * and normalized after summation only */
+        ct[j]  = acf[j] / (static_cast<real>(nfft) * (nframes - j));
+        ght[j] = ccf[j] / static_cast<real>(nfft);
+    }
+
     normalizeACF(ct, ght, static_cast<int>(nhb), nn);
 
     /* Determine tail value for statistics */
@@ -2257,12 +2259,8 @@ static void do_hbac(const char*             fn,
     analyse_corr(nn, hb->time, ct, ght, kt, nullptr, nullptr, nullptr, fit_start, temp);
 
     do_view(oenv, fn, nullptr);
-    sfree(rhbex);
     sfree(ct);
-    sfree(gt);
-    sfree(ht);
     sfree(ght);
-    sfree(dght);
     sfree(cct);
     sfree(kt);
 }
@@ -2312,9 +2310,10 @@ static void analyse_donor_properties(FILE* fp, t_hbdata* hb, int nframes, real t
         {
             nb = 0;
             nhtot++;
-            for (j = 0; (j < hb->a.nra) && (nb == 0); j++)
+            for (j = 0; (j < hb->hbmap[i].nr) && (nb == 0); j++)
             {
-                if (hb->hbmap[i][j] && hb->hbmap[i][j]->h[k] && is_hb(hb->hbmap[i][j]->h[k], nframes))
+                const t_hbond* hbh = hb->hbmap[i].hb[j];
+                if (hbh->h[k] && is_hb(hbh->h[k], nframes - hbh->n0))
                 {
                     nb = 1;
                 }
@@ -2400,12 +2399,12 @@ static void dump_hbmap(t_hbdata*      hb,
     for (i = 0; (i < hb->d.nrd); i++)
     {
         ddd = hb->d.don[i];
-        for (k = 0; (k < hb->a.nra); k++)
+        for (k = 0; (k < hb->hbmap[i].nr); k++)
         {
-            aaa = hb->a.acc[k];
+            aaa = hb->a.acc[hb->hbmap[i].acc[k]];
             for (m = 0; (m < hb->d.nhydro[i]); m++)
             {
-                if (hb->hbmap[i][k] && ISHB(hb->hbmap[i][k]->history[m]))
+                if (ISHB(hb->hbmap[i].hb[k]->history[m]))
                 {
                     sprintf(ds, "%s", mkatomname(atoms, ddd));
                     sprintf(as, "%s", mkatomname(atoms, aaa));
@@ -2962,7 +2961,6 @@ int gmx_hbond(int argc, char* argv[])
 
             p_hb[i]->bHBmap   = hb->bHBmap;
             p_hb[i]->bDAnr    = hb->bDAnr;
-            p_hb[i]->wordlen  = hb->wordlen;
             p_hb[i]->nframes  = hb->nframes;
             p_hb[i]->maxhydro = hb->maxhydro;
             p_hb[i]->danr     = hb->danr;
@@ -3531,23 +3529,24 @@ int gmx_hbond(int argc, char* argv[])
                 y = 0;
                 for (id = 0; (id < hb->d.nrd); id++)
                 {
-                    for (ia = 0; (ia < hb->a.nra); ia++)
+                    for (ia = 0; (ia < hb->hbmap[id].nr); ia++)
                     {
+                        const t_hbond* hbh = hb->hbmap[id].hb[ia];
                         for (hh = 0; (hh < hb->maxhydro); hh++)
                         {
-                            if (hb->hbmap[id][ia])
+                            if (ISHB(hbh->history[hh]))
                             {
-                                if (ISHB(hb->hbmap[id][ia]->history[hh]))
+                                range_check(y, 0, mat.ny);
+                                for (int r = 0; r < hbh->h[hh]->nrun; r++)
                                 {
-                                    for (x = 0; (x <= hb->hbmap[id][ia]->nframes); x++)
+                                    const int end = std::min(hbh->h[hh]->run[2 * r + 1],
+                                                             hbh->nframes + 1);
+                                    for (x = hbh->h[hh]->run[2 * r]; x < end; x++)
                                     {
-                                        int nn0 = hb->hbmap[id][ia]->n0;
-                                        range_check(y, 0, mat.ny);
-                                        mat.matrix(x + nn0, y) = static_cast<t_matelmt>(
-                                                is_hb(hb->hbmap[id][ia]->h[hh], x));
+                                        mat.matrix(x + hbh->n0, y) = 1;
                                     }
-                                    y++;
                                 }
+                                y++;
                             }
                         }
                     }
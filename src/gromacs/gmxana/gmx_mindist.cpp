@@ -42,6 +42,8 @@
 #include <cstring>
 
 #include <algorithm>
+#include <numeric>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -54,13 +56,16 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
+#include "gromacs/selection/nbsearch.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 
@@ -68,9 +73,9 @@ static void
 periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], real* rmin, real* rmax, int* min_ind)
 {
 #define NSHIFT_MAX 26
-    int  nsz, nshift, sx, sy, sz, i, j, s;
-    real sqr_box, r2min, r2max, r2;
-    rvec shift[NSHIFT_MAX], d0, d;
+    int  nsz, nshift, sx, sy, sz, i;
+    real sqr_box, r2min, r2max;
+    rvec shift[NSHIFT_MAX];
 
     sqr_box = std::min(norm2(box[XX]), norm2(box[YY]));
     if (pbcType == PbcType::Xyz)
@@ -109,28 +114,56 @@ periodic_dist(PbcType pbcType, matrix box, rvec x[], int n, const int index[], r
     r2min = sqr_box;
     r2max = 0;
 
-    for (i = 0; i < n; i++)
+    /* The pairs are divided over threads, the thread minima are reduced such
+     * that equal distances give the same pair as a serial loop would.
+     */
+#pragma omp parallel num_threads(gmx_omp_get_max_threads())
     {
-        for (j = i + 1; j < n; j++)
+        try
         {
-            rvec_sub(x[index[i]], x[index[j]], d0);
-            r2 = norm2(d0);
-            if (r2 > r2max)
+            real r2min_t = sqr_box, r2max_t = 0;
+            int  imin_t = -1, jmin_t = -1;
+
+#pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < n; i++)
             {
-                r2max = r2;
+                for (int j = i + 1; j < n; j++)
+                {
+                    rvec d0, d;
+                    rvec_sub(x[index[i]], x[index[j]], d0);
+                    real r2 = norm2(d0);
+                    if (r2 > r2max_t)
+                    {
+                        r2max_t = r2;
+                    }
+                    for (int s = 0; s < nshift; s++)
+                    {
+                        rvec_add(d0, shift[s], d);
+                        r2 = norm2(d);
+                        if (r2 < r2min_t)
+                        {
+                            r2min_t = r2;
+                            imin_t  = i;
+                            jmin_t  = j;
+                        }
+                    }
+                }
             }
-            for (s = 0; s < nshift; s++)
+
+#pragma omp critical
             {
-                rvec_add(d0, shift[s], d);
-                r2 = norm2(d);
-                if (r2 < r2min)
+                r2max = std::max(r2max, r2max_t);
+                const bool bFirstPair =
+                        (imin_t < min_ind[0] || (imin_t == min_ind[0] && jmin_t < min_ind[1]));
+                if (imin_t >= 0 && (r2min_t < r2min || (r2min_t == r2min && bFirstPair)))
                 {
-                    r2min      = r2;
-                    min_ind[0] = i;
-                    min_ind[1] = j;
+                    r2min      = r2min_t;
+                    min_ind[0] = imin_t;
+                    min_ind[1] = jmin_t;
                 }
             }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
     *rmin = std::sqrt(r2min);
@@ -228,6 +261,207 @@ static void periodic_mindist_plot(const char*             trxfn,
             index[ind_minj] + 1);
 }
 
+/* Below this number of atom pairs the direct double loop is faster than grid search */
+static const int64_t c_minPairsForGridSearch = 10000;
+
+/* Grid search for the minimum distance and the contacts within rcut between
+ * two groups. All pairs within rcut are found with the neighborhood grid
+ * search, with the work over group 1 atoms divided over OpenMP threads.
+ * Atoms without any neighbor within rcut are searched again with doubled
+ * cutoffs, which only continues until the minimum is known when nearest2 is
+ * nullptr. With nearest2 the squared minimum distance of every group 1 atom
+ * to group 2 is returned. Distances are computed exactly as in calc_dist.
+ */
+static void calc_mindist_grid(real         rcut,
+                              const t_pbc* pbc,
+                              const matrix box,
+                              rvec         x[],
+                              int          nx1,
+                              int          nx2,
+                              const int    index1[],
+                              const int    index2[],
+                              gmx_bool     bGroup,
+                              real*        rmin,
+                              int*         nmin,
+                              int*         ixmin,
+                              int*         jxmin,
+                              real         nearest2[])
+{
+    /* Margin on the search cutoff that makes sure that no pair is missed due to
+     * rounding differences between the grid search and pbc_dx.
+     */
+    const real searchMargin = 1.001;
+    const real rcut2        = gmx::square(rcut);
+    const real maxCutoff    = norm(box[XX]) + norm(box[YY]) + norm(box[ZZ]);
+    const int  nthreads     = gmx_omp_get_max_threads();
+
+    std::vector<gmx::RVec> xref(nx2);
+    for (int j = 0; j < nx2; j++)
+    {
+        xref[j] = x[index2[j]];
+    }
+
+    /* The closest group 2 atom and squared distance for each group 1 atom */
+    std::vector<real> atomMin2(nx1, GMX_REAL_MAX);
+    std::vector<int>  atomMinJ(nx1, -1);
+    /* The contacts per thread, either per group 2 atom or in total */
+    std::vector<std::vector<char>> jContact(nthreads, std::vector<char>(bGroup ? nx2 : 0, 0));
+    std::vector<int>               ncontact(nthreads, 0);
+
+    std::vector<int> pending(nx1);
+    std::iota(pending.begin(), pending.end(), 0);
+    std::vector<gmx::RVec> xtest;
+
+    bool bFound = false;
+    real cutoff = rcut;
+    while (!pending.empty())
+    {
+        gmx::AnalysisNeighborhood nb;
+        nb.setCutoff(cutoff * searchMargin);
+        gmx::AnalysisNeighborhoodSearch search =
+                nb.initSearch(pbc, gmx::AnalysisNeighborhoodPositions(xref));
+        const bool bCountContacts = (cutoff == rcut);
+        const real cutoff2        = (cutoff > 0 ? gmx::square(cutoff) : GMX_REAL_MAX);
+
+        const int numPending = pending.size();
+        xtest.resize(numPending);
+        for (int k = 0; k < numPending; k++)
+        {
+            xtest[k] = x[index1[pending[k]]];
+        }
+
+#pragma omp parallel num_threads(nthreads)
+        {
+            try
+            {
+                const int thread = gmx_omp_get_thread_num();
+                const int begin  = (thread * numPending) / nthreads;
+                const int end    = ((thread + 1) * numPending) / nthreads;
+
+                gmx::AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(
+                        gmx::AnalysisNeighborhoodPositions(as_rvec_array(xtest.data()) + begin,
+                                                           end - begin));
+                gmx::AnalysisNeighborhoodPair pair;
+                while (pairSearch.findNextPair(&pair))
+                {
+                    const int i  = pending[begin + pair.testIndex()];
+                    const int j  = pair.refIndex();
+                    const int ix = index1[i];
+                    const int jx = index2[j];
+                    if (ix == jx)
+                    {
+                        continue;
+                    }
+                    rvec dx;
+                    if (pbc)
+                    {
+                        pbc_dx(pbc, x[ix], x[jx], dx);
+                    }
+                    else
+                    {
+                        rvec_sub(x[ix], x[jx], dx);
+                    }
+                    const real r2 = iprod(dx, dx);
+                    if (bCountContacts && r2 <= rcut2)
+                    {
+                        if (bGroup)
+                        {
+                            jContact[thread][j] = 1;
+                        }
+                        else
+                        {
+                            ncontact[thread]++;
+                        }
+                    }
+                    if (r2 <= cutoff2
+                        && (r2 < atomMin2[i] || (r2 == atomMin2[i] && j < atomMinJ[i])))
+                    {
+                        atomMin2[i] = r2;
+                        atomMinJ[i] = j;
+                    }
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        /* Atoms that have a neighbor within the cutoff now have their minimum */
+        int numUnresolved = 0;
+        for (int i : pending)
+        {
+            if (atomMinJ[i] >= 0)
+            {
+                bFound = true;
+            }
+            else
+            {
+                pending[numUnresolved++] = i;
+            }
+        }
+        pending.resize(numUnresolved);
+
+        if ((bFound && nearest2 == nullptr) || cutoff <= 0)
+        {
+            break;
+        }
+        /* Without a cutoff all pairs are searched, which we switch to once
+         * the cutoff exceeds the size of the box.
+         */
+        cutoff *= 2;
+        if (cutoff > maxCutoff)
+        {
+            cutoff = 0;
+        }
+    }
+
+    /* Find the minimum in the same order as calc_dist does for equal distances */
+    real rmin2 = 1e12;
+    *ixmin     = -1;
+    *jxmin     = -1;
+    int jmin   = nx2;
+    for (int i = 0; i < nx1; i++)
+    {
+        if (atomMinJ[i] >= 0
+            && (atomMin2[i] < rmin2 || (atomMin2[i] == rmin2 && atomMinJ[i] < jmin)))
+        {
+            rmin2  = atomMin2[i];
+            jmin   = atomMinJ[i];
+            *ixmin = index1[i];
+            *jxmin = index2[jmin];
+        }
+        if (nearest2)
+        {
+            nearest2[i] = atomMin2[i];
+        }
+    }
+    *rmin = std::sqrt(rmin2);
+
+    *nmin = 0;
+    for (int thread = 0; thread < nthreads; thread++)
+    {
+        *nmin += ncontact[thread];
+    }
+    if (bGroup)
+    {
+        for (int j = 0; j < nx2; j++)
+        {
+            for (int thread = 0; thread < nthreads; thread++)
+            {
+                if (jContact[thread][j])
+                {
+                    (*nmin)++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Computes the minimum and maximum distance and the number of pairs within and
+ * beyond rcut between two groups. With bMin and large groups only the minimum
+ * distance and contacts are computed, using grid search. When nearest2 is not
+ * nullptr and bMin is set, it returns the squared minimum distance of each
+ * group 1 atom to group 2.
+ */
 static void calc_dist(real     rcut,
                       gmx_bool bPBC,
                       PbcType  pbcType,
@@ -238,6 +472,7 @@ static void calc_dist(real     rcut,
                       int      index1[],
                       int      index2[],
                       gmx_bool bGroup,
+                      gmx_bool bMin,
                       real*    rmin,
                       real*    rmax,
                       int*     nmin,
@@ -245,7 +480,8 @@ static void calc_dist(real     rcut,
                       int*     ixmin,
                       int*     jxmin,
                       int*     ixmax,
-                      int*     jxmax)
+                      int*     jxmax,
+                      real     nearest2[])
 {
     int   i, j, i0 = 0, j1;
     int   ix, jx;
@@ -269,6 +505,32 @@ static void calc_dist(real     rcut,
     {
         set_pbc(&pbc, pbcType, box);
     }
+    if (bMin && index2 && static_cast<int64_t>(nx1) * nx2 >= c_minPairsForGridSearch)
+    {
+        calc_mindist_grid(rcut,
+                          bPBC ? &pbc : nullptr,
+                          box,
+                          x,
+                          nx1,
+                          nx2,
+                          index1,
+                          index2,
+                          bGroup,
+                          rmin,
+                          nmin,
+                          ixmin,
+                          jxmin,
+                          nearest2);
+        *rmax = 0;
+        return;
+    }
+    if (nearest2)
+    {
+        for (i = 0; i < nx1; i++)
+        {
+            nearest2[i] = GMX_REAL_MAX;
+        }
+    }
     if (index2)
     {
         i0     = 0;
@@ -308,6 +570,10 @@ static void calc_dist(real     rcut,
                     rvec_sub(x[ix], x[jx], dx);
                 }
                 r2 = iprod(dx, dx);
+                if (nearest2 && r2 < nearest2[i])
+                {
+                    nearest2[i] = r2;
+                }
                 if (r2 < rmin2)
                 {
                     rmin2  = r2;
@@ -471,6 +737,8 @@ static void dist_plot(const char*             fn,
         }
     }
 
+    /* The minimum distance of each atom in the first group, for the residue minima */
+    std::vector<real> nearest2(nres ? gnx[0] : 0);
     if (nres)
     {
         snew(mindres, ng - 1);
@@ -521,6 +789,7 @@ static void dist_plot(const char*             fn,
                           index[0],
                           index[0],
                           bGroup,
+                          bMin,
                           &dmin,
                           &dmax,
                           &nmin,
@@ -528,7 +797,8 @@ static void dist_plot(const char*             fn,
                           &min1,
                           &min2,
                           &max1,
-                          &max2);
+                          &max2,
+                          nullptr);
                 fprintf(dist, "  %12e", bMin ? dmin : dmax);
                 if (num)
                 {
@@ -551,6 +821,7 @@ static void dist_plot(const char*             fn,
                                   index[i],
                                   index[k],
                                   bGroup,
+                                  bMin,
                                   &dmin,
                                   &dmax,
                                   &nmin,
@@ -558,7 +829,8 @@ static void dist_plot(const char*             fn,
                                   &min1,
                                   &min2,
                                   &max1,
-                                  &max2);
+                                  &max2,
+                                  nullptr);
                         fprintf(dist, "  %12e", bMin ? dmin : dmax);
                         if (num)
                         {
@@ -583,6 +855,7 @@ static void dist_plot(const char*             fn,
                           index[0],
                           index[i],
                           bGroup,
+                          bMin,
                           &dmin,
                           &dmax,
                           &nmin,
@@ -590,13 +863,27 @@ static void dist_plot(const char*             fn,
                           &min1,
                           &min2,
                           &max1,
-                          &max2);
+                          &max2,
+                          (nres && bMin) ? nearest2.data() : nullptr);
                 fprintf(dist, "  %12e", bMin ? dmin : dmax);
                 if (num)
                 {
                     fprintf(num, "  %8d", bMin ? nmin : nmax);
                 }
-                if (nres)
+                if (nres && bMin)
+                {
+                    /* The residue minima follow from the minima per atom */
+                    for (j = 0; j < nres; j++)
+                    {
+                        real rmin2 = GMX_REAL_MAX;
+                        for (k = residue[j]; k < residue[j + 1]; k++)
+                        {
+                            rmin2 = std::min(rmin2, nearest2[k]);
+                        }
+                        mindres[i - 1][j] = std::min(mindres[i - 1][j], std::sqrt(rmin2));
+                    }
+                }
+                else if (nres)
                 {
                     for (j = 0; j < nres; j++)
                     {
@@ -610,6 +897,7 @@ static void dist_plot(const char*             fn,
                                   &(index[0][residue[j]]),
                                   index[i],
                                   bGroup,
+                                  bMin,
                                   &dmin,
                                   &dmax,
                                   &nmin,
@@ -617,7 +905,8 @@ static void dist_plot(const char*             fn,
                                   &min1r,
                                   &min2r,
                                   &max1r,
-                                  &max2r);
+                                  &max2r,
+                                  nullptr);
                         mindres[i - 1][j] = std::min(mindres[i - 1][j], dmin);
                         maxdres[i - 1][j] = std::max(maxdres[i - 1][j], dmax);
                     }
@@ -774,6 +1063,9 @@ int gmx_mindist(int argc, char* argv[])
         "With the [TT]-group[tt] option a contact of an atom in another group",
         "with multiple atoms in the first group is counted as one contact",
         "instead of as multiple contacts.",
+        "The minimum distance and the contacts are found with a grid search",
+        "in parallel, such that the cost grows linearly with the group sizes.",
+        "The maximum distance with [TT]-max[tt] requires a loop over all pairs.",
         "With [TT]-or[tt], minimum distances to each residue in the first",
         "group are determined and plotted as a function of residue number.[PAR]",
         "With option [TT]-pi[tt] the minimum distance of a group to its",
@@ -40,10 +40,14 @@
 #include <cmath>
 #include <cstring>
 
+#include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
+#include "gromacs/correlationfunctions/meansquaredisplacement.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -58,9 +62,11 @@
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 static constexpr double diffusionConversionFactor = 1000.0; /* Convert nm^2/ps to 10e-5 cm^2/s */
@@ -95,6 +101,9 @@ struct t_corr
     std::vector<std::vector<gmx::RVec>> x0;   /* original positions */
     std::vector<gmx::RVec>              com;  /* center of mass correction for each frame */
     gmx_stats_t**                       lsq;  /* fitting stats for individual molecule msds */
+    int                                 nlsq; /* number of restart entries in lsq */
+    std::vector<std::vector<gmx::RVec>> xt;   /* positions in all frames per group, frame major,
+                                                 used by the FFT algorithm */
     msd_type                            type; /* the type of msd to calculate (lateral, etc.)*/
     int                                 axis; /* the axis along which to calculate */
     int                                 ncoords;
@@ -125,6 +134,8 @@ struct t_corr
         data(nrgrp, std::vector<real>()),
         datam(nullptr),
         lsq(nullptr),
+        nlsq(0),
+        xt(nrgrp),
         type(static_cast<msd_type>(type)),
         axis(axis),
         ncoords(0),
@@ -164,7 +175,7 @@ struct t_corr
     }
     ~t_corr()
     {
-        for (int i = 0; i < nrestart; i++)
+        for (int i = 0; i < nlsq; i++)
         {
             for (int j = 0; j < nmol; j++)
             {
@@ -570,6 +581,163 @@ static real calc1_mol(t_corr*   curr,
     return gtot / nx;
 }
 
+/* store the positions of a group for the FFT algorithm, with the com motion removed */
+static void store_positions(t_corr*    curr,
+                            int        nr,
+                            int        nx,
+                            const int  index[],
+                            gmx_bool   bMol,
+                            rvec       xc[],
+                            gmx_bool   bRmCOMM,
+                            const rvec com)
+{
+    for (int i = 0; i < nx; i++)
+    {
+        gmx::RVec x = xc[bMol ? i : index[i]];
+        if (bRmCOMM)
+        {
+            x -= com;
+        }
+        curr->xt[nr].push_back(x);
+    }
+}
+
+/* compute the msd of a group for all lag times, using all frames as restart
+ * points, from the positions stored by store_positions. The msd of each
+ * atom or molecule is computed with FFTs in parallel.
+ */
+static void
+calc_corr_fft(t_corr* curr, int nr, int nx, const int index[], gmx_bool bMol, gmx_bool bTen)
+{
+    const int nframes = curr->nframes;
+
+    /* The dimension pairs to compute, the first ndiag of which give the msd */
+    std::vector<std::pair<int, int>> dims;
+    switch (curr->type)
+    {
+        case NORMAL:
+            for (int m = 0; m < DIM; m++)
+            {
+                dims.emplace_back(m, m);
+            }
+            if (bTen)
+            {
+                dims.emplace_back(YY, XX);
+                dims.emplace_back(ZZ, XX);
+                dims.emplace_back(ZZ, YY);
+            }
+            break;
+        case X:
+        case Y:
+        case Z: dims.emplace_back(curr->type - X, curr->type - X); break;
+        case LATERAL:
+            for (int m = 0; m < DIM; m++)
+            {
+                if (m != curr->axis)
+                {
+                    dims.emplace_back(m, m);
+                }
+            }
+            break;
+        default: gmx_fatal(FARGS, "Error: did not expect option value %d", curr->type);
+    }
+    const int ndiag = bTen ? DIM : dims.size();
+
+    std::vector<real> weight(nx);
+    double            wtot = 0;
+    for (int i = 0; i < nx; i++)
+    {
+        weight[i] = curr->mass.empty() ? 1 : curr->mass[bMol ? i : index[i]];
+        wtot += weight[i];
+    }
+
+    const int nthreads = std::max(1, std::min(gmx_omp_get_max_threads(), nx));
+    /* Sums over atoms per thread for each dimension pair */
+    std::vector<std::vector<double>> sums(nthreads, std::vector<double>(dims.size() * nframes, 0));
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        try
+        {
+            gmx::MsdFftCalculator  calculator(nframes);
+            std::vector<gmx::RVec> x(nframes);
+            std::vector<double>    single(dims.size() * nframes);
+            std::vector<double>&   sum = sums[gmx_omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 16)
+            for (int i = 0; i < nx; i++)
+            {
+                if (weight[i] == 0)
+                {
+                    continue;
+                }
+                for (int t = 0; t < nframes; t++)
+                {
+                    x[t] = curr->xt[nr][t * static_cast<size_t>(nx) + i];
+                }
+                calculator.setPositions(x);
+                std::fill(single.begin(), single.end(), 0);
+                for (size_t d = 0; d < dims.size(); d++)
+                {
+                    calculator.addDisplacementProducts(
+                            dims[d].first,
+                            dims[d].second,
+                            1,
+                            gmx::arrayRefFromArray(single.data() + d * nframes, nframes));
+                }
+                for (size_t j = 0; j < single.size(); j++)
+                {
+                    sum[j] += weight[i] * single[j];
+                }
+                if (bMol)
+                {
+                    for (int t = 0; t < nframes; t++)
+                    {
+                        const real tt = curr->time[t];
+                        if (tt >= curr->beginfit && (curr->endfit < 0 || tt <= curr->endfit))
+                        {
+                            double g = 0;
+                            for (int d = 0; d < ndiag; d++)
+                            {
+                                g += single[d * nframes + t];
+                            }
+                            gmx_stats_add_point(curr->lsq[0][i], tt, g, 0, 0);
+                        }
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    for (int t = 0; t < nframes; t++)
+    {
+        std::vector<double> total(dims.size(), 0);
+        for (const auto& sum : sums)
+        {
+            for (size_t d = 0; d < dims.size(); d++)
+            {
+                total[d] += sum[d * nframes + t];
+            }
+        }
+        curr->data[nr][t] = 0;
+        for (int d = 0; d < ndiag; d++)
+        {
+            curr->data[nr][t] += total[d] / wtot;
+        }
+        if (bTen)
+        {
+            clear_mat(curr->datam[nr][t]);
+            for (size_t d = 0; d < dims.size(); d++)
+            {
+                curr->datam[nr][t][dims[d].first][dims[d].second] = total[d] / wtot;
+            }
+        }
+        /* the data are already averaged over the restart points */
+        curr->ndata[nr][t] = 1;
+    }
+}
+
 static void printmol(t_corr*                 curr,
                      const char*             fn,
                      const char*             fn_pdb,
@@ -600,7 +768,7 @@ static void printmol(t_corr*                 curr,
     for (i = 0; (i < curr->nmol); i++)
     {
         lsq1 = gmx_stats_init();
-        for (j = 0; (j < curr->nrestart); j++)
+        for (j = 0; (j < curr->nlsq); j++)
         {
             real xx, yy, dx, dy;
 
@@ -676,6 +844,7 @@ static int corr_loop(t_corr*                  curr,
                      int*                     index[],
                      t_calc_func*             calc1,
                      gmx_bool                 bTen,
+                     gmx_bool                 bFFT,
                      gmx::ArrayRef<const int> gnx_com,
                      int*                     index_com[],
                      real                     dt,
@@ -737,6 +906,18 @@ static int corr_loop(t_corr*                  curr,
         gpbc = gmx_rmpbc_init(&top->idef, pbcType, natoms);
     }
 
+    if (bFFT)
+    {
+        /* all frames are restart points, the molecule fits are collected in one entry */
+        curr->nlsq = 1;
+        snew(curr->lsq, curr->nlsq);
+        snew(curr->lsq[0], curr->nmol);
+        for (i = 0; i < curr->nmol; i++)
+        {
+            curr->lsq[0][i] = gmx_stats_init();
+        }
+    }
+
     /* the loop over all frames */
     do
     {
@@ -757,7 +938,7 @@ static int corr_loop(t_corr*                  curr,
 
 
         /* check whether we've reached a restart point */
-        if (bRmod(t, curr->t0, dt))
+        if (!bFFT && bRmod(t, curr->t0, dt))
         {
             curr->nrestart++;
 
@@ -771,6 +952,7 @@ static int corr_loop(t_corr*                  curr,
             {
                 curr->lsq[curr->nrestart - 1][i] = gmx_stats_init();
             }
+            curr->nlsq = curr->nrestart;
 
             if (debug)
             {
@@ -854,21 +1036,46 @@ static int corr_loop(t_corr*                  curr,
         /* loop over all groups in index file */
         for (i = 0; (i < curr->ngrp); i++)
         {
-            /* calculate something useful, like mean square displacements */
-            calc_corr(curr, i, gnx[i], index[i], xa[cur], (!gnx_com.empty()), com, calc1, bTen);
+            if (bFFT)
+            {
+                /* only store the positions, the msd is computed after reading all frames */
+                store_positions(curr, i, gnx[i], index[i], bMol, xa[cur], (!gnx_com.empty()), com);
+            }
+            else
+            {
+                /* calculate something useful, like mean square displacements */
+                calc_corr(curr, i, gnx[i], index[i], xa[cur], (!gnx_com.empty()), com, calc1, bTen);
+            }
         }
         cur    = prev;
         t_prev = t;
 
         curr->nframes++;
     } while (read_next_x(oenv, status, &t, x[cur], box));
-    fprintf(stderr,
-            "\nUsed %d restart points spaced %g %s over %g %s\n\n",
-            curr->nrestart,
-            output_env_conv_time(oenv, dt),
-            output_env_get_time_unit(oenv).c_str(),
-            output_env_conv_time(oenv, curr->time[curr->nframes - 1]),
-            output_env_get_time_unit(oenv).c_str());
+
+    if (bFFT)
+    {
+        curr->nrestart = curr->nframes;
+        for (i = 0; (i < curr->ngrp); i++)
+        {
+            calc_corr_fft(curr, i, gnx[i], index[i], bMol, bTen);
+        }
+        fprintf(stderr,
+                "\nUsed all %d frames as restart points over %g %s\n\n",
+                curr->nrestart,
+                output_env_conv_time(oenv, curr->time[curr->nframes - 1]),
+                output_env_get_time_unit(oenv).c_str());
+    }
+    else
+    {
+        fprintf(stderr,
+                "\nUsed %d restart points spaced %g %s over %g %s\n\n",
+                curr->nrestart,
+                output_env_conv_time(oenv, dt),
+                output_env_get_time_unit(oenv).c_str(),
+                output_env_conv_time(oenv, curr->time[curr->nframes - 1]),
+                output_env_get_time_unit(oenv).c_str());
+    }
 
     if (bMol)
     {
@@ -926,6 +1133,7 @@ static void do_corr(const char*             trx_file,
                     gmx_bool                bTen,
                     gmx_bool                bMW,
                     gmx_bool                bRmCOMM,
+                    gmx_bool                bFFT,
                     int                     type,
                     real                    dim_factor,
                     int                     axis,
@@ -980,6 +1188,7 @@ static void do_corr(const char*             trx_file,
                         index,
                         (mol_file != nullptr) ? calc1_mol : (bMW ? calc1_mw : calc1_norm),
                         bTen,
+                        bFFT,
                         gnx_com,
                         index_com,
                         dt,
@@ -1125,6 +1334,12 @@ int gmx_msd(int argc, char* argv[])
         "as [gmx-mdrun] usually already removes the center of mass motion.",
         "When you use this option be sure that the whole system is stored",
         "in the trajectory file.[PAR]",
+        "With [TT]-fft[tt], every frame is used as restarting point and",
+        "[TT]-trestart[tt] is ignored. The MSD of each atom or molecule is then",
+        "computed for all times at once using FFTs, which scales as T log T",
+        "with the number of frames T instead of T^2 and runs in parallel",
+        "over atoms or molecules. This requires storing the positions of",
+        "the selected atoms or molecules for all frames in memory.[PAR]",
         "The diffusion coefficient is determined by linear regression of the MSD.",
         "When [TT]-beginfit[tt] is -1, fitting starts at 10%",
         "and when [TT]-endfit[tt] is -1, fitting goes to 90%.",
@@ -1148,6 +1363,7 @@ int gmx_msd(int argc, char* argv[])
     static gmx_bool    bTen       = FALSE;
     static gmx_bool    bMW        = TRUE;
     static gmx_bool    bRmCOMM    = FALSE;
+    static gmx_bool    bFFT       = FALSE;
     t_pargs            pa[]       = {
         { "-type", FALSE, etENUM, { normtype }, "Compute diffusion coefficient in one direction" },
         { "-lateral",
@@ -1161,6 +1377,11 @@ int gmx_msd(int argc, char* argv[])
         { "-rmcomm", FALSE, etBOOL, { &bRmCOMM }, "Remove center of mass motion" },
         { "-tpdb", FALSE, etTIME, { &t_pdb }, "The frame to use for option [TT]-pdb[tt] (%t)" },
         { "-trestart", FALSE, etTIME, { &dt }, "Time between restarting points in trajectory (%t)" },
+        { "-fft",
+          FALSE,
+          etBOOL,
+          { &bFFT },
+          "Use FFTs to compute the MSD with every frame as restarting point" },
         { "-beginfit",
           FALSE,
           etTIME,
@@ -1260,6 +1481,11 @@ int gmx_msd(int argc, char* argv[])
         gmx_fatal(FARGS, "Can only calculate the full tensor for 3D msd");
     }
 
+    if (bFFT && opt2parg_bSet("-trestart", asize(pa), pa))
+    {
+        fprintf(stderr, "Option -trestart is ignored with -fft, all frames are restart points\n");
+    }
+
     bTop = read_tps_conf(tps_file, &top, &pbcType, &xdum, nullptr, box, bMW || bRmCOMM);
     if (mol_file && !bTop)
     {
@@ -1278,6 +1504,7 @@ int gmx_msd(int argc, char* argv[])
             bTen,
             bMW,
             bRmCOMM,
+            bFFT,
             type,
             dim_factor,
             axis,
@@ -60,8 +60,10 @@
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
@@ -201,7 +203,7 @@ int gmx_rms(int argc, char* argv[])
         { "-aver", FALSE, etINT, { &avl }, "HIDDENAverage over this distance in the RMSD matrix" }
     };
     int natoms_trx, natoms_trx2, natoms;
-    int i, j, k, m;
+    int i, j, k;
 #define NFRAME 5000
     int        maxframe = NFRAME, maxframe2 = NFRAME;
     real       t, *w_rls, *w_rms, *w_rls_m = nullptr, *w_rms_m = nullptr;
@@ -212,14 +214,14 @@ int gmx_rms(int argc, char* argv[])
     t_iatom*   iatom = nullptr;
 
     matrix box = { { 0 } };
-    rvec * x, *xp, *xm = nullptr, **mat_x = nullptr, **mat_x2, *mat_x2_j = nullptr, vec1, vec2;
+    rvec * x, *xp, *xm = nullptr, **mat_x = nullptr, **mat_x2;
     t_trxstatus* status;
     char         buf[256], buf2[256];
     int          ncons = 0;
     FILE*        fp;
     real         rlstot = 0, **rls, **rlsm = nullptr, *time, *time2, *rlsnorm = nullptr,
          **rmsd_mat = nullptr, **bond_mat = nullptr, *axis, *axis2, *del_xaxis, *del_yaxis,
-         rmsd_max, rmsd_min, rmsd_avg, bond_max, bond_min, ang;
+         rmsd_max, rmsd_min, rmsd_avg, bond_max, bond_min;
     real **  rmsdav_mat = nullptr, av_tot, weight, weight_tot;
     real **  delta = nullptr, delta_max, delta_scalex = 0, delta_scaley = 0, *delta_tot;
     int      delta_xsize = 0, del_lev = 100, mx, my, abs_my;
@@ -834,15 +836,9 @@ int gmx_rms(int argc, char* argv[])
             }
         }
 
-        if (bFitAll)
-        {
-            snew(mat_x2_j, natoms);
-        }
         for (i = 0; i < tel_mat; i++)
         {
             axis[i] = time[freq * i];
-            fprintf(stderr, "\r element %5d; time %5.2f  ", i, axis[i]);
-            fflush(stderr);
             if (bMat)
             {
                 snew(rmsd_mat[i], tel_mat2);
@@ -851,34 +847,70 @@ int gmx_rms(int argc, char* argv[])
             {
                 snew(bond_mat[i], tel_mat2);
             }
-            for (j = 0; j < tel_mat2; j++)
+        }
+        /* All elements are independent, so the rows are computed in parallel */
+#pragma omp parallel num_threads(gmx_omp_get_max_threads())
+        {
+            rvec* fitted_x2 = nullptr;
+            if (bFitAll)
             {
-                if (bFitAll)
+                snew(fitted_x2, natoms);
+            }
+#pragma omp for schedule(dynamic)
+            for (int row = 0; row < tel_mat; row++)
+            {
+                try
                 {
-                    for (k = 0; k < n_ind_m; k++)
+                    for (int col = (bFile2 ? 0 : row); col < tel_mat2; col++)
                     {
-                        copy_rvec(mat_x2[j][k], mat_x2_j[k]);
+                        rvec* x2_col = mat_x2[col];
+                        if (bFitAll)
+                        {
+                            for (int a = 0; a < n_ind_m; a++)
+                            {
+                                copy_rvec(mat_x2[col][a], fitted_x2[a]);
+                            }
+                            do_fit(n_ind_m, w_rls_m, mat_x[row], fitted_x2);
+                            x2_col = fitted_x2;
+                        }
+                        if (bMat && (bFile2 || row < col))
+                        {
+                            rmsd_mat[row][col] = calc_similar_ind(ewhat != ewRMSD,
+                                                                  irms[0],
+                                                                  ind_rms_m,
+                                                                  w_rms_m,
+                                                                  mat_x[row],
+                                                                  x2_col);
+                        }
+                        if (bBond)
+                        {
+                            real angleSum = 0;
+                            for (int b = 0; b < ibond; b++)
+                            {
+                                rvec bond1, bond2;
+                                rvec_sub(mat_x[row][ind_bond1[b]], mat_x[row][ind_bond2[b]], bond1);
+                                rvec_sub(x2_col[ind_bond1[b]], x2_col[ind_bond2[b]], bond2);
+                                angleSum += std::acos(cos_angle(bond1, bond2));
+                            }
+                            bond_mat[row][col] = angleSum * 180.0 / (M_PI * ibond);
+                        }
                     }
-                    do_fit(n_ind_m, w_rls_m, mat_x[i], mat_x2_j);
-                }
-                else
-                {
-                    mat_x2_j = mat_x2[j];
                 }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+            }
+            sfree(fitted_x2);
+        }
+        /* Fill the lower triangles and collect the statistics */
+        for (i = 0; i < tel_mat; i++)
+        {
+            for (j = 0; j < tel_mat2; j++)
+            {
                 if (bMat)
                 {
                     if (bFile2 || (i < j))
                     {
-                        rmsd_mat[i][j] = calc_similar_ind(
-                                ewhat != ewRMSD, irms[0], ind_rms_m, w_rms_m, mat_x[i], mat_x2_j);
-                        if (rmsd_mat[i][j] > rmsd_max)
-                        {
-                            rmsd_max = rmsd_mat[i][j];
-                        }
-                        if (rmsd_mat[i][j] < rmsd_min)
-                        {
-                            rmsd_min = rmsd_mat[i][j];
-                        }
+                        rmsd_max = std::max(rmsd_max, rmsd_mat[i][j]);
+                        rmsd_min = std::min(rmsd_min, rmsd_mat[i][j]);
                         rmsd_avg += rmsd_mat[i][j];
                     }
                     else
@@ -890,22 +922,8 @@ int gmx_rms(int argc, char* argv[])
                 {
                     if (bFile2 || (i <= j))
                     {
-                        ang = 0.0;
-                        for (m = 0; m < ibond; m++)
-                        {
-                            rvec_sub(mat_x[i][ind_bond1[m]], mat_x[i][ind_bond2[m]], vec1);
-                            rvec_sub(mat_x2_j[ind_bond1[m]], mat_x2_j[ind_bond2[m]], vec2);
-                            ang += std::acos(cos_angle(vec1, vec2));
-                        }
-                        bond_mat[i][j] = ang * 180.0 / (M_PI * ibond);
-                        if (bond_mat[i][j] > bond_max)
-                        {
-                            bond_max = bond_mat[i][j];
-                        }
-                        if (bond_mat[i][j] < bond_min)
-                        {
-                            bond_min = bond_mat[i][j];
-                        }
+                        bond_max = std::max(bond_max, bond_mat[i][j]);
+                        bond_min = std::min(bond_min, bond_mat[i][j]);
                     }
                     else
                     {
@@ -39,10 +39,18 @@
 #include <cmath>
 #include <cstdlib>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/confio.h"
+#include "gromacs/fileio/mrcdensitymap.h"
+#include "gromacs/fileio/mrcdensitymapheader.h"
 #include "gromacs/fileio/trxio.h"
+#include "gromacs/gmxana/densitygrid.h"
 #include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/math/gausstransform.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pbcutil/rmpbc.h"
@@ -51,12 +59,65 @@
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/inmemoryserializer.h"
 #include "gromacs/utility/smalloc.h"
 
 static const double bohr =
         0.529177249; /* conversion factor to compensate for VMD plugin conversion... */
 
+//! The range of the Gaussian spreading kernel in multiples of its width
+static const double c_spreadWidthMultiplesOfSigma = 4.0;
+
+/*! \brief Writes a block of lattice values in MRC density format.
+ *
+ * \param[in] fn      Output file name
+ * \param[in] data    Lattice values with the x index running fastest
+ * \param[in] size    Number of lattice points along x, y and z
+ * \param[in] origin  Position of the first lattice point (nm)
+ * \param[in] spacing Distance between lattice points (nm)
+ */
+static void write_mrc(const char* fn, gmx::ArrayRef<const float> data, const int size[], const rvec origin, real spacing)
+{
+    gmx::MrcDensityMapHeader header;
+    for (int d = 0; d < DIM; d++)
+    {
+        header.numColumnRowSection_[d] = size[d];
+        header.extent_[d]              = size[d];
+        /* MRC uses Angstrom, the origin is stored in the EMDB convention */
+        header.cellLength_[d]            = size[d] * spacing * 10;
+        header.userDefinedFloat_[12 + d] = origin[d] * 10;
+    }
+
+    double sum = 0, sum2 = 0;
+    header.dataStatistics_.min_ = data.empty() ? 0 : *std::min_element(data.begin(), data.end());
+    header.dataStatistics_.max_ = data.empty() ? 0 : *std::max_element(data.begin(), data.end());
+    for (const float value : data)
+    {
+        sum += value;
+        sum2 += value * value;
+    }
+    if (!data.empty())
+    {
+        const double mean            = sum / data.size();
+        header.dataStatistics_.mean_ = mean;
+        header.dataStatistics_.rms_  = std::sqrt(std::max(sum2 / data.size() - mean * mean, 0.0));
+    }
+
+    gmx::InMemorySerializer serializer;
+    gmx::MrcDensityMapOfFloatWriter(header, data).write(&serializer);
+    const std::vector<char> buffer = serializer.finishAndGetBuffer();
+
+    FILE* fp = gmx_ffopen(fn, "wb");
+    if (fwrite(buffer.data(), sizeof(char), buffer.size(), fp) != buffer.size())
+    {
+        gmx_fatal(FARGS, "Error writing density map to %s", fn);
+    }
+    gmx_ffclose(fp);
+}
+
 int gmx_spatial(int argc, char* argv[])
 {
     const char* desc[] = {
@@ -84,6 +145,12 @@ int gmx_spatial(int argc, char* argv[])
         "4. run [THISMODULE] on the [TT]c.tng[tt] output of step #3.",
         "5. Load [TT]grid.cube[tt] into VMD and view as an isosurface.",
         "",
+        "With [TT]-mrc[tt] the same grid is also written as an MRC density map,",
+        "which can be read by most molecular viewers and by the density-guided",
+        "simulation code in [gmx-mdrun]. With [TT]-sigma[tt] every atom is spread",
+        "onto the grid as a normalized Gaussian of that width instead of being counted",
+        "in a single bin, which gives smoother maps from shorter trajectories.",
+        "",
         "[BB]Note[bb] that systems such as micelles will require [TT]gmx trjconv -pbc cluster[tt] ",
         "between steps 1 and 2.",
         "",
@@ -127,6 +194,7 @@ int gmx_spatial(int argc, char* argv[])
     static real     rBINWIDTH    = 0.05; /* nm */
     static gmx_bool bCALCDIV     = TRUE;
     static int      iNAB         = 4;
+    static real     rSIGMA       = 0;
 
     t_pargs pa[] = { { "-pbc",
                        FALSE,
@@ -153,7 +221,13 @@ int gmx_spatial(int argc, char* argv[])
                        FALSE,
                        etINT,
                        { &iNAB },
-                       "Number of additional bins to ensure proper memory allocation" } };
+                       "Number of additional bins to ensure proper memory allocation" },
+                     { "-sigma",
+                       FALSE,
+                       etREAL,
+                       { &rSIGMA },
+                       "Width (nm) of the Gaussian used to spread each atom onto the grid, 0 "
+                       "counts atoms in bins" } };
 
     double            MINBIN[3];
     double            MAXBIN[3];
@@ -172,19 +246,19 @@ int gmx_spatial(int argc, char* argv[])
     int               i, nidx, nidxp;
     int               v;
     int               j, k;
-    int***            bin = nullptr;
     int               nbin[3];
     FILE*             flp;
     int               x, y, z, minx, miny, minz, maxx, maxy, maxz;
     int               numfr, numcu;
-    int               tot, maxval, minval;
+    double            tot, maxval, minval;
     double            norm;
     gmx_output_env_t* oenv;
     gmx_rmpbc_t       gpbc = nullptr;
 
     t_filenm fnm[] = { { efTPS, nullptr, nullptr, ffREAD }, /* this is for the topology */
                        { efTRX, "-f", nullptr, ffREAD },    /* and this for the trajectory */
-                       { efNDX, nullptr, nullptr, ffOPTRD } };
+                       { efNDX, nullptr, nullptr, ffOPTRD },
+                       { efMRC, "-mrc", "grid", ffOPTWR } };
 
 #define NFILE asize(fnm)
 
@@ -246,15 +320,34 @@ int gmx_spatial(int argc, char* argv[])
         MINBIN[i] -= iNAB * rBINWIDTH;
         nbin[i] = static_cast<int>(std::ceil((MAXBIN[i] - MINBIN[i]) / rBINWIDTH));
     }
-    snew(bin, nbin[XX]);
-    for (i = 0; i < nbin[XX]; ++i)
+    if (rSIGMA < 0)
     {
-        snew(bin[i], nbin[YY]);
-        for (j = 0; j < nbin[YY]; ++j)
-        {
-            snew(bin[i][j], nbin[ZZ]);
-        }
+        gmx_fatal(FARGS, "The Gaussian width should not be negative");
     }
+
+    /* The bin index is rounded up, so the upper edge of the range has a bin of its own.
+     * The grid is stored with the x index running fastest, as in the MRC format.
+     */
+    const int gridSize[DIM] = { nbin[XX] + 1, nbin[YY] + 1, nbin[ZZ] + 1 };
+    auto      gridCell      = [&gridSize](int x, int y, int z) {
+        return (z * gridSize[YY] + y) * gridSize[XX] + x;
+    };
+    const int numThreads = gmx_omp_get_max_threads();
+
+    gmx::DensityGridAccumulator bin(gridSize[XX] * gridSize[YY] * gridSize[ZZ], numThreads);
+    /* Bin k covers the interval ((k-1)*rBINWIDTH, k*rBINWIDTH], so its
+     * center is lattice point k of the Gaussian spreading lattice.
+     */
+    const gmx::GaussianSpreadKernelParameters::Shape kernelShape = {
+        gmx::DVec(rSIGMA / rBINWIDTH, rSIGMA / rBINWIDTH, rSIGMA / rBINWIDTH), c_spreadWidthMultiplesOfSigma
+    };
+    std::unique_ptr<gmx::GaussianDensityGridAccumulator> spread;
+    if (rSIGMA > 0)
+    {
+        spread = std::make_unique<gmx::GaussianDensityGridAccumulator>(
+                gmx::dynamicExtents3D(gridSize[ZZ], gridSize[YY], gridSize[XX]), kernelShape, numThreads);
+    }
+
     copy_mat(box, box_pbc);
     numfr = 0;
     minx = miny = minz = 999;
@@ -276,56 +369,56 @@ int gmx_spatial(int argc, char* argv[])
             set_pbc(&pbc, pbcType, box_pbc);
         }
 
-        for (i = 0; i < nidx; i++)
-        {
-            if (fr.x[index[i]][XX] < MINBIN[XX] || fr.x[index[i]][XX] > MAXBIN[XX]
-                || fr.x[index[i]][YY] < MINBIN[YY] || fr.x[index[i]][YY] > MAXBIN[YY]
-                || fr.x[index[i]][ZZ] < MINBIN[ZZ] || fr.x[index[i]][ZZ] > MAXBIN[ZZ])
-            {
-                printf("There was an item outside of the allocated memory. Increase the value "
-                       "given with the -nab option.\n");
-                printf("Memory was allocated for [%f,%f,%f]\tto\t[%f,%f,%f]\n",
-                       MINBIN[XX],
-                       MINBIN[YY],
-                       MINBIN[ZZ],
-                       MAXBIN[XX],
-                       MAXBIN[YY],
-                       MAXBIN[ZZ]);
-                printf("Memory was required for [%f,%f,%f]\n",
-                       fr.x[index[i]][XX],
-                       fr.x[index[i]][YY],
-                       fr.x[index[i]][ZZ]);
-                exit(1);
-            }
-            x = static_cast<int>(std::ceil((fr.x[index[i]][XX] - MINBIN[XX]) / rBINWIDTH));
-            y = static_cast<int>(std::ceil((fr.x[index[i]][YY] - MINBIN[YY]) / rBINWIDTH));
-            z = static_cast<int>(std::ceil((fr.x[index[i]][ZZ] - MINBIN[ZZ]) / rBINWIDTH));
-            ++bin[x][y][z];
-            if (x < minx)
-            {
-                minx = x;
-            }
-            if (x > maxx)
+        auto isOutsideGrid = [&](int i) {
+            return (fr.x[index[i]][XX] < MINBIN[XX] || fr.x[index[i]][XX] > MAXBIN[XX]
+                    || fr.x[index[i]][YY] < MINBIN[YY] || fr.x[index[i]][YY] > MAXBIN[YY]
+                    || fr.x[index[i]][ZZ] < MINBIN[ZZ] || fr.x[index[i]][ZZ] > MAXBIN[ZZ]);
+        };
+        const int numOutside = bin.accumulate(nidx, [&](int i, int* cell, double* weight) {
+            if (isOutsideGrid(i))
             {
-                maxx = x;
+                return false;
             }
-            if (y < miny)
-            {
-                miny = y;
-            }
-            if (y > maxy)
-            {
-                maxy = y;
-            }
-            if (z < minz)
-            {
-                minz = z;
-            }
-            if (z > maxz)
+            *cell = gridCell(static_cast<int>(std::ceil((fr.x[index[i]][XX] - MINBIN[XX]) / rBINWIDTH)),
+                             static_cast<int>(std::ceil((fr.x[index[i]][YY] - MINBIN[YY]) / rBINWIDTH)),
+                             static_cast<int>(std::ceil((fr.x[index[i]][ZZ] - MINBIN[ZZ]) / rBINWIDTH)));
+            *weight = 1;
+            return true;
+        });
+        if (numOutside > 0)
+        {
+            for (i = 0; i < nidx; i++)
             {
-                maxz = z;
+                if (isOutsideGrid(i))
+                {
+                    printf("There was an item outside of the allocated memory. Increase the value "
+                           "given with the -nab option.\n");
+                    printf("Memory was allocated for [%f,%f,%f]\tto\t[%f,%f,%f]\n",
+                           MINBIN[XX],
+                           MINBIN[YY],
+                           MINBIN[ZZ],
+                           MAXBIN[XX],
+                           MAXBIN[YY],
+                           MAXBIN[ZZ]);
+                    printf("Memory was required for [%f,%f,%f]\n",
+                           fr.x[index[i]][XX],
+                           fr.x[index[i]][YY],
+                           fr.x[index[i]][ZZ]);
+                    exit(1);
+                }
             }
         }
+        if (spread)
+        {
+            spread->accumulate(nidx, [&](int i, gmx::RVec* latticeCoordinate, real* amplitude) {
+                for (int d = 0; d < DIM; d++)
+                {
+                    (*latticeCoordinate)[d] = (fr.x[index[i]][d] - MINBIN[d]) / rBINWIDTH + 0.5;
+                }
+                *amplitude = 1;
+                return true;
+            });
+        }
         numfr++;
         /* printf("%f\t%f\t%f\n",box[XX][XX],box[YY][YY],box[ZZ][ZZ]); */
 
@@ -336,6 +429,27 @@ int gmx_spatial(int argc, char* argv[])
         gmx_rmpbc_done(gpbc);
     }
 
+    /* Find the range of bins that were visited */
+    gmx::ArrayRef<const double> counts = bin.grid();
+    for (z = 0; z < gridSize[ZZ]; z++)
+    {
+        for (y = 0; y < gridSize[YY]; y++)
+        {
+            for (x = 0; x < gridSize[XX]; x++)
+            {
+                if (counts[gridCell(x, y, z)] != 0)
+                {
+                    minx = std::min(minx, x);
+                    maxx = std::max(maxx, x);
+                    miny = std::min(miny, y);
+                    maxy = std::max(maxy, y);
+                    minz = std::min(minz, z);
+                    maxz = std::max(maxz, z);
+                }
+            }
+        }
+    }
+
     if (!bCUTDOWN)
     {
         minx = miny = minz = 0;
@@ -408,17 +522,31 @@ int gmx_spatial(int argc, char* argv[])
                 {
                     continue;
                 }
-                if (bin[k][j][i] != 0)
+                if (counts[gridCell(k, j, i)] != 0)
                 {
                     printf("A bin was not empty when it should have been empty. Programming "
                            "error.\n");
-                    printf("bin[%d][%d][%d] was = %d\n", k, j, i, bin[k][j][i]);
+                    printf("bin[%d][%d][%d] was = %g\n", k, j, i, counts[gridCell(k, j, i)]);
                     exit(1);
                 }
             }
         }
     }
 
+    /* With spreading the Gaussians reach beyond the visited bins */
+    gmx::ArrayRef<const double> density = counts;
+    if (spread)
+    {
+        density                     = spread->grid();
+        const gmx::IVec spreadRange = kernelShape.latticeSpreadRange();
+        minx = std::max(minx - spreadRange[XX], 0);
+        maxx = std::min(maxx + spreadRange[XX], nbin[XX] - 1);
+        miny = std::max(miny - spreadRange[YY], 0);
+        maxy = std::min(maxy + spreadRange[YY], nbin[YY] - 1);
+        minz = std::max(minz - spreadRange[ZZ], 0);
+        maxz = std::min(maxz + spreadRange[ZZ], nbin[ZZ] - 1);
+    }
+
     minval = 999;
     maxval = 0;
     for (k = 0; k < nbin[XX]; k++)
@@ -439,14 +567,15 @@ int gmx_spatial(int argc, char* argv[])
                 {
                     continue;
                 }
-                tot += bin[k][j][i];
-                if (bin[k][j][i] > maxval)
+                const double value = density[gridCell(k, j, i)];
+                tot += value;
+                if (value > maxval)
                 {
-                    maxval = bin[k][j][i];
+                    maxval = value;
                 }
-                if (bin[k][j][i] < minval)
+                if (value < minval)
                 {
-                    minval = bin[k][j][i];
+                    minval = value;
                 }
             }
         }
@@ -481,7 +610,7 @@ int gmx_spatial(int argc, char* argv[])
                 {
                     continue;
                 }
-                fprintf(flp, "%12.6f ", static_cast<double>(norm * bin[k][j][i]) / numfr);
+                fprintf(flp, "%12.6f ", norm * density[gridCell(k, j, i)] / numfr);
             }
             fprintf(flp, "\n");
         }
@@ -489,6 +618,33 @@ int gmx_spatial(int argc, char* argv[])
     }
     gmx_ffclose(flp);
 
+    if (opt2bSet("-mrc", NFILE, fnm))
+    {
+        /* Same block of bins as in the cube file, bins outside the grid are empty */
+        const int  mrcSize[DIM] = { maxx - minx + 1 - (2 * iIGNOREOUTER),
+                                   maxy - miny + 1 - (2 * iIGNOREOUTER),
+                                   maxz - minz + 1 - (2 * iIGNOREOUTER) };
+        const int  mrcStart[DIM] = { minx + iIGNOREOUTER, miny + iIGNOREOUTER, minz + iIGNOREOUTER };
+        const rvec mrcOrigin     = { static_cast<real>(MINBIN[XX] + (mrcStart[XX] - 0.5) * rBINWIDTH),
+                                 static_cast<real>(MINBIN[YY] + (mrcStart[YY] - 0.5) * rBINWIDTH),
+                                 static_cast<real>(MINBIN[ZZ] + (mrcStart[ZZ] - 0.5) * rBINWIDTH) };
+        std::vector<float> mrcData;
+        mrcData.reserve(std::max(mrcSize[XX] * mrcSize[YY] * mrcSize[ZZ], 0));
+        for (i = mrcStart[ZZ]; i < mrcStart[ZZ] + mrcSize[ZZ]; i++)
+        {
+            for (j = mrcStart[YY]; j < mrcStart[YY] + mrcSize[YY]; j++)
+            {
+                for (k = mrcStart[XX]; k < mrcStart[XX] + mrcSize[XX]; k++)
+                {
+                    const bool inGrid = (k >= 0 && k < gridSize[XX] && j >= 0 && j < gridSize[YY]
+                                         && i >= 0 && i < gridSize[ZZ]);
+                    mrcData.push_back(inGrid ? norm * density[gridCell(k, j, i)] / numfr : 0);
+                }
+            }
+        }
+        write_mrc(opt2fn("-mrc", NFILE, fnm), mrcData, mrcSize, mrcOrigin, rBINWIDTH);
+    }
+
     if (bCALCDIV)
     {
         printf("Counts per frame in all %d cubes divided by %le\n", numcu, 1.0 / norm);
@@ -42,10 +42,16 @@
 #include <cmath>
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/math/vec.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/exceptions.h"
@@ -189,6 +195,94 @@ gmx_sans_t* gmx_sans_init(const t_topology* top, gmx_neutron_atomic_structurefac
     return gsans;
 }
 
+#if GMX_SIMD_HAVE_REAL
+//! Width to which the coordinate arrays are padded for the SIMD distance kernel
+static const int c_histogramPadding = GMX_SIMD_REAL_WIDTH;
+#else
+//! Width to which the coordinate arrays are padded for the distance kernel
+static const int c_histogramPadding = 1;
+#endif
+
+//! Number of histogram rows handed to a thread at a time
+static const int c_histogramRowsPerTask = 16;
+
+/*! \brief Returns the histogram bin of the pair of atoms i and j.
+ *
+ * This is the reference binning, which the SIMD kernel reproduces exactly.
+ */
+static inline int
+pair_distance_bin(int i, int j, const real* x, const real* y, const real* z, double binwidth)
+{
+    const real dx = x[i] - x[j];
+    const real dy = y[i] - y[j];
+    const real dz = z[i] - z[j];
+    return static_cast<int>(std::floor(std::sqrt(dx * dx + dy * dy + dz * dz) / binwidth));
+}
+
+/*! \brief Adds the pairs of atom i with atoms 0 to i-1 to the histogram gr.
+ *
+ * The coordinates are stored separately per dimension, padded to
+ * c_histogramPadding. Distances and bin indices are computed with SIMD,
+ * the weights are added to the bins with a scalar loop.
+ * The SIMD square root and the multiplication by the inverse bin width
+ * are not correctly rounded, so pairs that land very close to a bin edge
+ * are binned again with pair_distance_bin(). This keeps the histogram
+ * identical to binning every pair with the scalar code.
+ */
+static void add_pairs_to_histogram(int           i,
+                                   const real*   x,
+                                   const real*   y,
+                                   const real*   z,
+                                   const double* slength,
+                                   double        binwidth,
+                                   double*       gr)
+{
+#if GMX_SIMD_HAVE_REAL
+    using gmx::SimdBool;
+    using gmx::SimdReal;
+
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t bin[GMX_SIMD_REAL_WIDTH];
+    const SimdReal                           xi(x[i]);
+    const SimdReal                           yi(y[i]);
+    const SimdReal                           zi(z[i]);
+    const SimdReal                           invBinwidthS(1.0 / binwidth);
+    // Bound on the rounding error of the bin position in units of the position
+    const SimdReal edgeToleranceS(16 * GMX_REAL_EPS);
+    const SimdReal oneS(1.0_real);
+
+    for (int j0 = 0; j0 < i; j0 += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal dx        = xi - gmx::load<SimdReal>(x + j0);
+        const SimdReal dy        = yi - gmx::load<SimdReal>(y + j0);
+        const SimdReal dz        = zi - gmx::load<SimdReal>(z + j0);
+        const SimdReal r         = gmx::sqrt(gmx::fma(dz, dz, gmx::fma(dy, dy, dx * dx)));
+        const SimdReal position  = r * invBinwidthS;
+        const SimdReal fraction  = position - gmx::trunc(position);
+        const SimdReal tolerance = edgeToleranceS * gmx::max(position, oneS);
+        const SimdBool nearEdge  = (fraction < tolerance || oneS - fraction < tolerance);
+        store(bin, gmx::cvttR2I(position));
+
+        const int jEnd = std::min(GMX_SIMD_REAL_WIDTH, i - j0);
+        if (gmx::anyTrue(nearEdge))
+        {
+            for (int j = 0; j < jEnd; j++)
+            {
+                bin[j] = pair_distance_bin(i, j0 + j, x, y, z, binwidth);
+            }
+        }
+        for (int j = 0; j < jEnd; j++)
+        {
+            gr[bin[j]] += slength[i] * slength[j0 + j];
+        }
+    }
+#else
+    for (int j = 0; j < i; j++)
+    {
+        gr[pair_distance_bin(i, j, x, y, z, binwidth)] += slength[i] * slength[j];
+    }
+#endif
+}
+
 gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans_t*  gsans,
                                                                         rvec*        x,
                                                                         matrix       box,
@@ -303,56 +397,45 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
     }
     else
     {
-#if GMX_OPENMP
-        nthreads = gmx_omp_get_max_threads();
-        /* Allocating memory for tgr arrays */
-        snew(tgr, nthreads);
-        for (i = 0; i < nthreads; i++)
+        /* Copy the coordinates to padded arrays per dimension for SIMD access,
+         * the padding is never binned.
+         */
+        const int paddedSize =
+                ((isize + c_histogramPadding - 1) / c_histogramPadding) * c_histogramPadding;
+        std::vector<real, gmx::AlignedAllocator<real>> xs(paddedSize), ys(paddedSize), zs(paddedSize);
+        std::vector<double>                            bs(isize);
+        for (i = 0; i < isize; i++)
         {
-            snew(tgr[i], pr->grn);
+            xs[i] = x[index[i]][XX];
+            ys[i] = x[index[i]][YY];
+            zs[i] = x[index[i]][ZZ];
+            bs[i] = gsans->slength[index[i]];
         }
-#    pragma omp parallel shared(tgr) private(tid, i, j)
+        const int numThreads = gmx_omp_get_max_threads();
+
+        /* Each thread fills its own histogram, these are summed afterwards */
+        std::vector<std::vector<double>> threadGr(numThreads, std::vector<double>(pr->grn, 0.0));
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+        for (int i0 = 0; i0 < isize; i0 += c_histogramRowsPerTask)
         {
-            tid = gmx_omp_get_thread_num();
-/* starting parallel threads */
-#    pragma omp for
-            for (i = 0; i < isize; i++)
+            try
             {
-                try
+                double*   gr   = threadGr[gmx_omp_get_thread_num()].data();
+                const int iEnd = std::min(i0 + c_histogramRowsPerTask, isize);
+                for (int ii = i0; ii < iEnd; ii++)
                 {
-                    for (j = 0; j < i; j++)
-                    {
-                        tgr[tid][static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                                gsans->slength[index[i]] * gsans->slength[index[j]];
-                    }
+                    add_pairs_to_histogram(ii, xs.data(), ys.data(), zs.data(), bs.data(), binwidth, gr);
                 }
-                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        /* collecating data for pr->gr */
-        for (i = 0; i < pr->grn; i++)
+        for (const auto& gr : threadGr)
         {
-            for (j = 0; j < nthreads; j++)
+            for (i = 0; i < pr->grn; i++)
             {
-                pr->gr[i] += tgr[j][i];
+                pr->gr[i] += gr[i];
             }
         }
-        /* freeing memory for tgr */
-        for (i = 0; i < nthreads; i++)
-        {
-            sfree(tgr[i]);
-        }
-        sfree(tgr);
-#else
-        for (i = 0; i < isize; i++)
-        {
-            for (j = 0; j < i; j++)
-            {
-                pr->gr[static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                        gsans->slength[index[i]] * gsans->slength[index[j]];
-            }
-        }
-#endif
     }
 
     /* normalize if needed */
@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/trxio.h"
@@ -51,13 +52,18 @@
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/strdb.h"
 
@@ -161,6 +167,59 @@ extern t_complex*** rc_tensor_allocation(int x, int y, int z)
 }
 
 
+#if GMX_SIMD_HAVE_REAL
+//! Width to which the coordinates of each atom type are padded for SIMD
+static const int c_sfactorPadding = GMX_SIMD_REAL_WIDTH;
+#else
+//! Width to which the coordinates of each atom type are padded
+static const int c_sfactorPadding = 1;
+#endif
+
+/*! \brief Computes the sums of cos(k.x) and sin(k.x) over n atoms.
+ *
+ * The coordinates are stored separately per dimension and n should be
+ * a multiple of c_sfactorPadding.
+ */
+static void sum_cos_sin(int         n,
+                        const real* x,
+                        const real* y,
+                        const real* z,
+                        const rvec  k,
+                        real*       sumCos,
+                        real*       sumSin)
+{
+#if GMX_SIMD_HAVE_REAL
+    using gmx::SimdReal;
+
+    const SimdReal kx(k[XX]);
+    const SimdReal ky(k[YY]);
+    const SimdReal kz(k[ZZ]);
+    SimdReal       cosS = gmx::setZero();
+    SimdReal       sinS = gmx::setZero();
+    for (int p = 0; p < n; p += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal xdotk = kx * gmx::load<SimdReal>(x + p);
+        const SimdReal kdotx = gmx::fma(
+                kz, gmx::load<SimdReal>(z + p), gmx::fma(ky, gmx::load<SimdReal>(y + p), xdotk));
+        SimdReal       s, c;
+        gmx::sincos(kdotx, &s, &c);
+        cosS = cosS + c;
+        sinS = sinS + s;
+    }
+    *sumCos = gmx::reduce(cosS);
+    *sumSin = gmx::reduce(sinS);
+#else
+    *sumCos = 0;
+    *sumSin = 0;
+    for (int p = 0; p < n; p++)
+    {
+        const real kdotx = k[XX] * x[p] + k[YY] * y[p] + k[ZZ] * z[p];
+        *sumCos += std::cos(kdotx);
+        *sumSin += std::sin(kdotx);
+    }
+#endif
+}
+
 extern void compute_structure_factor(structure_factor_t* sft,
                                      matrix              box,
                                      reduced_atom_t*     red,
@@ -175,8 +234,8 @@ extern void compute_structure_factor(structure_factor_t* sft,
 
     t_complex*** tmpSF;
     rvec         k_factor;
-    real         kdotx, asf, kx, ky, kz, krr;
-    int          kr, maxkx, maxky, maxkz, i, j, k, p, *counter;
+    real         kx, ky, kz, krr;
+    int          kr, maxkx, maxky, maxkz, i, j, k, *counter;
 
 
     k_factor[XX] = 2 * M_PI / box[XX][XX];
@@ -190,16 +249,47 @@ extern void compute_structure_factor(structure_factor_t* sft,
     snew(counter, sf->n_angles);
 
     tmpSF = rc_tensor_allocation(maxkx, maxky, maxkz);
-    /*
-     * The big loop...
-     * compute real and imaginary part of the structure factor for every
-     * (kx,ky,kz))
+
+    /* Order the atoms by type, so the atomic scattering factor is constant
+     * within each block of atoms. Each block is padded with atoms at the
+     * origin, of which the contribution is subtracted afterwards.
      */
-    fprintf(stderr, "\n");
+    std::vector<int> types;
+    for (i = 0; i < isize; i++)
+    {
+        types.push_back(redt[i].t);
+    }
+    std::sort(types.begin(), types.end());
+    types.erase(std::unique(types.begin(), types.end()), types.end());
+    const int                                      ntypes = types.size();
+    std::vector<int>                               typeStart(ntypes + 1, 0), typePadding(ntypes);
+    std::vector<real, gmx::AlignedAllocator<real>> xs, ys, zs;
+    for (int t = 0; t < ntypes; t++)
+    {
+        typeStart[t] = xs.size();
+        for (i = 0; i < isize; i++)
+        {
+            if (redt[i].t == types[t])
+            {
+                xs.push_back(redt[i].x[XX]);
+                ys.push_back(redt[i].x[YY]);
+                zs.push_back(redt[i].x[ZZ]);
+            }
+        }
+        typePadding[t] = 0;
+        while (xs.size() % c_sfactorPadding != 0)
+        {
+            xs.push_back(0);
+            ys.push_back(0);
+            zs.push_back(0);
+            typePadding[t]++;
+        }
+    }
+    typeStart[ntypes] = xs.size();
+
+    /* Count the k vectors contributing to each scattering angle */
     for (i = 0; i < maxkx; i++)
     {
-        fprintf(stderr, "\rdone %3.1f%%     ", (100.0 * (i + 1)) / maxkx);
-        fflush(stderr);
         kx = i * k_factor[XX];
         for (j = 0; j < maxky; j++)
         {
@@ -217,27 +307,67 @@ extern void compute_structure_factor(structure_factor_t* sft,
                         {
                             counter[kr]++; /* will be used for the copmutation
                                               of the average*/
-                            for (p = 0; p < isize; p++)
-                            {
-                                asf = sf_table[redt[p].t][kr];
-
-                                kdotx = kx * redt[p].x[XX] + ky * redt[p].x[YY] + kz * redt[p].x[ZZ];
-
-                                tmpSF[i][j][k].re += std::cos(kdotx) * asf;
-                                tmpSF[i][j][k].im += std::sin(kdotx) * asf;
-                            }
                         }
                     }
                 }
             }
         }
-    } /* end loop on i */
-      /*
-       *  compute the square modulus of the structure factor, averaging on the surface
-       *  kx*kx + ky*ky + kz*kz = krr*krr
-       *  note that this is correct only for a (on the macroscopic scale)
-       *  isotropic system.
-       */
+    }
+
+    /*
+     * The big loop...
+     * compute real and imaginary part of the structure factor for every
+     * (kx,ky,kz)), the planes of constant kx are distributed over threads
+     */
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(dynamic)
+    for (int ix = 0; ix < maxkx; ix++)
+    {
+        try
+        {
+            rvec kvec;
+            kvec[XX] = ix * k_factor[XX];
+            for (int iy = 0; iy < maxky; iy++)
+            {
+                kvec[YY] = iy * k_factor[YY];
+                for (int iz = 0; iz < maxkz; iz++)
+                {
+                    if (ix == 0 && iy == 0 && iz == 0)
+                    {
+                        continue;
+                    }
+                    kvec[ZZ]       = iz * k_factor[ZZ];
+                    const real kn  = std::sqrt(gmx::square(kvec[XX]) + gmx::square(kvec[YY])
+                                              + gmx::square(kvec[ZZ]));
+                    const int  kri = gmx::roundToInt(kn / sf->ref_k);
+                    if (kn < start_q || kn > end_q || kri >= sf->n_angles)
+                    {
+                        continue;
+                    }
+                    for (int t = 0; t < ntypes; t++)
+                    {
+                        const real asf = sf_table[types[t]][kri];
+                        real       sumCos, sumSin;
+                        sum_cos_sin(typeStart[t + 1] - typeStart[t],
+                                    xs.data() + typeStart[t],
+                                    ys.data() + typeStart[t],
+                                    zs.data() + typeStart[t],
+                                    kvec,
+                                    &sumCos,
+                                    &sumSin);
+                        tmpSF[ix][iy][iz].re += (sumCos - typePadding[t]) * asf;
+                        tmpSF[ix][iy][iz].im += sumSin * asf;
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    /*
+     *  compute the square modulus of the structure factor, averaging on the surface
+     *  kx*kx + ky*ky + kz*kz = krr*krr
+     *  note that this is correct only for a (on the macroscopic scale)
+     *  isotropic system.
+     */
     for (i = 0; i < maxkx; i++)
     {
         kx = i * k_factor[XX];
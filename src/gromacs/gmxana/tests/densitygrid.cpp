@@ -0,0 +1,121 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the threaded density grid accumulation
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/densitygrid.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+TEST(DensityGridAccumulator, SumsOverThreadsAndCalls)
+{
+    const int    numCells = 10000;
+    const int    numItems = 50000;
+    const double weight   = 0.5;
+    for (int numThreads : { 1, 3 })
+    {
+        DensityGridAccumulator accumulator(numCells, numThreads);
+        for (int call = 0; call < 2; call++)
+        {
+            const int numSkipped = accumulator.accumulate(numItems, [&](int i, int* cell, double* w) {
+                *cell = (i * 7) % numCells;
+                *w    = weight;
+                return i % 5 != 0;
+            });
+            EXPECT_EQ(numItems / 5, numSkipped);
+            // Reducing in between calls should not lose or double count anything
+            if (call == 0)
+            {
+                accumulator.grid();
+            }
+        }
+
+        std::vector<double> reference(numCells, 0.0);
+        for (int i = 0; i < numItems; i++)
+        {
+            if (i % 5 != 0)
+            {
+                reference[(i * 7) % numCells] += 2 * weight;
+            }
+        }
+        ArrayRef<const double> grid = accumulator.grid();
+        ASSERT_EQ(numCells, static_cast<int>(grid.size()));
+        for (int cell = 0; cell < numCells; cell++)
+        {
+            EXPECT_EQ(reference[cell], grid[cell]) << "in cell " << cell;
+        }
+    }
+}
+
+TEST(GaussianDensityGridAccumulator, ConservesAmplitudeInsideLattice)
+{
+    const int                                  size = 24;
+    const GaussianSpreadKernelParameters::Shape shape{ DVec(1.5, 1.5, 1.5), 4.0 };
+    const int                                  numItems = 20;
+    GaussianDensityGridAccumulator accumulator(dynamicExtents3D(size, size, size), shape, 3);
+    accumulator.accumulate(numItems, [](int i, RVec* latticeCoordinate, real* amplitude) {
+        *latticeCoordinate = { 10.0_real + 0.1_real * i, 11.3_real, 12.7_real - 0.05_real * i };
+        *amplitude         = 2;
+        return true;
+    });
+    ArrayRef<const double> grid = accumulator.grid();
+    ASSERT_EQ(size * size * size, static_cast<int>(grid.size()));
+    const double total = std::accumulate(grid.begin(), grid.end(), 0.0);
+    EXPECT_NEAR(2.0 * numItems, total, 1e-3 * numItems);
+    // The x index runs fastest, so the maximum is at x=11, y=11, z=12
+    const auto maximum = std::max_element(grid.begin(), grid.end()) - grid.begin();
+    EXPECT_EQ((12 * size + 11) * size + 11, maximum);
+}
+
+} // namespace
+
+} // namespace gmx
@@ -0,0 +1,119 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2022, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx cluster.
+ */
+
+#include "gmxpre.h"
+
+#include <sstream>
+#include <string>
+
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+using gmx::test::StdioTestHelper;
+
+//! Returns the contents of \p filename without xvg comment and legend lines
+std::string readDataLines(const std::string& filename)
+{
+    std::istringstream contents(gmx::TextReader::readFileToString(filename));
+    std::string        data;
+    std::string        line;
+    while (std::getline(contents, line))
+    {
+        if (!line.empty() && line[0] != '#' && line[0] != '@')
+        {
+            data += line + "\n";
+        }
+    }
+    return data;
+}
+
+/*! \brief Test fixture for gmx cluster
+ *
+ * Uses the 40 water molecules and 21 frames of the gmx hbond tests.
+ */
+class ClusterTest : public gmx::test::CommandLineTestBase
+{
+public:
+    //! Clusters the frames with \p method, writing the cluster ids to \p clid and \p clndx
+    void runCluster(const char* method, const std::string& clid, const std::string& clndx)
+    {
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin("0\n");
+
+        CommandLine cmdline;
+        cmdline.append("cluster");
+        cmdline.addOption("-s", fileManager().getInputFilePath("hbond.gro"));
+        cmdline.addOption("-f", fileManager().getInputFilePath("hbond_traj.xtc"));
+        cmdline.addOption("-method", method);
+        // Gives clusters of up to five frames for this trajectory
+        cmdline.addOption("-cutoff", "0.1");
+        cmdline.addOption("-g", fileManager().getTemporaryFilePath(".log"));
+        cmdline.addOption("-o", fileManager().getTemporaryFilePath(".xpm"));
+        cmdline.addOption("-dist", fileManager().getTemporaryFilePath("dist.xvg"));
+        cmdline.addOption("-clid", clid);
+        cmdline.addOption("-clndx", clndx);
+        ASSERT_EQ(0, gmx_cluster(cmdline.argc(), cmdline.argv()));
+    }
+};
+
+TEST_F(ClusterTest, GromosSparseMatchesGromos)
+{
+    const std::string gromosClid  = fileManager().getTemporaryFilePath("gromos.xvg");
+    const std::string gromosClndx = fileManager().getTemporaryFilePath("gromos.ndx");
+    const std::string sparseClid  = fileManager().getTemporaryFilePath("sparse.xvg");
+    const std::string sparseClndx = fileManager().getTemporaryFilePath("sparse.ndx");
+    runCluster("gromos", gromosClid, gromosClndx);
+    runCluster("gromos-sparse", sparseClid, sparseClndx);
+
+    const std::string gromosIds = readDataLines(gromosClid);
+    ASSERT_FALSE(gromosIds.empty());
+    EXPECT_EQ(gromosIds, readDataLines(sparseClid));
+    EXPECT_EQ(gmx::TextReader::readFileToString(gromosClndx),
+              gmx::TextReader::readFileToString(sparseClndx));
+}
+
+} // namespace
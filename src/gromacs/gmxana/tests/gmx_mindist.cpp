@@ -194,4 +194,59 @@ TEST_F(MindistTest, matrixWorks)
 
 // TODO test periodic image - needs a tpr?
 
+/* These groups have enough atom pairs for the grid search to be used */
+class MindistGridTest : public gmx::test::CommandLineTestBase
+{
+public:
+    MindistGridTest()
+    {
+        std::string simDB = gmx::test::TestFileManager::getTestSimulationDatabaseDirectory();
+        std::string gro   = gmx::Path::join(simDB, "alanine_vsite_solvated.gro");
+        commandLine().addOption("-f", gro);
+        commandLine().addOption("-s", gro);
+    }
+
+    void runTest(const CommandLine& args, const char* stringForStdin)
+    {
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin(stringForStdin);
+
+        CommandLine& cmdline = commandLine();
+        cmdline.merge(args);
+        ASSERT_EQ(0, gmx_mindist(cmdline.argc(), cmdline.argv()));
+        checkOutputFiles();
+    }
+};
+
+// Contacts between the protein and the water in a triclinic box
+TEST_F(MindistGridTest, findsContacts)
+{
+    setOutputFile("-od", "mindist.xvg", XvgMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    setOutputFile("-o", "atm-pair.out", gmx::test::ExactTextMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.3" };
+    const char* const stdIn     = "1 13";
+    runTest(CommandLine(cmdline), stdIn);
+}
+
+// Groups that overlap, where the pairs of an atom with itself are skipped
+TEST_F(MindistGridTest, groupWorksWithOverlappingGroups)
+{
+    setOutputFile("-od", "mindist.xvg", XvgMatch());
+    setOutputFile("-on", "ncontacts.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-group", "-d", "0.25" };
+    const char* const stdIn     = "0 1";
+    runTest(CommandLine(cmdline), stdIn);
+}
+
+// Residue minima beyond the cutoff need repeated searches with larger cutoffs
+TEST_F(MindistGridTest, residueMinimaBeyondCutoff)
+{
+    setOutputFile("-od", "mindist.xvg", XvgMatch());
+    setOutputFile("-or", "mindistres.xvg", XvgMatch());
+    const char* const cmdline[] = { "mindist", "-d", "0.05" };
+    const char* const stdIn     = "1 13";
+    runTest(CommandLine(cmdline), stdIn);
+}
+
 } // namespace
@@ -188,4 +188,14 @@ TEST_F(MsdMolTest, diffMolSelected)
     runTest(CommandLine(cmdline), "spc5_3.ndx", "spc5");
 }
 
+//! Test fixture for the FFT algorithm, which uses all frames as restart points
+using MsdFftTest = MsdTest;
+
+// The reference MSD for all lag times, which -trestart 1 also gives
+TEST_F(MsdFftTest, threeDimensionalDiffusion)
+{
+    const char* const cmdline[] = { "msd", "-mw", "no", "-fft", "-type", "no", "-lateral", "no" };
+    runTest(CommandLine(cmdline));
+}
+
 } // namespace
@@ -0,0 +1,121 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx sans.
+ */
+
+#include "gmxpre.h"
+
+#include <cstdio>
+
+#include <string>
+
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/gmxpreprocess/grompp.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/refdata.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/xvgtest.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+using gmx::test::StdioTestHelper;
+using gmx::test::XvgMatch;
+
+/*! \brief Test fixture for gmx sans
+ *
+ * Uses the 40 water molecules and 21 frames of the gmx hbond tests.
+ */
+class SansTest : public gmx::test::CommandLineTestBase
+{
+public:
+    //! Runs gmx sans on all atoms with the options in \p args
+    void runTest(const CommandLine& args)
+    {
+        std::string tpr = fileManager().getTemporaryFilePath(".tpr");
+        std::string mdp = fileManager().getTemporaryFilePath(".mdp");
+        FILE*       fp  = fopen(mdp.c_str(), "w");
+        fprintf(fp, "cutoff-scheme = verlet\n");
+        fprintf(fp, "rcoulomb      = 0.85\n");
+        fprintf(fp, "rvdw          = 0.85\n");
+        fprintf(fp, "rlist         = 0.85\n");
+        fclose(fp);
+
+        // Prepare a .tpr file
+        {
+            CommandLine caller;
+            caller.append("grompp");
+            caller.addOption("-maxwarn", 0);
+            caller.addOption("-f", mdp.c_str());
+            std::string gro = fileManager().getInputFilePath("hbond.gro");
+            caller.addOption("-c", gro.c_str());
+            std::string top = fileManager().getInputFilePath("hbond.top");
+            caller.addOption("-p", top.c_str());
+            caller.addOption("-o", tpr.c_str());
+            ASSERT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
+        }
+        // Run the analysis on the System group
+        {
+            StdioTestHelper stdioHelper(&fileManager());
+            stdioHelper.redirectStringToStdin("0\n");
+
+            CommandLine& cmdline = commandLine();
+            cmdline.merge(args);
+            cmdline.addOption("-s", tpr.c_str());
+            ASSERT_EQ(0, gmx_sans(cmdline.argc(), cmdline.argv()));
+            checkOutputFiles();
+        }
+    }
+};
+
+TEST_F(SansTest, ComputesDebyeSpectrumFromPairHistogram)
+{
+    // The pair distance histogram is summed in double precision, but the
+    // order of the summation depends on the number of threads.
+    XvgMatch match;
+    match.tolerance(gmx::test::relativeToleranceAsFloatingPoint(1, 1e-5));
+    setInputFile("-f", "hbond_traj.xtc");
+    setOutputFile("-pr", "pr.xvg", match);
+    setOutputFile("-sq", "sq.xvg", match);
+    const char* const cmdline[] = { "sans", "-mode", "direct", "-endq", "20", "-qstep", "0.5" };
+    runTest(CommandLine(cmdline));
+}
+
+} // namespace
@@ -0,0 +1,80 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx saxs.
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/gmx_ana.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/refdata.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/xvgtest.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+using gmx::test::StdioTestHelper;
+using gmx::test::XvgMatch;
+
+//! Test fixture for gmx saxs
+using SaxsTest = gmx::test::CommandLineTestBase;
+
+TEST_F(SaxsTest, ComputesStructureFactorOfWater)
+{
+    // The structure factor sums cos and sin of k.x over the atoms, which
+    // are evaluated with SIMD, so only agree up to rounding.
+    XvgMatch match;
+    match.tolerance(gmx::test::relativeToleranceAsFloatingPoint(1, 1e-4));
+    // Uses the 40 water molecules and 21 frames of the gmx hbond tests
+    setInputFile("-s", "hbond.gro");
+    setInputFile("-f", "hbond_traj.xtc");
+    setOutputFile("-sq", "sq.xvg", match);
+
+    auto& cmdline = commandLine();
+
+    StdioTestHelper stdioHelper(&fileManager());
+    stdioHelper.redirectStringToStdin("0\n");
+
+    ASSERT_EQ(0, gmx_saxs(cmdline.argc(), cmdline.argv()));
+    checkOutputFiles();
+}
+
+} // namespace
@@ -0,0 +1,114 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the pair distance histogram of gmx sans.
+ */
+
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/nsfactor.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/real.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+/*! \brief Returns the histogram of all pairs binned one by one
+ *
+ * This is how gmx sans binned the pairs before the SIMD kernel.
+ */
+std::vector<double> referenceHistogram(const std::vector<gmx::RVec>& x, double binwidth, int numBins)
+{
+    std::vector<double> gr(numBins, 0.0);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            gr[static_cast<int>(std::floor(std::sqrt(distance2(x[i], x[j])) / binwidth))] += 1.0;
+        }
+    }
+    return gr;
+}
+
+TEST(RadialDistributionHistogramTest, MatchesScalarBinningAtBinEdges)
+{
+    const double binwidth = 0.01;
+
+    // Atoms on the x axis at each multiple of the bin width and one ulp to
+    // either side, so that many pair distances land on or next to bin edges.
+    // The number of atoms is not a multiple of the SIMD width.
+    std::vector<gmx::RVec> x;
+    for (int k = 0; k <= 40; k++)
+    {
+        const real position = k * binwidth;
+        x.emplace_back(std::nextafter(position, -GMX_REAL_MAX), 0, 0);
+        x.emplace_back(position, 0, 0);
+        x.emplace_back(std::nextafter(position, GMX_REAL_MAX), 0, 0);
+    }
+    const int           numAtoms = x.size();
+    std::vector<int>    index(numAtoms);
+    std::vector<double> slength(numAtoms, 1.0);
+    for (int i = 0; i < numAtoms; i++)
+    {
+        index[i] = i;
+    }
+    gmx_sans_t sans = { nullptr, slength.data() };
+    matrix     box  = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+    gmx_radial_distribution_histogram_t* pr = calc_radial_distribution_histogram(
+            &sans, as_rvec_array(x.data()), box, index.data(), numAtoms, binwidth, FALSE, FALSE, 0, 0);
+
+    // All weights are one, so the sums are exact regardless of the order
+    const std::vector<double> reference = referenceHistogram(x, binwidth, pr->grn);
+    for (int bin = 0; bin < pr->grn; bin++)
+    {
+        EXPECT_EQ(reference[bin], pr->gr[bin]) << "for bin " << bin;
+    }
+
+    sfree(pr->gr);
+    sfree(pr->r);
+    sfree(pr);
+}
+
+} // namespace
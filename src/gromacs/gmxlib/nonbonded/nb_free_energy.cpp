@@ -56,6 +56,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/mdatom.h"
 #include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/utility/fatalerror.h"
 
 
@@ -64,6 +65,7 @@ struct ScalarDataTypes
 {
     using RealType                     = real; //!< The data type to use as real.
     using IntType                      = int;  //!< The data type to use as int.
+    using BoolType                     = bool; //!< The data type to use as bool for real value comparison.
     static constexpr int simdRealWidth = 1;    //!< The width of the RealType.
     static constexpr int simdIntWidth  = 1;    //!< The width of the IntType.
 };
@@ -74,17 +76,21 @@ struct SimdDataTypes
 {
     using RealType                     = gmx::SimdReal;         //!< The data type to use as real.
     using IntType                      = gmx::SimdInt32;        //!< The data type to use as int.
+    using BoolType                     = gmx::SimdBool;         //!< The data type to use as bool for real value comparison.
     static constexpr int simdRealWidth = GMX_SIMD_REAL_WIDTH;   //!< The width of the RealType.
     static constexpr int simdIntWidth  = GMX_SIMD_FINT32_WIDTH; //!< The width of the IntType.
 };
 #endif
 
-//! Computes r^(1/p) and 1/r^(1/p) for the standard p=6
-template<class RealType>
-static inline void pthRoot(const RealType r, RealType* pthRoot, RealType* invPthRoot)
+/*! \brief Computes r^(1/p) and 1/r^(1/p) for the standard p=6
+ *
+ * Both results are set to zero for elements where \p mask is false.
+ */
+template<class RealType, class BoolType>
+static inline void pthRoot(const RealType r, RealType* pthRoot, RealType* invPthRoot, const BoolType mask)
 {
-    *invPthRoot = gmx::invsqrt(std::cbrt(r));
-    *pthRoot    = 1 / (*invPthRoot);
+    *invPthRoot = gmx::maskzInvsqrt(gmx::cbrt(r), mask);
+    *pthRoot    = gmx::maskzInv(*invPthRoot, mask);
 }
 
 template<class RealType>
@@ -158,45 +164,43 @@ static inline RealType lennardJonesPotential(const RealType v6,
 }
 
 /* Ewald LJ */
-static inline real ewaldLennardJonesGridSubtract(const real c6grid, const real potentialShift, const real oneSixth)
+template<class RealType>
+static inline RealType ewaldLennardJonesGridSubtract(const RealType c6grid,
+                                                     const real     potentialShift,
+                                                     const real     oneSixth)
 {
     return (c6grid * potentialShift * oneSixth);
 }
 
 /* LJ Potential switch */
-template<class RealType>
+template<class RealType, class BoolType>
 static inline RealType potSwitchScalarForceMod(const RealType fScalarInp,
                                                const RealType potential,
                                                const RealType sw,
                                                const RealType r,
-                                               const RealType rVdw,
                                                const RealType dsw,
-                                               const real     zero)
+                                               const BoolType mask)
 {
-    if (r < rVdw)
-    {
-        real fScalar = fScalarInp * sw - r * potential * dsw;
-        return (fScalar);
-    }
-    return (zero);
+    /* The mask should select on rV < rVdw */
+    const RealType fScalar = fScalarInp * sw - r * potential * dsw;
+    return (gmx::selectByMask(fScalar, mask));
 }
-template<class RealType>
-static inline RealType potSwitchPotentialMod(const RealType potentialInp,
-                                             const RealType sw,
-                                             const RealType r,
-                                             const RealType rVdw,
-                                             const real     zero)
+template<class RealType, class BoolType>
+static inline RealType potSwitchPotentialMod(const RealType potentialInp, const RealType sw, const BoolType mask)
 {
-    if (r < rVdw)
-    {
-        real potential = potentialInp * sw;
-        return (potential);
-    }
-    return (zero);
+    /* The mask should select on rV < rVdw */
+    const RealType potential = potentialInp * sw;
+    return (gmx::selectByMask(potential, mask));
 }
 
 
-//! Templated free-energy non-bonded kernel
+/*! \brief Templated free-energy non-bonded kernel
+ *
+ * The j-particles in the list of each i-particle are processed in chunks
+ * of DataTypes::simdRealWidth. The per-pair parameters are loaded into
+ * aligned buffers, after which the soft-core and reciprocal-space
+ * corrections are evaluated with masks for all pairs in a chunk at once.
+ */
 template<typename DataTypes, bool useSoftCore, bool scLambdasOrAlphasDiffer, bool vdwInteractionTypeIsEwald, bool elecInteractionTypeIsEwald, bool vdwModifierIsPotSwitch>
 static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
                                   rvec* gmx_restrict         xx,
@@ -212,15 +216,19 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
 
     using RealType = typename DataTypes::RealType;
     using IntType  = typename DataTypes::IntType;
+    using BoolType = typename DataTypes::BoolType;
+
+    constexpr int c_width = DataTypes::simdRealWidth;
 
-    /* FIXME: How should these be handled with SIMD? */
     constexpr real oneTwelfth = 1.0 / 12.0;
     constexpr real oneSixth   = 1.0 / 6.0;
     constexpr real zero       = 0.0;
     constexpr real half       = 0.5;
     constexpr real one        = 1.0;
     constexpr real two        = 2.0;
-    constexpr real six        = 6.0;
+
+    const RealType zeroR = zero;
+    const RealType oneR  = one;
 
     /* Extract pointer to non-bonded interaction constants */
     const interaction_const_t* ic = fr->ic;
@@ -343,9 +351,6 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
     GMX_RELEASE_ASSERT(!(vdwInteractionTypeIsEwald && vdwModifierIsPotSwitch),
                        "Can not apply soft-core to switched Ewald potentials");
 
-    real dvdlCoul = 0;
-    real dvdlVdw  = 0;
-
     /* Lambda factor for state A, 1-lambda*/
     real LFC[NSTATES], LFV[NSTATES];
     LFC[STATE_A] = one - lambda_coul;
@@ -379,9 +384,25 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
 
     int numExcludedPairsBeyondRlist = 0;
 
+    RealType dvdlCoul = zeroR;
+    RealType dvdlVdw  = zeroR;
+
+    /* Buffers for the per-pair data of a chunk of j-particles */
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t preloadJnr[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadPairIncluded[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadPairExcluded[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadSelfScale[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadQq[NSTATES][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadC6[NSTATES][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadC12[NSTATES][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         preloadC6Grid[NSTATES][c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         forceBufferX[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         forceBufferY[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real         forceBufferZ[c_width];
+
     for (int n = 0; n < nri; n++)
     {
-        int npair_within_cutoff = 0;
+        bool haveWithinCutoffPairs = false;
 
         const int  is3   = 3 * shift[n];
         const real shX   = shiftvec[is3];
@@ -398,69 +419,103 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
         const real iqB   = facel * chargeB[ii];
         const int  ntiA  = 2 * ntype * typeA[ii];
         const int  ntiB  = 2 * ntype * typeB[ii];
-        real       vCTot = 0;
-        real       vVTot = 0;
-        real       fIX   = 0;
-        real       fIY   = 0;
-        real       fIZ   = 0;
+        RealType   vCTot = zeroR;
+        RealType   vVTot = zeroR;
+        RealType   fIX   = zeroR;
+        RealType   fIY   = zeroR;
+        RealType   fIZ   = zeroR;
 
-        for (int k = nj0; k < nj1; k++)
+        for (int k = nj0; k < nj1; k += c_width)
         {
-            int            tj[NSTATES];
-            const int      jnr = jjnr[k];
-            const int      j3  = 3 * jnr;
-            RealType       c6[NSTATES], c12[NSTATES], qq[NSTATES], vCoul[NSTATES], vVdw[NSTATES];
-            RealType       r, rInv, rp, rpm2;
-            RealType       alphaVdwEff, alphaCoulEff, sigma6[NSTATES];
-            const RealType dX  = ix - x[j3];
-            const RealType dY  = iy - x[j3 + 1];
-            const RealType dZ  = iz - x[j3 + 2];
-            const RealType rSq = dX * dX + dY * dY + dZ * dZ;
-            RealType       fScalC[NSTATES], fScalV[NSTATES];
-            /* Check if this pair on the exlusions list.*/
-            const bool bPairIncluded = nlist->excl_fep == nullptr || nlist->excl_fep[k];
-
-            if (rSq >= rcutoff_max2 && bPairIncluded)
+            /* Gather the per-pair parameters, padding lanes beyond the end
+             * of the list get a valid j-index and zero parameters.
+             */
+            for (int s = 0; s < c_width; s++)
             {
-                /* We save significant time by skipping all code below.
-                 * Note that with soft-core interactions, the actual cut-off
-                 * check might be different. But since the soft-core distance
-                 * is always larger than r, checking on r here is safe.
-                 * Exclusions outside the cutoff can not be skipped as
-                 * when using Ewald: the reciprocal-space
-                 * Ewald component still needs to be subtracted.
-                 */
-
-                continue;
+                if (k + s < nj1)
+                {
+                    const int  jnr           = jjnr[k + s];
+                    const bool pairIncluded  = (nlist->excl_fep == nullptr || nlist->excl_fep[k + s]);
+                    const int  tjA           = ntiA + 2 * typeA[jnr];
+                    const int  tjB           = ntiB + 2 * typeB[jnr];
+                    preloadJnr[s]            = jnr;
+                    preloadPairIncluded[s]   = pairIncluded ? one : zero;
+                    preloadPairExcluded[s]   = pairIncluded ? zero : one;
+                    preloadSelfScale[s]      = (ii == jnr) ? half : one;
+                    preloadQq[STATE_A][s]    = iqA * chargeA[jnr];
+                    preloadQq[STATE_B][s]    = iqB * chargeB[jnr];
+                    preloadC6[STATE_A][s]    = nbfp[tjA];
+                    preloadC6[STATE_B][s]    = nbfp[tjB];
+                    preloadC12[STATE_A][s]   = nbfp[tjA + 1];
+                    preloadC12[STATE_B][s]   = nbfp[tjB + 1];
+                    if (vdwInteractionTypeIsEwald)
+                    {
+                        preloadC6Grid[STATE_A][s] = nbfp_grid[tjA];
+                        preloadC6Grid[STATE_B][s] = nbfp_grid[tjB];
+                    }
+                }
+                else
+                {
+                    preloadJnr[s]          = jjnr[k];
+                    preloadPairIncluded[s] = zero;
+                    preloadPairExcluded[s] = zero;
+                    preloadSelfScale[s]    = one;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        preloadQq[i][s]     = zero;
+                        preloadC6[i][s]     = zero;
+                        preloadC12[i][s]    = zero;
+                        preloadC6Grid[i][s] = zero;
+                    }
+                }
             }
-            npair_within_cutoff++;
 
-            if (rSq > rlistSquared)
-            {
-                numExcludedPairsBeyondRlist++;
-            }
+            RealType jx, jy, jz;
+            gmx::gatherLoadUTranspose<3>(x, preloadJnr, &jx, &jy, &jz);
 
-            if (rSq > 0)
-            {
-                /* Note that unlike in the nbnxn kernels, we do not need
-                 * to clamp the value of rSq before taking the invsqrt
-                 * to avoid NaN in the LJ calculation, since here we do
-                 * not calculate LJ interactions when C6 and C12 are zero.
-                 */
+            const RealType dX  = ix - jx;
+            const RealType dY  = iy - jy;
+            const RealType dZ  = iz - jz;
+            const RealType rSq = dX * dX + dY * dY + dZ * dZ;
 
-                rInv = gmx::invsqrt(rSq);
-                r    = rSq * rInv;
+            const BoolType bPairIncluded = (zeroR < gmx::load<RealType>(preloadPairIncluded));
+            const BoolType bPairExcluded = (zeroR < gmx::load<RealType>(preloadPairExcluded));
+
+            /* We save significant time by skipping all code below when
+             * all pairs are beyond the cut-off. Note that with soft-core
+             * interactions, the actual cut-off check might be different.
+             * But since the soft-core distance is always larger than r,
+             * checking on r here is safe. Exclusions outside the cutoff
+             * can not be skipped as when using Ewald: the reciprocal-space
+             * Ewald component still needs to be subtracted.
+             */
+            const BoolType bWithinCutoffOrExcluded =
+                    (bPairIncluded && rSq < rcutoff_max2) || bPairExcluded;
+            if (!gmx::anyTrue(bWithinCutoffOrExcluded))
+            {
+                continue;
             }
-            else
+            haveWithinCutoffPairs = true;
+
+            const BoolType bExcludedBeyondRlist = bWithinCutoffOrExcluded && (rlistSquared < rSq);
+            if (gmx::anyTrue(bExcludedBeyondRlist))
             {
-                /* The force at r=0 is zero, because of symmetry.
-                 * But note that the potential is in general non-zero,
-                 * since the soft-cored r will be non-zero.
-                 */
-                rInv = 0;
-                r    = 0;
+                numExcludedPairsBeyondRlist +=
+                        static_cast<int>(gmx::reduce(gmx::selectByMask(oneR, bExcludedBeyondRlist)));
             }
 
+            /* Note that unlike in the nbnxn kernels, we do not need
+             * to clamp the value of rSq before taking the invsqrt
+             * to avoid NaN in the LJ calculation, since here we do
+             * not calculate LJ interactions when C6 and C12 are zero.
+             * The force at r=0 is zero, because of symmetry.
+             * But note that the potential is in general non-zero,
+             * since the soft-cored r will be non-zero.
+             */
+            const RealType rInv = gmx::maskzInvsqrt(rSq, zeroR < rSq);
+            const RealType r    = rSq * rInv;
+
+            RealType rp, rpm2;
             if (useSoftCore)
             {
                 rpm2 = rSq * rSq;  /* r4 */
@@ -473,223 +528,228 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
                  * the simplest math and cheapest code.
                  */
                 rpm2 = rInv * rInv;
-                rp   = 1;
+                rp   = oneR;
             }
 
-            RealType fScal = 0;
+            RealType fScal = zeroR;
 
-            qq[STATE_A] = iqA * chargeA[jnr];
-            qq[STATE_B] = iqB * chargeB[jnr];
-
-            tj[STATE_A] = ntiA + 2 * typeA[jnr];
-            tj[STATE_B] = ntiB + 2 * typeB[jnr];
+            RealType qq[NSTATES], c6[NSTATES], c12[NSTATES];
+            for (int i = 0; i < NSTATES; i++)
+            {
+                qq[i]  = gmx::load<RealType>(preloadQq[i]);
+                c6[i]  = gmx::load<RealType>(preloadC6[i]);
+                c12[i] = gmx::load<RealType>(preloadC12[i]);
+            }
 
-            if (bPairIncluded)
+            if (gmx::anyTrue(bPairIncluded))
             {
-                c6[STATE_A] = nbfp[tj[STATE_A]];
-                c6[STATE_B] = nbfp[tj[STATE_B]];
+                RealType sigma6[NSTATES];
+                RealType alphaVdwEff, alphaCoulEff;
+                if (useSoftCore)
+                {
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
+                        const BoolType c6AndC12Positive = (zeroR < c6[i]) && (zeroR < c12[i]);
+                        sigma6[i] = half * c12[i] * gmx::maskzInv(c6[i], c6AndC12Positive);
+                        /* for disappearing coul and vdw with soft core at the same time */
+                        sigma6[i] = gmx::blend(
+                                RealType(sigma6_def), gmx::max(sigma6[i], RealType(sigma6_min)), c6AndC12Positive);
+                    }
 
+                    /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
+                    const BoolType bothC12Positive = (zeroR < c12[STATE_A]) && (zeroR < c12[STATE_B]);
+                    alphaVdwEff  = gmx::selectByNotMask(RealType(alpha_vdw), bothC12Positive);
+                    alphaCoulEff = gmx::selectByNotMask(RealType(alpha_coul), bothC12Positive);
+                }
+
+                RealType vCoul[NSTATES], vVdw[NSTATES], fScalC[NSTATES], fScalV[NSTATES];
                 for (int i = 0; i < NSTATES; i++)
                 {
-                    c12[i] = nbfp[tj[i] + 1];
+                    fScalC[i] = zeroR;
+                    fScalV[i] = zeroR;
+                    vCoul[i]  = zeroR;
+                    vVdw[i]   = zeroR;
+
+                    /* Only spend time on A or B state if it is non-zero */
+                    const BoolType nonZeroState =
+                            bPairIncluded && ((qq[i] != zeroR) || (c6[i] != zeroR) || (c12[i] != zeroR));
+                    if (!gmx::anyTrue(nonZeroState))
+                    {
+                        continue;
+                    }
+
+                    RealType rInvC, rInvV, rC, rV, rPInvC, rPInvV;
+                    /* this section has to be inside the loop because of the dependence on sigma6 */
                     if (useSoftCore)
                     {
-                        if ((c6[i] > 0) && (c12[i] > 0))
+                        rPInvC = gmx::maskzInv(alphaCoulEff * lFacCoul[i] * sigma6[i] + rp, nonZeroState);
+                        pthRoot(rPInvC, &rInvC, &rC, nonZeroState);
+                        if (scLambdasOrAlphasDiffer)
                         {
-                            /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
-                            sigma6[i] = half * c12[i] / c6[i];
-                            if (sigma6[i] < sigma6_min) /* for disappearing coul and vdw with soft core at the same time */
-                            {
-                                sigma6[i] = sigma6_min;
-                            }
+                            rPInvV = gmx::maskzInv(alphaVdwEff * lFacVdw[i] * sigma6[i] + rp, nonZeroState);
+                            pthRoot(rPInvV, &rInvV, &rV, nonZeroState);
                         }
                         else
                         {
-                            sigma6[i] = sigma6_def;
+                            /* We can avoid one expensive pow and one / operation */
+                            rPInvV = rPInvC;
+                            rInvV  = rInvC;
+                            rV     = rC;
                         }
                     }
-                }
+                    else
+                    {
+                        rPInvC = oneR;
+                        rInvC  = rInv;
+                        rC     = r;
 
-                if (useSoftCore)
-                {
-                    /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
-                    if ((c12[STATE_A] > 0) && (c12[STATE_B] > 0))
+                        rPInvV = oneR;
+                        rInvV  = rInv;
+                        rV     = r;
+                    }
+
+                    /* Only process the coulomb interactions if we have charges,
+                     * and if we either include all entries in the list (no cutoff
+                     * used in the kernel), or if we are within the cutoff.
+                     */
+                    BoolType computeElecInteraction;
+                    if (elecInteractionTypeIsEwald)
                     {
-                        alphaVdwEff  = 0;
-                        alphaCoulEff = 0;
+                        computeElecInteraction = nonZeroState && (r < rCoulomb) && (qq[i] != zeroR);
                     }
                     else
                     {
-                        alphaVdwEff  = alpha_vdw;
-                        alphaCoulEff = alpha_coul;
+                        computeElecInteraction = nonZeroState && (rC < rCoulomb) && (qq[i] != zeroR);
+                    }
+                    if (gmx::anyTrue(computeElecInteraction))
+                    {
+                        if (elecInteractionTypeIsEwald)
+                        {
+                            vCoul[i]  = ewaldPotential(qq[i], rInvC, sh_ewald);
+                            fScalC[i] = ewaldScalarForce(qq[i], rInvC);
+                        }
+                        else
+                        {
+                            vCoul[i]  = reactionFieldPotential(qq[i], rInvC, rC, krf, crf);
+                            fScalC[i] = reactionFieldScalarForce(qq[i], rInvC, rC, krf, two);
+                        }
+                        vCoul[i]  = gmx::selectByMask(vCoul[i], computeElecInteraction);
+                        fScalC[i] = gmx::selectByMask(fScalC[i], computeElecInteraction);
                     }
-                }
-
-                for (int i = 0; i < NSTATES; i++)
-                {
-                    fScalC[i] = 0;
-                    fScalV[i] = 0;
-                    vCoul[i]  = 0;
-                    vVdw[i]   = 0;
-
-                    RealType rInvC, rInvV, rC, rV, rPInvC, rPInvV;
 
-                    /* Only spend time on A or B state if it is non-zero */
-                    if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
+                    /* Only process the VDW interactions if we have
+                     * some non-zero parameters, and if we either
+                     * include all entries in the list (no cutoff used
+                     * in the kernel), or if we are within the cutoff.
+                     */
+                    BoolType computeVdwInteraction;
+                    if (vdwInteractionTypeIsEwald)
+                    {
+                        computeVdwInteraction =
+                                nonZeroState && (r < rVdw) && ((c6[i] != zeroR) || (c12[i] != zeroR));
+                    }
+                    else
+                    {
+                        computeVdwInteraction =
+                                nonZeroState && (rV < rVdw) && ((c6[i] != zeroR) || (c12[i] != zeroR));
+                    }
+                    if (gmx::anyTrue(computeVdwInteraction))
                     {
-                        /* this section has to be inside the loop because of the dependence on sigma6 */
+                        RealType rInv6;
                         if (useSoftCore)
                         {
-                            rPInvC = one / (alphaCoulEff * lFacCoul[i] * sigma6[i] + rp);
-                            pthRoot(rPInvC, &rInvC, &rC);
-                            if (scLambdasOrAlphasDiffer)
-                            {
-                                rPInvV = one / (alphaVdwEff * lFacVdw[i] * sigma6[i] + rp);
-                                pthRoot(rPInvV, &rInvV, &rV);
-                            }
-                            else
-                            {
-                                /* We can avoid one expensive pow and one / operation */
-                                rPInvV = rPInvC;
-                                rInvV  = rInvC;
-                                rV     = rC;
-                            }
+                            rInv6 = rPInvV;
                         }
                         else
                         {
-                            rPInvC = 1;
-                            rInvC  = rInv;
-                            rC     = r;
-
-                            rPInvV = 1;
-                            rInvV  = rInv;
-                            rV     = r;
+                            rInv6 = calculateRinv6(rInvV);
                         }
+                        const RealType vVdw6  = calculateVdw6(c6[i], rInv6);
+                        const RealType vVdw12 = calculateVdw12(c12[i], rInv6);
 
-                        /* Only process the coulomb interactions if we have charges,
-                         * and if we either include all entries in the list (no cutoff
-                         * used in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeElecInteraction = (elecInteractionTypeIsEwald && r < rCoulomb)
-                                                      || (!elecInteractionTypeIsEwald && rC < rCoulomb);
+                        vVdw[i] = lennardJonesPotential(
+                                vVdw6, vVdw12, c6[i], c12[i], repulsionShift, dispersionShift, oneSixth, oneTwelfth);
+                        fScalV[i] = lennardJonesScalarForce(vVdw6, vVdw12);
 
-                        if ((qq[i] != 0) && computeElecInteraction)
+                        if (vdwInteractionTypeIsEwald)
                         {
-                            if (elecInteractionTypeIsEwald)
-                            {
-                                vCoul[i]  = ewaldPotential(qq[i], rInvC, sh_ewald);
-                                fScalC[i] = ewaldScalarForce(qq[i], rInvC);
-                            }
-                            else
-                            {
-                                vCoul[i]  = reactionFieldPotential(qq[i], rInvC, rC, krf, crf);
-                                fScalC[i] = reactionFieldScalarForce(qq[i], rInvC, rC, krf, two);
-                            }
+                            /* Subtract the grid potential at the cut-off */
+                            vVdw[i] = vVdw[i]
+                                      + ewaldLennardJonesGridSubtract(
+                                              gmx::load<RealType>(preloadC6Grid[i]), shLjEwald, oneSixth);
                         }
 
-                        /* Only process the VDW interactions if we have
-                         * some non-zero parameters, and if we either
-                         * include all entries in the list (no cutoff used
-                         * in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeVdwInteraction = (vdwInteractionTypeIsEwald && r < rVdw)
-                                                     || (!vdwInteractionTypeIsEwald && rV < rVdw);
-                        if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
+                        if (vdwModifierIsPotSwitch)
                         {
-                            RealType rInv6;
-                            if (useSoftCore)
-                            {
-                                rInv6 = rPInvV;
-                            }
-                            else
-                            {
-                                rInv6 = calculateRinv6(rInvV);
-                            }
-                            RealType vVdw6  = calculateVdw6(c6[i], rInv6);
-                            RealType vVdw12 = calculateVdw12(c12[i], rInv6);
-
-                            vVdw[i] = lennardJonesPotential(
-                                    vVdw6, vVdw12, c6[i], c12[i], repulsionShift, dispersionShift, oneSixth, oneTwelfth);
-                            fScalV[i] = lennardJonesScalarForce(vVdw6, vVdw12);
-
-                            if (vdwInteractionTypeIsEwald)
-                            {
-                                /* Subtract the grid potential at the cut-off */
-                                vVdw[i] += ewaldLennardJonesGridSubtract(
-                                        nbfp_grid[tj[i]], shLjEwald, oneSixth);
-                            }
-
-                            if (vdwModifierIsPotSwitch)
-                            {
-                                RealType d        = rV - ic->rvdw_switch;
-                                d                 = (d > zero) ? d : zero;
-                                const RealType d2 = d * d;
-                                const RealType sw =
-                                        one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
-                                const RealType dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
-
-                                fScalV[i] = potSwitchScalarForceMod(
-                                        fScalV[i], vVdw[i], sw, rV, rVdw, dsw, zero);
-                                vVdw[i] = potSwitchPotentialMod(vVdw[i], sw, rV, rVdw, zero);
-                            }
+                            const RealType d        = gmx::max(rV - ic->rvdw_switch, zeroR);
+                            const RealType d2       = d * d;
+                            const RealType sw       = one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
+                            const RealType dsw      = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
+                            const BoolType withinRV = (rV < rVdw);
+
+                            fScalV[i] = potSwitchScalarForceMod(fScalV[i], vVdw[i], sw, rV, dsw, withinRV);
+                            vVdw[i]   = potSwitchPotentialMod(vVdw[i], sw, withinRV);
                         }
-
-                        /* fScalC (and fScalV) now contain: dV/drC * rC
-                         * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
-                         * Further down we first multiply by r^p-2 and then by
-                         * the vector r, which in total gives: dV/drC * (r/rC)^1-p
-                         */
-                        fScalC[i] *= rPInvC;
-                        fScalV[i] *= rPInvV;
+                        vVdw[i]   = gmx::selectByMask(vVdw[i], computeVdwInteraction);
+                        fScalV[i] = gmx::selectByMask(fScalV[i], computeVdwInteraction);
                     }
+
+                    /* fScalC (and fScalV) now contain: dV/drC * rC
+                     * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                     * Further down we first multiply by r^p-2 and then by
+                     * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                     */
+                    fScalC[i] = fScalC[i] * rPInvC;
+                    fScalV[i] = fScalV[i] * rPInvV;
                 } // end for (int i = 0; i < NSTATES; i++)
 
                 /* Assemble A and B states */
                 for (int i = 0; i < NSTATES; i++)
                 {
-                    vCTot += LFC[i] * vCoul[i];
-                    vVTot += LFV[i] * vVdw[i];
+                    vCTot = vCTot + LFC[i] * vCoul[i];
+                    vVTot = vVTot + LFV[i] * vVdw[i];
 
-                    fScal += LFC[i] * fScalC[i] * rpm2;
-                    fScal += LFV[i] * fScalV[i] * rpm2;
+                    fScal = fScal + LFC[i] * fScalC[i] * rpm2;
+                    fScal = fScal + LFV[i] * fScalV[i] * rpm2;
 
                     if (useSoftCore)
                     {
-                        dvdlCoul += vCoul[i] * DLF[i]
-                                    + LFC[i] * alphaCoulEff * dlFacCoul[i] * fScalC[i] * sigma6[i];
-                        dvdlVdw += vVdw[i] * DLF[i]
-                                   + LFV[i] * alphaVdwEff * dlFacVdw[i] * fScalV[i] * sigma6[i];
+                        dvdlCoul = dvdlCoul + vCoul[i] * DLF[i]
+                                   + LFC[i] * alphaCoulEff * dlFacCoul[i] * fScalC[i] * sigma6[i];
+                        dvdlVdw = dvdlVdw + vVdw[i] * DLF[i]
+                                  + LFV[i] * alphaVdwEff * dlFacVdw[i] * fScalV[i] * sigma6[i];
                     }
                     else
                     {
-                        dvdlCoul += vCoul[i] * DLF[i];
-                        dvdlVdw += vVdw[i] * DLF[i];
+                        dvdlCoul = dvdlCoul + vCoul[i] * DLF[i];
+                        dvdlVdw  = dvdlVdw + vVdw[i] * DLF[i];
                     }
                 }
-            } // end if (bPairIncluded)
-            else if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD)
+            } // end if (gmx::anyTrue(bPairIncluded))
+
+            const bool haveExcludedPairs = gmx::anyTrue(bPairExcluded);
+
+            if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD && haveExcludedPairs)
             {
                 /* For excluded pairs, which are only in this pair list when
                  * using the Verlet scheme, we don't use soft-core.
                  * As there is no singularity, there is no need for soft-core.
                  */
-                const real FF = -two * krf;
-                RealType   VV = krf * rSq - crf;
-
-                if (ii == jnr)
-                {
-                    VV *= half;
-                }
+                const RealType FF = gmx::selectByMask(RealType(-two * krf), bPairExcluded);
+                const RealType VV = gmx::selectByMask(
+                        (krf * rSq - crf) * gmx::load<RealType>(preloadSelfScale), bPairExcluded);
 
                 for (int i = 0; i < NSTATES; i++)
                 {
-                    vCTot += LFC[i] * qq[i] * VV;
-                    fScal += LFC[i] * qq[i] * FF;
-                    dvdlCoul += DLF[i] * qq[i] * VV;
+                    vCTot    = vCTot + LFC[i] * qq[i] * VV;
+                    fScal    = fScal + LFC[i] * qq[i] * FF;
+                    dvdlCoul = dvdlCoul + DLF[i] * qq[i] * VV;
                 }
             }
 
-            if (elecInteractionTypeIsEwald && (r < rCoulomb || !bPairIncluded))
+            const BoolType computeElecEwaldCorrection = (bPairIncluded && (r < rCoulomb)) || bPairExcluded;
+            if (elecInteractionTypeIsEwald && gmx::anyTrue(computeElecEwaldCorrection))
             {
                 /* See comment in the preamble. When using Ewald interactions
                  * (unless we use a switch modifier) we subtract the reciprocal-space
@@ -699,39 +759,40 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
                  * the softcore to the entire electrostatic interaction,
                  * including the reciprocal-space component.
                  */
-                real v_lr, f_lr;
-
-                const RealType ewrt   = r * coulombTableScale;
-                IntType        ewitab = static_cast<IntType>(ewrt);
-                const RealType eweps  = ewrt - ewitab;
-                ewitab                = 4 * ewitab;
-                f_lr                  = ewtab[ewitab] + eweps * ewtab[ewitab + 1];
-                v_lr = (ewtab[ewitab + 2] - coulombTableScaleInvHalf * eweps * (ewtab[ewitab] + f_lr));
-                f_lr *= rInv;
+                /* Pairs that do not need the correction use the first table
+                 * entry, so we never index outside the table.
+                 */
+                const RealType ewrt   = gmx::selectByMask(r, computeElecEwaldCorrection) * coulombTableScale;
+                const IntType  ewitab = gmx::cvttR2I(ewrt);
+                const RealType eweps  = ewrt - gmx::trunc(ewrt);
+                RealType       tabF, tabD, tabV, tabDummy;
+                gmx::gatherLoadBySimdIntTranspose<4>(ewtab, ewitab, &tabF, &tabD, &tabV, &tabDummy);
+                RealType f_lr = tabF + eweps * tabD;
+                RealType v_lr = tabV - coulombTableScaleInvHalf * eweps * (tabF + f_lr);
+                f_lr          = gmx::selectByMask(f_lr * rInv, computeElecEwaldCorrection);
 
                 /* Note that any possible Ewald shift has already been applied in
                  * the normal interaction part above.
                  */
 
-                if (ii == jnr)
-                {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
-                     */
-                    v_lr *= half;
-                }
+                /* If the i particle (ii) has itself (jnr) in its neighborlist,
+                 * which can only happen with the Verlet scheme, this corresponds
+                 * to a self-interaction that will occur twice.
+                 * Scale it down by 50% to only include it once.
+                 */
+                v_lr = gmx::selectByMask(v_lr * gmx::load<RealType>(preloadSelfScale),
+                                         computeElecEwaldCorrection);
 
                 for (int i = 0; i < NSTATES; i++)
                 {
-                    vCTot -= LFC[i] * qq[i] * v_lr;
-                    fScal -= LFC[i] * qq[i] * f_lr;
-                    dvdlCoul -= (DLF[i] * qq[i]) * v_lr;
+                    vCTot    = vCTot - LFC[i] * qq[i] * v_lr;
+                    fScal    = fScal - LFC[i] * qq[i] * f_lr;
+                    dvdlCoul = dvdlCoul - (DLF[i] * qq[i]) * v_lr;
                 }
             }
 
-            if (vdwInteractionTypeIsEwald && (r < rVdw || !bPairIncluded))
+            const BoolType computeVdwEwaldCorrection = (bPairIncluded && (r < rVdw)) || bPairExcluded;
+            if (vdwInteractionTypeIsEwald && gmx::anyTrue(computeVdwEwaldCorrection))
             {
                 /* See comment in the preamble. When using LJ-Ewald interactions
                  * (unless we use a switch modifier) we subtract the reciprocal-space
@@ -746,101 +807,115 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
                  * r close to 0 for non-interacting pairs.
                  */
 
-                const RealType rs   = rSq * rInv * vdwTableScale;
-                const IntType  ri   = static_cast<IntType>(rs);
-                const RealType frac = rs - ri;
-                const RealType f_lr = (1 - frac) * tab_ewald_F_lj[ri] + frac * tab_ewald_F_lj[ri + 1];
+                const RealType rs   = gmx::selectByMask(rSq * rInv, computeVdwEwaldCorrection) * vdwTableScale;
+                const IntType  ri   = gmx::cvttR2I(rs);
+                const RealType frac = rs - gmx::trunc(rs);
+                RealType       tabF0, tabF1, tabV0, tabDummy;
+                gmx::gatherLoadUBySimdIntTranspose<1>(tab_ewald_F_lj, ri, &tabF0, &tabF1);
+                gmx::gatherLoadUBySimdIntTranspose<1>(tab_ewald_V_lj, ri, &tabV0, &tabDummy);
+                const RealType f_lr = (one - frac) * tabF0 + frac * tabF1;
                 /* TODO: Currently the Ewald LJ table does not contain
                  * the factor 1/6, we should add this.
                  */
-                const RealType FF = f_lr * rInv / six;
-                RealType       VV =
-                        (tab_ewald_V_lj[ri] - vdwTableScaleInvHalf * frac * (tab_ewald_F_lj[ri] + f_lr))
-                        / six;
-
-                if (ii == jnr)
-                {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
-                     */
-                    VV *= half;
-                }
+                const RealType FF = gmx::selectByMask(f_lr * rInv * oneSixth, computeVdwEwaldCorrection);
+                /* Scale down the self-interaction, see the Coulomb case above */
+                const RealType VV = gmx::selectByMask(
+                        (tabV0 - vdwTableScaleInvHalf * frac * (tabF0 + f_lr)) * oneSixth
+                                * gmx::load<RealType>(preloadSelfScale),
+                        computeVdwEwaldCorrection);
 
                 for (int i = 0; i < NSTATES; i++)
                 {
-                    const real c6grid = nbfp_grid[tj[i]];
-                    vVTot += LFV[i] * c6grid * VV;
-                    fScal += LFV[i] * c6grid * FF;
-                    dvdlVdw += (DLF[i] * c6grid) * VV;
+                    const RealType c6grid = gmx::load<RealType>(preloadC6Grid[i]);
+                    vVTot                 = vVTot + LFV[i] * c6grid * VV;
+                    fScal                 = fScal + LFV[i] * c6grid * FF;
+                    dvdlVdw               = dvdlVdw + (DLF[i] * c6grid) * VV;
                 }
             }
 
             if (doForces)
             {
-                const real tX = fScal * dX;
-                const real tY = fScal * dY;
-                const real tZ = fScal * dZ;
-                fIX           = fIX + tX;
-                fIY           = fIY + tY;
-                fIZ           = fIZ + tZ;
-                /* OpenMP atomics are expensive, but this kernels is also
-                 * expensive, so we can take this hit, instead of using
-                 * thread-local output buffers and extra reduction.
-                 *
-                 * All the OpenMP regions in this file are trivial and should
-                 * not throw, so no need for try/catch.
-                 */
+                const RealType tX = fScal * dX;
+                const RealType tY = fScal * dY;
+                const RealType tZ = fScal * dZ;
+                fIX               = fIX + tX;
+                fIY               = fIY + tY;
+                fIZ               = fIZ + tZ;
+
+                gmx::store(forceBufferX, tX);
+                gmx::store(forceBufferY, tY);
+                gmx::store(forceBufferZ, tZ);
+                const int numJInChunk = std::min(c_width, nj1 - k);
+                for (int s = 0; s < numJInChunk; s++)
+                {
+                    const int j3 = 3 * preloadJnr[s];
+                    /* OpenMP atomics are expensive, but this kernels is also
+                     * expensive, so we can take this hit, instead of using
+                     * thread-local output buffers and extra reduction.
+                     *
+                     * All the OpenMP regions in this file are trivial and should
+                     * not throw, so no need for try/catch.
+                     */
 #pragma omp atomic
-                f[j3] -= tX;
+                    f[j3] -= forceBufferX[s];
 #pragma omp atomic
-                f[j3 + 1] -= tY;
+                    f[j3 + 1] -= forceBufferY[s];
 #pragma omp atomic
-                f[j3 + 2] -= tZ;
+                    f[j3 + 2] -= forceBufferZ[s];
+                }
             }
-        } // end for (int k = nj0; k < nj1; k++)
+        } // end for (int k = nj0; k < nj1; k += c_width)
 
         /* The atomics below are expensive with many OpenMP threads.
          * Here unperturbed i-particles will usually only have a few
          * (perturbed) j-particles in the list. Thus with a buffered list
          * we can skip a significant number of i-reductions with a check.
          */
-        if (npair_within_cutoff > 0)
+        if (haveWithinCutoffPairs)
         {
-            if (doForces)
+            if (doForces || doShiftForces)
             {
+                const real fIXSum = gmx::reduce(fIX);
+                const real fIYSum = gmx::reduce(fIY);
+                const real fIZSum = gmx::reduce(fIZ);
+                if (doForces)
+                {
 #pragma omp atomic
-                f[ii3] += fIX;
+                    f[ii3] += fIXSum;
 #pragma omp atomic
-                f[ii3 + 1] += fIY;
+                    f[ii3 + 1] += fIYSum;
 #pragma omp atomic
-                f[ii3 + 2] += fIZ;
-            }
-            if (doShiftForces)
-            {
+                    f[ii3 + 2] += fIZSum;
+                }
+                if (doShiftForces)
+                {
 #pragma omp atomic
-                fshift[is3] += fIX;
+                    fshift[is3] += fIXSum;
 #pragma omp atomic
-                fshift[is3 + 1] += fIY;
+                    fshift[is3 + 1] += fIYSum;
 #pragma omp atomic
-                fshift[is3 + 2] += fIZ;
+                    fshift[is3 + 2] += fIZSum;
+                }
             }
             if (doPotential)
             {
-                int ggid = gid[n];
+                const int  ggid     = gid[n];
+                const real vCTotSum = gmx::reduce(vCTot);
+                const real vVTotSum = gmx::reduce(vVTot);
 #pragma omp atomic
-                Vc[ggid] += vCTot;
+                Vc[ggid] += vCTotSum;
 #pragma omp atomic
-                Vv[ggid] += vVTot;
+                Vv[ggid] += vVTotSum;
             }
         }
     } // end for (int n = 0; n < nri; n++)
 
+    const real dvdlCoulSum = gmx::reduce(dvdlCoul);
+    const real dvdlVdwSum  = gmx::reduce(dvdlVdw);
 #pragma omp atomic
-    dvdl[efptCOUL] += dvdlCoul;
+    dvdl[efptCOUL] += dvdlCoulSum;
 #pragma omp atomic
-    dvdl[efptVDW] += dvdlVdw;
+    dvdl[efptVDW] += dvdlVdwSum;
 
     /* Estimate flops, average for free energy stuff:
      * 12  flops per outer iteration
@@ -877,9 +952,9 @@ static KernelFunction dispatchKernelOnUseSimd(const bool useSimd)
 {
     if (useSimd)
     {
-#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_INT32_ARITHMETICS && GMX_USE_SIMD_KERNELS
-        /* FIXME: Here SimdDataTypes should be used to enable SIMD. So far, the code in nb_free_energy_kernel is not adapted to SIMD */
-        return (nb_free_energy_kernel<ScalarDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_INT32_ARITHMETICS && GMX_USE_SIMD_KERNELS \
+        && GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL
+        return (nb_free_energy_kernel<SimdDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
 #else
         return (nb_free_energy_kernel<ScalarDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald, elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
 #endif
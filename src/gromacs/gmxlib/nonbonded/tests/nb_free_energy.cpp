@@ -0,0 +1,348 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the SIMD and scalar instantiations of the free-energy
+ * nonbonded kernel give the same forces, energies and dV/dlambda.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/gmxlib/nonbonded/nb_kernel.h"
+#include "gromacs/gmxlib/nonbonded/nonbonded.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdtypes/forceoutput.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/nblist.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::test::relativeToleranceAsFloatingPoint;
+
+/*! \brief Number of atoms in the test system
+ *
+ * Atom i has the atoms i to c_numAtoms-1 in its j-list, so the lists
+ * have all lengths from 1 to c_numAtoms and end in chunks of any size
+ * up to the SIMD width.
+ */
+constexpr int c_numAtoms = 18;
+//! Number of atom types, the last one has no LJ interactions
+constexpr int c_numTypes = 3;
+//! LJ C6 parameters of the atom types
+constexpr real c_c6[c_numTypes] = { 1.0e-3, 2.5e-3, 0 };
+//! LJ C12 parameters of the atom types
+constexpr real c_c12[c_numTypes] = { 1.0e-6, 3.0e-6, 0 };
+//! The cut-off distance for Coulomb and LJ
+constexpr real c_cutoff = 1.0;
+//! The pair list cut-off, excluded pairs beyond this distance are not allowed
+constexpr real c_rlist = 1.5;
+
+//! The outputs of one call of the free-energy kernel
+struct KernelOutput
+{
+    //! Forces on the atoms
+    std::vector<gmx::RVec> forces;
+    //! The shift force on the central image
+    gmx::RVec shiftForce;
+    //! Coulomb energy
+    real vCoulomb;
+    //! LJ energy
+    real vVdw;
+    //! dV/dlambda for Coulomb
+    real dvdlCoulomb;
+    //! dV/dlambda for LJ
+    real dvdlVdw;
+};
+
+/*! \brief Parameters: electrostatics type, LJ modifier and whether to use soft-core
+ */
+using FreeEnergyKernelParameters = std::tuple<int, int, bool>;
+
+/*! \brief Test fixture for the free-energy kernel
+ *
+ * The system has atoms on a distorted 3x3x2 lattice. In state B
+ * every third atom loses its charge and LJ interactions, so soft-core
+ * is applied to its pairs. A quarter of the pairs, including the
+ * self-pairs, are excluded, and some pairs are beyond the cut-off.
+ */
+class FreeEnergyKernelTest : public ::testing::TestWithParam<FreeEnergyKernelParameters>
+{
+public:
+    FreeEnergyKernelTest() : x_(c_numAtoms)
+    {
+        for (int a = 0; a < c_numAtoms; a++)
+        {
+            x_[a] = { 0.45_real * (a % 3) + 0.03_real * ((a * 7) % 5),
+                      0.45_real * ((a / 3) % 3) + 0.02_real * ((a * 3) % 7),
+                      0.45_real * (a / 9) + 0.025_real * ((a * 5) % 3) };
+
+            chargeA_.push_back((a % 2 == 0 ? 0.4_real : -0.4_real) * (1 + 0.1_real * (a % 4)));
+            chargeB_.push_back(a % 3 == 0 ? 0 : 0.5_real * chargeA_[a]);
+            typeA_.push_back(a % 2);
+            typeB_.push_back(a % 3 == 0 ? c_numTypes - 1 : typeA_[a]);
+        }
+
+        // The kernels expect C6 and C12 scaled by 6 and 12
+        for (int ti = 0; ti < c_numTypes; ti++)
+        {
+            for (int tj = 0; tj < c_numTypes; tj++)
+            {
+                nbfp_.push_back(6 * std::sqrt(c_c6[ti] * c_c6[tj]));
+                nbfp_.push_back(12 * std::sqrt(c_c12[ti] * c_c12[tj]));
+            }
+        }
+
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            iinr_.push_back(i);
+            gid_.push_back(0);
+            shift_.push_back(CENTRAL);
+            jindex_.push_back(jjnr_.size());
+            for (int j = i; j < c_numAtoms; j++)
+            {
+                jjnr_.push_back(j);
+                exclFep_.push_back((j == i || (i + j) % 4 == 0) ? 0 : 1);
+            }
+        }
+        jindex_.push_back(jjnr_.size());
+    }
+
+    //! Runs the kernel with the SIMD instantiation when \p useSimd is set
+    KernelOutput runKernel(bool useSimd)
+    {
+        const int  eeltype     = std::get<0>(GetParam());
+        const int  vdwModifier = std::get<1>(GetParam());
+        const bool useSoftCore = std::get<2>(GetParam());
+
+        interaction_const_t ic;
+        ic.vdw_modifier = vdwModifier;
+        ic.rvdw         = c_cutoff;
+        ic.rvdw_switch  = 0.8;
+        if (vdwModifier == eintmodPOTSHIFT)
+        {
+            ic.dispersion_shift.cpot = -1.0 / gmx::power6(ic.rvdw);
+            ic.repulsion_shift.cpot  = -1.0 / gmx::power12(ic.rvdw);
+        }
+
+        // The soft-core parameters are needed before the Ewald tables are set up,
+        // as the tables then cover excluded pairs up to rlist instead of rcoulomb
+        t_lambda fepvals     = {};
+        fepvals.sc_alpha     = useSoftCore ? 0.5 : 0;
+        fepvals.sc_power     = 1;
+        fepvals.sc_r_power   = 6;
+        fepvals.sc_sigma     = 0.3;
+        fepvals.sc_sigma_min = 0.3;
+        fepvals.bScCoul      = TRUE;
+
+        ic.softCoreParameters = std::make_unique<interaction_const_t::SoftCoreParameters>(fepvals);
+
+        ic.eeltype          = eeltype;
+        ic.coulomb_modifier = eintmodPOTSHIFT;
+        ic.rcoulomb         = c_cutoff;
+        if (EEL_PME_EWALD(eeltype))
+        {
+            ic.ewaldcoeff_q       = calc_ewaldcoeff_q(ic.rcoulomb, 1e-5);
+            ic.sh_ewald           = std::erfc(ic.ewaldcoeff_q * ic.rcoulomb) / ic.rcoulomb;
+            ic.coulombEwaldTables = std::make_unique<EwaldCorrectionTables>();
+            ic.vdwEwaldTables     = std::make_unique<EwaldCorrectionTables>();
+            init_interaction_const_tables(nullptr, &ic, c_rlist, 0);
+        }
+        else
+        {
+            // Reaction-field with epsilon_rf=inf
+            ic.k_rf = 0.5 * std::pow(ic.rcoulomb, -3);
+            ic.c_rf = 1 / ic.rcoulomb + ic.k_rf * ic.rcoulomb * ic.rcoulomb;
+        }
+        t_forcerec fr;
+        fr.ic               = &ic;
+        fr.use_simd_kernels = useSimd;
+        fr.rlist            = c_rlist;
+        fr.ntype            = c_numTypes;
+        fr.nbfp             = nbfp_;
+        snew(fr.shift_vec, SHIFTS);
+
+        t_mdatoms mdatoms = {};
+        mdatoms.nr        = c_numAtoms;
+        mdatoms.chargeA   = chargeA_.data();
+        mdatoms.chargeB   = chargeB_.data();
+        mdatoms.typeA     = typeA_.data();
+        mdatoms.typeB     = typeB_.data();
+
+        t_nblist nlist = {};
+        nlist.nri      = c_numAtoms;
+        nlist.nrj      = jjnr_.size();
+        nlist.iinr     = iinr_.data();
+        nlist.gid      = gid_.data();
+        nlist.shift    = shift_.data();
+        nlist.jindex   = jindex_.data();
+        nlist.jjnr     = jjnr_.data();
+        nlist.excl_fep = exclFep_.data();
+
+        // Lambda differs between Coulomb and LJ, so soft-core is applied separately
+        real lambda[efptNR] = { 0 };
+        real dvdl[efptNR]   = { 0 };
+        lambda[efptCOUL]    = 0.4;
+        lambda[efptVDW]     = 0.7;
+        real vCoulomb       = 0;
+        real vVdw           = 0;
+
+        nb_kernel_data_t kernelData = {};
+        kernelData.flags          = (GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE
+                            | GMX_NONBONDED_DO_POTENTIAL);
+        kernelData.lambda         = lambda;
+        kernelData.dvdl           = dvdl;
+        kernelData.energygrp_elec = &vCoulomb;
+        kernelData.energygrp_vdw  = &vVdw;
+
+        gmx::PaddedVector<gmx::RVec> forces(c_numAtoms, { 0, 0, 0 });
+        std::vector<gmx::RVec>       shiftForces(SHIFTS, { 0, 0, 0 });
+        gmx::ForceWithShiftForces    forceWithShiftForces(
+                forces.arrayRefWithPadding(), true, shiftForces);
+        t_nrnb nrnb;
+
+        gmx_nb_free_energy_kernel(&nlist,
+                                  as_rvec_array(x_.data()),
+                                  &forceWithShiftForces,
+                                  &fr,
+                                  &mdatoms,
+                                  &kernelData,
+                                  &nrnb);
+
+        KernelOutput output;
+        output.forces.assign(forces.begin(), forces.end());
+        output.shiftForce  = shiftForces[CENTRAL];
+        output.vCoulomb    = vCoulomb;
+        output.vVdw        = vVdw;
+        output.dvdlCoulomb = dvdl[efptCOUL];
+        output.dvdlVdw     = dvdl[efptVDW];
+        return output;
+    }
+
+private:
+    //! Coordinates, padded for the SIMD gathers in the kernel
+    gmx::PaddedVector<gmx::RVec> x_;
+    //! Charges in state A
+    std::vector<real> chargeA_;
+    //! Charges in state B
+    std::vector<real> chargeB_;
+    //! Atom types in state A
+    std::vector<int> typeA_;
+    //! Atom types in state B
+    std::vector<int> typeB_;
+    //! LJ parameter matrix
+    std::vector<real> nbfp_;
+    //! i-atoms of the pair list
+    std::vector<int> iinr_;
+    //! Energy group pair indices of the i-atoms
+    std::vector<int> gid_;
+    //! Shift indices of the i-atoms
+    std::vector<int> shift_;
+    //! Start of the j-list for each i-atom
+    std::vector<int> jindex_;
+    //! j-atoms of the pair list
+    std::vector<int> jjnr_;
+    //! Whether each pair is included (1) or excluded (0)
+    std::vector<char> exclFep_;
+};
+
+TEST_P(FreeEnergyKernelTest, SimdMatchesScalar)
+{
+    const KernelOutput reference = runKernel(false);
+    const KernelOutput simd      = runKernel(true);
+
+    // The SIMD kernel sums the pair contributions in a different order,
+    // so compare relative to the magnitude of the largest contributions.
+    real forceMagnitude = 0;
+    for (const gmx::RVec& f : reference.forces)
+    {
+        forceMagnitude = std::max(forceMagnitude, norm(f));
+    }
+    const auto forceTolerance = relativeToleranceAsFloatingPoint(forceMagnitude, 1e-5);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.forces[a][d], simd.forces[a][d], forceTolerance)
+                    << "atom " << a << " dimension " << d;
+        }
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        EXPECT_REAL_EQ_TOL(reference.shiftForce[d], simd.shiftForce[d], forceTolerance);
+    }
+
+    EXPECT_REAL_EQ_TOL(reference.vCoulomb,
+                       simd.vCoulomb,
+                       relativeToleranceAsFloatingPoint(reference.vCoulomb, 1e-5));
+    EXPECT_REAL_EQ_TOL(
+            reference.vVdw, simd.vVdw, relativeToleranceAsFloatingPoint(reference.vVdw, 1e-5));
+    EXPECT_REAL_EQ_TOL(reference.dvdlCoulomb,
+                       simd.dvdlCoulomb,
+                       relativeToleranceAsFloatingPoint(reference.dvdlCoulomb, 1e-5));
+    EXPECT_REAL_EQ_TOL(reference.dvdlVdw,
+                       simd.dvdlVdw,
+                       relativeToleranceAsFloatingPoint(reference.dvdlVdw, 1e-5));
+}
+
+INSTANTIATE_TEST_CASE_P(WithDifferentInteractions,
+                        FreeEnergyKernelTest,
+                        ::testing::Combine(::testing::Values(eelRF, eelPME),
+                                           ::testing::Values(eintmodPOTSHIFT, eintmodPOTSWITCH),
+                                           ::testing::Bool()));
+
+} // namespace
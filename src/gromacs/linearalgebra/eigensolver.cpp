@@ -366,7 +366,20 @@ void sparse_parallel_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenval
 #endif
 
 
-void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter)
+/*! \brief Determines eigenpairs of a symmetric matrix of size n with the Lanczos
+ * method of ARPACK, using only products of the matrix with vectors.
+ *
+ * \p which is "SA" for the smallest or "LA" for the largest eigenvalues,
+ * \p multiply(x, y) should store the product of the matrix with x in y.
+ */
+template<typename MultiplyFunction>
+static void lanczos_eigensolver(int              n,
+                                const char*      which,
+                                int              neig,
+                                real*            eigenvalues,
+                                real*            eigenvectors,
+                                int              maxiter,
+                                MultiplyFunction multiply)
 {
     int   iwork[80];
     int   iparam[11];
@@ -375,21 +388,11 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
     real* workd;
     real* workl;
     real* v;
-    int   n;
     int   ido, info, lworkl, i, ncv, dovec;
     real  abstol;
     int*  select;
     int   iter;
 
-#ifdef GMX_MPI_NOT
-    MPI_Comm_size(MPI_COMM_WORLD, &n);
-    if (n > 1)
-    {
-        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
-        return;
-    }
-#endif
-
     if (eigenvectors != nullptr)
     {
         dovec = 1;
@@ -399,7 +402,6 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
         dovec = 0;
     }
 
-    n   = A->nrow;
     ncv = 2 * neig;
 
     if (ncv > n)
@@ -434,14 +436,14 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
     {
 #if GMX_DOUBLE
         F77_FUNC(dsaupd, DSAUPD)
-        (&ido, "I", &n, "SA", &neig, &abstol, resid, &ncv, v, &n, iparam, ipntr, workd, iwork, workl, &lworkl, &info);
+        (&ido, "I", &n, which, &neig, &abstol, resid, &ncv, v, &n, iparam, ipntr, workd, iwork, workl, &lworkl, &info);
 #else
         F77_FUNC(ssaupd, SSAUPD)
-        (&ido, "I", &n, "SA", &neig, &abstol, resid, &ncv, v, &n, iparam, ipntr, workd, iwork, workl, &lworkl, &info);
+        (&ido, "I", &n, which, &neig, &abstol, resid, &ncv, v, &n, iparam, ipntr, workd, iwork, workl, &lworkl, &info);
 #endif
         if (ido == -1 || ido == 1)
         {
-            gmx_sparsematrix_vector_multiply(A, workd + ipntr[0] - 1, workd + ipntr[1] - 1);
+            multiply(workd + ipntr[0] - 1, workd + ipntr[1] - 1);
         }
 
         fprintf(stderr, "\rIteration %4d: %3d out of %3d Ritz values converged.", iter++, iparam[4], neig);
@@ -478,7 +480,7 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
      nullptr,
      "I",
      &n,
-     "SA",
+     which,
      &neig,
      &abstol,
      resid,
@@ -502,7 +504,7 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
      nullptr,
      "I",
      &n,
-     "SA",
+     which,
      &neig,
      &abstol,
      resid,
@@ -523,3 +525,43 @@ void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real
     sfree(workl);
     sfree(select);
 }
+
+void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter)
+{
+#ifdef GMX_MPI_NOT
+    int n;
+    MPI_Comm_size(MPI_COMM_WORLD, &n);
+    if (n > 1)
+    {
+        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
+        return;
+    }
+#endif
+
+    lanczos_eigensolver(A->nrow, "SA", neig, eigenvalues, eigenvectors, maxiter, [A](real* x, real* y) {
+        gmx_sparsematrix_vector_multiply(A, x, y);
+    });
+}
+
+void dense_iterative_eigensolver(const real* a,
+                                 int         n,
+                                 int         neig,
+                                 real*       eigenvalues,
+                                 real*       eigenvectors,
+                                 int         maxiter,
+                                 int         nthreads)
+{
+    lanczos_eigensolver(n, "LA", neig, eigenvalues, eigenvectors, maxiter, [a, n, nthreads](real* x, real* y) {
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+        for (int i = 0; i < n; i++)
+        {
+            const real* row = a + static_cast<size_t>(i) * n;
+            real        sum = 0;
+            for (int j = 0; j < n; j++)
+            {
+                sum += row[j] * x[j];
+            }
+            y[i] = sum;
+        }
+    });
+}
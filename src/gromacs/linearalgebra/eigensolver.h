@@ -75,4 +75,22 @@ void eigensolver(real* a, int n, int index_lower, int index_upper, real* eigenva
  */
 void sparse_eigensolver(gmx_sparsematrix_t* A, int neig, real* eigenvalues, real* eigenvectors, int maxiter);
 
+/*! \brief Iterative eigensolver for the largest eigenvalues of a dense symmetric matrix.
+ *
+ *  This routine is intended for large matrices of which only a few
+ *  eigenvectors are needed, since it only multiplies the matrix with vectors,
+ *  using nthreads OpenMP threads, and never modifies it.
+ *
+ *  It will determine the neig largest eigenvalues in ascending order, and if the
+ *  eigenvectors pointer is non-NULL also the corresponding eigenvectors as rows
+ *  of a matrix of size neig*n. neig should be less than n/2.
+ */
+void dense_iterative_eigensolver(const real* a,
+                                 int         n,
+                                 int         neig,
+                                 real*       eigenvalues,
+                                 real*       eigenvectors,
+                                 int         maxiter,
+                                 int         nthreads);
+
 #endif
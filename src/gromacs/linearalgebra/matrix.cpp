@@ -43,9 +43,13 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
+#include "gmx_blas.h"
 #include "gmx_lapack.h"
 
 double** alloc_matrix(int n, int m)
@@ -247,3 +251,40 @@ double multi_regression(FILE* fp, int nrow, double* y, int ncol, double** xx, do
 
     return chi2;
 }
+
+void symmetric_rank_k_update(int n, int nvec, const real* x, real* c, int nthreads)
+{
+    /* Number of columns of c per task, small enough to give each thread
+     * several tasks, large enough for efficient matrix-matrix products.
+     */
+    const int blockSize = 64;
+    const int numBlocks = (n + blockSize - 1) / blockSize;
+
+    /* Each task updates one block of (Fortran) columns from the diagonal
+     * down, so the tasks write to disjoint parts of c.
+     */
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+    for (int block = 0; block < numBlocks; block++)
+    {
+        try
+        {
+            int   start = block * blockSize;
+            int   m     = n - start;
+            int   ncol  = std::min(blockSize, m);
+            int   ld    = n;
+            int   k     = nvec;
+            real  one   = 1;
+            real* xPtr  = const_cast<real*>(x) + start;
+            real* cPtr  = c + static_cast<size_t>(start) * n + start;
+
+#if GMX_DOUBLE
+            F77_FUNC(dgemm, DGEMM)
+            ("N", "T", &m, &ncol, &k, &one, xPtr, &ld, xPtr, &ld, &one, cPtr, &ld);
+#else
+            F77_FUNC(sgemm, SGEMM)
+            ("N", "T", &m, &ncol, &k, &one, xPtr, &ld, xPtr, &ld, &one, cPtr, &ld);
+#endif
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
@@ -39,6 +39,8 @@
 
 #include <stdio.h>
 
+#include "gromacs/utility/real.h"
+
 double** alloc_matrix(int n, int m);
 
 void free_matrix(double** a);
@@ -58,4 +60,12 @@ double multi_regression(FILE* fp, int ny, double* y, int nx, double** xx, double
  * If fp is not NULL debug information will be written to it.
  */
 
+/* Add the outer products of nvec vectors of length n to the symmetric
+ * n x n matrix c, i.e. c += x x^T. Vector k is stored at x + k*n.
+ * Only the elements c[j*n + i] with i >= j, i.e. the upper triangle in C
+ * storage, are guaranteed to be updated. Square tiles of c are updated
+ * with BLAS matrix-matrix products, distributed over nthreads OpenMP threads.
+ */
+void symmetric_rank_k_update(int n, int nvec, const real* x, real* c, int nthreads);
+
 #endif
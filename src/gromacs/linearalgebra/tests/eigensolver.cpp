@@ -0,0 +1,190 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the iterative dense eigensolver against the full LAPACK eigensolver
+ */
+#include "gmxpre.h"
+
+#include "gromacs/linearalgebra/eigensolver.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::test::relativeToleranceAsFloatingPoint;
+
+//! Size of the test matrices
+constexpr int c_n = 24;
+//! Number of eigenpairs determined by the iterative solver
+constexpr int c_numEigenpairs = 4;
+//! Maximum number of iterations for the iterative solver
+constexpr int c_maxIterations = 100000;
+//! Tolerance for eigenvalues, which are of the order of c_n
+const auto c_eigenvalueTolerance = relativeToleranceAsFloatingPoint(c_n, 1e-5);
+//! Tolerance for the overlap of normalized eigenvectors
+const auto c_eigenvectorTolerance = relativeToleranceAsFloatingPoint(1, 1e-4);
+
+//! Returns a symmetric matrix with well separated eigenvalues of both signs
+std::vector<real> symmetricTestMatrix()
+{
+    std::vector<real> a(c_n * c_n);
+    for (int i = 0; i < c_n; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            real value = 0.02_real * (((i + 3) * (j + 5)) % 11) - 0.1_real;
+            if (i == j)
+            {
+                value += i - 0.5_real * c_n;
+            }
+            a[i * c_n + j] = value;
+            a[j * c_n + i] = value;
+        }
+    }
+    return a;
+}
+
+//! Returns the absolute value of the dot product of two vectors of length c_n
+real absDotProduct(const real* v, const real* w)
+{
+    real sum = 0;
+    for (int i = 0; i < c_n; i++)
+    {
+        sum += v[i] * w[i];
+    }
+    return std::abs(sum);
+}
+
+class DenseIterativeEigensolverTest : public ::testing::Test
+{
+public:
+    DenseIterativeEigensolverTest() :
+        a_(symmetricTestMatrix()), eigenvalues_(c_n), eigenvectors_(c_n * c_n)
+    {
+        // eigensolver() destroys its input
+        std::vector<real> a = a_;
+        eigensolver(a.data(), c_n, 0, c_n, eigenvalues_.data(), eigenvectors_.data());
+    }
+
+    //! The test matrix
+    std::vector<real> a_;
+    //! All eigenvalues of a_ from the full eigensolver, ascending
+    std::vector<real> eigenvalues_;
+    //! All eigenvectors of a_ from the full eigensolver, as rows
+    std::vector<real> eigenvectors_;
+};
+
+TEST_F(DenseIterativeEigensolverTest, FindsHighestEigenpairs)
+{
+    std::vector<real> eigenvalues(c_numEigenpairs);
+    std::vector<real> eigenvectors(c_numEigenpairs * c_n);
+    dense_iterative_eigensolver(a_.data(),
+                                c_n,
+                                c_numEigenpairs,
+                                eigenvalues.data(),
+                                eigenvectors.data(),
+                                c_maxIterations,
+                                2);
+
+    for (int k = 0; k < c_numEigenpairs; k++)
+    {
+        const int reference = c_n - c_numEigenpairs + k;
+        EXPECT_REAL_EQ_TOL(eigenvalues_[reference], eigenvalues[k], c_eigenvalueTolerance)
+                << "for eigenvalue " << reference;
+        // Eigenvectors are only determined up to their sign
+        EXPECT_REAL_EQ_TOL(1.0_real,
+                           absDotProduct(eigenvectors_.data() + reference * c_n,
+                                         eigenvectors.data() + k * c_n),
+                           c_eigenvectorTolerance)
+                << "for eigenvector " << reference;
+    }
+}
+
+TEST_F(DenseIterativeEigensolverTest, FindsLowestEigenpairsOfNegatedMatrix)
+{
+    std::vector<real> negatedA(a_.size());
+    for (size_t i = 0; i < a_.size(); i++)
+    {
+        negatedA[i] = -a_[i];
+    }
+
+    std::vector<real> eigenvalues(c_numEigenpairs);
+    std::vector<real> eigenvectors(c_numEigenpairs * c_n);
+    dense_iterative_eigensolver(negatedA.data(),
+                                c_n,
+                                c_numEigenpairs,
+                                eigenvalues.data(),
+                                eigenvectors.data(),
+                                c_maxIterations,
+                                2);
+
+    // The largest eigenvalues of -A, in ascending order, are minus the
+    // smallest eigenvalues of A, in descending order.
+    for (int k = 0; k < c_numEigenpairs; k++)
+    {
+        const int reference = c_numEigenpairs - 1 - k;
+        EXPECT_REAL_EQ_TOL(eigenvalues_[reference], -eigenvalues[k], c_eigenvalueTolerance)
+                << "for eigenvalue " << reference;
+        EXPECT_REAL_EQ_TOL(1.0_real,
+                           absDotProduct(eigenvectors_.data() + reference * c_n,
+                                         eigenvectors.data() + k * c_n),
+                           c_eigenvectorTolerance)
+                << "for eigenvector " << reference;
+    }
+}
+
+TEST_F(DenseIterativeEigensolverTest, FindsHighestEigenvaluesWithoutEigenvectors)
+{
+    std::vector<real> eigenvalues(c_numEigenpairs);
+    dense_iterative_eigensolver(
+            a_.data(), c_n, c_numEigenpairs, eigenvalues.data(), nullptr, c_maxIterations, 1);
+
+    for (int k = 0; k < c_numEigenpairs; k++)
+    {
+        const int reference = c_n - c_numEigenpairs + k;
+        EXPECT_REAL_EQ_TOL(eigenvalues_[reference], eigenvalues[k], c_eigenvalueTolerance)
+                << "for eigenvalue " << reference;
+    }
+}
+
+} // namespace
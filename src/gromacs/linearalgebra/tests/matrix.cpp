@@ -0,0 +1,108 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the symmetric rank-k update of linearalgebra/matrix.h
+ */
+#include "gmxpre.h"
+
+#include "gromacs/linearalgebra/matrix.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::test::relativeToleranceAsFloatingPoint;
+
+class SymmetricRankKUpdateTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(SymmetricRankKUpdateTest, MatchesNaiveUpdate)
+{
+    const int n        = GetParam();
+    const int nvec     = 5;
+    const int nthreads = 2;
+
+    std::vector<real> x(n * nvec);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = 0.1_real * ((i * 7) % 23) - 1.1_real;
+    }
+    std::vector<real> c(n * n);
+    for (int j = 0; j < n; j++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            c[j * n + i] = 0.01_real * (i + j);
+        }
+    }
+
+    std::vector<real> reference = c;
+    for (int k = 0; k < nvec; k++)
+    {
+        const real* v = x.data() + k * n;
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                reference[j * n + i] += v[i] * v[j];
+            }
+        }
+    }
+
+    symmetric_rank_k_update(n, nvec, x.data(), c.data(), nthreads);
+
+    // Only the upper triangle in C storage is guaranteed to be updated
+    for (int j = 0; j < n; j++)
+    {
+        for (int i = j; i < n; i++)
+        {
+            EXPECT_REAL_EQ_TOL(
+                    reference[j * n + i], c[j * n + i], relativeToleranceAsFloatingPoint(10, 1e-6))
+                    << "for element i=" << i << " j=" << j;
+        }
+    }
+}
+
+//! Sizes below, at and above the block size of the update, including a partial block
+INSTANTIATE_TEST_CASE_P(WithSizes, SymmetricRankKUpdateTest, ::testing::Values(1, 9, 64, 150));
+
+} // namespace
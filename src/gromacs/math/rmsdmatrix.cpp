@@ -0,0 +1,459 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements routines from rmsdmatrix.h.
+ *
+ * \ingroup module_math
+ */
+#include "gmxpre.h"
+
+#include "rmsdmatrix.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Relative precision to which the largest eigenvalue is converged.
+constexpr double c_eigenvaluePrecision = 1e-11;
+//! Maximum number of Newton iterations for the largest eigenvalue.
+constexpr int c_maxNewtonIterations = 50;
+//! Number of frames along each side of a tile of the RMSD matrix.
+constexpr int c_tileSize = 32;
+//! Maximum number of pivot frames used for bounding the RMSD of pairs.
+constexpr int c_numPivots = 8;
+//! Relative margin on the cutoff when comparing lower bounds.
+constexpr real c_lowerBoundTolerance = 1e-4;
+
+/*! \brief
+ * Returns the largest eigenvalue of the QCP key matrix.
+ *
+ * \param[in] s  Weighted inner products s[d1][d2] = sum_i w_i a_i[d1] b_i[d2].
+ * \param[in] e0 Half the sum of the weighted squared norms, an upper bound.
+ */
+double qcpLargestEigenvalue(const double s[DIM][DIM], double e0)
+{
+    const double sxx = s[XX][XX], sxy = s[XX][YY], sxz = s[XX][ZZ];
+    const double syx = s[YY][XX], syy = s[YY][YY], syz = s[YY][ZZ];
+    const double szx = s[ZZ][XX], szy = s[ZZ][YY], szz = s[ZZ][ZZ];
+
+    const double sxx2 = sxx * sxx, syy2 = syy * syy, szz2 = szz * szz;
+    const double sxy2 = sxy * sxy, syz2 = syz * syz, sxz2 = sxz * sxz;
+    const double syx2 = syx * syx, szy2 = szy * szy, szx2 = szx * szx;
+
+    const double syzSzymSyySzz2      = 2.0 * (syz * szy - syy * szz);
+    const double sxx2Syy2Szz2Syz2Szy2 = syy2 + szz2 - sxx2 + syz2 + szy2;
+    const double sxy2Sxz2Syx2Szx2     = sxy2 + sxz2 - syx2 - szx2;
+
+    const double sxzpSzx = sxz + szx, syzpSzy = syz + szy, sxypSyx = sxy + syx;
+    const double syzmSzy = syz - szy, sxzmSzx = sxz - szx, sxymSyx = sxy - syx;
+    const double sxxpSyy = sxx + syy, sxxmSyy = sxx - syy;
+
+    /* Coefficients of the characteristic polynomial x^4 + c2 x^2 + c1 x + c0 */
+    const double c2 = -2.0 * (sxx2 + syy2 + szz2 + sxy2 + syx2 + sxz2 + szx2 + syz2 + szy2);
+    const double c1 = 8.0
+                      * (sxx * syz * szy + syy * szx * sxz + szz * sxy * syx - sxx * syy * szz
+                         - syz * szx * sxy - szy * syx * sxz);
+    const double c0 =
+            sxy2Sxz2Syx2Szx2 * sxy2Sxz2Syx2Szx2
+            + (sxx2Syy2Szz2Syz2Szy2 + syzSzymSyySzz2) * (sxx2Syy2Szz2Syz2Szy2 - syzSzymSyySzz2)
+            + (-sxzpSzx * syzmSzy + sxymSyx * (sxxmSyy - szz))
+                      * (-sxzmSzx * syzpSzy + sxymSyx * (sxxmSyy + szz))
+            + (-sxzpSzx * syzpSzy - sxypSyx * (sxxpSyy - szz))
+                      * (-sxzmSzx * syzmSzy - sxypSyx * (sxxpSyy + szz))
+            + (sxypSyx * syzpSzy + sxzpSzx * (sxxmSyy + szz))
+                      * (-sxymSyx * syzmSzy + sxzpSzx * (sxxpSyy + szz))
+            + (sxypSyx * syzmSzy + sxzmSzx * (sxxmSyy - szz))
+                      * (-sxymSyx * syzpSzy + sxzmSzx * (sxxpSyy - szz));
+
+    /* Newton iteration from the upper bound converges to the largest root */
+    double lambda = e0;
+    for (int iteration = 0; iteration < c_maxNewtonIterations; iteration++)
+    {
+        const double previous = lambda;
+        const double x2       = lambda * lambda;
+        const double b        = (x2 + c2) * lambda;
+        const double a        = b + c1;
+        lambda -= (a * lambda + c0) / (2.0 * x2 * lambda + b + a);
+        if (std::fabs(lambda - previous) < std::fabs(c_eigenvaluePrecision * lambda))
+        {
+            break;
+        }
+    }
+    return lambda;
+}
+
+//! Coordinates of the atoms with non-zero weight in a frame, stored per dimension.
+struct PackedFrame
+{
+    //! Coordinates of the packed atoms.
+    std::array<std::vector<real>, DIM> x;
+    //! Weighted sum of the squared norms of the coordinates.
+    double normSquared = 0;
+};
+
+/*! \brief
+ * Packs the coordinates of \p atoms of \p x.
+ *
+ * \param[in] x       Coordinates of all atoms.
+ * \param[in] atoms   Atoms to pack.
+ * \param[in] weights Weights of the packed atoms.
+ * \param[in] center  Whether to put the weighted centre at the origin.
+ */
+PackedFrame packFrame(const rvec*          x,
+                      ArrayRef<const int>  atoms,
+                      ArrayRef<const real> weights,
+                      bool                 center)
+{
+    DVec   shift = { 0, 0, 0 };
+    double totalWeight = 0;
+    if (center)
+    {
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                shift[d] += weights[i] * static_cast<double>(x[atoms[i]][d]);
+            }
+            totalWeight += weights[i];
+        }
+        shift /= totalWeight;
+    }
+
+    PackedFrame frame;
+    for (int d = 0; d < DIM; d++)
+    {
+        frame.x[d].resize(atoms.size());
+        for (size_t i = 0; i < atoms.size(); i++)
+        {
+            frame.x[d][i] = static_cast<real>(x[atoms[i]][d] - shift[d]);
+            frame.normSquared += weights[i] * static_cast<double>(frame.x[d][i]) * frame.x[d][i];
+        }
+    }
+    return frame;
+}
+
+//! Computes the weighted inner products between the coordinates of \p a and \p b.
+void calcInnerProducts(const PackedFrame&   a,
+                       const PackedFrame&   b,
+                       ArrayRef<const real> weights,
+                       double               s[DIM][DIM])
+{
+    const real* ax = a.x[XX].data();
+    const real* ay = a.x[YY].data();
+    const real* az = a.x[ZZ].data();
+    const real* bx = b.x[XX].data();
+    const real* by = b.x[YY].data();
+    const real* bz = b.x[ZZ].data();
+
+    double sxx = 0, sxy = 0, sxz = 0, syx = 0, syy = 0, syz = 0, szx = 0, szy = 0, szz = 0;
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        const double w   = weights[i];
+        const double wax = w * ax[i];
+        const double way = w * ay[i];
+        const double waz = w * az[i];
+        sxx += wax * bx[i];
+        sxy += wax * by[i];
+        sxz += wax * bz[i];
+        syx += way * bx[i];
+        syy += way * by[i];
+        syz += way * bz[i];
+        szx += waz * bx[i];
+        szy += waz * by[i];
+        szz += waz * bz[i];
+    }
+    s[XX][XX] = sxx;
+    s[XX][YY] = sxy;
+    s[XX][ZZ] = sxz;
+    s[YY][XX] = syx;
+    s[YY][YY] = syy;
+    s[YY][ZZ] = syz;
+    s[ZZ][XX] = szx;
+    s[ZZ][YY] = szy;
+    s[ZZ][ZZ] = szz;
+}
+
+//! Returns the RMSD between two packed frames.
+real calcPackedRmsd(const PackedFrame&   a,
+                    const PackedFrame&   b,
+                    ArrayRef<const real> weights,
+                    double               totalWeight,
+                    bool                 fit)
+{
+    double s[DIM][DIM];
+    calcInnerProducts(a, b, weights, s);
+    const double e0 = 0.5 * (a.normSquared + b.normSquared);
+    /* Without fitting, the trace gives the plain weighted sum of squared deviations */
+    const double lambda = fit ? qcpLargestEigenvalue(s, e0) : s[XX][XX] + s[YY][YY] + s[ZZ][ZZ];
+    return static_cast<real>(std::sqrt(std::max(0.0, 2.0 * (e0 - lambda) / totalWeight)));
+}
+
+//! Atoms with non-zero weight and their weights.
+struct WeightedAtoms
+{
+    //! Indices of the atoms.
+    std::vector<int> atoms;
+    //! Weights of the atoms.
+    std::vector<real> weights;
+    //! Sum of the weights.
+    double totalWeight = 0;
+};
+
+//! Selects the atoms with non-zero weight.
+WeightedAtoms selectWeightedAtoms(ArrayRef<const real> weights)
+{
+    WeightedAtoms selected;
+    for (int i = 0; i < gmx::ssize(weights); i++)
+    {
+        if (weights[i] != 0)
+        {
+            selected.atoms.push_back(i);
+            selected.weights.push_back(weights[i]);
+            selected.totalWeight += weights[i];
+        }
+    }
+    GMX_RELEASE_ASSERT(selected.totalWeight > 0, "RMSD needs atoms with positive weight");
+    return selected;
+}
+
+//! Packs all \p frames in parallel.
+std::vector<PackedFrame> packFrames(ArrayRef<const rvec* const> frames,
+                                    const WeightedAtoms&        selected,
+                                    bool                        center,
+                                    int                         numThreads)
+{
+    std::vector<PackedFrame> packedFrames(frames.size());
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int f = 0; f < gmx::ssize(frames); f++)
+    {
+        try
+        {
+            packedFrames[f] = packFrame(frames[f], selected.atoms, selected.weights, center);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+    return packedFrames;
+}
+
+} // namespace
+
+real calcFittedRmsd(ArrayRef<const RVec> reference,
+                    ArrayRef<const RVec> x,
+                    ArrayRef<const real> weights)
+{
+    GMX_RELEASE_ASSERT(reference.size() == x.size() && x.size() == weights.size(),
+                       "Coordinates and weights should have the same size");
+    const WeightedAtoms  selected = selectWeightedAtoms(weights);
+    ArrayRef<const int>  atoms    = selected.atoms;
+    ArrayRef<const real> w        = selected.weights;
+    const PackedFrame    a        = packFrame(as_rvec_array(reference.data()), atoms, w, true);
+    const PackedFrame    b        = packFrame(as_rvec_array(x.data()), atoms, w, true);
+    return calcPackedRmsd(a, b, w, selected.totalWeight, true);
+}
+
+void calcRmsdMatrix(ArrayRef<const rvec* const>    frames,
+                    ArrayRef<const real>           weights,
+                    bool                           fit,
+                    int                            numThreads,
+                    const RmsdMatrixEntryReceiver& storeEntry)
+{
+    const WeightedAtoms            selected  = selectWeightedAtoms(weights);
+    const int                      numFrames = frames.ssize();
+    const std::vector<PackedFrame> packedFrames = packFrames(frames, selected, fit, numThreads);
+
+    /* Tiles on and above the diagonal, each covering up to c_tileSize^2 pairs */
+    const int                        numTilesPerSide = (numFrames + c_tileSize - 1) / c_tileSize;
+    std::vector<std::pair<int, int>> tiles;
+    for (int tile1 = 0; tile1 < numTilesPerSide; tile1++)
+    {
+        for (int tile2 = tile1; tile2 < numTilesPerSide; tile2++)
+        {
+            tiles.emplace_back(tile1, tile2);
+        }
+    }
+
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (int tile = 0; tile < gmx::ssize(tiles); tile++)
+    {
+        try
+        {
+            const int begin1 = tiles[tile].first * c_tileSize;
+            const int end1   = std::min(begin1 + c_tileSize, numFrames);
+            const int begin2 = tiles[tile].second * c_tileSize;
+            const int end2   = std::min(begin2 + c_tileSize, numFrames);
+
+            std::vector<real> tileRmsd;
+            tileRmsd.reserve(c_tileSize * c_tileSize);
+            for (int f1 = begin1; f1 < end1; f1++)
+            {
+                for (int f2 = std::max(begin2, f1 + 1); f2 < end2; f2++)
+                {
+                    tileRmsd.push_back(calcPackedRmsd(packedFrames[f1],
+                                                      packedFrames[f2],
+                                                      selected.weights,
+                                                      selected.totalWeight,
+                                                      fit));
+                }
+            }
+
+#pragma omp critical
+            {
+                auto rmsd = tileRmsd.begin();
+                for (int f1 = begin1; f1 < end1; f1++)
+                {
+                    for (int f2 = std::max(begin2, f1 + 1); f2 < end2; f2++)
+                    {
+                        storeEntry(f1, f2, *rmsd++);
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+void calcRmsdNeighbors(ArrayRef<const rvec* const>    frames,
+                       ArrayRef<const real>           weights,
+                       bool                           fit,
+                       real                           cutoff,
+                       int                            numThreads,
+                       const RmsdMatrixEntryReceiver& storeEntry)
+{
+    const WeightedAtoms            selected  = selectWeightedAtoms(weights);
+    const int                      numFrames = frames.ssize();
+    const std::vector<PackedFrame> packedFrames = packFrames(frames, selected, fit, numThreads);
+    if (numFrames == 0)
+    {
+        return;
+    }
+    auto rmsd = [&](int f1, int f2) {
+        return calcPackedRmsd(packedFrames[std::min(f1, f2)],
+                              packedFrames[std::max(f1, f2)],
+                              selected.weights,
+                              selected.totalWeight,
+                              fit);
+    };
+
+    /* Choose pivots far from each other: each next pivot is the frame
+     * with the largest RMSD to its closest pivot so far.
+     */
+    const int                         numPivots = std::min(c_numPivots, numFrames);
+    std::vector<std::array<real, c_numPivots>> pivotRmsd(numFrames);
+    std::vector<real>                 closestPivotRmsd(numFrames, GMX_REAL_MAX);
+    int                               pivot = 0;
+    for (int p = 0; p < numPivots; p++)
+    {
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (int f = 0; f < numFrames; f++)
+        {
+            pivotRmsd[f][p]     = (f == pivot) ? 0 : rmsd(f, pivot);
+            closestPivotRmsd[f] = std::min(closestPivotRmsd[f], pivotRmsd[f][p]);
+        }
+        pivot = static_cast<int>(
+                std::max_element(closestPivotRmsd.begin(), closestPivotRmsd.end())
+                - closestPivotRmsd.begin());
+    }
+
+    /* Sorted on the RMSD to the first pivot, the neighbors of a frame
+     * can only be found within a window of width cutoff. The tolerance
+     * protects against rounding errors in the lower bounds.
+     */
+    const real       boundCutoff = cutoff * (1 + c_lowerBoundTolerance);
+    std::vector<int> order(numFrames);
+    for (int f = 0; f < numFrames; f++)
+    {
+        order[f] = f;
+    }
+    std::sort(order.begin(), order.end(), [&pivotRmsd](int a, int b) {
+        return pivotRmsd[a][0] < pivotRmsd[b][0];
+    });
+
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+    for (int position = 0; position < numFrames; position++)
+    {
+        try
+        {
+            const int                          f1 = order[position];
+            std::vector<std::pair<int, real>> neighbors;
+            for (int next = position + 1;
+                 next < numFrames && pivotRmsd[order[next]][0] - pivotRmsd[f1][0] < boundCutoff;
+                 next++)
+            {
+                const int f2         = order[next];
+                bool      mayBeClose = true;
+                for (int p = 1; p < numPivots && mayBeClose; p++)
+                {
+                    mayBeClose = std::abs(pivotRmsd[f1][p] - pivotRmsd[f2][p]) < boundCutoff;
+                }
+                if (mayBeClose)
+                {
+                    const real value = rmsd(f1, f2);
+                    if (value < cutoff)
+                    {
+                        neighbors.emplace_back(f2, value);
+                    }
+                }
+            }
+            if (!neighbors.empty())
+            {
+#pragma omp critical
+                {
+                    for (const auto& neighbor : neighbors)
+                    {
+                        storeEntry(std::min(f1, neighbor.first),
+                                   std::max(f1, neighbor.first),
+                                   neighbor.second);
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+} // namespace gmx
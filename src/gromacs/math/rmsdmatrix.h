@@ -0,0 +1,133 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares routines for computing RMSD after optimal superposition,
+ * for single structure pairs and for pairs in a set of frames.
+ *
+ * The rotation is not constructed. Instead the largest eigenvalue of
+ * the key matrix of the quaternion characteristic polynomial (QCP)
+ * is found by Newton iteration, see Theobald, Acta Cryst. A61, 478
+ * (2005) and Liu et al., J. Comput. Chem. 31, 1561 (2010). This gives
+ * the same RMSD as do_fit() followed by rmsdev() at a fraction of the
+ * cost.
+ *
+ * \inlibraryapi
+ * \ingroup module_math
+ */
+#ifndef GMX_MATH_RMSDMATRIX_H
+#define GMX_MATH_RMSDMATRIX_H
+
+#include <functional>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+/*! \brief
+ * Returns the weighted RMSD between \p x and \p reference after
+ * optimal translation and rotation of \p x.
+ *
+ * \param[in] reference Reference coordinates.
+ * \param[in] x         Coordinates to compare, same size as \p reference.
+ * \param[in] weights   Weight of each atom, at least one must be positive.
+ */
+real calcFittedRmsd(ArrayRef<const RVec> reference,
+                    ArrayRef<const RVec> x,
+                    ArrayRef<const real> weights);
+
+/*! \brief
+ * Receives the RMSD between frames \p frame1 < \p frame2.
+ *
+ * Calls are serialized, so the receiver does not need to be thread safe.
+ */
+using RmsdMatrixEntryReceiver = std::function<void(int frame1, int frame2, real rmsd)>;
+
+/*! \brief
+ * Computes the weighted RMSD between all pairs of frames.
+ *
+ * Atoms with zero weight are ignored. With \p fit set, each pair is
+ * compared after optimal translation and rotation, otherwise the
+ * coordinates are compared as they are.
+ *
+ * The pairs are processed in square tiles of frames, so that the
+ * coordinates of a tile stay in cache, and tiles are distributed over
+ * \p numThreads OpenMP threads. The results of each tile are passed
+ * to \p storeEntry once the tile is complete.
+ *
+ * \param[in] frames     Coordinates of each frame, each with weights.size() atoms.
+ * \param[in] weights    Weight of each atom, at least one must be positive.
+ * \param[in] fit        Whether to superimpose each pair.
+ * \param[in] numThreads Number of OpenMP threads to use.
+ * \param[in] storeEntry Receiver for the matrix entries above the diagonal.
+ */
+void calcRmsdMatrix(ArrayRef<const rvec* const>    frames,
+                    ArrayRef<const real>           weights,
+                    bool                           fit,
+                    int                            numThreads,
+                    const RmsdMatrixEntryReceiver& storeEntry);
+
+/*! \brief
+ * Computes the weighted RMSD between all pairs of frames closer than \p cutoff.
+ *
+ * Gives the same entries as calcRmsdMatrix(), restricted to those
+ * below \p cutoff, without evaluating most of the other pairs. Since
+ * the RMSD is a metric, the difference between the RMSDs of two frames
+ * to a third, pivot, frame is a lower bound for their mutual RMSD.
+ * The frames are sorted on their RMSD to a first pivot, so that only
+ * pairs within a window of width \p cutoff in that order are visited,
+ * and these are screened further with a few more pivots that are far
+ * from each other. Memory use is linear in the number of frames.
+ *
+ * \param[in] frames     Coordinates of each frame, each with weights.size() atoms.
+ * \param[in] weights    Weight of each atom, at least one must be positive.
+ * \param[in] fit        Whether to superimpose each pair.
+ * \param[in] cutoff     Only pairs with an RMSD below this value are returned.
+ * \param[in] numThreads Number of OpenMP threads to use.
+ * \param[in] storeEntry Receiver for the pairs, in no particular order.
+ */
+void calcRmsdNeighbors(ArrayRef<const rvec* const>    frames,
+                       ArrayRef<const real>           weights,
+                       bool                           fit,
+                       real                           cutoff,
+                       int                            numThreads,
+                       const RmsdMatrixEntryReceiver& storeEntry);
+
+} // namespace gmx
+
+#endif
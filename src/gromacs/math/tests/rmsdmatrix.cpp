@@ -0,0 +1,227 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests RMSD computation after superposition and the RMSD matrix.
+ *
+ * \ingroup module_math
+ */
+#include "gmxpre.h"
+
+#include "gromacs/math/rmsdmatrix.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/do_fit.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+//! Number of atoms in the test structures.
+constexpr int c_numAtoms = 25;
+
+//! Returns random coordinates in a 3 nm cube, different for each \p seed.
+std::vector<RVec> randomStructure(int seed)
+{
+    DefaultRandomEngine           rng(seed);
+    UniformRealDistribution<real> dist(0, 3);
+    std::vector<RVec>             x(c_numAtoms);
+    for (auto& position : x)
+    {
+        position = { dist(rng), dist(rng), dist(rng) };
+    }
+    return x;
+}
+
+//! Returns \p x rotated around the z axis by \p angle and then translated by \p shift.
+std::vector<RVec> rotateAndShift(const std::vector<RVec>& x, real angle, const RVec& shift)
+{
+    std::vector<RVec> result;
+    for (const auto& position : x)
+    {
+        const real cosAngle = std::cos(angle);
+        const real sinAngle = std::sin(angle);
+        result.emplace_back(cosAngle * position[XX] - sinAngle * position[YY] + shift[XX],
+                            sinAngle * position[XX] + cosAngle * position[YY] + shift[YY],
+                            position[ZZ] + shift[ZZ]);
+    }
+    return result;
+}
+
+//! Returns the RMSD of \p x from \p reference after fitting with do_fit().
+real referenceFittedRmsd(std::vector<RVec> reference, std::vector<RVec> x, std::vector<real> w)
+{
+    rvec* xr = as_rvec_array(reference.data());
+    rvec* xf = as_rvec_array(x.data());
+    reset_x(c_numAtoms, nullptr, c_numAtoms, nullptr, xr, w.data());
+    reset_x(c_numAtoms, nullptr, c_numAtoms, nullptr, xf, w.data());
+    do_fit(c_numAtoms, w.data(), xr, xf);
+    return rmsdev(c_numAtoms, w.data(), xr, xf);
+}
+
+//! Returns the weights used in the tests, with some atoms excluded.
+std::vector<real> testWeights()
+{
+    std::vector<real> weights;
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        weights.push_back(i % 5 == 4 ? 0 : 1 + i % 3);
+    }
+    return weights;
+}
+
+TEST(FittedRmsdTest, IsZeroForRotatedCopy)
+{
+    const std::vector<RVec> x       = randomStructure(1);
+    const std::vector<RVec> rotated = rotateAndShift(x, 1.2, { 1, -2, 0.5 });
+    const std::vector<real> weights = testWeights();
+    EXPECT_REAL_EQ_TOL(0, calcFittedRmsd(x, rotated, weights), absoluteTolerance(1e-5));
+}
+
+TEST(FittedRmsdTest, MatchesDoFit)
+{
+    const std::vector<RVec> reference = randomStructure(1);
+    const std::vector<RVec> x         = rotateAndShift(randomStructure(2), 0.7, { 0.3, 0, 2 });
+    const std::vector<real> weights   = testWeights();
+    EXPECT_REAL_EQ_TOL(referenceFittedRmsd(reference, x, weights),
+                       calcFittedRmsd(reference, x, weights),
+                       relativeToleranceAsFloatingPoint(1, 1e-5));
+}
+
+//! Test fixture for the RMSD matrix, parametrized on whether to fit.
+class RmsdMatrixTest : public ::testing::TestWithParam<bool>
+{
+};
+
+TEST_P(RmsdMatrixTest, ComputesEachPairOnce)
+{
+    const bool fit = GetParam();
+    /* More frames than fit in one tile, not a multiple of the tile size */
+    const int                      numFrames = 75;
+    std::vector<std::vector<RVec>> structures;
+    std::vector<const rvec*>       frames;
+    for (int f = 0; f < numFrames; f++)
+    {
+        const RVec shift = { 0, 0, 0.01_real * f };
+        structures.push_back(rotateAndShift(randomStructure(f % 10), 0.1 * f, shift));
+    }
+    for (const auto& structure : structures)
+    {
+        frames.push_back(as_rvec_array(structure.data()));
+    }
+    std::vector<real> weights = testWeights();
+
+    std::vector<std::vector<int>> timesComputed(numFrames, std::vector<int>(numFrames, 0));
+    calcRmsdMatrix(frames, weights, fit, 2, [&](int frame1, int frame2, real rmsd) {
+        ASSERT_LT(frame1, frame2);
+        timesComputed[frame1][frame2]++;
+        std::vector<RVec> x1 = structures[frame1];
+        std::vector<RVec> x2 = structures[frame2];
+        const real        expected =
+                fit ? referenceFittedRmsd(x1, x2, weights)
+                    : rmsdev(c_numAtoms,
+                             weights.data(),
+                             as_rvec_array(x1.data()),
+                             as_rvec_array(x2.data()));
+        EXPECT_REAL_EQ_TOL(expected, rmsd, relativeToleranceAsFloatingPoint(1, 1e-4))
+                << "Frames " << frame1 << " and " << frame2;
+    });
+    for (int f1 = 0; f1 < numFrames; f1++)
+    {
+        for (int f2 = 0; f2 < numFrames; f2++)
+        {
+            EXPECT_EQ(f1 < f2 ? 1 : 0, timesComputed[f1][f2]);
+        }
+    }
+}
+
+TEST_P(RmsdMatrixTest, NeighborsMatchFullMatrix)
+{
+    const bool fit = GetParam();
+    /* Clusters of frames around a few structures, so that pruning has an effect */
+    const int                      numFrames = 120;
+    std::vector<std::vector<RVec>> structures;
+    std::vector<const rvec*>       frames;
+    for (int f = 0; f < numFrames; f++)
+    {
+        const RVec shift = { 0, 0, 0.002_real * f };
+        structures.push_back(rotateAndShift(randomStructure(f % 4), 0.02 * f, shift));
+    }
+    for (const auto& structure : structures)
+    {
+        frames.push_back(as_rvec_array(structure.data()));
+    }
+    const std::vector<real> weights = testWeights();
+    const real              cutoff  = fit ? 0.3 : 0.2;
+
+    std::map<std::pair<int, int>, real> expected;
+    calcRmsdMatrix(frames, weights, fit, 1, [&](int frame1, int frame2, real rmsd) {
+        if (rmsd < cutoff)
+        {
+            expected[{ frame1, frame2 }] = rmsd;
+        }
+    });
+    std::map<std::pair<int, int>, real> found;
+    calcRmsdNeighbors(frames, weights, fit, cutoff, 2, [&](int frame1, int frame2, real rmsd) {
+        ASSERT_LT(frame1, frame2);
+        EXPECT_TRUE(found.emplace(std::make_pair(frame1, frame2), rmsd).second);
+    });
+    ASSERT_FALSE(expected.empty());
+    EXPECT_LT(expected.size(), numFrames * (numFrames - 1) / 2);
+    EXPECT_EQ(expected, found);
+}
+
+INSTANTIATE_TEST_CASE_P(WithAndWithoutFit, RmsdMatrixTest, ::testing::Values(false, true));
+
+} // namespace
+
+} // namespace test
+
+} // namespace gmx
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Defines gmx::AsyncOutputWriter.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "asyncoutputwriter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+class AsyncOutputWriter::Impl
+{
+public:
+    explicit Impl(int maxQueuedTasks);
+    ~Impl();
+
+    //! Executes queued tasks until stopped
+    void run();
+    //! Rethrows the exception stored by a failed task, if any
+    void rethrowTaskError(std::unique_lock<std::mutex>* lock);
+
+    //! The maximum number of waiting tasks
+    const int maxQueuedTasks_;
+    //! Protects all the members below
+    std::mutex mutex_;
+    //! Signaled when a task is queued or the writer is stopped
+    std::condition_variable taskQueued_;
+    //! Signaled when a task has completed
+    std::condition_variable taskDone_;
+    //! The tasks waiting for execution
+    std::deque<std::function<void()>> tasks_;
+    //! Whether a task is currently running
+    bool taskRunning_ = false;
+    //! Whether the thread should exit once the queue is empty
+    bool stop_ = false;
+    //! The exception thrown by a task, if any
+    std::exception_ptr taskError_;
+    //! The background thread, started last
+    std::thread thread_;
+};
+
+AsyncOutputWriter::Impl::Impl(int maxQueuedTasks) :
+    maxQueuedTasks_(maxQueuedTasks), thread_([this]() { run(); })
+{
+}
+
+AsyncOutputWriter::Impl::~Impl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    taskQueued_.notify_one();
+    thread_.join();
+}
+
+void AsyncOutputWriter::Impl::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        taskQueued_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty())
+        {
+            return;
+        }
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        taskRunning_ = true;
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        taskRunning_ = false;
+        if (error)
+        {
+            // Later tasks may depend on the failed one having completed,
+            // e.g., appending to the same file, so they are not run.
+            taskError_ = error;
+            tasks_.clear();
+        }
+        taskDone_.notify_all();
+    }
+}
+
+void AsyncOutputWriter::Impl::rethrowTaskError(std::unique_lock<std::mutex>* lock)
+{
+    if (taskError_)
+    {
+        std::exception_ptr error = taskError_;
+        taskError_               = nullptr;
+        lock->unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+AsyncOutputWriter::AsyncOutputWriter(int maxQueuedTasks)
+{
+    GMX_RELEASE_ASSERT(maxQueuedTasks > 0, "Need to be able to queue at least one task");
+    impl_ = std::make_unique<Impl>(maxQueuedTasks);
+}
+
+AsyncOutputWriter::~AsyncOutputWriter()
+{
+    // Impl::~Impl() runs the remaining tasks before joining the thread.
+}
+
+void AsyncOutputWriter::enqueue(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    impl_->taskDone_.wait(lock, [this]() {
+        return impl_->taskError_
+               || static_cast<int>(impl_->tasks_.size()) < impl_->maxQueuedTasks_;
+    });
+    impl_->rethrowTaskError(&lock);
+    impl_->tasks_.push_back(std::move(task));
+    lock.unlock();
+    impl_->taskQueued_.notify_one();
+}
+
+void AsyncOutputWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(impl_->mutex_);
+    impl_->taskDone_.wait(lock, [this]() { return impl_->tasks_.empty() && !impl_->taskRunning_; });
+    impl_->rethrowTaskError(&lock);
+}
+
+} // namespace gmx
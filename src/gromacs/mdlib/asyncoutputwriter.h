@@ -0,0 +1,97 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief Declares gmx::AsyncOutputWriter.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+#ifndef GMX_MDLIB_ASYNCOUTPUTWRITER_H
+#define GMX_MDLIB_ASYNCOUTPUTWRITER_H
+
+#include <functional>
+#include <memory>
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief Runs output tasks in order on a background thread.
+ *
+ * Tasks are executed one at a time in the order in which they were
+ * queued. At most a fixed number of tasks can be pending; enqueue()
+ * blocks while the queue is full, which bounds the memory used for
+ * frames that are waiting to be written.
+ *
+ * A task must own all the data it uses, since the caller may modify
+ * its own buffers as soon as enqueue() returns. Files written to by
+ * tasks should only be accessed by the caller after flush().
+ *
+ * An exception thrown by a task is stored and rethrown from the next
+ * call to enqueue() or flush(); tasks queued after the failing one
+ * are discarded.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+class AsyncOutputWriter
+{
+public:
+    /*! \brief Starts the background thread
+     *
+     * \param[in] maxQueuedTasks  The maximum number of tasks that can be
+     *                            waiting, not counting the running one
+     */
+    explicit AsyncOutputWriter(int maxQueuedTasks);
+    //! Waits for all queued tasks to complete and stops the thread
+    ~AsyncOutputWriter();
+
+    /*! \brief Queues \p task for execution on the background thread
+     *
+     * Blocks while \c maxQueuedTasks tasks are already waiting.
+     */
+    void enqueue(std::function<void()> task);
+    //! Waits until all queued tasks have completed
+    void flush();
+
+private:
+    class Impl;
+
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
@@ -39,16 +39,25 @@
 
 #include "config.h"
 
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/collect.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/tngio.h"
+#include "gromacs/fileio/trajectoryframeindex.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/asyncoutputwriter.h"
 #include "gromacs/mdlib/trajectory_writing.h"
 #include "gromacs/mdrunutility/handlerestart.h"
 #include "gromacs/mdrunutility/multisim.h"
@@ -67,16 +76,28 @@
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/baseversion.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/futil.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/programcontext.h"
 #include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/sysinfo.h"
 
 struct gmx_mdoutf
 {
     t_fileio*                     fp_trn;
     t_fileio*                     fp_xtc;
+    const char*                   fn_trn;
+    const char*                   fn_xtc;
+    gmx::TrajectoryFrameIndex*    trnFrameIndex;     /* nullptr when not maintained */
+    gmx::TrajectoryFrameIndex*    xtcFrameIndex;     /* nullptr when not maintained */
+    gmx::AsyncOutputWriter*       trajectoryWriter;  /* nullptr when writing synchronously */
+    gmx::AsyncOutputWriter*       checkpointWriter;  /* nullptr when finishing synchronously */
+    std::string*                  checkpointWarning; /* last warning from checkpointWriter */
+    gmx::AsyncOutputWriter*       tngWriter;         /* nullptr when writing synchronously */
+    gmx::AsyncOutputWriter*       tngLowPrecWriter;  /* nullptr when writing synchronously */
     gmx_tng_trajectory_t          tng;
     gmx_tng_trajectory_t          tng_low_prec;
     int                           x_compression_precision; /* only used by XTC output */
@@ -99,6 +120,248 @@ struct gmx_mdoutf
     MPI_Comm                      mastersComm;
 };
 
+/*! \brief Returns the frame index to maintain for trajectory output to \p filename
+ *
+ * Any index stored for an earlier run is removed when the file is
+ * overwritten. An index is only maintained when GMX_TRAJECTORY_FRAME_INDEX
+ * is set. When appending, the stored index is reused and updated, but when
+ * there is none, no index is maintained, since building one requires
+ * scanning the whole existing trajectory.
+ */
+static gmx::TrajectoryFrameIndex* initFrameIndex(const char* filename, bool restartWithAppending)
+{
+    const std::string indexFileName = gmx::TrajectoryFrameIndex::fileNameForTrajectory(filename);
+    if (!restartWithAppending && gmx_fexist(indexFileName))
+    {
+        std::remove(indexFileName.c_str());
+    }
+    if (std::getenv("GMX_TRAJECTORY_FRAME_INDEX") == nullptr)
+    {
+        return nullptr;
+    }
+    if (!restartWithAppending)
+    {
+        return new gmx::TrajectoryFrameIndex;
+    }
+    t_fileio* fio        = gmx_fio_open(filename, "r");
+    auto      frameIndex = gmx::TrajectoryFrameIndex::readStored(filename, fio);
+    gmx_fio_close(fio);
+    return frameIndex ? new gmx::TrajectoryFrameIndex(std::move(*frameIndex)) : nullptr;
+}
+
+//! Adds the frame written to \p fio starting at \p offset to \p index, when present
+static void addFrameToIndex(gmx::TrajectoryFrameIndex* index, t_fileio* fio, int64_t step, double t, gmx_off_t offset)
+{
+    if (index != nullptr)
+    {
+        index->addFrame(step, t, offset, gmx_fio_ftell(fio));
+    }
+}
+
+//! Writes the frame indices of the trajectory output files
+static void writeFrameIndices(gmx_mdoutf_t of)
+{
+    if (of->trnFrameIndex != nullptr)
+    {
+        of->trnFrameIndex->write(of->fn_trn);
+    }
+    if (of->xtcFrameIndex != nullptr)
+    {
+        of->xtcFrameIndex->write(of->fn_xtc);
+    }
+}
+
+/*! \brief The number of trajectory frames that can wait for the background writer
+ *
+ * With two frames, the MD loop only blocks when output is requested
+ * while two earlier frames are still waiting to be written.
+ */
+static constexpr int c_maxQueuedTrajectoryFrames = 2;
+
+/*! \brief A TRR or TNG frame owned by a background writer
+ *
+ * Empty vectors correspond to output that is not written.
+ */
+struct TrajectoryFrameCopy
+{
+    int64_t                step;
+    double                 t;
+    real                   lambda;
+    bool                   hasBox;
+    matrix                 box;
+    int                    natoms;
+    std::vector<gmx::RVec> x;
+    std::vector<gmx::RVec> v;
+    std::vector<gmx::RVec> f;
+};
+
+//! Returns a copy of the \p natoms vectors in \p v, or an empty vector when \p v is nullptr
+static std::vector<gmx::RVec> copyVectors(const rvec* v, int natoms)
+{
+    if (v == nullptr)
+    {
+        return {};
+    }
+    const gmx::RVec* begin = reinterpret_cast<const gmx::RVec*>(v);
+    return std::vector<gmx::RVec>(begin, begin + natoms);
+}
+
+//! Returns \p v as an rvec pointer, or nullptr when \p v is empty
+static const rvec* vectorsOrNull(const std::vector<gmx::RVec>& v)
+{
+    return v.empty() ? nullptr : as_rvec_array(v.data());
+}
+
+//! Returns a copy of the frame data passed, \p box, \p x, \p v and \p f can be nullptr
+static TrajectoryFrameCopy copyFrame(int64_t     step,
+                                     double      t,
+                                     real        lambda,
+                                     const rvec* box,
+                                     int         natoms,
+                                     const rvec* x,
+                                     const rvec* v,
+                                     const rvec* f)
+{
+    TrajectoryFrameCopy frame;
+    frame.step   = step;
+    frame.t      = t;
+    frame.lambda = lambda;
+    frame.hasBox = (box != nullptr);
+    if (box != nullptr)
+    {
+        copy_mat(box, frame.box);
+    }
+    frame.natoms = natoms;
+    frame.x      = copyVectors(x, natoms);
+    frame.v      = copyVectors(v, natoms);
+    frame.f      = copyVectors(f, natoms);
+    return frame;
+}
+
+/*! \brief Writes a frame to \p tng, on the background thread \p writer when that is not nullptr
+ *
+ * Does nothing when \p tng is nullptr.
+ */
+static void writeTngFrame(gmx_tng_trajectory_t    tng,
+                          gmx::AsyncOutputWriter* writer,
+                          gmx_bool                bUseLossyCompression,
+                          int64_t                 step,
+                          double                  t,
+                          real                    lambda,
+                          const rvec*             box,
+                          int                     natoms,
+                          const rvec*             x,
+                          const rvec*             v,
+                          const rvec*             f)
+{
+    if (tng == nullptr)
+    {
+        return;
+    }
+    if (writer == nullptr)
+    {
+        gmx_fwrite_tng(tng, bUseLossyCompression, step, t, lambda, box, natoms, x, v, f);
+        return;
+    }
+    TrajectoryFrameCopy frame = copyFrame(step, t, lambda, box, natoms, x, v, f);
+    writer->enqueue([tng, bUseLossyCompression, frame = std::move(frame)]() {
+        gmx_fwrite_tng(tng,
+                       bUseLossyCompression,
+                       frame.step,
+                       frame.t,
+                       frame.lambda,
+                       frame.hasBox ? frame.box : nullptr,
+                       frame.natoms,
+                       vectorsOrNull(frame.x),
+                       vectorsOrNull(frame.v),
+                       vectorsOrNull(frame.f));
+    });
+}
+
+/*! \brief Writes a TRR frame and adds it to the frame index
+ *
+ * \throws FileIOError when the frame cannot be written. Errors are thrown
+ * instead of being fatal, because this runs on the background writer,
+ * which rethrows them on the thread that queues the frames.
+ */
+static void writeTrrFrame(gmx_mdoutf_t of,
+                          int64_t      step,
+                          double       t,
+                          real         lambda,
+                          const rvec*  box,
+                          int          natoms,
+                          const rvec*  x,
+                          const rvec*  v,
+                          const rvec*  f)
+{
+    const gmx_off_t offset = gmx_fio_ftell(of->fp_trn);
+    gmx_trr_write_frame(of->fp_trn, step, t, lambda, box, natoms, x, v, f);
+    if (gmx_fio_flush(of->fp_trn) != 0)
+    {
+        GMX_THROW(gmx::FileIOError("Cannot write trajectory; maybe you are out of disk space?"));
+    }
+    addFrameToIndex(of->trnFrameIndex, of->fp_trn, step, t, offset);
+}
+
+/*! \brief Compresses and writes an XTC frame and adds it to the frame index
+ *
+ * \throws FileIOError when the frame cannot be written, see writeTrrFrame().
+ */
+static void writeXtcFrame(gmx_mdoutf_t of, int64_t step, double t, const rvec* box, const rvec* x)
+{
+    const gmx_off_t offset = gmx_fio_ftell(of->fp_xtc);
+    if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, box, x, of->x_compression_precision) == 0)
+    {
+        GMX_THROW(gmx::FileIOError(
+                "XTC error. This indicates you are out of disk space, or a "
+                "simulation with major instabilities resulting in coordinates "
+                "that are NaN or too large to be represented in the XTC format."));
+    }
+    addFrameToIndex(of->xtcFrameIndex, of->fp_xtc, step, t, offset);
+}
+
+/*! \brief Waits until all frames queued for the background writers are written
+ *
+ * Needs to be called before the trajectory files or their frame
+ * indices are accessed from the calling thread.
+ */
+static void flushTrajectoryWriter(gmx_mdoutf_t of)
+{
+    for (gmx::AsyncOutputWriter* writer : { of->trajectoryWriter, of->tngWriter, of->tngLowPrecWriter })
+    {
+        if (writer != nullptr)
+        {
+            writer->flush();
+        }
+    }
+}
+
+//! Stops the background writers of the TNG files, after writing all queued frames
+static void stopTngWriters(gmx_mdoutf_t of)
+{
+    delete of->tngWriter;
+    delete of->tngLowPrecWriter;
+    of->tngWriter        = nullptr;
+    of->tngLowPrecWriter = nullptr;
+}
+
+/*! \brief Waits until the checkpoint being finished in the background, if any, is complete
+ *
+ * Errors from finishing the checkpoint are thrown and warnings are
+ * reported here, on the calling thread.
+ */
+static void flushCheckpointWriter(gmx_mdoutf_t of)
+{
+    if (of->checkpointWriter != nullptr)
+    {
+        of->checkpointWriter->flush();
+        if (!of->checkpointWarning->empty())
+        {
+            gmx_warning("%s", of->checkpointWarning->c_str());
+            of->checkpointWarning->clear();
+        }
+    }
+}
 
 gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
                          int                           nfile,
@@ -123,12 +386,21 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
 
     snew(of, 1);
 
-    of->fp_trn       = nullptr;
-    of->fp_ene       = nullptr;
-    of->fp_xtc       = nullptr;
-    of->tng          = nullptr;
-    of->tng_low_prec = nullptr;
-    of->fp_dhdl      = nullptr;
+    of->fp_trn            = nullptr;
+    of->fp_ene            = nullptr;
+    of->fp_xtc            = nullptr;
+    of->fn_trn            = nullptr;
+    of->fn_xtc            = nullptr;
+    of->trnFrameIndex     = nullptr;
+    of->xtcFrameIndex     = nullptr;
+    of->trajectoryWriter  = nullptr;
+    of->checkpointWriter  = nullptr;
+    of->checkpointWarning = nullptr;
+    of->tngWriter         = nullptr;
+    of->tngLowPrecWriter  = nullptr;
+    of->tng               = nullptr;
+    of->tng_low_prec      = nullptr;
+    of->fp_dhdl           = nullptr;
 
     of->eIntegrator             = ir->eI;
     of->bExpanded               = ir->bExpanded;
@@ -159,7 +431,11 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
             filename = ftp2fn(efCOMPRESSED, nfile, fnm);
             switch (fn2ftp(filename))
             {
-                case efXTC: of->fp_xtc = open_xtc(filename, filemode); break;
+                case efXTC:
+                    of->fp_xtc        = open_xtc(filename, filemode);
+                    of->fn_xtc        = filename;
+                    of->xtcFrameIndex = initFrameIndex(filename, restartWithAppending);
+                    break;
                 case efTNG:
                     gmx_tng_open(filename, filemode[0], &of->tng_low_prec);
                     if (filemode[0] == 'w')
@@ -186,7 +462,9 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
                        and/or velocities to the TNG file instead. */
                     if (ir->nstxout != 0 || ir->nstxout_compressed == 0 || !of->tng_low_prec)
                     {
-                        of->fp_trn = gmx_trr_open(filename, filemode);
+                        of->fp_trn        = gmx_trr_open(filename, filemode);
+                        of->fn_trn        = filename;
+                        of->trnFrameIndex = initFrameIndex(filename, restartWithAppending);
                     }
                     break;
                 case efTNG:
@@ -241,6 +519,38 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
         {
             snew(of->f_global, top_global->natoms);
         }
+
+        /* XTC compression and writing of TRR and XTC frames are done
+           on a background thread, so that they overlap with the
+           following MD steps. */
+        if ((of->fp_trn != nullptr || of->fp_xtc != nullptr)
+            && std::getenv("GMX_NO_ASYNC_TRAJECTORY_OUTPUT") == nullptr)
+        {
+            of->trajectoryWriter = new gmx::AsyncOutputWriter(c_maxQueuedTrajectoryFrames);
+        }
+        /* TNG compression is expensive, so each TNG file gets its own
+           thread. This way the two files are also compressed concurrently. */
+        if (std::getenv("GMX_NO_ASYNC_TRAJECTORY_OUTPUT") == nullptr)
+        {
+            if (of->tng != nullptr)
+            {
+                of->tngWriter = new gmx::AsyncOutputWriter(c_maxQueuedTrajectoryFrames);
+            }
+            if (of->tng_low_prec != nullptr)
+            {
+                of->tngLowPrecWriter = new gmx::AsyncOutputWriter(c_maxQueuedTrajectoryFrames);
+            }
+        }
+
+        /* Syncing a checkpoint to disk and renaming it are done on
+           a background thread. This can not be done when the renaming
+           requires an MPI barrier between simulations. */
+        if (!GMX_FAHCORE && !of->simulationsShareState
+            && std::getenv("GMX_NO_ASYNC_CHECKPOINT") == nullptr)
+        {
+            of->checkpointWriter  = new gmx::AsyncOutputWriter(1);
+            of->checkpointWarning = new std::string;
+        }
     }
 
     if (bCiteTng)
@@ -278,6 +588,114 @@ static void mpiBarrierBeforeRename(const bool applyMpiBarrierBeforeRename, MPI_C
 #endif
     }
 }
+
+/*! \brief Returns the message for a failure to fsync \p fio, or throws when such failures are fatal
+ *
+ * \throws FileIOError unless GMX_IGNORE_FSYNC_FAILURE is set.
+ */
+static std::string fsyncFailureMessage(t_fileio* fio)
+{
+    const std::string message = gmx::formatString(
+            "Cannot fsync '%s'; maybe you are out of disk space?", gmx_fio_getname(fio));
+    if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
+    {
+        GMX_THROW(gmx::FileIOError(message));
+    }
+    return message;
+}
+
+/*! \brief Makes a checkpoint written to \p fp durable and moves it to \p fn
+ *
+ * Syncs the checkpoint, which was written to the temporary file \p fntemp,
+ * to disk and closes it. Unless \p bNumberAndKeep is set, or an output file
+ * or the checkpoint could not be synced, the previous checkpoint is then
+ * kept with suffix _prev and the new one is renamed to \p fn.
+ *
+ * Can run on the checkpoint writer thread, so errors are not reported here.
+ *
+ * \returns A warning to report, or an empty string.
+ * \throws FileIOError when the checkpoint cannot be synced, closed or renamed.
+ */
+static std::string finishCheckpointFile(t_fileio*          fp,
+                                        const std::string& fntemp,
+                                        const char*        fn,
+                                        gmx_bool           bNumberAndKeep,
+                                        bool               outputFilesSynced,
+                                        bool               applyMpiBarrierBeforeRename,
+                                        MPI_Comm           mpiBarrierCommunicator)
+{
+    char        buf[1024];
+    std::string warning;
+    bool        synced = outputFilesSynced;
+
+    /* The output files the checkpoint depends on have been synced
+       before the checkpoint was written, so only the checkpoint
+       itself needs to be physically written out to disk here. */
+    if (gmx_fio_fsync(fp) != 0)
+    {
+        warning = fsyncFailureMessage(fp);
+        synced  = false;
+    }
+
+    if (gmx_fio_close(fp) != 0)
+    {
+        GMX_THROW(gmx::FileIOError(
+                "Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?"));
+    }
+
+    /* we don't move the checkpoint if the user specified they didn't want it,
+       or if the fsyncs failed */
+#if !GMX_NO_RENAME
+    if (!bNumberAndKeep && synced)
+    {
+        if (gmx_fexist(fn))
+        {
+            /* Rename the previous checkpoint file */
+            mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
+
+            std::strcpy(buf, fn);
+            buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
+            std::strcat(buf, "_prev");
+            std::strcat(buf, fn + std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
+            if (!GMX_FAHCORE)
+            {
+                /* we copy here so that if something goes wrong between now and
+                 * the rename below, there's always a state.cpt.
+                 * If renames are atomic (such as in POSIX systems),
+                 * this copying should be unneccesary.
+                 */
+                gmx_file_copy(fn, buf, FALSE);
+                /* We don't really care if this fails:
+                 * there's already a new checkpoint.
+                 */
+            }
+            else
+            {
+                gmx_file_rename(fn, buf);
+            }
+        }
+
+        /* Rename the checkpoint file from the temporary to the final name */
+        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
+
+        if (gmx_file_rename(fntemp.c_str(), fn) != 0)
+        {
+            GMX_THROW(gmx::FileIOError(
+                    "Cannot rename checkpoint file; maybe you are out of disk space?"));
+        }
+    }
+#else
+    GMX_UNUSED_VALUE(fntemp);
+    GMX_UNUSED_VALUE(fn);
+    GMX_UNUSED_VALUE(bNumberAndKeep);
+    GMX_UNUSED_VALUE(synced);
+    GMX_UNUSED_VALUE(applyMpiBarrierBeforeRename);
+    GMX_UNUSED_VALUE(mpiBarrierCommunicator);
+#endif /* GMX_NO_RENAME */
+
+    return warning;
+}
+
 /*! \brief Write a checkpoint to the filename
  *
  * Appends the _step<step>.cpt with bNumberAndKeep, otherwise moves
@@ -300,13 +718,14 @@ static void write_checkpoint(const char*                     fn,
                              const gmx::MdModulesNotifier&   mdModulesNotifier,
                              gmx::WriteCheckpointDataHolder* modularSimulatorCheckpointData,
                              bool                            applyMpiBarrierBeforeRename,
-                             MPI_Comm                        mpiBarrierCommunicator)
+                             MPI_Comm                        mpiBarrierCommunicator,
+                             gmx::AsyncOutputWriter*         checkpointWriter,
+                             std::string*                    checkpointWarning)
 {
     t_fileio* fp;
     char*     fntemp; /* the temporary checkpoint file name */
     int       npmenodes;
     char      buf[1024], suffix[5 + STEPSTRSIZE], sbuf[STEPSTRSIZE];
-    t_fileio* ret;
 
     if (DOMAINDECOMP(cr))
     {
@@ -342,6 +761,17 @@ static void write_checkpoint(const char*                     fn,
     /* Get offsets for open files */
     auto outputfiles = gmx_fio_get_output_file_positions();
 
+    /* Make sure all output files the checkpoint refers to are physically
+       on disk before the checkpoint can replace the previous one. This
+       is done before the checkpoint is opened, so that the checkpoint
+       itself is left to be synced when it is finished. */
+    t_fileio*  unsyncedFile      = gmx_fio_all_output_fsync();
+    const bool outputFilesSynced = (unsyncedFile == nullptr);
+    if (!outputFilesSynced)
+    {
+        gmx_warning("%s", fsyncFailureMessage(unsyncedFile).c_str());
+    }
+
     fp = gmx_fio_open(fntemp, "w");
 
     /* We can check many more things now (CPU, acceleration, etc), but
@@ -404,73 +834,37 @@ static void write_checkpoint(const char*                     fn,
                           &outputfiles,
                           modularSimulatorCheckpointData);
 
-    /* we really, REALLY, want to make sure to physically write the checkpoint,
-       and all the files it depends on, out to disk. Because we've
-       opened the checkpoint with gmx_fio_open(), it's in our list
-       of open files.  */
-    ret = gmx_fio_all_output_fsync();
-
-    if (ret)
-    {
-        char buf[STRLEN];
-        sprintf(buf, "Cannot fsync '%s'; maybe you are out of disk space?", gmx_fio_getname(ret));
-
-        if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
-        {
-            gmx_file(buf);
-        }
-        else
-        {
-            gmx_warning("%s", buf);
-        }
-    }
-
-    if (gmx_fio_close(fp) != 0)
+    if (checkpointWriter != nullptr)
     {
-        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        /* Syncing to disk can take long, in particular on parallel file
+           systems, so this continues in the background. The previous
+           checkpoint stays in place until the new one is complete. */
+        const std::string fntempString = fntemp;
+        checkpointWriter->enqueue(
+                [fp, fntempString, fn, bNumberAndKeep, outputFilesSynced, checkpointWarning]() {
+                    *checkpointWarning = finishCheckpointFile(fp,
+                                                              fntempString,
+                                                              fn,
+                                                              bNumberAndKeep,
+                                                              outputFilesSynced,
+                                                              false,
+                                                              MPI_COMM_NULL);
+                });
     }
-
-    /* we don't move the checkpoint if the user specified they didn't want it,
-       or if the fsyncs failed */
-#if !GMX_NO_RENAME
-    if (!bNumberAndKeep && !ret)
+    else
     {
-        if (gmx_fexist(fn))
-        {
-            /* Rename the previous checkpoint file */
-            mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
-
-            std::strcpy(buf, fn);
-            buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
-            std::strcat(buf, "_prev");
-            std::strcat(buf, fn + std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
-            if (!GMX_FAHCORE)
-            {
-                /* we copy here so that if something goes wrong between now and
-                 * the rename below, there's always a state.cpt.
-                 * If renames are atomic (such as in POSIX systems),
-                 * this copying should be unneccesary.
-                 */
-                gmx_file_copy(fn, buf, FALSE);
-                /* We don't really care if this fails:
-                 * there's already a new checkpoint.
-                 */
-            }
-            else
-            {
-                gmx_file_rename(fn, buf);
-            }
-        }
-
-        /* Rename the checkpoint file from the temporary to the final name */
-        mpiBarrierBeforeRename(applyMpiBarrierBeforeRename, mpiBarrierCommunicator);
-
-        if (gmx_file_rename(fntemp, fn) != 0)
+        const std::string warning = finishCheckpointFile(fp,
+                                                         fntemp,
+                                                         fn,
+                                                         bNumberAndKeep,
+                                                         outputFilesSynced,
+                                                         applyMpiBarrierBeforeRename,
+                                                         mpiBarrierCommunicator);
+        if (!warning.empty())
         {
-            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
+            gmx_warning("%s", warning.c_str());
         }
     }
-#endif /* GMX_NO_RENAME */
 
     sfree(fntemp);
 
@@ -494,8 +888,20 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
                              ObservablesHistory*             observablesHistory,
                              gmx::WriteCheckpointDataHolder* modularSimulatorCheckpointData)
 {
+    /* The checkpoint stores the output file positions, so all frames
+     * written before the checkpoint need to be in the files.
+     */
+    flushTrajectoryWriter(of);
     fflush_tng(of->tng);
     fflush_tng(of->tng_low_prec);
+    /* The previous checkpoint needs to be in place before it can be
+     * moved aside for the new one.
+     */
+    flushCheckpointWriter(of);
+    /* Store the frame indices together with the checkpoint, so that
+     * a restart with appending can continue them.
+     */
+    writeFrameIndices(of);
     /* Write the checkpoint file.
      * When simulations share the state, an MPI barrier is applied before
      * renaming old and new checkpoint files to minimize the risk of
@@ -519,7 +925,9 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
                      *(of->mdModulesNotifier),
                      modularSimulatorCheckpointData,
                      of->simulationsShareState,
-                     of->mastersComm);
+                     of->mastersComm,
+                     of->checkpointWriter,
+                     of->checkpointWarning);
 }
 
 void mdoutf_write_to_trajectory_files(FILE*                           fplog,
@@ -603,37 +1011,58 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
             const rvec* v = (mdof_flags & MDOF_V) ? state_global->v.rvec_array() : nullptr;
             const rvec* f = (mdof_flags & MDOF_F) ? f_global : nullptr;
 
-            if (of->fp_trn)
+            if (of->fp_trn && of->trajectoryWriter)
             {
-                gmx_trr_write_frame(
-                        of->fp_trn, step, t, state_local->lambda[efptFEP], state_local->box, natoms, x, v, f);
-                if (gmx_fio_flush(of->fp_trn) != 0)
-                {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-                }
+                TrajectoryFrameCopy frame =
+                        copyFrame(step, t, state_local->lambda[efptFEP], state_local->box, natoms, x, v, f);
+                of->trajectoryWriter->enqueue([of, frame = std::move(frame)]() {
+                    writeTrrFrame(of,
+                                  frame.step,
+                                  frame.t,
+                                  frame.lambda,
+                                  frame.box,
+                                  frame.natoms,
+                                  vectorsOrNull(frame.x),
+                                  vectorsOrNull(frame.v),
+                                  vectorsOrNull(frame.f));
+                });
+            }
+            else if (of->fp_trn)
+            {
+                writeTrrFrame(of, step, t, state_local->lambda[efptFEP], state_local->box, natoms, x, v, f);
             }
 
             /* If a TNG file is open for uncompressed coordinate output also write
                velocities and forces to it. */
             else if (of->tng)
             {
-                gmx_fwrite_tng(
-                        of->tng, FALSE, step, t, state_local->lambda[efptFEP], state_local->box, natoms, x, v, f);
+                writeTngFrame(of->tng,
+                              of->tngWriter,
+                              FALSE,
+                              step,
+                              t,
+                              state_local->lambda[efptFEP],
+                              state_local->box,
+                              natoms,
+                              x,
+                              v,
+                              f);
             }
             /* If only a TNG file is open for compressed coordinate output (no uncompressed
                coordinate output) also write forces and velocities to it. */
             else if (of->tng_low_prec)
             {
-                gmx_fwrite_tng(of->tng_low_prec,
-                               FALSE,
-                               step,
-                               t,
-                               state_local->lambda[efptFEP],
-                               state_local->box,
-                               natoms,
-                               x,
-                               v,
-                               f);
+                writeTngFrame(of->tng_low_prec,
+                              of->tngLowPrecWriter,
+                              FALSE,
+                              step,
+                              t,
+                              state_local->lambda[efptFEP],
+                              state_local->box,
+                              natoms,
+                              x,
+                              v,
+                              f);
             }
         }
         if (mdof_flags & MDOF_X_COMPRESSED)
@@ -663,24 +1092,30 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, state_local->box, xxtc, of->x_compression_precision)
-                == 0)
+            if (of->fp_xtc && of->trajectoryWriter)
+            {
+                std::vector<gmx::RVec> xCopy = copyVectors(xxtc, of->natoms_x_compressed);
+                matrix                 box;
+                copy_mat(state_local->box, box);
+                of->trajectoryWriter->enqueue([of, step, t, xCopy = std::move(xCopy), box]() {
+                    writeXtcFrame(of, step, t, box, as_rvec_array(xCopy.data()));
+                });
+            }
+            else if (of->fp_xtc)
             {
-                gmx_fatal(FARGS,
-                          "XTC error. This indicates you are out of disk space, or a "
-                          "simulation with major instabilities resulting in coordinates "
-                          "that are NaN or too large to be represented in the XTC format.\n");
+                writeXtcFrame(of, step, t, state_local->box, xxtc);
             }
-            gmx_fwrite_tng(of->tng_low_prec,
-                           TRUE,
-                           step,
-                           t,
-                           state_local->lambda[efptFEP],
-                           state_local->box,
-                           of->natoms_x_compressed,
-                           xxtc,
-                           nullptr,
-                           nullptr);
+            writeTngFrame(of->tng_low_prec,
+                          of->tngLowPrecWriter,
+                          TRUE,
+                          step,
+                          t,
+                          state_local->lambda[efptFEP],
+                          state_local->box,
+                          of->natoms_x_compressed,
+                          xxtc,
+                          nullptr,
+                          nullptr);
             if (of->natoms_x_compressed != of->natoms_global)
             {
                 sfree(xxtc);
@@ -700,7 +1135,7 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                 {
                     lambda = state_local->lambda[efptFEP];
                 }
-                gmx_fwrite_tng(of->tng, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
+                writeTngFrame(of->tng, of->tngWriter, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
             }
         }
         if (mdof_flags & (MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED)
@@ -718,7 +1153,17 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                 {
                     lambda = state_local->lambda[efptFEP];
                 }
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
+                writeTngFrame(of->tng_low_prec,
+                              of->tngLowPrecWriter,
+                              FALSE,
+                              step,
+                              t,
+                              lambda,
+                              box,
+                              natoms,
+                              nullptr,
+                              nullptr,
+                              nullptr);
             }
         }
 
@@ -738,6 +1183,8 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
     if (of->tng || of->tng_low_prec)
     {
         wallcycle_start(of->wcycle, ewcTRAJ);
+        flushTrajectoryWriter(of);
+        stopTngWriters(of);
         gmx_tng_close(&of->tng);
         gmx_tng_close(&of->tng_low_prec);
         wallcycle_stop(of->wcycle, ewcTRAJ);
@@ -750,6 +1197,15 @@ void done_mdoutf(gmx_mdoutf_t of)
     {
         done_ener_file(of->fp_ene);
     }
+    flushTrajectoryWriter(of);
+    delete of->trajectoryWriter;
+    stopTngWriters(of);
+    flushCheckpointWriter(of);
+    delete of->checkpointWriter;
+    delete of->checkpointWarning;
+    writeFrameIndices(of);
+    delete of->xtcFrameIndex;
+    delete of->trnFrameIndex;
     if (of->fp_xtc)
     {
         close_xtc(of->fp_xtc);
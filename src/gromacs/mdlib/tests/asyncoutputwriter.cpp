@@ -0,0 +1,102 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief Tests for the AsyncOutputWriter class
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/mdlib/asyncoutputwriter.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/exceptions.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+TEST(AsyncOutputWriter, RunsTasksInOrder)
+{
+    std::vector<int>  done;
+    AsyncOutputWriter writer(2);
+    for (int i = 0; i < 10; i++)
+    {
+        writer.enqueue([&done, i]() { done.push_back(i); });
+    }
+    writer.flush();
+    ASSERT_EQ(10U, done.size());
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_EQ(i, done[i]);
+    }
+}
+
+TEST(AsyncOutputWriter, RunsRemainingTasksOnDestruction)
+{
+    int numDone = 0;
+    {
+        AsyncOutputWriter writer(3);
+        for (int i = 0; i < 3; i++)
+        {
+            writer.enqueue([&numDone]() { numDone++; });
+        }
+    }
+    EXPECT_EQ(3, numDone);
+}
+
+TEST(AsyncOutputWriter, RethrowsTaskErrorOnFlush)
+{
+    int               numDone = 0;
+    AsyncOutputWriter writer(2);
+    writer.enqueue([]() { GMX_THROW(FileIOError("Cannot write")); });
+    EXPECT_THROW_GMX(writer.flush(), FileIOError);
+
+    // The writer can be used again after the error was reported
+    writer.enqueue([&numDone]() { numDone++; });
+    EXPECT_NO_THROW_GMX(writer.flush());
+    EXPECT_EQ(1, numDone);
+}
+
+} // namespace
+
+} // namespace gmx
@@ -47,6 +47,7 @@
 #include <cctype>
 #include <cstdio>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -685,6 +686,17 @@ bool SelectionCollection::requiresIndexGroups() const
 }
 
 
+int SelectionCollection::requiredAtomCount() const
+{
+    const gmx_ana_index_t& requiredAtoms = impl_->requiredAtoms_;
+    if (requiredAtoms.isize == 0)
+    {
+        return 0;
+    }
+    return *std::max_element(requiredAtoms.index, requiredAtoms.index + requiredAtoms.isize) + 1;
+}
+
+
 SelectionList SelectionCollection::parseFromStdin(int count, bool bInteractive, const std::string& context)
 {
     StandardInputStream inputStream;
@@ -230,6 +230,20 @@ public:
      * Does not throw.
      */
     bool requiresIndexGroups() const;
+    /*! \brief
+     * Returns the number of atoms from the start of a frame that are
+     * required for evaluating the selections.
+     *
+     * \returns One more than the largest atom index that is required for
+     *     evaluating the selections, or zero if no atoms are required.
+     *
+     * Frames passed to evaluate() need to contain at least this many atoms
+     * (if they do not have an index), so the rest of the atoms need not be
+     * read.  Can only be called after compile().
+     *
+     * Does not throw.
+     */
+    int requiredAtomCount() const;
     /*! \brief
      * Sets the topology for the collection.
      *
@@ -44,6 +44,11 @@
 #include <cstring>
 
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/enxio.h"
@@ -147,41 +152,101 @@ static void sort_files(gmx::ArrayRef<std::string> files, real* settime)
 }
 
 
-static int scan_ene_files(const std::vector<std::string>& files, real* readtime, real* timestep, int* nremax)
+//! The information from the start of an energy file that is needed to join files
+struct EnergyFileStart
 {
-    /* Check number of energy terms and start time of all files */
-    int          nre, nremin = 0, nresav = 0;
-    ener_file_t  in;
-    real         t1, t2;
-    char         inputstring[STRLEN];
-    gmx_enxnm_t* enm;
-    t_enxframe*  fr;
+    //! The number of energy terms in the file
+    int nre = 0;
+    //! The time of the first frame
+    real t1 = 0;
+    //! The time of the second frame, only read for the first file
+    real t2 = 0;
+    //! The number of energy terms in the last frame that was read
+    int lastFrameNre = 0;
+};
+
+/*! \brief Reads the number of energy terms and the start time of \p fileName
+ *
+ * Only the frame headers are needed, so the energies and blocks are skipped.
+ */
+static EnergyFileStart scanEnergyFileStart(const std::string& fileName, bool readSecondFrame)
+{
+    EnergyFileStart start;
+    ener_file_t     in  = open_enx(fileName.c_str(), "r");
+    gmx_enxnm_t*    enm = nullptr;
+    t_enxframe*     fr;
 
     snew(fr, 1);
+    do_enxnms(in, &start.nre, &enm);
+    gmx_bool* bReadTerm;
+    snew(bReadTerm, start.nre);
+    enx_set_data_to_read(in, start.nre, bReadTerm, TRUE);
+    sfree(bReadTerm);
+    do_enx(in, fr);
+    start.t1 = fr->t;
+    if (readSecondFrame)
+    {
+        do_enx(in, fr);
+        start.t2 = fr->t;
+    }
+    start.lastFrameNre = fr->nre;
+    done_ener_file(in);
+    free_enxnms(start.nre, enm);
+    free_enxframe(fr);
+    sfree(fr);
+
+    return start;
+}
+
+static int scan_ene_files(const std::vector<std::string>& files, real* readtime, real* timestep, int* nremax)
+{
+    /* Check number of energy terms and start time of all files */
+    int  nremin = 0, nresav = 0;
+    char inputstring[STRLEN];
+
+    /* The files are independent, so their starts are read concurrently,
+     * but with at most one worker per hardware thread so that many input
+     * files do not lead to many threads and open files.
+     */
+    std::vector<EnergyFileStart> starts(files.size());
+    std::atomic<size_t>          nextFile(0);
+    const auto                   scanFiles = [&files, &starts, &nextFile]() {
+        for (size_t f = nextFile++; f < files.size(); f = nextFile++)
+        {
+            starts[f] = scanEnergyFileStart(files[f], f == 0);
+        }
+    };
+    const size_t numWorkers =
+            std::min<size_t>(files.size(), std::max(1U, std::thread::hardware_concurrency()));
+    std::vector<std::future<void>> workers;
+    for (size_t w = 0; w < numWorkers; w++)
+    {
+        workers.push_back(std::async(std::launch::async, scanFiles));
+    }
+    for (auto& worker : workers)
+    {
+        worker.get();
+    }
 
     for (size_t f = 0; f < files.size(); f++)
     {
-        in  = open_enx(files[f].c_str(), "r");
-        enm = nullptr;
-        do_enxnms(in, &nre, &enm);
+        const int nre = starts[f].nre;
 
         if (f == 0)
         {
-            nresav  = nre;
-            nremin  = nre;
-            *nremax = nre;
-            do_enx(in, fr);
-            t1 = fr->t;
-            do_enx(in, fr);
-            t2          = fr->t;
-            *timestep   = t2 - t1;
-            readtime[f] = t1;
-            close_enx(in);
+            nresav      = nre;
+            nremin      = nre;
+            *nremax     = nre;
+            *timestep   = starts[f].t2 - starts[f].t1;
+            readtime[f] = starts[f].t1;
         }
         else
         {
-            nremin  = std::min(nremin, fr->nre);
-            *nremax = std::max(*nremax, fr->nre);
+            /* The number of terms in the frame read last from the previous file */
+            const int frameNre = starts[f - 1].lastFrameNre;
+
+            nremin  = std::min(nremin, frameNre);
+            *nremax = std::max(*nremax, frameNre);
             if (nre != nresav)
             {
                 fprintf(stderr,
@@ -190,7 +255,7 @@ static int scan_ene_files(const std::vector<std::string>& files, real* readtime,
                         files[f - 1].c_str(),
                         nresav,
                         files[f].c_str(),
-                        fr->nre);
+                        frameNre);
                 fprintf(stderr,
                         "\nContinue conversion using only the first %d terms (n/y)?\n"
                         "(you should be sure that the energy terms match)\n",
@@ -204,18 +269,12 @@ static int scan_ene_files(const std::vector<std::string>& files, real* readtime,
                     fprintf(stderr, "Will not convert\n");
                     exit(0);
                 }
-                nresav = fr->nre;
+                nresav = frameNre;
             }
-            do_enx(in, fr);
-            readtime[f] = fr->t;
-            close_enx(in);
+            readtime[f] = starts[f].t1;
         }
-        fprintf(stderr, "\n");
-        free_enxnms(nre, enm);
     }
-
-    free_enxframe(fr);
-    sfree(fr);
+    fprintf(stderr, "\n");
 
     return nremin;
 }
@@ -128,6 +128,17 @@ public:
          * \see setRmPBC()
          */
         efNoUserRmPBC = 1 << 5,
+        /*! \brief
+         * Indicates that the module only uses coordinates of selected atoms.
+         *
+         * If this flag is specified, frames after the first one may only
+         * contain the leading atoms that are required for evaluating the
+         * selections (extended to complete molecules if PBC removal is
+         * active), and t_trxframe::natoms is smaller accordingly.
+         * This allows the reader to skip decompressing the rest of the
+         * atoms in XTC trajectories.
+         */
+        efOnlySelectedAtoms = 1 << 6,
     };
 
     //! Initializes default settings.
@@ -381,6 +381,7 @@ void Angle::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings*
     };
 
     settings->setHelpText(desc);
+    settings->setFlag(TrajectoryAnalysisSettings::efOnlySelectedAtoms);
 
     options->addOption(FileNameOption("oav")
                                .filetype(eftPlot)
@@ -156,6 +156,7 @@ void Distance::initOptions(IOptionsContainer* options, TrajectoryAnalysisSetting
     };
 
     settings->setHelpText(desc);
+    settings->setFlag(TrajectoryAnalysisSettings::efOnlySelectedAtoms);
 
     options->addOption(FileNameOption("oav")
                                .filetype(eftPlot)
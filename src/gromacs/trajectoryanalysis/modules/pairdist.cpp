@@ -219,6 +219,7 @@ void PairDistance::initOptions(IOptionsContainer* options, TrajectoryAnalysisSet
     };
 
     settings->setHelpText(desc);
+    settings->setFlag(TrajectoryAnalysisSettings::efOnlySelectedAtoms);
 
     options->addOption(FileNameOption("o")
                                .filetype(eftPlot)
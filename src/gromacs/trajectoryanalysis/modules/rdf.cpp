@@ -67,12 +67,16 @@
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/selection/selectionoption.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysismodule.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/stringutil.h"
 
 namespace gmx
@@ -155,11 +159,13 @@ private:
     SelectionList sel_;
 
     /*! \brief
-     * Raw pairwise distance data from which the RDF is computed.
+     * Binned pairwise distance data from which the RDF is computed.
      *
-     * There is a data set for each selection in `sel_`, with a single
-     * column.  Each point set will contain a single pairwise distance
-     * that contributes to the RDF.
+     * There is a data set for each selection in `sel_`, with two columns.
+     * The pair distances of a frame are binned by the module itself, and
+     * each point set contains the center of a non-empty bin and the number
+     * of pairs in that bin.  Registered as "binnedpairdist"; the raw
+     * distances are not available as a data set.
      */
     AnalysisData pairDist_;
     /*! \brief
@@ -178,7 +184,7 @@ private:
      * the averager is normalized by the average number of reference
      * positions (average of the first column of `normFactors_`).
      */
-    AnalysisDataSimpleHistogramModulePointer pairCounts_;
+    AnalysisDataWeightedHistogramModulePointer pairCounts_;
     /*! \brief
      * Average normalization factors.
      */
@@ -201,13 +207,17 @@ private:
     real cut2_;
     real rmax2_;
     int  surfaceGroupCount_;
+    //! Number of bins in `pairCounts_`.
+    int binCount_;
+    //! Width of the bins in `pairCounts_`.
+    real binWidth_;
 
     // Copy and assign disallowed by base.
 };
 
 Rdf::Rdf() :
     surface_(SurfaceType::None),
-    pairCounts_(new AnalysisDataSimpleHistogramModule()),
+    pairCounts_(new AnalysisDataWeightedHistogramModule()),
     normAve_(new AnalysisDataAverageModule()),
     localTop_(nullptr),
     binwidth_(0.002),
@@ -223,7 +233,7 @@ Rdf::Rdf() :
 {
     pairDist_.setMultipoint(true);
     pairDist_.addModule(pairCounts_);
-    registerAnalysisDataset(&pairDist_, "pairdist");
+    registerAnalysisDataset(&pairDist_, "binnedpairdist");
     registerBasicDataset(pairCounts_.get(), "paircount");
 
     normFactors_.addModule(normAve_);
@@ -280,10 +290,14 @@ void Rdf::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
         "the volume of a bin is not easily computable.",
         "",
         "Option [TT]-cn[tt] produces the cumulative number RDF,",
-        "i.e. the average number of particles within a distance r."
+        "i.e. the average number of particles within a distance r.",
+        "",
+        "Within each frame, the pair search and the binning of the pair",
+        "distances are divided over the available OpenMP threads."
     };
 
     settings->setHelpText(desc);
+    settings->setFlag(TrajectoryAnalysisSettings::efOnlySelectedAtoms);
 
     options->addOption(FileNameOption("o")
                                .filetype(eftPlot)
@@ -356,7 +370,7 @@ void Rdf::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolog
     pairDist_.setDataSetCount(sel_.size());
     for (size_t i = 0; i < sel_.size(); ++i)
     {
-        pairDist_.setColumnCount(i, 1);
+        pairDist_.setColumnCount(i, 2);
     }
     plotSettings_ = settings.plotSettings();
     nb_.setXYMode(bXY_);
@@ -430,6 +444,53 @@ void Rdf::initAfterFirstFrame(const TrajectoryAnalysisSettings& settings, const
     // We use the double amount of bins, so we can correctly
     // write the rdf and rdf_cn output at i*binwidth values.
     pairCounts_->init(histogramFromRange(0.0, rmax_).binWidth(binwidth_ / 2.0));
+    binCount_ = pairCounts_->settings().binCount();
+    binWidth_ = pairCounts_->settings().binWidth();
+}
+
+//! Number of squared pair distances each thread collects before binning them.
+constexpr int c_distanceBufferSize = 1024;
+//! Minimum number of selection positions per thread in a pair search.
+constexpr int c_positionsPerThread = 64;
+
+/*! \brief
+ * Work buffers for one thread in the pair search of a frame.
+ */
+struct RdfThreadData
+{
+    /*! \brief
+     * Squared pair distances waiting to be binned.
+     *
+     * Padded so that the SIMD binning can load full registers.
+     */
+    std::vector<real, AlignedAllocator<real>> distance2;
+    //! Number of valid entries in `distance2`.
+    int distanceCount = 0;
+    //! Pair counts per bin, with one extra bin for discarded pairs.
+    std::vector<int> counts;
+    /*! \brief
+     * Minimum distance to each surface group.
+     *
+     * One entry for each group (residue/molecule, per -surf) in the
+     * reference selection, empty without -surf.
+     * This is needed to support neighborhood searching, which may not
+     * return the reference positions in order: for each position, we need
+     * to search through all the reference positions and update this array
+     * to find the minimum distance to each surface group, and then compute
+     * the RDF from these numbers.
+     */
+    std::vector<real> surfaceDist2;
+};
+
+/*! \brief
+ * Returns the histogram bin for a squared pair distance.
+ *
+ * Distances with a square not above \p cut2 or that fall beyond the last
+ * bin go to the extra bin \p binCount.
+ */
+inline int pairDistanceBin(real r2, real cut2, real inverseBinWidth, int binCount)
+{
+    return r2 > cut2 ? std::min(static_cast<int>(std::sqrt(r2) * inverseBinWidth), binCount) : binCount;
 }
 
 /*! \brief
@@ -449,23 +510,39 @@ public:
                   int                                surfaceGroupCount) :
         TrajectoryAnalysisModuleData(module, opt, selections)
     {
-        surfaceDist2_.resize(surfaceGroupCount);
+        threadData_.resize(gmx_omp_get_max_threads());
+        for (RdfThreadData& threadData : threadData_)
+        {
+            threadData.surfaceDist2.resize(surfaceGroupCount);
+        }
     }
 
     void finish() override { finishDataHandles(); }
 
     /*! \brief
-     * Minimum distance to each surface group.
-     *
-     * One entry for each group (residue/molecule, per -surf) in the
-     * reference selection.
-     * This is needed to support neighborhood searching, which may not
-     * return the reference positions in order: for each position, we need
-     * to search through all the reference positions and update this array
-     * to find the minimum distance to each surface group, and then compute
-     * the RDF from these numbers.
+     * Adds a squared pair distance, binning the buffer when it is full.
      */
-    std::vector<real> surfaceDist2_;
+    void addDistance(RdfThreadData* threadData, real r2, real cut2, real binWidth, int binCount)
+    {
+        threadData->distance2[threadData->distanceCount++] = r2;
+        if (threadData->distanceCount == c_distanceBufferSize)
+        {
+            binPairDistances(threadData->distance2.data(),
+                             threadData->distanceCount,
+                             cut2,
+                             binWidth,
+                             binCount,
+                             threadData->counts.data());
+            threadData->distanceCount = 0;
+        }
+    }
+
+    //! Work buffers for each thread.
+    std::vector<RdfThreadData> threadData_;
+    //! Positions in the selection, split into contiguous ranges over the threads.
+    std::vector<int> positionIndices_;
+    //! Pair counts summed over the threads.
+    std::vector<int> counts_;
 };
 
 TrajectoryAnalysisModuleDataPointer Rdf::startFrames(const AnalysisDataParallelOptions& opt,
@@ -481,7 +558,7 @@ void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAna
     const Selection&     refSel    = TrajectoryAnalysisModuleData::parallelSelection(refSel_);
     const SelectionList& sel       = TrajectoryAnalysisModuleData::parallelSelections(sel_);
     RdfModuleData&       frameData = *static_cast<RdfModuleData*>(pdata);
-    const bool           bSurface  = !frameData.surfaceDist2_.empty();
+    const bool           bSurface  = !frameData.threadData_[0].surfaceDist2.empty();
 
     matrix boxForVolume;
     copy_mat(fr.box, boxForVolume);
@@ -531,57 +608,106 @@ void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAna
     {
         dh.selectDataSet(g);
 
-        if (bSurface)
+        const int posCount   = sel[g].posCount();
+        const int numThreads = std::max(
+                1, std::min(static_cast<int>(frameData.threadData_.size()), posCount / c_positionsPerThread));
+        std::vector<int>& positionIndices = frameData.positionIndices_;
+        positionIndices.resize(posCount);
+        for (int i = 0; i < posCount; ++i)
         {
-            // Special loop for surface calculation, where a separate neighbor
-            // search is done for each position in the selection, and the
-            // nearest position from each surface group is tracked.
-            std::vector<real>& surfaceDist2 = frameData.surfaceDist2_;
-            for (int i = 0; i < sel[g].posCount(); ++i)
+            positionIndices[i] = i;
+        }
+
+        // Each thread searches the pairs of a contiguous range of selection
+        // positions and bins them into its own histogram.
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (int thread = 0; thread < numThreads; ++thread)
+        {
+            try
             {
-                std::fill(surfaceDist2.begin(), surfaceDist2.end(), std::numeric_limits<real>::max());
-                AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g].position(i));
-                AnalysisNeighborhoodPair       pair;
-                while (pairSearch.findNextPair(&pair))
+                RdfThreadData& threadData = frameData.threadData_[thread];
+                threadData.distance2.resize(c_distanceBufferSize + GMX_REAL_MAX_SIMD_WIDTH);
+                threadData.distanceCount = 0;
+                threadData.counts.assign(binCount_ + 1, 0);
+                const int begin = (posCount * thread) / numThreads;
+                const int end   = (posCount * (thread + 1)) / numThreads;
+
+                if (bSurface)
                 {
-                    const real r2    = pair.distance2();
-                    const int  refId = refSel.position(pair.refIndex()).mappedId();
-                    if (r2 < surfaceDist2[refId])
+                    // Special loop for surface calculation, where a separate neighbor
+                    // search is done for each position in the selection, and the
+                    // nearest position from each surface group is tracked.
+                    std::vector<real>& surfaceDist2 = threadData.surfaceDist2;
+                    for (int i = begin; i < end; ++i)
                     {
-                        surfaceDist2[refId] = r2;
+                        std::fill(surfaceDist2.begin(), surfaceDist2.end(), std::numeric_limits<real>::max());
+                        AnalysisNeighborhoodPairSearch pairSearch =
+                                nbsearch.startPairSearch(sel[g].position(i));
+                        AnalysisNeighborhoodPair pair;
+                        while (pairSearch.findNextPair(&pair))
+                        {
+                            const real r2    = pair.distance2();
+                            const int  refId = refSel.position(pair.refIndex()).mappedId();
+                            if (r2 < surfaceDist2[refId])
+                            {
+                                surfaceDist2[refId] = r2;
+                            }
+                        }
+                        // Accumulate the RDF from the distances to the surface.
+                        for (const real r2 : surfaceDist2)
+                        {
+                            // Here, we need to check for rmax, since the value might
+                            // be above the cutoff if no points were close to some
+                            // surface positions.
+                            if (r2 <= rmax2_)
+                            {
+                                frameData.addDistance(&threadData, r2, cut2_, binWidth_, binCount_);
+                            }
+                        }
                     }
                 }
-                // Accumulate the RDF from the distances to the surface.
-                for (size_t i = 0; i < surfaceDist2.size(); ++i)
+                else if (begin < end)
                 {
-                    const real r2 = surfaceDist2[i];
-                    // Here, we need to check for rmax, since the value might
-                    // be above the cutoff if no points were close to some
-                    // surface positions.
-                    if (r2 > cut2_ && r2 <= rmax2_)
+                    // Standard neighborhood search over all pairs within the cutoff
+                    // for the -surf no case.
+                    AnalysisNeighborhoodPositions positions(sel[g]);
+                    positions.indexed(constArrayRefFromArray(positionIndices.data() + begin, end - begin));
+                    AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(positions);
+                    AnalysisNeighborhoodPair       pair;
+                    while (pairSearch.findNextPair(&pair))
                     {
-                        dh.setPoint(0, std::sqrt(r2));
-                        dh.finishPointSet();
+                        frameData.addDistance(&threadData, pair.distance2(), cut2_, binWidth_, binCount_);
                     }
                 }
+                binPairDistances(threadData.distance2.data(),
+                                 threadData.distanceCount,
+                                 cut2_,
+                                 binWidth_,
+                                 binCount_,
+                                 threadData.counts.data());
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        else
+
+        // Merge the thread histograms and pass the non-empty bins on to
+        // the histogram module, with the bin center as the distance.
+        std::vector<int>& counts = frameData.counts_;
+        counts.assign(binCount_, 0);
+        for (int thread = 0; thread < numThreads; ++thread)
         {
-            // Standard neighborhood search over all pairs within the cutoff
-            // for the -surf no case.
-            AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g]);
-            AnalysisNeighborhoodPair       pair;
-            while (pairSearch.findNextPair(&pair))
+            const std::vector<int>& threadCounts = frameData.threadData_[thread].counts;
+            for (int bin = 0; bin < binCount_; ++bin)
             {
-                const real r2 = pair.distance2();
-                if (r2 > cut2_)
-                {
-                    // TODO: Consider whether the histogramming could be done with
-                    // less overhead (after first measuring the overhead).
-                    dh.setPoint(0, std::sqrt(r2));
-                    dh.finishPointSet();
-                }
+                counts[bin] += threadCounts[bin];
+            }
+        }
+        for (int bin = 0; bin < binCount_; ++bin)
+        {
+            if (counts[bin] > 0)
+            {
+                dh.setPoint(0, (bin + 0.5_real) * binWidth_);
+                dh.setPoint(1, counts[bin]);
+                dh.finishPointSet();
             }
         }
         // Normalization factor for the number density (only used without
@@ -689,6 +815,51 @@ void Rdf::writeOutput() {}
 
 } // namespace
 
+void binPairDistances(const real* distance2,
+                      int         count,
+                      real        cut2,
+                      real        binWidth,
+                      int         binCount,
+                      int*        counts)
+{
+    const real inverseBinWidth = 1.0_real / binWidth;
+    int        i               = 0;
+#if GMX_SIMD_HAVE_REAL
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t bins[GMX_SIMD_REAL_WIDTH];
+    const SimdReal                           cut2S(cut2);
+    const SimdReal                           inverseBinWidthS(inverseBinWidth);
+    const SimdReal                           discardBinS(static_cast<real>(binCount));
+    // Bound on the error of the SIMD square root in units of the position in bins
+    const SimdReal edgeToleranceS(16 * GMX_REAL_EPS);
+    const SimdReal oneS(1.0_real);
+    for (; i + GMX_SIMD_REAL_WIDTH <= count; i += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal r2        = load<SimdReal>(distance2 + i);
+        const SimdBool inRange   = cut2S < r2;
+        const SimdReal position  = min(sqrt(r2) * inverseBinWidthS, discardBinS);
+        const SimdReal fraction  = position - trunc(position);
+        const SimdReal tolerance = edgeToleranceS * max(position, oneS);
+        if (anyTrue(inRange && (fraction < tolerance || oneS - fraction < tolerance)))
+        {
+            for (int j = i; j < i + GMX_SIMD_REAL_WIDTH; ++j)
+            {
+                counts[pairDistanceBin(distance2[j], cut2, inverseBinWidth, binCount)]++;
+            }
+            continue;
+        }
+        store(bins, cvttR2I(blend(discardBinS, position, inRange)));
+        for (int j = 0; j < GMX_SIMD_REAL_WIDTH; ++j)
+        {
+            counts[bins[j]]++;
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        counts[pairDistanceBin(distance2[i], cut2, inverseBinWidth, binCount)]++;
+    }
+}
+
 const char RdfInfo::name[]             = "rdf";
 const char RdfInfo::shortDescription[] = "Calculate radial distribution functions";
 
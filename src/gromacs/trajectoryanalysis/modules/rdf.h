@@ -43,6 +43,7 @@
 #define GMX_TRAJECTORYANALYSIS_MODULES_RDF_H
 
 #include "gromacs/trajectoryanalysis/analysismodule.h"
+#include "gromacs/utility/real.h"
 
 namespace gmx
 {
@@ -58,6 +59,28 @@ public:
     static TrajectoryAnalysisModulePointer create();
 };
 
+/*! \brief
+ * Adds squared pair distances to a histogram of pair distances.
+ *
+ * \param[in]     distance2 Squared pair distances, aligned for SIMD loads.
+ * \param[in]     count     Number of entries in \p distance2.
+ * \param[in]     cut2      Distances with a square not above this are discarded.
+ * \param[in]     binWidth  Width of the histogram bins, the first starting at zero.
+ * \param[in]     binCount  Number of bins in the histogram.
+ * \param[in,out] counts    Pair counts, with one extra bin at \p binCount
+ *     that collects the discarded pairs and those beyond the last bin.
+ *
+ * The SIMD square root is not correctly rounded, so distances that land
+ * very close to a bin edge are binned again with the scalar code. This
+ * keeps the result identical to binning every distance with std::sqrt().
+ */
+void binPairDistances(const real* distance2,
+                      int         count,
+                      real        cut2,
+                      real        binWidth,
+                      int         binCount,
+                      int*        counts);
+
 } // namespace analysismodules
 
 } // namespace gmx
@@ -379,6 +379,7 @@ private:
 
     double solsize_;
     int    ndots_;
+    double nbSkin_;
     // double                  minarea_;
     double dgsDefault_;
     bool   bIncludeSolute_;
@@ -405,6 +406,7 @@ private:
 Sasa::Sasa() :
     solsize_(0.14),
     ndots_(24),
+    nbSkin_(0),
     dgsDefault_(0),
     bIncludeSolute_(true),
     mtop_(nullptr),
@@ -454,7 +456,15 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
         "to keep in mind that the results for volume and density are very",
         "approximate. For example, in ice Ih, one can easily fit water molecules in the",
         "pores which would yield a volume that is too low, and surface area and density",
-        "that are both too high."
+        "that are both too high.[PAR]",
+
+        "The calculation is parallelized over atoms with OpenMP.",
+        "With [TT]-nbskin[tt] > 0, the neighbor list is built with a buffer",
+        "of that size and reused for subsequent frames as long as no atom",
+        "has moved more than half the buffer. This speeds up the analysis",
+        "of trajectories where the atoms move little between frames,",
+        "such as frequently saved frames or structures with restraints.",
+        "The results are the same as without the buffer."
     };
 
     settings->setHelpText(desc);
@@ -506,6 +516,8 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
             DoubleOption("probe").store(&solsize_).description("Radius of the solvent probe (nm)"));
     options->addOption(IntegerOption("ndots").store(&ndots_).description(
             "Number of dots per sphere, more dots means more accuracy"));
+    options->addOption(DoubleOption("nbskin").store(&nbSkin_).description(
+            "Buffer (nm) for reusing the neighbor list between frames (0: search every frame)"));
     // options->addOption(DoubleOption("minarea").store(&minarea_)
     //                       .description("The minimum area (nm^2) to count an atom as a surface atom when writing a position restraint file (see help)"));
     options->addOption(
@@ -651,6 +663,7 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
 
     calculator_.setDotCount(ndots_);
     calculator_.setRadii(radii_);
+    calculator_.setNeighborListSkin(nbSkin_);
 
     // Initialize all the output data objects and initialize the output plotters.
 
@@ -52,11 +52,22 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
-using namespace gmx;
+using gmx::AlignedAllocator;
+using gmx::AnalysisNeighborhood;
+using gmx::AnalysisNeighborhoodPair;
+using gmx::AnalysisNeighborhoodPairSearch;
+using gmx::AnalysisNeighborhoodPositions;
+using gmx::AnalysisNeighborhoodSearch;
+using gmx::ArrayRef;
+using gmx::RVec;
 
 #define UNSP_ICO_DOD 9
 #define UNSP_ICO_ARC 10
@@ -617,7 +628,7 @@ static std::vector<real> make_unsp(int densit, int cubus)
         GMX_RELEASE_ASSERT(false, "Invalid unit sphere mode");
     }
 
-    const int ndot = ssize(xus) / 3;
+    const int ndot = gmx::ssize(xus) / 3;
 
     /* determine distribution of points in elementary cubes */
     if (cubus)
@@ -707,11 +718,270 @@ static std::vector<real> make_unsp(int densit, int cubus)
     return xus;
 }
 
+namespace
+{
+
+#if GMX_SIMD_HAVE_REAL
+//! Width to which the dot arrays are padded for the SIMD burial test.
+constexpr int c_dotPadding = GMX_SIMD_REAL_WIDTH;
+#else
+//! Width to which the dot arrays are padded for the burial test.
+constexpr int c_dotPadding = 1;
+#endif
+
+//! Number of atoms handed to a thread at a time.
+constexpr int c_atomsPerTask = 16;
+
+/*! \brief
+ * Number of calculations done without a neighbor list after a list was
+ * not reused at all.
+ *
+ * Building the list costs more than a plain search, so with atoms moving
+ * more than the skin between calculations, the list is only retried now
+ * and then.
+ */
+constexpr int c_neighborListRetryInterval = 10;
+
+//! How the neighbors are found in a calculation.
+enum class NeighborMode
+{
+    //! Search for the neighbors.
+    Search,
+    //! Search for the neighbors and store them in the list.
+    Build,
+    //! Use the neighbors in the list.
+    Reuse
+};
+
+/*! \internal \brief
+ * Dots on the unit sphere, in the layouts needed by the calculation.
+ */
+struct UnitSphereDots
+{
+    //! Dot coordinates as x,y,z triplets.
+    std::vector<real> xus;
+    //! Number of dots.
+    int count = 0;
+    //! Number of dots padded to a multiple of the SIMD width.
+    int paddedCount = 0;
+    //! X coordinates of the dots, padded with zeros to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> x;
+    //! Y coordinates of the dots, padded with zeros to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> y;
+    //! Z coordinates of the dots, padded with zeros to \p paddedCount.
+    std::vector<real, AlignedAllocator<real>> z;
+};
+
+/*! \internal \brief
+ * Neighbor list that can be reused for several calculations.
+ *
+ * The list is built with the cutoff extended by a skin, and remains valid
+ * as long as no pair of spheres can have come closer than the skin from
+ * outside the list.
+ */
+struct SasaNeighborList
+{
+    //! Whether the list has been built.
+    bool bValid = false;
+    //! PBC type used when building the list.
+    PbcType pbcType = PbcType::No;
+    //! Box used when building the list.
+    matrix box = { { 0 } };
+    //! Atom indices that the list was built for.
+    std::vector<int> index;
+    //! Positions of the atoms in \p index when the list was built.
+    std::vector<RVec> x;
+    //! For each atom, positions in \p index of its potential neighbors.
+    std::vector<std::vector<int>> neighbors;
+    //! Number of calculations that have used the current list.
+    int useCount = 0;
+    //! Number of calculations to still do without a list.
+    int skipCount = 0;
+};
+
+//! Initializes the dot layouts from the x,y,z triplets in \p dots->xus.
+void initUnitSphereDots(UnitSphereDots* dots)
+{
+    dots->count       = gmx::ssize(dots->xus) / 3;
+    dots->paddedCount = ((dots->count + c_dotPadding - 1) / c_dotPadding) * c_dotPadding;
+    dots->x.assign(dots->paddedCount, 0.0_real);
+    dots->y.assign(dots->paddedCount, 0.0_real);
+    dots->z.assign(dots->paddedCount, 0.0_real);
+    for (int j = 0; j < dots->count; ++j)
+    {
+        dots->x[j] = dots->xus[3 * j];
+        dots->y[j] = dots->xus[3 * j + 1];
+        dots->z[j] = dots->xus[3 * j + 2];
+    }
+}
+
+/*! \brief
+ * Marks the dots of a sphere that are buried by a neighboring sphere.
+ *
+ * \param[in]     dots     Unit sphere dots.
+ * \param[in]     dx       Vector from the sphere center to the neighbor.
+ * \param[in]     refdot   A dot with a projection on \p dx larger than this
+ *     is inside the neighbor.
+ * \param[in,out] freeDot  One for each dot that is still free, zero for
+ *     buried dots and for the padding.
+ * \returns The number of dots that became buried.
+ */
+int buryDots(const UnitSphereDots& dots, const rvec dx, real refdot, real* freeDot)
+{
+#if GMX_SIMD_HAVE_REAL
+    using gmx::SimdBool;
+    using gmx::SimdReal;
+
+    const SimdReal dxS(dx[XX]);
+    const SimdReal dyS(dx[YY]);
+    const SimdReal dzS(dx[ZZ]);
+    const SimdReal refdotS(refdot);
+    SimdReal       buriedS = gmx::setZero();
+    for (int j = 0; j < dots.paddedCount; j += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal x       = gmx::load<SimdReal>(dots.x.data() + j);
+        const SimdReal y       = gmx::load<SimdReal>(dots.y.data() + j);
+        const SimdReal z       = gmx::load<SimdReal>(dots.z.data() + j);
+        const SimdBool bBuried = refdotS < fma(dzS, z, fma(dyS, y, dxS * x));
+        const SimdReal free    = gmx::load<SimdReal>(freeDot + j);
+        buriedS                = buriedS + selectByMask(free, bBuried);
+        store(freeDot + j, selectByNotMask(free, bBuried));
+    }
+    // The sum is exact, since it is a sum of small integers.
+    return static_cast<int>(reduce(buriedS));
+#else
+    int buried = 0;
+    for (int j = 0; j < dots.count; ++j)
+    {
+        if (freeDot[j] != 0 && dx[XX] * dots.x[j] + dx[YY] * dots.y[j] + dx[ZZ] * dots.z[j] > refdot)
+        {
+            freeDot[j] = 0;
+            ++buried;
+        }
+    }
+    return buried;
+#endif
+}
+
+//! Returns the number of threads to use for \p nat atoms.
+int sasaThreadCount(int nat)
+{
+    return std::max(1, std::min(gmx_omp_get_max_threads(), nat / c_atomsPerTask));
+}
+
+/*! \brief
+ * Checks whether a neighbor list can still be used for the given atoms.
+ *
+ * The list is valid if it was built for the same atoms with the same PBC,
+ * and twice the largest atom displacement plus the change in the box
+ * vectors is below \p skin.
+ */
+bool neighborListIsValid(const SasaNeighborList& list,
+                         const rvec*             coords,
+                         int                     nat,
+                         const int               index[],
+                         const t_pbc*            pbc,
+                         real                    skin)
+{
+    if (!list.bValid || gmx::ssize(list.index) != nat || !std::equal(index, index + nat, list.index.begin()))
+    {
+        return false;
+    }
+    const PbcType pbcType = (pbc != nullptr ? pbc->pbcType : PbcType::No);
+    if (pbcType != list.pbcType)
+    {
+        return false;
+    }
+    real boxChange = 0.0;
+    if (pbc != nullptr)
+    {
+        for (int d = 0; d < DIM; ++d)
+        {
+            rvec diff;
+            rvec_sub(pbc->box[d], list.box[d], diff);
+            boxChange += norm(diff);
+        }
+    }
+    real maxDisplacement2 = 0.0;
+    for (int i = 0; i < nat; ++i)
+    {
+        maxDisplacement2 = std::max(maxDisplacement2, distance2(coords[index[i]], list.x[i]));
+    }
+    return 2 * std::sqrt(maxDisplacement2) + boxChange < skin;
+}
+
+//! Prepares \p list for storing the neighbors of the given atoms.
+void startNeighborList(const rvec* coords, int nat, const int index[], const t_pbc* pbc, SasaNeighborList* list)
+{
+    list->bValid  = true;
+    list->pbcType = (pbc != nullptr ? pbc->pbcType : PbcType::No);
+    if (pbc != nullptr)
+    {
+        copy_mat(pbc->box, list->box);
+    }
+    list->index.assign(index, index + nat);
+    list->x.resize(nat);
+    for (int i = 0; i < nat; ++i)
+    {
+        list->x[i] = coords[index[i]];
+    }
+    list->neighbors.resize(nat);
+    list->useCount = 0;
+}
+
+/*! \brief
+ * Decides how to find the neighbors, and updates \p list accordingly.
+ *
+ * \p list can be `NULL`, in which case neighbors are always searched.
+ */
+NeighborMode chooseNeighborMode(const rvec*       coords,
+                                int               nat,
+                                const int         index[],
+                                const t_pbc*      pbc,
+                                real              skin,
+                                SasaNeighborList* list)
+{
+    if (list == nullptr)
+    {
+        return NeighborMode::Search;
+    }
+    if (neighborListIsValid(*list, coords, nat, index, pbc, skin))
+    {
+        ++list->useCount;
+        return NeighborMode::Reuse;
+    }
+    if (list->bValid && list->useCount <= 1)
+    {
+        list->skipCount = c_neighborListRetryInterval;
+    }
+    list->bValid = false;
+    if (list->skipCount > 0)
+    {
+        --list->skipCount;
+        return NeighborMode::Search;
+    }
+    startNeighborList(coords, nat, index, pbc, list);
+    ++list->useCount;
+    return NeighborMode::Build;
+}
+
+} // namespace
+
+/*! \brief
+ * Computes the surface area, and optionally the volume and surface dots.
+ *
+ * The atoms are processed in parallel.  The per-atom results are summed in
+ * the order of \p index afterwards, so the results do not depend on the
+ * number of threads.
+ * If \p list is not `NULL`, the neighbors are taken from it while it is
+ * valid, and it is rebuilt with a search using \p nbList (whose cutoff
+ * includes \p skin) when needed.  Otherwise, the neighbors are searched
+ * with \p nb.
+ */
 static void nsc_dclm_pbc(const rvec*                 coords,
                          const ArrayRef<const real>& radius,
                          int                         nat,
-                         const real*                 xus,
-                         int                         n_dot,
+                         const UnitSphereDots&       dots,
                          int                         mode,
                          real*                       value_of_area,
                          real**                      at_area,
@@ -720,8 +990,12 @@ static void nsc_dclm_pbc(const rvec*                 coords,
                          int*                        nu_dots,
                          int                         index[],
                          AnalysisNeighborhood*       nb,
+                         SasaNeighborList*           list,
+                         AnalysisNeighborhood*       nbList,
+                         real                        skin,
                          const t_pbc*                pbc)
 {
+    const int  n_dot   = dots.count;
     const real dotarea = FOURPI / static_cast<real>(n_dot);
 
     if (debug)
@@ -729,29 +1003,10 @@ static void nsc_dclm_pbc(const rvec*                 coords,
         fprintf(debug, "nsc_dclm: n_dot=%5d %9.3f\n", n_dot, dotarea);
     }
 
-    /* start with neighbour list */
-    /* calculate neighbour list with the box algorithm */
     if (nat == 0)
     {
         return;
     }
-    real  area = 0.0, vol = 0.0;
-    real *dots = nullptr, *atom_area = nullptr;
-    int   lfnr = 0, maxdots = 0;
-    if (mode & FLAG_VOLUME)
-    {
-        vol = 0.;
-    }
-    if (mode & FLAG_DOTS)
-    {
-        maxdots = (3 * n_dot * nat) / 10;
-        snew(dots, maxdots);
-        lfnr = 0;
-    }
-    if (mode & FLAG_ATOM_AREA)
-    {
-        snew(atom_area, nat);
-    }
 
     // Compute the center of the molecule for volume calculation.
     // In principle, the center should not influence the results, but that is
@@ -772,94 +1027,152 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     ys /= nat;
     zs /= nat;
 
-    AnalysisNeighborhoodPositions pos(coords, radius.size());
-    pos.indexed(constArrayRefFromArray(index, nat));
-    AnalysisNeighborhoodSearch nbsearch(nb->initSearch(pbc, pos));
+    const NeighborMode neighborMode = chooseNeighborMode(coords, nat, index, pbc, skin, list);
+    AnalysisNeighborhoodSearch nbsearch;
+    if (neighborMode != NeighborMode::Reuse)
+    {
+        AnalysisNeighborhoodPositions pos(coords, radius.size());
+        pos.indexed(gmx::constArrayRefFromArray(index, nat));
+        nbsearch = (neighborMode == NeighborMode::Build ? nbList : nb)->initSearch(pbc, pos);
+    }
 
-    std::vector<int> wkdot(n_dot);
+    const int                                              numThreads = sasaThreadCount(nat);
+    std::vector<std::vector<real, AlignedAllocator<real>>> threadFreeDots(numThreads);
+    std::vector<int>                                       freeDotCount(nat);
+    std::vector<real>              atomVolume((mode & FLAG_VOLUME) ? nat : 0);
+    std::vector<std::vector<real>> atomDots((mode & FLAG_DOTS) ? nat : 0);
 
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic, c_atomsPerTask)
     for (int i = 0; i < nat; ++i)
     {
-        const int                      iat  = index[i];
-        const real                     ai   = radius[iat];
-        const real                     aisq = ai * ai;
-        AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
-        AnalysisNeighborhoodPair       pair;
-        std::fill(wkdot.begin(), wkdot.end(), 1);
-        int currDotCount = n_dot;
-        while (currDotCount > 0 && pairSearch.findNextPair(&pair))
+        try
         {
-            const int  jat = index[pair.refIndex()];
-            const real aj  = radius[jat];
-            const real d2  = pair.distance2();
-            if (iat == jat || d2 > gmx::square(ai + aj))
+            std::vector<real, AlignedAllocator<real>>& freeDot =
+                    threadFreeDots[gmx_omp_get_thread_num()];
+            freeDot.assign(dots.paddedCount, 0.0_real);
+            std::fill(freeDot.begin(), freeDot.begin() + n_dot, 1.0_real);
+
+            const int  iat          = index[i];
+            const real ai           = radius[iat];
+            const real aisq         = ai * ai;
+            int        currDotCount = n_dot;
+            if (neighborMode == NeighborMode::Reuse)
             {
-                continue;
+                for (const int j : list->neighbors[i])
+                {
+                    if (currDotCount == 0)
+                    {
+                        break;
+                    }
+                    const int  jat = index[j];
+                    const real aj  = radius[jat];
+                    rvec       dx;
+                    if (pbc != nullptr)
+                    {
+                        pbc_dx(pbc, coords[jat], coords[iat], dx);
+                    }
+                    else
+                    {
+                        rvec_sub(coords[jat], coords[iat], dx);
+                    }
+                    const real d2 = norm2(dx);
+                    if (d2 > gmx::square(ai + aj))
+                    {
+                        continue;
+                    }
+                    const real refdot = (d2 + aisq - aj * aj) / (2 * ai);
+                    currDotCount -= buryDots(dots, dx, refdot, freeDot.data());
+                }
             }
-            const rvec& dx     = pair.dx();
-            const real  refdot = (d2 + aisq - aj * aj) / (2 * ai);
-            // TODO: Consider whether micro-optimizations from the old
-            // implementation would be useful, compared to the complexity that
-            // they bring: instead of this direct loop, the neighbors were
-            // stored into a temporary array, the loop order was
-            // reversed (first over dots, then over neighbors), and for each
-            // dot, it was first checked whether the same neighbor that
-            // resulted in marking the previous dot covered would also cover
-            // this dot. This presumably plays together with sorting of the
-            // surface dots (done in make_unsp) to avoid some of the looping.
-            // Alternatively, we could keep a skip list here to avoid
-            // repeatedly looping over dots that have already marked as
-            // covered.
-            for (int j = 0; j < n_dot; ++j)
+            else
             {
-                if (wkdot[j] && iprod(&xus[3 * j], dx) > refdot)
+                // When building the list, all neighbors need to be found,
+                // even after all dots are buried.
+                const bool        bBuild    = (neighborMode == NeighborMode::Build);
+                std::vector<int>* neighbors = bBuild ? &list->neighbors[i] : nullptr;
+                if (bBuild)
                 {
-                    --currDotCount;
-                    wkdot[j] = 0;
+                    neighbors->clear();
+                }
+                AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
+                AnalysisNeighborhoodPair       pair;
+                while ((bBuild || currDotCount > 0) && pairSearch.findNextPair(&pair))
+                {
+                    const int  jat = index[pair.refIndex()];
+                    const real aj  = radius[jat];
+                    const real d2  = pair.distance2();
+                    if (iat == jat)
+                    {
+                        continue;
+                    }
+                    if (bBuild && d2 <= gmx::square(ai + aj + skin))
+                    {
+                        neighbors->push_back(pair.refIndex());
+                    }
+                    if (currDotCount == 0 || d2 > gmx::square(ai + aj))
+                    {
+                        continue;
+                    }
+                    const real refdot = (d2 + aisq - aj * aj) / (2 * ai);
+                    currDotCount -= buryDots(dots, pair.dx(), refdot, freeDot.data());
                 }
             }
-        }
+            freeDotCount[i] = currDotCount;
 
-        const real a = aisq * dotarea * currDotCount;
-        area         = area + a;
-        if (mode & FLAG_ATOM_AREA)
-        {
-            atom_area[i] = a;
-        }
-        const real xi = coords[iat][XX];
-        const real yi = coords[iat][YY];
-        const real zi = coords[iat][ZZ];
-        if (mode & FLAG_DOTS)
-        {
-            for (int l = 0; l < n_dot; l++)
+            const real xi = coords[iat][XX];
+            const real yi = coords[iat][YY];
+            const real zi = coords[iat][ZZ];
+            if (mode & FLAG_DOTS)
             {
-                if (wkdot[l])
+                atomDots[i].reserve(3 * currDotCount);
+                for (int l = 0; l < n_dot; l++)
                 {
-                    lfnr++;
-                    if (maxdots <= 3 * lfnr + 1)
+                    if (freeDot[l] != 0)
                     {
-                        maxdots = maxdots + n_dot * 3;
-                        srenew(dots, maxdots);
+                        atomDots[i].push_back(ai * dots.xus[3 * l] + xi);
+                        atomDots[i].push_back(ai * dots.xus[1 + 3 * l] + yi);
+                        atomDots[i].push_back(ai * dots.xus[2 + 3 * l] + zi);
                     }
-                    dots[3 * lfnr - 3] = ai * xus[3 * l] + xi;
-                    dots[3 * lfnr - 2] = ai * xus[1 + 3 * l] + yi;
-                    dots[3 * lfnr - 1] = ai * xus[2 + 3 * l] + zi;
                 }
             }
-        }
-        if (mode & FLAG_VOLUME)
-        {
-            real dx = 0.0, dy = 0.0, dz = 0.0;
-            for (int l = 0; l < n_dot; l++)
+            if (mode & FLAG_VOLUME)
             {
-                if (wkdot[l])
+                real dx = 0.0, dy = 0.0, dz = 0.0;
+                for (int l = 0; l < n_dot; l++)
                 {
-                    dx = dx + xus[3 * l];
-                    dy = dy + xus[1 + 3 * l];
-                    dz = dz + xus[2 + 3 * l];
+                    if (freeDot[l] != 0)
+                    {
+                        dx = dx + dots.xus[3 * l];
+                        dy = dy + dots.xus[1 + 3 * l];
+                        dz = dz + dots.xus[2 + 3 * l];
+                    }
                 }
+                atomVolume[i] = aisq
+                                * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs)
+                                   + ai * currDotCount);
             }
-            vol = vol + aisq * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs) + ai * currDotCount);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    real  area = 0.0, vol = 0.0;
+    real* atom_area = nullptr;
+    if (mode & FLAG_ATOM_AREA)
+    {
+        snew(atom_area, nat);
+    }
+    for (int i = 0; i < nat; ++i)
+    {
+        const real ai = radius[index[i]];
+        const real a  = ai * ai * dotarea * freeDotCount[i];
+        area          = area + a;
+        if (mode & FLAG_ATOM_AREA)
+        {
+            atom_area[i] = a;
+        }
+        if (mode & FLAG_VOLUME)
+        {
+            vol = vol + atomVolume[i];
         }
     }
 
@@ -869,10 +1182,22 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     }
     if (mode & FLAG_DOTS)
     {
+        int lfnr = 0;
+        for (int i = 0; i < nat; ++i)
+        {
+            lfnr += freeDotCount[i];
+        }
+        real* dotsOut = nullptr;
+        snew(dotsOut, std::max(3 * lfnr, 1));
+        real* dotPtr = dotsOut;
+        for (int i = 0; i < nat; ++i)
+        {
+            dotPtr = std::copy(atomDots[i].begin(), atomDots[i].end(), dotPtr);
+        }
         GMX_RELEASE_ASSERT(nu_dots != nullptr, "Must have valid nu_dots pointer");
         *nu_dots = lfnr;
         GMX_RELEASE_ASSERT(lidots != nullptr, "Must have valid lidots pointer");
-        *lidots = dots;
+        *lidots = dotsOut;
     }
     if (mode & FLAG_ATOM_AREA)
     {
@@ -893,12 +1218,24 @@ namespace gmx
 class SurfaceAreaCalculator::Impl
 {
 public:
-    Impl() : flags_(0) {}
+    Impl() : flags_(0), maxRadius_(0.0), skin_(0.0) {}
 
-    std::vector<real>            unitSphereDots_;
+    //! Sets the cutoffs of the neighborhood searches from the radii and the skin.
+    void updateCutoffs()
+    {
+        nb_.setCutoff(2 * maxRadius_);
+        nbList_.setCutoff(2 * maxRadius_ + skin_);
+        list_.bValid = false;
+    }
+
+    UnitSphereDots               unitSphereDots_;
     ArrayRef<const real>         radius_;
     int                          flags_;
+    real                         maxRadius_;
+    real                         skin_;
     mutable AnalysisNeighborhood nb_;
+    mutable AnalysisNeighborhood nbList_;
+    mutable SasaNeighborList     list_;
 };
 
 SurfaceAreaCalculator::SurfaceAreaCalculator() : impl_(new Impl()) {}
@@ -907,7 +1244,8 @@ SurfaceAreaCalculator::~SurfaceAreaCalculator() {}
 
 void SurfaceAreaCalculator::setDotCount(int dotCount)
 {
-    impl_->unitSphereDots_ = make_unsp(dotCount, 4);
+    impl_->unitSphereDots_.xus = make_unsp(dotCount, 4);
+    initUnitSphereDots(&impl_->unitSphereDots_);
 }
 
 void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
@@ -915,11 +1253,17 @@ void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
     impl_->radius_ = radius;
     if (!radius.empty())
     {
-        const real maxRadius = *std::max_element(radius.begin(), radius.end());
-        impl_->nb_.setCutoff(2 * maxRadius);
+        impl_->maxRadius_ = *std::max_element(radius.begin(), radius.end());
+        impl_->updateCutoffs();
     }
 }
 
+void SurfaceAreaCalculator::setNeighborListSkin(real skin)
+{
+    impl_->skin_ = std::max(skin, 0.0_real);
+    impl_->updateCutoffs();
+}
+
 void SurfaceAreaCalculator::setCalculateVolume(bool bVolume)
 {
     if (bVolume)
@@ -1004,8 +1348,7 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
     nsc_dclm_pbc(x,
                  impl_->radius_,
                  nat,
-                 &impl_->unitSphereDots_[0],
-                 impl_->unitSphereDots_.size() / 3,
+                 impl_->unitSphereDots_,
                  flags,
                  area,
                  at_area,
@@ -1014,6 +1357,9 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
                  n_dots,
                  index,
                  &impl_->nb_,
+                 impl_->skin_ > 0 ? &impl_->list_ : nullptr,
+                 &impl_->nbList_,
+                 impl_->skin_,
                  pbc);
 }
 
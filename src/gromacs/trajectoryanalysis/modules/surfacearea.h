@@ -72,6 +72,9 @@ namespace gmx
  * original documentation of the method, a density of 600-700 dots gives an
  * accuracy of 1.5 A^2 per atom.
  *
+ * The atoms are processed in parallel using OpenMP, and the dot burial test
+ * uses SIMD.  The results do not depend on the number of threads.
+ *
  * \ingroup module_trajectoryanalysis
  */
 class SurfaceAreaCalculator
@@ -106,6 +109,22 @@ public:
      * Does not throw.
      */
     void setRadii(const ArrayRef<const real>& radius);
+    /*! \brief
+     * Sets a skin for reusing the neighbor list between calculations.
+     *
+     * \param[in]  skin  Buffer added to the neighbor list cutoff
+     *     (zero, the default, disables reuse).
+     *
+     * With a positive skin, the neighbor list built in calculate() is kept
+     * and reused by subsequent calls for the same set of atoms, until the
+     * atoms (and the box) have moved enough that a pair outside the list
+     * could be in contact.  This then makes calculate() unsafe to call
+     * concurrently from multiple threads.
+     * Like setRadii(), this cannot be called after calculate().
+     *
+     * Does not throw.
+     */
+    void setNeighborListSkin(real skin);
 
     /*! \brief
      * Requests calculation of volume.
@@ -47,8 +47,11 @@
 #include <cstring>
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "gromacs/coordinateio/trajectoryframereader.h"
 #include "gromacs/fileio/oenv.h"
 #include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/trxio.h"
@@ -61,6 +64,7 @@
 #include "gromacs/selection/selectioncollection.h"
 #include "gromacs/selection/selectionoption.h"
 #include "gromacs/selection/selectionoptionbehavior.h"
+#include "gromacs/topology/mtop_lookup.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
@@ -89,6 +93,12 @@ public:
     void initFirstFrame();
     void initFrameIndexGroup();
     void finishTrajectory();
+    /*! \brief
+     * Makes \p fr point to the next frame from the trajectory.
+     *
+     * \returns false if there were no more frames.
+     */
+    bool loadNextFrame();
 
     // From ITopologyProvider
     gmx_mtop_t* getTopology(bool required) override
@@ -129,12 +139,21 @@ public:
     bool        bDeltaTimeSet_;
 
     bool bTrajOpen_;
-    //! The current frame, or \p NULL if no frame loaded yet.
+    /*! \brief
+     * The current frame, or \p NULL if no frame loaded yet.
+     *
+     * Points to the frame owned by \p reader_, or to \p topologyFrame_
+     * when there is no trajectory.
+     */
     t_trxframe* fr;
-    gmx_rmpbc_t gpbc_;
-    //! Used to store the status variable from read_first_frame().
-    t_trxstatus*      status_;
-    gmx_output_env_t* oenv_;
+    //! Frame prepared from the topology coordinates, or \p NULL.
+    t_trxframe* topologyFrame_;
+    //! Atoms contained in the trajectory frames with -fgroup.
+    std::vector<int> frameIndex_;
+    gmx_rmpbc_t      gpbc_;
+    //! Reads the trajectory, one frame ahead of the analysis.
+    std::unique_ptr<TrajectoryFrameReader> reader_;
+    gmx_output_env_t*                      oenv_;
 };
 
 
@@ -148,8 +167,8 @@ TrajectoryAnalysisRunnerCommon::Impl::Impl(TrajectoryAnalysisSettings* settings)
     bDeltaTimeSet_(false),
     bTrajOpen_(false),
     fr(nullptr),
+    topologyFrame_(nullptr),
     gpbc_(nullptr),
-    status_(nullptr),
     oenv_(nullptr)
 {
 }
@@ -158,14 +177,12 @@ TrajectoryAnalysisRunnerCommon::Impl::Impl(TrajectoryAnalysisSettings* settings)
 TrajectoryAnalysisRunnerCommon::Impl::~Impl()
 {
     finishTrajectory();
-    if (fr != nullptr)
+    if (topologyFrame_ != nullptr)
     {
         // There doesn't seem to be a function for freeing frame data
-        sfree(fr->x);
-        sfree(fr->v);
-        sfree(fr->f);
-        sfree(fr->index);
-        sfree(fr);
+        sfree(topologyFrame_->x);
+        sfree(topologyFrame_->v);
+        sfree(topologyFrame_);
     }
     if (oenv_ != nullptr)
     {
@@ -213,15 +230,11 @@ void TrajectoryAnalysisRunnerCommon::Impl::initFirstFrame()
     int frflags = settings_.frflags();
     frflags |= TRX_NEED_X;
 
-    snew(fr, 1);
-
     if (hasTrajectory())
     {
-        if (!read_first_frame(oenv_, &status_, trjfile_.c_str(), fr, frflags))
-        {
-            GMX_THROW(FileIOError("Could not read coordinates from trajectory"));
-        }
+        reader_    = std::make_unique<TrajectoryFrameReader>(trjfile_, frflags, 1, oenv_);
         bTrajOpen_ = true;
+        loadNextFrame();
 
         if (topInfo_.hasTopology())
         {
@@ -243,6 +256,8 @@ void TrajectoryAnalysisRunnerCommon::Impl::initFirstFrame()
         {
             GMX_THROW(InvalidInputError("Forces cannot be read from a topology"));
         }
+        snew(topologyFrame_, 1);
+        fr         = topologyFrame_;
         fr->natoms = topInfo_.mtop()->natoms;
         fr->bX     = TRUE;
         snew(fr->x, fr->natoms);
@@ -260,9 +275,9 @@ void TrajectoryAnalysisRunnerCommon::Impl::initFirstFrame()
         }
         fr->bBox = TRUE;
         copy_mat(topInfo_.boxtop_, fr->box);
+        setTrxFramePbcType(fr, topInfo_.pbcType());
     }
 
-    setTrxFramePbcType(fr, topInfo_.pbcType());
     if (topInfo_.hasTopology() && settings_.hasRmPBC())
     {
         gpbc_ = gmx_rmpbc_init(topInfo_);
@@ -285,18 +300,16 @@ void TrajectoryAnalysisRunnerCommon::Impl::initFrameIndexGroup()
                 fr->natoms);
         GMX_THROW(InconsistentInputError(message));
     }
+    frameIndex_.assign(trajectoryGroup_.atomIndices().begin(), trajectoryGroup_.atomIndices().end());
     fr->bIndex = TRUE;
-    snew(fr->index, trajectoryGroup_.atomCount());
-    std::copy(trajectoryGroup_.atomIndices().begin(), trajectoryGroup_.atomIndices().end(), fr->index);
+    fr->index  = frameIndex_.data();
 }
 
 void TrajectoryAnalysisRunnerCommon::Impl::finishTrajectory()
 {
-    if (bTrajOpen_)
-    {
-        close_trx(status_);
-        bTrajOpen_ = false;
-    }
+    // The reader is kept until the runner is destroyed, because it owns
+    // the last frame.
+    bTrajOpen_ = false;
     if (gpbc_ != nullptr)
     {
         gmx_rmpbc_done(gpbc_);
@@ -304,6 +317,25 @@ void TrajectoryAnalysisRunnerCommon::Impl::finishTrajectory()
     }
 }
 
+bool TrajectoryAnalysisRunnerCommon::Impl::loadNextFrame()
+{
+    t_trxframe* next = bTrajOpen_ ? reader_->readNextFrame() : nullptr;
+    if (next == nullptr)
+    {
+        return false;
+    }
+    // The frame is analyzed in place, so the index group and PBC type
+    // that the reader does not know about are set for every frame.
+    fr = next;
+    if (!frameIndex_.empty())
+    {
+        fr->bIndex = TRUE;
+        fr->index  = frameIndex_.data();
+    }
+    setTrxFramePbcType(fr, topInfo_.pbcType());
+    return true;
+}
+
 /*********************************************************************
  * TrajectoryAnalysisRunnerCommon
  */
@@ -438,12 +470,44 @@ void TrajectoryAnalysisRunnerCommon::initFrameIndexGroup()
 }
 
 
+void TrajectoryAnalysisRunnerCommon::initRequiredAtoms(const SelectionCollection& selections)
+{
+    Impl& impl = *impl_;
+    // With -fgroup, the atoms in the frame are not the leading atoms of the system.
+    if (!impl.settings_.hasFlag(TrajectoryAnalysisSettings::efOnlySelectedAtoms) || !impl.bTrajOpen_
+        || impl.fr->bIndex)
+    {
+        return;
+    }
+    int natoms = selections.requiredAtomCount();
+    if (natoms == 0 || natoms >= impl.fr->natoms)
+    {
+        return;
+    }
+    if (impl.gpbc_ != nullptr)
+    {
+        // Molecules are made whole, so the molecule containing the last
+        // required atom needs to be complete.
+        const gmx_mtop_t* mtop          = impl.topInfo_.mtop();
+        int               moleculeBlock = 0;
+        int               moleculeIndex = 0;
+        mtopGetMolblockIndex(mtop, natoms - 1, &moleculeBlock, &moleculeIndex, nullptr);
+        const MoleculeBlockIndices& block = mtop->moleculeBlockIndices[moleculeBlock];
+        natoms = block.globalAtomStart + (moleculeIndex + 1) * block.numAtomsPerMolecule;
+    }
+    if (natoms < impl.fr->natoms)
+    {
+        impl.reader_->setNumAtomsToRead(natoms);
+    }
+}
+
+
 bool TrajectoryAnalysisRunnerCommon::readNextFrame()
 {
     bool bContinue = false;
     if (hasTrajectory())
     {
-        bContinue = read_next_frame(impl_->oenv_, impl_->status_, impl_->fr);
+        bContinue = impl_->loadNextFrame();
     }
     if (!bContinue)
     {
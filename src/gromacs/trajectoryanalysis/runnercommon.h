@@ -104,12 +104,28 @@ public:
      * Can be called after selections have been compiled.
      */
     void initFrameIndexGroup();
+    /*! \brief
+     * Limits the atoms read from subsequent frames to those required.
+     *
+     * \param[in] selections  Compiled selections used by the module.
+     *
+     * Only has an effect if the module has specified
+     * TrajectoryAnalysisSettings::efOnlySelectedAtoms, and only for
+     * trajectory formats that support reading partial frames.
+     * Should be called after initFrameIndexGroup() and before the first
+     * call to initFrame().
+     */
+    void initRequiredAtoms(const SelectionCollection& selections);
     /*! \brief
      * Reads the next frame from the trajectory.
      *
      * \returns false if there were no more frames.
      *
      * After this call, frame() returns the newly loaded frame.
+     * If there were no more frames, frame() still returns the last frame.
+     * The next frame is read in a background thread while the current one
+     * is analyzed, such that I/O and decompression overlap with the
+     * analysis. The frames are still analyzed one at a time, in order.
      */
     bool readNextFrame();
     /*! \brief
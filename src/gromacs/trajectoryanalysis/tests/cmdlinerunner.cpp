@@ -43,6 +43,8 @@
 
 #include "gromacs/trajectoryanalysis/cmdlinerunner.h"
 
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -50,6 +52,8 @@
 #include "gromacs/commandline/cmdlineoptionsmodule.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionoption.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysismodule.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
@@ -58,6 +62,7 @@
 
 #include "testutils/cmdlinetest.h"
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 namespace
 {
@@ -95,6 +100,68 @@ public:
         ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleDirect(createRunner(), &cmdline));
     }
 
+    /*! \brief
+     * Runs a module that selects \p selection from freevolume-rotated.xtc.
+     *
+     * The trajectory has the frame of freevolume.xtc and two rotated
+     * copies of it. When \p onlySelectedAtoms is set, the module lets the
+     * runner read only the atoms that the selection needs after the first
+     * frame. \p numAtomsRead is set to the number of atoms in the last
+     * analyzed frame.
+     *
+     * \returns The selected positions in all frames.
+     */
+    std::vector<gmx::RVec> runSelectionModule(const char*        selection,
+                                              bool               onlySelectedAtoms,
+                                              const CommandLine& args,
+                                              int*               numAtomsRead)
+    {
+        using ::testing::_;
+        using ::testing::Invoke;
+
+        gmx::Selection         sel;
+        std::vector<gmx::RVec> positions;
+        auto                   module = std::make_unique<MockModule>();
+        auto initSelectionOptions = [&sel, onlySelectedAtoms](
+                                            gmx::IOptionsContainer*          options,
+                                            gmx::TrajectoryAnalysisSettings* settings) {
+            options->addOption(gmx::SelectionOption("sel").store(&sel).required());
+            if (onlySelectedAtoms)
+            {
+                settings->setFlag(gmx::TrajectoryAnalysisSettings::efOnlySelectedAtoms);
+            }
+        };
+        EXPECT_CALL(*module, initOptions(_, _)).WillOnce(Invoke(initSelectionOptions));
+        EXPECT_CALL(*module, initAnalysis(_, _));
+        EXPECT_CALL(*module, analyzeFrame(_, _, _, _))
+                .Times(3)
+                .WillRepeatedly(Invoke([&sel, &positions, numAtomsRead](
+                                               int /*frnr*/,
+                                               const t_trxframe& fr,
+                                               t_pbc* /*pbc*/,
+                                               gmx::TrajectoryAnalysisModuleData* /*pdata*/) {
+                    *numAtomsRead = fr.natoms;
+                    for (const rvec& x : sel.coordinates())
+                    {
+                        positions.emplace_back(x);
+                    }
+                }));
+        EXPECT_CALL(*module, finishAnalysis(_));
+        EXPECT_CALL(*module, writeOutput());
+
+        CommandLine cmdline;
+        cmdline.append("module");
+        cmdline.addOption("-s", fileManager().getInputFilePath("freevolume.tpr"));
+        cmdline.addOption("-f", fileManager().getInputFilePath("freevolume-rotated.xtc"));
+        cmdline.addOption("-sel", selection);
+        cmdline.merge(args);
+        EXPECT_EQ(0,
+                  gmx::test::CommandLineTestHelper::runModuleDirect(
+                          gmx::TrajectoryAnalysisCommandLineRunner::createModule(std::move(module)),
+                          &cmdline));
+        return positions;
+    }
+
     std::unique_ptr<MockModule> mockModule_;
 };
 
@@ -159,4 +226,88 @@ TEST_F(TrajectoryAnalysisCommandLineRunnerTest, FailsWithTrajectorySubsetWithout
     EXPECT_THROW_GMX(runTest(CommandLine(cmdline)), gmx::InconsistentInputError);
 }
 
+TEST_F(TrajectoryAnalysisCommandLineRunnerTest, AnalyzesAllFramesInOrder)
+{
+    std::vector<int64_t> steps;
+
+    using ::testing::_;
+    using ::testing::AnyNumber;
+    using ::testing::Invoke;
+    EXPECT_CALL(*mockModule_, initOptions(_, _));
+    EXPECT_CALL(*mockModule_, initAnalysis(_, _));
+    EXPECT_CALL(*mockModule_, analyzeFrame(_, _, _, _))
+            .Times(AnyNumber())
+            .WillRepeatedly(Invoke([&steps](int               frnr,
+                                            const t_trxframe& fr,
+                                            t_pbc* /*pbc*/,
+                                            gmx::TrajectoryAnalysisModuleData* /*pdata*/) {
+                EXPECT_EQ(static_cast<int>(steps.size()), frnr);
+                steps.push_back(fr.step);
+            }));
+    EXPECT_CALL(*mockModule_, finishAnalysis(_)).WillOnce(Invoke([&steps](int nframes) {
+        EXPECT_EQ(static_cast<int>(steps.size()), nframes);
+    }));
+    EXPECT_CALL(*mockModule_, writeOutput());
+
+    setInputFile("-f", "extract_cluster.trr");
+    EXPECT_NO_THROW_GMX(runTest(CommandLine()));
+
+    // The frames are read ahead in the background, but must still be
+    // analyzed in order.
+    ASSERT_GT(steps.size(), 2U);
+    for (size_t i = 1; i < steps.size(); ++i)
+    {
+        EXPECT_LT(steps[i - 1], steps[i]);
+    }
+}
+
+//! Checks that reading only the selected atoms gives the positions of a full read
+void checkOnlySelectedAtomsMatchesFullRead(const std::vector<gmx::RVec>& fullPositions,
+                                           int                           fullNumAtoms,
+                                           const std::vector<gmx::RVec>& partialPositions,
+                                           int                           partialNumAtoms)
+{
+    EXPECT_LT(partialNumAtoms, fullNumAtoms);
+    ASSERT_FALSE(fullPositions.empty());
+    ASSERT_EQ(fullPositions.size(), partialPositions.size());
+    for (size_t i = 0; i < fullPositions.size(); ++i)
+    {
+        for (int d = 0; d < DIM; ++d)
+        {
+            EXPECT_REAL_EQ(fullPositions[i][d], partialPositions[i][d]) << "position " << i;
+        }
+    }
+}
+
+TEST_F(TrajectoryAnalysisCommandLineRunnerTest, ReadsOnlySelectedAtomsLikeFullRead)
+{
+    // Atoms 100 to 110 are in the middle of the sixth emim molecule,
+    // which has atoms 96 to 114
+    const char* const selection = "atomnr 3 8 to 10 100 to 110";
+    const char* const cmdline[] = { "-normpbc" };
+
+    int  fullNumAtoms    = 0;
+    int  partialNumAtoms = 0;
+    auto fullPositions = runSelectionModule(selection, false, CommandLine(cmdline), &fullNumAtoms);
+    auto partialPositions =
+            runSelectionModule(selection, true, CommandLine(cmdline), &partialNumAtoms);
+    checkOnlySelectedAtomsMatchesFullRead(
+            fullPositions, fullNumAtoms, partialPositions, partialNumAtoms);
+    EXPECT_EQ(110, partialNumAtoms);
+}
+
+TEST_F(TrajectoryAnalysisCommandLineRunnerTest, ReadsOnlySelectedAtomsOfWholeMolecules)
+{
+    const char* const selection = "atomnr 3 8 to 10 100 to 110";
+
+    int  fullNumAtoms    = 0;
+    int  partialNumAtoms = 0;
+    auto fullPositions    = runSelectionModule(selection, false, CommandLine(), &fullNumAtoms);
+    auto partialPositions = runSelectionModule(selection, true, CommandLine(), &partialNumAtoms);
+    checkOnlySelectedAtomsMatchesFullRead(
+            fullPositions, fullNumAtoms, partialPositions, partialNumAtoms);
+    // Molecules are made whole, so the whole molecule of atom 110 is read
+    EXPECT_EQ(114, partialNumAtoms);
+}
+
 } // namespace
@@ -51,8 +51,17 @@
 
 #include "gromacs/trajectoryanalysis/modules/rdf.h"
 
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/math/functions.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/gmxomp.h"
+
 #include "testutils/cmdlinetest.h"
 #include "testutils/testasserts.h"
 #include "testutils/textblockmatchers.h"
@@ -65,6 +74,25 @@ namespace
 using gmx::test::CommandLine;
 using gmx::test::NoTextMatch;
 
+/*! \brief
+ * Sets the number of OpenMP threads for the lifetime of the object.
+ *
+ * Without OpenMP, the module runs on one thread regardless.
+ */
+class ScopedOpenMPThreadCount
+{
+public:
+    //! Sets the number of threads to \p numThreads.
+    explicit ScopedOpenMPThreadCount(int numThreads) : oldNumThreads_(gmx_omp_get_max_threads())
+    {
+        gmx_omp_set_num_threads(numThreads);
+    }
+    ~ScopedOpenMPThreadCount() { gmx_omp_set_num_threads(oldNumThreads_); }
+
+private:
+    int oldNumThreads_;
+};
+
 /********************************************************************
  * Tests for gmx::analysismodules::Rdf.
  */
@@ -78,7 +106,20 @@ TEST_F(RdfModuleTest, BasicTest)
                                     "name OW", "-sel", "name OW", "not name OW" };
     setTopology("spc216.gro");
     setOutputFile("-o", ".xvg", NoTextMatch());
-    excludeDataset("pairdist");
+    excludeDataset("binnedpairdist");
+    runTest(CommandLine(cmdline));
+}
+
+// The selections of 216 positions are split over three threads, each of
+// which bins its own pairs. The pair counts must be identical to BasicTest.
+TEST_F(RdfModuleTest, BasicTestWithMultipleThreads)
+{
+    const char* const cmdline[] = { "rdf",     "-bin", "0.05",    "-ref",
+                                    "name OW", "-sel", "name OW", "not name OW" };
+    setTopology("spc216.gro");
+    setOutputFile("-o", ".xvg", NoTextMatch());
+    excludeDataset("binnedpairdist");
+    ScopedOpenMPThreadCount threadCount(4);
     runTest(CommandLine(cmdline));
 }
 
@@ -98,7 +139,7 @@ TEST_F(RdfModuleTest, SelectionsSolelyFromIndexFileWork)
     setTrajectory("spc216.gro");
     setInputFile("-n", "index.ndx");
     setOutputFile("-o", ".xvg", NoTextMatch());
-    excludeDataset("pairdist");
+    excludeDataset("binnedpairdist");
     runTest(CommandLine(cmdline));
 }
 
@@ -118,7 +159,7 @@ TEST_F(RdfModuleTest, SelectionsFromBothTopologyFileAndIndexFileWork)
     setTopology("spc216.gro");
     setInputFile("-n", "index.ndx");
     setOutputFile("-o", ".xvg", NoTextMatch());
-    excludeDataset("pairdist");
+    excludeDataset("binnedpairdist");
     runTest(CommandLine(cmdline));
 }
 
@@ -136,7 +177,26 @@ TEST_F(RdfModuleTest, CalculatesSurf)
                                     "not name OW" };
     setTopology("spc216.gro");
     setOutputFile("-o", ".xvg", NoTextMatch());
-    excludeDataset("pairdist");
+    excludeDataset("binnedpairdist");
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(RdfModuleTest, CalculatesSurfWithMultipleThreads)
+{
+    const char* const cmdline[] = { "rdf",
+                                    "-bin",
+                                    "0.05",
+                                    "-surf",
+                                    "res",
+                                    "-ref",
+                                    "within 0.5 of (resnr 1 and name OW)",
+                                    "-sel",
+                                    "name OW",
+                                    "not name OW" };
+    setTopology("spc216.gro");
+    setOutputFile("-o", ".xvg", NoTextMatch());
+    excludeDataset("binnedpairdist");
+    ScopedOpenMPThreadCount threadCount(4);
     runTest(CommandLine(cmdline));
 }
 
@@ -146,7 +206,7 @@ TEST_F(RdfModuleTest, CalculatesXY)
                                     "name OW", "-sel", "name OW", "not name OW" };
     setTopology("spc216.gro");
     setOutputFile("-o", ".xvg", NoTextMatch());
-    excludeDataset("pairdist");
+    excludeDataset("binnedpairdist");
     // TODO: Consider if it is possible to get a more reproducible result
     // and/or a stricter tolerance (e.g., by checking that the sum of
     // neighboring values still stays constant).
@@ -154,4 +214,73 @@ TEST_F(RdfModuleTest, CalculatesXY)
     runTest(CommandLine(cmdline));
 }
 
+/********************************************************************
+ * Tests for gmx::analysismodules::binPairDistances().
+ */
+
+//! Buffer type that binPairDistances() can load with SIMD.
+using DistanceBuffer = std::vector<real, gmx::AlignedAllocator<real>>;
+
+//! Bins squared pair distances one by one with std::sqrt().
+std::vector<int> binPairDistancesReference(const DistanceBuffer& distance2,
+                                           real                  cut2,
+                                           real                  binWidth,
+                                           int                   binCount)
+{
+    std::vector<int> counts(binCount + 1, 0);
+    for (const real r2 : distance2)
+    {
+        int bin = binCount;
+        if (r2 > cut2)
+        {
+            bin = std::min(static_cast<int>(std::sqrt(r2) * (1.0_real / binWidth)), binCount);
+        }
+        counts[bin]++;
+    }
+    return counts;
+}
+
+TEST(RdfBinPairDistancesTest, MatchesScalarBinningAtBinEdges)
+{
+    const real binWidth = 0.001;
+    const int  binCount = 1000;
+    const real cut2     = gmx::square(0.1_real);
+
+    // Squared distances at each bin edge and one ulp on either side,
+    // at the cutoff and beyond the last bin. The count is not a multiple
+    // of the SIMD width, so the scalar remainder loop is covered as well.
+    DistanceBuffer distance2;
+    for (int edge = 0; edge <= binCount + 1; edge++)
+    {
+        const real r2 = gmx::square(edge * binWidth);
+        distance2.push_back(std::nextafter(r2, 0.0_real));
+        distance2.push_back(r2);
+        distance2.push_back(std::nextafter(r2, GMX_REAL_MAX));
+    }
+    distance2.push_back(std::nextafter(cut2, 0.0_real));
+    distance2.push_back(cut2);
+    distance2.push_back(std::nextafter(cut2, GMX_REAL_MAX));
+    distance2.push_back(gmx::square(2.0_real));
+
+    std::vector<int> counts(binCount + 1, 0);
+    gmx::analysismodules::binPairDistances(
+            distance2.data(), distance2.size(), cut2, binWidth, binCount, counts.data());
+
+    EXPECT_EQ(binPairDistancesReference(distance2, cut2, binWidth, binCount), counts);
+}
+
+TEST(RdfBinPairDistancesTest, AddsToExistingCounts)
+{
+    const real binWidth = 0.1;
+    const int  binCount = 4;
+
+    DistanceBuffer   distance2 = { 0.0025, 0.0225, 0.0225, 0.25, 1.0 };
+    std::vector<int> counts    = { 1, 2, 3, 4, 5 };
+    gmx::analysismodules::binPairDistances(
+            distance2.data(), distance2.size(), 0.0, binWidth, binCount, counts.data());
+
+    const std::vector<int> expected = { 2, 4, 3, 4, 7 };
+    EXPECT_EQ(expected, counts);
+}
+
 } // namespace
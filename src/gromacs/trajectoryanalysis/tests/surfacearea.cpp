@@ -131,7 +131,24 @@ public:
         }
     }
 
-    void calculate(int ndots, int flags, bool bPBC)
+    void perturbPoints(real maxShift)
+    {
+        gmx::UniformRealDistribution<real> dist(-maxShift, maxShift);
+        for (size_t i = 0; i < x_.size(); ++i)
+        {
+            x_[i][XX] += dist(rng_);
+            x_[i][YY] += dist(rng_);
+            x_[i][ZZ] += dist(rng_);
+        }
+    }
+
+    void initCalculator(gmx::SurfaceAreaCalculator* calculator, int ndots)
+    {
+        calculator->setDotCount(ndots);
+        calculator->setRadii(radius_);
+    }
+
+    void calculate(int ndots, int flags, bool bPBC, gmx::SurfaceAreaCalculator* calculator = nullptr)
     {
         volume_ = 0.0;
         sfree(atomArea_);
@@ -144,23 +161,27 @@ public:
         {
             set_pbc(&pbc, PbcType::Xyz, box_);
         }
-        gmx::SurfaceAreaCalculator calculator;
-        calculator.setDotCount(ndots);
-        calculator.setRadii(radius_);
-        calculator.calculate(as_rvec_array(x_.data()),
-                             bPBC ? &pbc : nullptr,
-                             index_.size(),
-                             index_.data(),
-                             flags,
-                             &area_,
-                             &volume_,
-                             &atomArea_,
-                             &dots_,
-                             &dotCount_);
+        gmx::SurfaceAreaCalculator localCalculator;
+        if (calculator == nullptr)
+        {
+            calculator = &localCalculator;
+            initCalculator(calculator, ndots);
+        }
+        calculator->calculate(as_rvec_array(x_.data()),
+                              bPBC ? &pbc : nullptr,
+                              index_.size(),
+                              index_.data(),
+                              flags,
+                              &area_,
+                              &volume_,
+                              &atomArea_,
+                              &dots_,
+                              &dotCount_);
     }
     real resultArea() const { return area_; }
     real resultVolume() const { return volume_; }
     real atomArea(int index) const { return atomArea_[index]; }
+    int  atomCount() const { return index_.size(); }
 
     void checkReference(gmx::test::TestReferenceChecker* checker, const char* id, bool checkDotCoordinates)
     {
@@ -371,4 +392,37 @@ TEST_F(SurfaceAreaTest, Computes100PointsWithTriclinicPBC)
     checkReference(&checker, "100Points", false);
 }
 
+TEST_F(SurfaceAreaTest, ReusesNeighborListWithSkin)
+{
+    gmx::test::FloatingPointTolerance tolerance(gmx::test::defaultRealTolerance());
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    gmx::SurfaceAreaCalculator calculator;
+    calculator.setNeighborListSkin(0.5);
+    initCalculator(&calculator, 24);
+    const int flags = FLAG_ATOM_AREA | FLAG_VOLUME;
+    // The points move enough that the list is both reused and rebuilt.
+    for (int step = 0; step < 6; ++step)
+    {
+        ASSERT_NO_FATAL_FAILURE(calculate(24, flags, true));
+        const real        area   = resultArea();
+        const real        volume = resultVolume();
+        std::vector<real> atomAreas;
+        for (int i = 0; i < atomCount(); ++i)
+        {
+            atomAreas.push_back(atomArea(i));
+        }
+        ASSERT_NO_FATAL_FAILURE(calculate(24, flags, true, &calculator));
+        EXPECT_REAL_EQ_TOL(area, resultArea(), tolerance);
+        EXPECT_REAL_EQ_TOL(volume, resultVolume(), tolerance);
+        for (int i = 0; i < atomCount(); ++i)
+        {
+            EXPECT_REAL_EQ_TOL(atomAreas[i], atomArea(i), tolerance);
+        }
+        perturbPoints(0.05);
+    }
+}
+
 } // namespace